@@ -41,6 +41,7 @@ void topology_scale_freq_tick(void);
 /* Replace task scheduler's default thermal pressure API */
 #define arch_scale_thermal_pressure topology_get_thermal_pressure
 #define arch_set_thermal_pressure   topology_set_thermal_pressure
+#define arch_set_thermal_pressure_hint topology_set_thermal_pressure_hint
 
 #include <asm-generic/topology.h>
 
@@ -2351,6 +2351,32 @@ static int do_test(const char *alg, u32 type, u32 mask, int m, u32 num_mb)
 				NULL, 0, 16, 8, speed_template_16);
 		break;
 
+	case 222:
+		/* the best available driver against the generic templates */
+		test_aead_speed("ccm(aes)", ENCRYPT, sec,
+				NULL, 0, 16, 16, speed_template_16_32);
+		test_aead_speed("ccm_base(ctr(aes-generic),cbcmac(aes-generic))",
+				ENCRYPT, sec, NULL, 0, 16, 16,
+				speed_template_16_32);
+		test_aead_speed("ccm(aes)", DECRYPT, sec,
+				NULL, 0, 16, 16, speed_template_16_32);
+		test_aead_speed("ccm_base(ctr(aes-generic),cbcmac(aes-generic))",
+				DECRYPT, sec, NULL, 0, 16, 16,
+				speed_template_16_32);
+		test_aead_speed("authenc(hmac(sha256),cbc(aes))", ENCRYPT, sec,
+				authenc_sha256_aes_speed_template, 1, 32, 16,
+				aead_speed_template_56);
+		test_aead_speed("authenc(hmac(sha256-generic),cbc(aes-generic))",
+				ENCRYPT, sec, authenc_sha256_aes_speed_template,
+				1, 32, 16, aead_speed_template_56);
+		test_aead_speed("authenc(hmac(sha256),cbc(aes))", DECRYPT, sec,
+				authenc_sha256_aes_speed_template, 1, 32, 16,
+				aead_speed_template_56);
+		test_aead_speed("authenc(hmac(sha256-generic),cbc(aes-generic))",
+				DECRYPT, sec, authenc_sha256_aes_speed_template,
+				1, 32, 16, aead_speed_template_56);
+		break;
+
 	case 300:
 		if (alg) {
 			test_hash_speed(alg, sec, generic_hash_speed_template);
@@ -64,6 +64,29 @@ static u8 speed_template_32[] = {32, 0};
 static u8 aead_speed_template_19[] = {19, 0};
 static u8 aead_speed_template_20[] = {20, 0};
 static u8 aead_speed_template_36[] = {36, 0};
+static u8 aead_speed_template_56[] = {56, 0};
+
+/* authenc() key blob: rtattr, enc key length, hmac(sha256) key, aes key */
+static struct aead_speed_template authenc_sha256_aes_speed_template[] = {
+	{
+		.key	=
+#ifdef __LITTLE_ENDIAN
+			  "\x08\x00"		/* rta length */
+			  "\x01\x00"		/* rta type */
+#else
+			  "\x00\x08"		/* rta length */
+			  "\x00\x01"		/* rta type */
+#endif
+			  "\x00\x00\x00\x10"	/* enc key length */
+			  "\x00\x01\x02\x03\x04\x05\x06\x07"
+			  "\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f"
+			  "\x10\x11\x12\x13\x14\x15\x16\x17"
+			  "\x18\x19\x1a\x1b\x1c\x1d\x1e\x1f"
+			  "\x06\xa9\x21\x40\x36\xb8\xa1\x5b"
+			  "\x51\x2e\x03\xd5\x34\x12\x00\x06",
+		.klen	= 56,
+	},
+};
 
 /*
  * Digest speed tests
@@ -57,6 +57,7 @@ void topology_set_freq_scale(const struct cpumask *cpus, unsigned long cur_freq,
 }
 
 DEFINE_PER_CPU(unsigned long, cpu_scale) = SCHED_CAPACITY_SCALE;
+EXPORT_PER_CPU_SYMBOL_GPL(cpu_scale);
 
 void topology_set_cpu_scale(unsigned int cpu, unsigned long capacity)
 {
@@ -65,14 +66,43 @@ void topology_set_cpu_scale(unsigned int cpu, unsigned long capacity)
 
 DEFINE_PER_CPU(unsigned long, thermal_pressure);
 
+/*
+ * The thermal pressure seen by the scheduler is the larger of the capacity
+ * actually capped by cooling devices and the one thermal drivers predict is
+ * about to be.
+ */
+static DEFINE_PER_CPU(unsigned long, thermal_pressure_cap);
+static DEFINE_PER_CPU(unsigned long, thermal_pressure_hint);
+
+static void topology_update_thermal_pressure(int cpu)
+{
+	WRITE_ONCE(per_cpu(thermal_pressure, cpu),
+		   max(READ_ONCE(per_cpu(thermal_pressure_cap, cpu)),
+		       READ_ONCE(per_cpu(thermal_pressure_hint, cpu))));
+}
+
 void topology_set_thermal_pressure(const struct cpumask *cpus,
 			       unsigned long th_pressure)
 {
 	int cpu;
 
-	for_each_cpu(cpu, cpus)
-		WRITE_ONCE(per_cpu(thermal_pressure, cpu), th_pressure);
+	for_each_cpu(cpu, cpus) {
+		WRITE_ONCE(per_cpu(thermal_pressure_cap, cpu), th_pressure);
+		topology_update_thermal_pressure(cpu);
+	}
+}
+
+void topology_set_thermal_pressure_hint(const struct cpumask *cpus,
+					unsigned long th_pressure)
+{
+	int cpu;
+
+	for_each_cpu(cpu, cpus) {
+		WRITE_ONCE(per_cpu(thermal_pressure_hint, cpu), th_pressure);
+		topology_update_thermal_pressure(cpu);
+	}
 }
+EXPORT_SYMBOL_GPL(topology_set_thermal_pressure_hint);
 
 static ssize_t cpu_capacity_show(struct device *dev,
 				 struct device_attribute *attr,
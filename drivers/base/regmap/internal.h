@@ -164,6 +164,15 @@ struct regmap {
 
 	/* if set, the regmap core can sleep */
 	bool can_sleep;
+
+	/*
+	 * hardware accesses performed, writes skipped as no-ops and
+	 * updates folded into a preceding update of the same register
+	 */
+	unsigned long io_reads;
+	unsigned long io_writes;
+	unsigned long io_elided;
+	unsigned long io_merged;
 };
 
 struct regcache_ops {
@@ -286,8 +286,10 @@ static bool regcache_reg_needs_sync(struct regmap *map, unsigned int reg,
 
 	/* Is this the hardware default?  If so skip. */
 	ret = regcache_lookup_reg(map, reg);
-	if (ret >= 0 && val == map->reg_defaults[ret].def)
+	if (ret >= 0 && val == map->reg_defaults[ret].def) {
+		map->io_elided++;
 		return false;
+	}
 	return true;
 }
 
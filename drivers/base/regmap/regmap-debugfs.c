@@ -64,6 +64,35 @@ static const struct file_operations regmap_name_fops = {
 	.llseek = default_llseek,
 };
 
+static ssize_t regmap_io_stats_read_file(struct file *file,
+					 char __user *user_buf, size_t count,
+					 loff_t *ppos)
+{
+	struct regmap *map = file->private_data;
+	unsigned long reads, writes, elided, merged;
+	char buf[128];
+	int ret;
+
+	map->lock(map->lock_arg);
+	reads = map->io_reads;
+	writes = map->io_writes;
+	elided = map->io_elided;
+	merged = map->io_merged;
+	map->unlock(map->lock_arg);
+
+	ret = snprintf(buf, sizeof(buf),
+		       "reads: %lu\nwrites: %lu\nelided: %lu\nmerged: %lu\n",
+		       reads, writes, elided, merged);
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, ret);
+}
+
+static const struct file_operations regmap_io_stats_fops = {
+	.open = simple_open,
+	.read = regmap_io_stats_read_file,
+	.llseek = default_llseek,
+};
+
 static void regmap_debugfs_free_dump_cache(struct regmap *map)
 {
 	struct regmap_debugfs_off_cache *c;
@@ -606,6 +635,9 @@ void regmap_debugfs_init(struct regmap *map)
 	debugfs_create_file("range", 0400, map->debugfs,
 			    map, &regmap_reg_ranges_fops);
 
+	debugfs_create_file("io_stats", 0400, map->debugfs,
+			    map, &regmap_io_stats_fops);
+
 	if (map->max_register || regmap_readable(map, 0)) {
 		umode_t registers_mode;
 
@@ -13,17 +13,31 @@
 #include <linux/module.h>
 #include <linux/init.h>
 
+/* Number of SPMI commands handed to the controller at once */
+#define REGMAP_SPMI_BATCH	16
+
 static int regmap_spmi_base_read(void *context,
 				 const void *reg, size_t reg_size,
 				 void *val, size_t val_size)
 {
+	struct spmi_batch_cmd cmds[REGMAP_SPMI_BATCH];
 	u8 addr = *(u8 *)reg;
+	unsigned int n = 0;
 	int err = 0;
 
 	BUG_ON(reg_size != 1);
 
-	while (val_size-- && !err)
-		err = spmi_register_read(context, addr++, val++);
+	while (val_size-- && !err) {
+		cmds[n].opcode = SPMI_CMD_READ;
+		cmds[n].addr = addr++;
+		cmds[n].buf = val++;
+		cmds[n].len = 1;
+
+		if (++n == ARRAY_SIZE(cmds) || !val_size) {
+			err = spmi_batch(context, cmds, n);
+			n = 0;
+		}
+	}
 
 	return err;
 }
@@ -32,37 +46,34 @@ static int regmap_spmi_base_gather_write(void *context,
 					 const void *reg, size_t reg_size,
 					 const void *val, size_t val_size)
 {
+	struct spmi_batch_cmd cmds[REGMAP_SPMI_BATCH];
 	const u8 *data = val;
 	u8 addr = *(u8 *)reg;
+	unsigned int n = 0;
 	int err = 0;
 
 	BUG_ON(reg_size != 1);
 
-	/*
-	 * SPMI defines a more bandwidth-efficient 'Register 0 Write' sequence,
-	 * use it when possible.
-	 */
-	if (addr == 0 && val_size) {
-		err = spmi_register_zero_write(context, *data);
-		if (err)
-			goto err_out;
-
-		data++;
-		addr++;
+	while (val_size && !err) {
+		/*
+		 * SPMI defines a more bandwidth-efficient 'Register 0 Write'
+		 * sequence, use it when possible.
+		 */
+		if (addr == 0)
+			cmds[n].opcode = SPMI_CMD_ZERO_WRITE;
+		else
+			cmds[n].opcode = SPMI_CMD_WRITE;
+		cmds[n].addr = addr++;
+		cmds[n].wbuf = data++;
+		cmds[n].len = 1;
 		val_size--;
-	}
 
-	while (val_size) {
-		err = spmi_register_write(context, addr, *data);
-		if (err)
-			goto err_out;
-
-		data++;
-		addr++;
-		val_size--;
+		if (++n == ARRAY_SIZE(cmds) || !val_size) {
+			err = spmi_batch(context, cmds, n);
+			n = 0;
+		}
 	}
 
-err_out:
 	return err;
 }
 
@@ -102,10 +113,37 @@ struct regmap *__devm_regmap_init_spmi_base(struct spmi_device *sdev,
 }
 EXPORT_SYMBOL_GPL(__devm_regmap_init_spmi_base);
 
+/*
+ * Pick the command moving the next chunk of a block access and return the
+ * size of that chunk: the more bandwidth-efficient 'Extended Register'
+ * commands while the address fits in 8 bits, their 'Long' variants above,
+ * each carrying as many bytes as the controller accepts.
+ */
+static size_t regmap_spmi_ext_chunk(struct spmi_device *sdev, u16 addr,
+				    size_t val_size, bool write, u8 *opcode)
+{
+	size_t len;
+
+	if (addr <= 0xFF) {
+		*opcode = write ? SPMI_CMD_EXT_WRITE : SPMI_CMD_EXT_READ;
+		len = spmi_max_xfer_len(sdev, *opcode);
+
+		/* Don't wrap around the 8-bit address space */
+		len = min_t(size_t, len, 0x100 - addr);
+	} else {
+		*opcode = write ? SPMI_CMD_EXT_WRITEL : SPMI_CMD_EXT_READL;
+		len = spmi_max_xfer_len(sdev, *opcode);
+	}
+
+	return min(len, val_size);
+}
+
 static int regmap_spmi_ext_read(void *context,
 				const void *reg, size_t reg_size,
 				void *val, size_t val_size)
 {
+	struct spmi_batch_cmd cmds[REGMAP_SPMI_BATCH];
+	unsigned int n = 0;
 	int err = 0;
 	size_t len;
 	u16 addr;
@@ -114,35 +152,23 @@ static int regmap_spmi_ext_read(void *context,
 
 	addr = *(u16 *)reg;
 
-	/*
-	 * Split accesses into two to take advantage of the more
-	 * bandwidth-efficient 'Extended Register Read' command when possible
-	 */
-	while (addr <= 0xFF && val_size) {
-		len = min_t(size_t, val_size, 16);
-
-		err = spmi_ext_register_read(context, addr, val, len);
-		if (err)
-			goto err_out;
+	while (val_size && !err) {
+		len = regmap_spmi_ext_chunk(context, addr, val_size, false,
+					    &cmds[n].opcode);
+		cmds[n].addr = addr;
+		cmds[n].buf = val;
+		cmds[n].len = len;
 
 		addr += len;
 		val += len;
 		val_size -= len;
-	}
-
-	while (val_size) {
-		len = min_t(size_t, val_size, 8);
-
-		err = spmi_ext_register_readl(context, addr, val, len);
-		if (err)
-			goto err_out;
 
-		addr += len;
-		val += len;
-		val_size -= len;
+		if (++n == ARRAY_SIZE(cmds) || !val_size) {
+			err = spmi_batch(context, cmds, n);
+			n = 0;
+		}
 	}
 
-err_out:
 	return err;
 }
 
@@ -150,6 +176,8 @@ static int regmap_spmi_ext_gather_write(void *context,
 					const void *reg, size_t reg_size,
 					const void *val, size_t val_size)
 {
+	struct spmi_batch_cmd cmds[REGMAP_SPMI_BATCH];
+	unsigned int n = 0;
 	int err = 0;
 	size_t len;
 	u16 addr;
@@ -158,31 +186,23 @@ static int regmap_spmi_ext_gather_write(void *context,
 
 	addr = *(u16 *)reg;
 
-	while (addr <= 0xFF && val_size) {
-		len = min_t(size_t, val_size, 16);
-
-		err = spmi_ext_register_write(context, addr, val, len);
-		if (err)
-			goto err_out;
+	while (val_size && !err) {
+		len = regmap_spmi_ext_chunk(context, addr, val_size, true,
+					    &cmds[n].opcode);
+		cmds[n].addr = addr;
+		cmds[n].wbuf = val;
+		cmds[n].len = len;
 
 		addr += len;
 		val += len;
 		val_size -= len;
-	}
-
-	while (val_size) {
-		len = min_t(size_t, val_size, 8);
-
-		err = spmi_ext_register_writel(context, addr, val, len);
-		if (err)
-			goto err_out;
 
-		addr += len;
-		val += len;
-		val_size -= len;
+		if (++n == ARRAY_SIZE(cmds) || !val_size) {
+			err = spmi_batch(context, cmds, n);
+			n = 0;
+		}
 	}
 
-err_out:
 	return err;
 }
 
@@ -1930,6 +1930,7 @@ int _regmap_write(struct regmap *map, unsigned int reg,
 			dev_info(map->dev, "%x <= %x\n", reg, val);
 
 		trace_regmap_reg_write(map, reg, val);
+		map->io_writes++;
 	}
 
 	return ret;
@@ -2028,6 +2029,9 @@ int _regmap_raw_write(struct regmap *map, unsigned int reg,
 	if (val_len)
 		ret = _regmap_raw_write_impl(map, reg, val, val_len, noinc);
 
+	if (ret == 0 && !map->cache_only)
+		map->io_writes += val_count;
+
 	return ret;
 }
 
@@ -2695,6 +2699,7 @@ static int _regmap_read(struct regmap *map, unsigned int reg,
 			dev_info(map->dev, "%x => %x\n", reg, *val);
 
 		trace_regmap_reg_read(map, reg, *val);
+		map->io_reads++;
 
 		if (!map->cache_bypass)
 			regcache_write(map, reg, *val);
@@ -3040,6 +3045,8 @@ static int _regmap_update_bits(struct regmap *map, unsigned int reg,
 			ret = _regmap_write(map, reg, tmp);
 			if (ret == 0 && change)
 				*change = true;
+		} else {
+			map->io_elided++;
 		}
 	}
 
@@ -3088,6 +3095,62 @@ int regmap_update_bits_base(struct regmap *map, unsigned int reg,
 }
 EXPORT_SYMBOL_GPL(regmap_update_bits_base);
 
+/**
+ * regmap_multi_reg_update_bits() - Perform a sequence of read/modify/write
+ *                                  cycles as a single transaction
+ *
+ * @map: Register map to update
+ * @updates: Array of structures containing register, mask and value
+ * @num_updates: Number of updates in the array
+ *
+ * Apply the updates in order with the register map locked once, so that
+ * no other user of the map can interleave accesses with them.  Consecutive
+ * updates of the same register are combined into a single read/modify/write
+ * cycle, and as with regmap_update_bits() registers which already hold their
+ * new value are not written, so updates of cached registers that don't
+ * change anything cause no I/O at all.
+ *
+ * A value of zero will be returned on success, a negative errno will be
+ * returned in error cases.  The updates preceding a failing one remain
+ * applied.
+ */
+int regmap_multi_reg_update_bits(struct regmap *map,
+				 const struct reg_update *updates,
+				 int num_updates)
+{
+	unsigned int reg, mask, val;
+	int ret = 0;
+	int i, j;
+
+	for (i = 0; i < num_updates; i++)
+		if (!IS_ALIGNED(updates[i].reg, map->reg_stride))
+			return -EINVAL;
+
+	map->lock(map->lock_arg);
+
+	for (i = 0; i < num_updates; i = j) {
+		reg = updates[i].reg;
+		mask = updates[i].mask;
+		val = updates[i].val & mask;
+
+		for (j = i + 1; j < num_updates && updates[j].reg == reg; j++) {
+			mask |= updates[j].mask;
+			val &= ~updates[j].mask;
+			val |= updates[j].val & updates[j].mask;
+			map->io_merged++;
+		}
+
+		ret = _regmap_update_bits(map, reg, mask, val, NULL, false);
+		if (ret != 0)
+			break;
+	}
+
+	map->unlock(map->lock_arg);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(regmap_multi_reg_update_bits);
+
 /**
  * regmap_test_bits() - Check if all specified bits are set in a register.
  *
@@ -3858,6 +3858,7 @@ static struct gdsc venus_gdsc = {
 		.name = "venus",
 	},
 	.pwrsts = PWRSTS_OFF_ON,
+	.flags = LATENCY_GOV | ASYNC_RESUME,
 };
 
 static struct gdsc venus_core0_gdsc = {
@@ -3865,7 +3866,7 @@ static struct gdsc venus_core0_gdsc = {
 	.pd = {
 		.name = "venus_core0",
 	},
-	.flags = HW_CTRL,
+	.flags = HW_CTRL | LATENCY_GOV | ASYNC_RESUME,
 	.pwrsts = PWRSTS_OFF_ON,
 };
 
@@ -3875,6 +3876,7 @@ static struct gdsc mdss_gdsc = {
 		.name = "mdss",
 	},
 	.pwrsts = PWRSTS_OFF_ON,
+	.flags = LATENCY_GOV | ASYNC_RESUME,
 };
 
 static struct gdsc jpeg_gdsc = {
@@ -3883,6 +3885,7 @@ static struct gdsc jpeg_gdsc = {
 		.name = "jpeg",
 	},
 	.pwrsts = PWRSTS_OFF_ON,
+	.flags = LATENCY_GOV | ASYNC_RESUME,
 };
 
 static struct gdsc vfe0_gdsc = {
@@ -3891,6 +3894,7 @@ static struct gdsc vfe0_gdsc = {
 		.name = "vfe0",
 	},
 	.pwrsts = PWRSTS_OFF_ON,
+	.flags = LATENCY_GOV | ASYNC_RESUME,
 };
 
 static struct gdsc vfe1_gdsc = {
@@ -3899,6 +3903,7 @@ static struct gdsc vfe1_gdsc = {
 		.name = "vfe1",
 	},
 	.pwrsts = PWRSTS_OFF_ON,
+	.flags = LATENCY_GOV | ASYNC_RESUME,
 };
 
 static struct gdsc oxili_gx_gdsc = {
@@ -3908,7 +3913,7 @@ static struct gdsc oxili_gx_gdsc = {
 		.name = "oxili_gx",
 	},
 	.pwrsts = PWRSTS_OFF_ON,
-	.flags = CLAMP_IO,
+	.flags = CLAMP_IO | LATENCY_GOV | ASYNC_RESUME,
 };
 
 static struct gdsc oxili_cx_gdsc = {
@@ -3917,6 +3922,7 @@ static struct gdsc oxili_cx_gdsc = {
 		.name = "oxili_cx",
 	},
 	.pwrsts = PWRSTS_OFF_ON,
+	.flags = LATENCY_GOV | ASYNC_RESUME,
 };
 
 static struct gdsc cpp_gdsc = {
@@ -4,6 +4,7 @@
  */
 
 #include <linux/bitops.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/err.h>
 #include <linux/export.h>
@@ -14,6 +15,7 @@
 #include <linux/regmap.h>
 #include <linux/regulator/consumer.h>
 #include <linux/reset-controller.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include "gdsc.h"
 
@@ -323,8 +325,58 @@ static int gdsc_disable(struct generic_pm_domain *domain)
 	return 0;
 }
 
+static void gdsc_account(struct gdsc_latency *lat, ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	lat->count++;
+	lat->last_ns = ns;
+	lat->max_ns = max(lat->max_ns, ns);
+	lat->total_ns += ns;
+}
+
+static int gdsc_power_on(struct generic_pm_domain *domain)
+{
+	struct gdsc *sc = domain_to_gdsc(domain);
+	ktime_t start = ktime_get();
+	int ret;
+
+	ret = gdsc_enable(domain);
+	if (!ret)
+		gdsc_account(&sc->on_latency, start);
+
+	return ret;
+}
+
+static int gdsc_power_off(struct generic_pm_domain *domain)
+{
+	struct gdsc *sc = domain_to_gdsc(domain);
+	ktime_t start = ktime_get();
+	int ret;
+
+	ret = gdsc_disable(domain);
+	if (!ret)
+		gdsc_account(&sc->off_latency, start);
+
+	return ret;
+}
+
+/*
+ * genpd powers a domain back on from the system resume callbacks of the
+ * first of its devices to resume. Resuming these devices asynchronously lets
+ * independent domains power up in parallel instead of one after another.
+ */
+static int gdsc_attach_dev(struct generic_pm_domain *domain,
+			   struct device *dev)
+{
+	device_enable_async_suspend(dev);
+
+	return 0;
+}
+
 static int gdsc_init(struct gdsc *sc)
 {
+	struct dev_power_governor *gov = NULL;
 	u32 mask, val;
 	int on, ret;
 
@@ -380,14 +432,85 @@ static int gdsc_init(struct gdsc *sc)
 		gdsc_clear_mem_on(sc);
 
 	if (!sc->pd.power_off)
-		sc->pd.power_off = gdsc_disable;
+		sc->pd.power_off = gdsc_power_off;
 	if (!sc->pd.power_on)
-		sc->pd.power_on = gdsc_enable;
-	pm_genpd_init(&sc->pd, NULL, !on);
+		sc->pd.power_on = gdsc_power_on;
+	if ((sc->flags & ASYNC_RESUME) && !sc->pd.attach_dev)
+		sc->pd.attach_dev = gdsc_attach_dev;
+
+	/*
+	 * With a governor genpd measures the on/off latencies of the domain,
+	 * and only powers it down when they fit the QoS constraints of its
+	 * devices. simple_qos_governor isn't exported, so modular builds go
+	 * without.
+	 */
+	if ((sc->flags & LATENCY_GOV) && IS_BUILTIN(CONFIG_COMMON_CLK_QCOM))
+		gov = &simple_qos_governor;
+
+	pm_genpd_init(&sc->pd, gov, !on);
 
 	return 0;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static void gdsc_latency_show(struct seq_file *s, const char *name,
+			      const struct gdsc_latency *lat)
+{
+	seq_printf(s, "%s: count %llu last %llu ns max %llu ns avg %llu ns\n",
+		   name, lat->count, lat->last_ns, lat->max_ns,
+		   lat->count ? div64_u64(lat->total_ns, lat->count) : 0);
+}
+
+static int gdsc_timing_show(struct seq_file *s, void *unused)
+{
+	struct gdsc *sc = s->private;
+	struct genpd_power_state *state;
+
+	gdsc_latency_show(s, "on", &sc->on_latency);
+	gdsc_latency_show(s, "off", &sc->off_latency);
+
+	if (sc->pd.gov) {
+		state = &sc->pd.states[sc->pd.state_idx];
+		seq_printf(s, "governor: on %lld ns off %lld ns\n",
+			   state->power_on_latency_ns,
+			   state->power_off_latency_ns);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(gdsc_timing);
+
+static void gdsc_debugfs_init(struct gdsc_desc *desc)
+{
+	struct dentry *root;
+	int i;
+
+	/* The root is shared by all clock controllers providing GDSCs */
+	root = debugfs_lookup("qcom_gdsc", NULL);
+	if (!root) {
+		root = debugfs_create_dir("qcom_gdsc", NULL);
+		if (IS_ERR(root))
+			return;
+		dget(root);
+	}
+
+	desc->debugfs = debugfs_create_dir(dev_name(desc->dev), root);
+	dput(root);
+
+	for (i = 0; i < desc->num; i++) {
+		if (!desc->scs[i])
+			continue;
+
+		debugfs_create_file(desc->scs[i]->pd.name, 0400, desc->debugfs,
+				    desc->scs[i], &gdsc_timing_fops);
+	}
+}
+#else
+static void gdsc_debugfs_init(struct gdsc_desc *desc)
+{
+}
+#endif
+
 int gdsc_register(struct gdsc_desc *desc,
 		  struct reset_controller_dev *rcdev, struct regmap *regmap)
 {
@@ -435,7 +558,13 @@ int gdsc_register(struct gdsc_desc *desc,
 			pm_genpd_add_subdomain(scs[i]->parent, &scs[i]->pd);
 	}
 
-	return of_genpd_add_provider_onecell(dev->of_node, data);
+	ret = of_genpd_add_provider_onecell(dev->of_node, data);
+	if (ret)
+		return ret;
+
+	gdsc_debugfs_init(desc);
+
+	return 0;
 }
 
 void gdsc_unregister(struct gdsc_desc *desc)
@@ -445,6 +574,8 @@ void gdsc_unregister(struct gdsc_desc *desc)
 	struct gdsc **scs = desc->scs;
 	size_t num = desc->num;
 
+	debugfs_remove_recursive(desc->debugfs);
+
 	/* Remove subdomains */
 	for (i = 0; i < num; i++) {
 		if (!scs[i])
@@ -9,10 +9,25 @@
 #include <linux/err.h>
 #include <linux/pm_domain.h>
 
+struct dentry;
 struct regmap;
 struct regulator;
 struct reset_controller_dev;
 
+/**
+ * struct gdsc_latency - measured latency of a GDSC power transition
+ * @count: number of transitions
+ * @last_ns: duration of the last transition
+ * @max_ns: duration of the longest transition
+ * @total_ns: accumulated duration of all transitions
+ */
+struct gdsc_latency {
+	u64 count;
+	u64 last_ns;
+	u64 max_ns;
+	u64 total_ns;
+};
+
 /**
  * struct gdsc - Globally Distributed Switch Controller
  * @pd: generic power domain
@@ -25,6 +40,8 @@ struct reset_controller_dev;
  * @resets: ids of resets associated with this gdsc
  * @reset_count: number of @resets
  * @rcdev: reset controller
+ * @on_latency: measured latency of powering the GDSC on
+ * @off_latency: measured latency of powering the GDSC off
  */
 struct gdsc {
 	struct generic_pm_domain	pd;
@@ -42,7 +59,7 @@ struct gdsc {
 #define PWRSTS_ON		BIT(2)
 #define PWRSTS_OFF_ON		(PWRSTS_OFF | PWRSTS_ON)
 #define PWRSTS_RET_ON		(PWRSTS_RET | PWRSTS_ON)
-	const u8			flags;
+	const u16			flags;
 #define VOTABLE		BIT(0)
 #define CLAMP_IO	BIT(1)
 #define HW_CTRL		BIT(2)
@@ -51,18 +68,24 @@ struct gdsc {
 #define POLL_CFG_GDSCR	BIT(5)
 #define ALWAYS_ON	BIT(6)
 #define RETAIN_FF_ENABLE	BIT(7)
+#define LATENCY_GOV	BIT(8)
+#define ASYNC_RESUME	BIT(9)
 	struct reset_controller_dev	*rcdev;
 	unsigned int			*resets;
 	unsigned int			reset_count;
 
 	const char 			*supply;
 	struct regulator		*rsupply;
+
+	struct gdsc_latency		on_latency;
+	struct gdsc_latency		off_latency;
 };
 
 struct gdsc_desc {
 	struct device *dev;
 	struct gdsc **scs;
 	size_t num;
+	struct dentry *debugfs;
 };
 
 #ifdef CONFIG_QCOM_GDSC
@@ -6,9 +6,14 @@
  * SAW power controller driver
  */
 
+#include <linux/debugfs.h>
 #include <linux/kernel.h>
 #include <linux/init.h>
+#include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/moduleparam.h>
 #include <linux/slab.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
@@ -18,6 +23,8 @@
 #include <linux/cpuidle.h>
 #include <linux/cpu_pm.h>
 #include <linux/qcom_scm.h>
+#include <linux/sched/clock.h>
+#include <linux/seq_file.h>
 
 #include <asm/proc-fns.h>
 #include <asm/suspend.h>
@@ -34,6 +41,9 @@
 #define SPM_CTL_INDEX_SHIFT	4
 #define SPM_CTL_EN		BIT(0)
 
+/* log2(us) residency buckets, the last one is open ended */
+#define SPM_HIST_BUCKETS	16
+
 enum pm_sleep_mode {
 	PM_SLEEP_MODE_STBY,
 	PM_SLEEP_MODE_RET,
@@ -67,12 +77,49 @@ struct spm_reg_data {
 	u8 start_index[PM_SLEEP_MODE_NR];
 };
 
+enum spm_wakeup_src {
+	SPM_WAKEUP_TIMER,
+	SPM_WAKEUP_IRQ,
+	SPM_WAKEUP_ABORT,
+	SPM_WAKEUP_NR,
+};
+
+static const char * const spm_wakeup_src_names[SPM_WAKEUP_NR] = {
+	[SPM_WAKEUP_TIMER]	= "timer",
+	[SPM_WAKEUP_IRQ]	= "irq",
+	[SPM_WAKEUP_ABORT]	= "abort",
+};
+
+/**
+ * struct spm_idle_stats - idle statistics of one cpu
+ * @residency: observed residency histogram per idle state
+ * @wakeup: wakeup source counts per idle state
+ * @demoted: power collapse requests demoted to WFI by the irq prediction
+ * @too_deep: power collapses that did not reach their target residency
+ * @too_shallow: demotions after which the cpu stayed idle long enough for
+ *		 power collapse
+ *
+ * Only ever updated by the owning cpu from its idle loop, readers live with
+ * a possibly torn snapshot.
+ */
+struct spm_idle_stats {
+	u64 residency[CPUIDLE_STATE_MAX][SPM_HIST_BUCKETS];
+	u64 wakeup[CPUIDLE_STATE_MAX][SPM_WAKEUP_NR];
+	u64 demoted;
+	u64 too_deep;
+	u64 too_shallow;
+};
+
 struct spm_driver_data {
 	struct cpuidle_driver cpuidle_driver;
 	void __iomem *reg_base;
 	const struct spm_reg_data *reg_data;
+	struct spm_idle_stats stats;
+	struct dentry *debugfs;
 };
 
+static struct dentry *spm_debugfs_root;
+
 static const u32 spm_reg_offset_v2_1[SPM_REG_NR] = {
 	[SPM_REG_CFG]		= 0x08,
 	[SPM_REG_SPM_CTL]	= 0x30,
@@ -213,13 +260,120 @@ static int qcom_cpu_spc(struct spm_driver_data *drv)
 	return ret;
 }
 
+#ifdef CONFIG_IRQ_TIMINGS
+static bool spm_predict_irq;
+
+static int spm_predict_irq_set(const char *val, const struct kernel_param *kp)
+{
+	bool enable;
+	int ret;
+
+	ret = kstrtobool(val, &enable);
+	if (ret)
+		return ret;
+
+	if (enable == spm_predict_irq)
+		return 0;
+
+	if (enable)
+		irq_timings_enable();
+	else
+		irq_timings_disable();
+	spm_predict_irq = enable;
+
+	return 0;
+}
+
+static const struct kernel_param_ops spm_predict_irq_ops = {
+	.set = spm_predict_irq_set,
+	.get = param_get_bool,
+};
+module_param_cb(predict_irq, &spm_predict_irq_ops, &spm_predict_irq, 0644);
+MODULE_PARM_DESC(predict_irq,
+		 "Demote power collapse to WFI when an interrupt is predicted within the target residency");
+
+/*
+ * Use the interrupt timings to check whether one of the periodic interrupt
+ * sources is expected to fire before the state would pay off. The governor
+ * only knows about timers, so a periodic device interrupt (e.g. BAM or IPA
+ * completions) otherwise makes it pick power collapse over and over again.
+ */
+static bool spm_irq_predicted(struct cpuidle_driver *drv, int idx)
+{
+	u64 now, next;
+
+	if (!spm_predict_irq)
+		return false;
+
+	now = local_clock();
+	next = irq_timings_next_event(now);
+	if (next == U64_MAX || next < now)
+		return false;
+
+	return next - now < drv->states[idx].target_residency_ns;
+}
+#else
+static inline bool spm_irq_predicted(struct cpuidle_driver *drv, int idx)
+{
+	return false;
+}
+#endif
+
+static void spm_account_idle(struct spm_driver_data *data,
+			     struct cpuidle_device *dev, int idx, int ret,
+			     u64 start, u64 end, bool demoted)
+{
+	struct spm_idle_stats *stats = &data->stats;
+	struct cpuidle_driver *drv = &data->cpuidle_driver;
+	u64 next_timer = READ_ONCE(dev->next_hrtimer);
+	u64 residency = end - start;
+	unsigned int bucket;
+	u64 us;
+
+	if (ret < 0) {
+		stats->wakeup[idx][SPM_WAKEUP_ABORT]++;
+		return;
+	}
+
+	us = div_u64(residency, NSEC_PER_USEC);
+	bucket = us ? ilog2(us) + 1 : 0;
+	stats->residency[ret][min_t(unsigned int, bucket,
+				    SPM_HIST_BUCKETS - 1)]++;
+
+	if (next_timer && end >= next_timer)
+		stats->wakeup[ret][SPM_WAKEUP_TIMER]++;
+	else
+		stats->wakeup[ret][SPM_WAKEUP_IRQ]++;
+
+	if (demoted) {
+		stats->demoted++;
+		if (residency >= drv->states[idx].target_residency_ns)
+			stats->too_shallow++;
+	} else if (ret > 0 &&
+		   residency < drv->states[ret].target_residency_ns) {
+		stats->too_deep++;
+	}
+}
+
 static int spm_enter_idle_state(struct cpuidle_device *dev,
 				struct cpuidle_driver *drv, int idx)
 {
 	struct spm_driver_data *data = container_of(drv, struct spm_driver_data,
 						    cpuidle_driver);
+	bool demoted = false;
+	u64 start, end;
+	int ret;
+
+	if (idx && spm_irq_predicted(drv, idx))
+		demoted = true;
+
+	start = ktime_get_mono_fast_ns();
+	ret = CPU_PM_CPU_IDLE_ENTER_PARAM(qcom_cpu_spc, demoted ? 0 : idx, data);
+	end = ktime_get_mono_fast_ns();
+
+	spm_account_idle(data, dev, idx, ret, start, end, demoted);
 
-	return CPU_PM_CPU_IDLE_ENTER_PARAM(qcom_cpu_spc, idx, data);
+	return ret;
 }
 
 static struct cpuidle_driver qcom_spm_idle_driver = {
@@ -235,6 +389,94 @@ static struct cpuidle_driver qcom_spm_idle_driver = {
 	}
 };
 
+static int residency_hist_show(struct seq_file *s, void *unused)
+{
+	struct spm_driver_data *drv = s->private;
+	struct spm_idle_stats *stats = &drv->stats;
+	int i, j;
+
+	seq_printf(s, "%-8s", "us");
+	for (i = 0; i < drv->cpuidle_driver.state_count; i++)
+		seq_printf(s, " %12s", drv->cpuidle_driver.states[i].name);
+	seq_putc(s, '\n');
+
+	for (j = 0; j < SPM_HIST_BUCKETS; j++) {
+		seq_printf(s, "%s%-7lu", j == SPM_HIST_BUCKETS - 1 ? ">=" : "<",
+			   j == SPM_HIST_BUCKETS - 1 ? BIT(j - 1) : BIT(j));
+		for (i = 0; i < drv->cpuidle_driver.state_count; i++)
+			seq_printf(s, " %12llu",
+				   READ_ONCE(stats->residency[i][j]));
+		seq_putc(s, '\n');
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(residency_hist);
+
+static int wakeup_sources_show(struct seq_file *s, void *unused)
+{
+	struct spm_driver_data *drv = s->private;
+	struct spm_idle_stats *stats = &drv->stats;
+	int i, j;
+
+	seq_printf(s, "%-8s", "state");
+	for (j = 0; j < SPM_WAKEUP_NR; j++)
+		seq_printf(s, " %12s", spm_wakeup_src_names[j]);
+	seq_putc(s, '\n');
+
+	for (i = 0; i < drv->cpuidle_driver.state_count; i++) {
+		seq_printf(s, "%-8s", drv->cpuidle_driver.states[i].name);
+		for (j = 0; j < SPM_WAKEUP_NR; j++)
+			seq_printf(s, " %12llu",
+				   READ_ONCE(stats->wakeup[i][j]));
+		seq_putc(s, '\n');
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(wakeup_sources);
+
+/* The histograms are tables, expose them in debugfs rather than sysfs */
+static void spm_debugfs_init(struct platform_device *pdev,
+			     struct spm_driver_data *drv)
+{
+	if (!spm_debugfs_root)
+		spm_debugfs_root = debugfs_create_dir("qcom_spm", NULL);
+
+	drv->debugfs = debugfs_create_dir(dev_name(&pdev->dev),
+					  spm_debugfs_root);
+	debugfs_create_file("residency_hist", 0400, drv->debugfs, drv,
+			    &residency_hist_fops);
+	debugfs_create_file("wakeup_sources", 0400, drv->debugfs, drv,
+			    &wakeup_sources_fops);
+}
+
+#define SPM_STAT_ATTR(_name)						\
+static ssize_t _name##_show(struct device *dev,				\
+			    struct device_attribute *attr, char *buf)	\
+{									\
+	struct spm_driver_data *drv = dev_get_drvdata(dev);		\
+									\
+	return sprintf(buf, "%llu\n", READ_ONCE(drv->stats._name));	\
+}									\
+static DEVICE_ATTR_RO(_name)
+
+SPM_STAT_ATTR(demoted);
+SPM_STAT_ATTR(too_deep);
+SPM_STAT_ATTR(too_shallow);
+
+static struct attribute *spm_stats_attrs[] = {
+	&dev_attr_demoted.attr,
+	&dev_attr_too_deep.attr,
+	&dev_attr_too_shallow.attr,
+	NULL,
+};
+
+static const struct attribute_group spm_stats_group = {
+	.name = "idle_stats",
+	.attrs = spm_stats_attrs,
+};
+
 static const struct of_device_id qcom_idle_state_match[] = {
 	{ .compatible = "qcom,idle-state-spc", .data = spm_enter_idle_state },
 	{ },
@@ -351,13 +593,24 @@ static int spm_dev_probe(struct platform_device *pdev)
 	/* Set up Standby as the default low power mode */
 	spm_set_low_power_mode(drv, PM_SLEEP_MODE_STBY);
 
-	return cpuidle_register(&drv->cpuidle_driver, NULL);
+	ret = devm_device_add_group(&pdev->dev, &spm_stats_group);
+	if (ret)
+		return ret;
+
+	spm_debugfs_init(pdev, drv);
+
+	ret = cpuidle_register(&drv->cpuidle_driver, NULL);
+	if (ret)
+		debugfs_remove_recursive(drv->debugfs);
+
+	return ret;
 }
 
 static int spm_dev_remove(struct platform_device *pdev)
 {
 	struct spm_driver_data *drv = platform_get_drvdata(pdev);
 
+	debugfs_remove_recursive(drv->debugfs);
 	cpuidle_unregister(&drv->cpuidle_driver);
 	return 0;
 }
@@ -0,0 +1,741 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2021, The Linux Foundation. All rights reserved.
+ */
+
+#include <linux/dma-mapping.h>
+#include <linux/interrupt.h>
+#include <linux/slab.h>
+#include <linux/types.h>
+#include <asm/unaligned.h>
+#include <crypto/aes.h>
+#include <crypto/algapi.h>
+#include <crypto/gcm.h>
+#include <crypto/scatterwalk.h>
+#include <crypto/sha1.h>
+#include <crypto/sha2.h>
+
+#include "aead.h"
+
+#define CCM_NONCE_ADATA_SHIFT		6
+#define CCM_NONCE_AUTHSIZE_SHIFT	3
+#define CCM_RFC4309_IV_SIZE		8
+
+/* ENCR_SEG_START is 16 bits wide and holds the formatted aad length */
+#define QCE_AEAD_MAX_ASSOCLEN		(U16_MAX - 2 * AES_BLOCK_SIZE)
+
+static LIST_HEAD(aead_algs);
+
+static const u32 std_iv_sha1[SHA256_DIGEST_SIZE / sizeof(u32)] = {
+	SHA1_H0, SHA1_H1, SHA1_H2, SHA1_H3, SHA1_H4, 0, 0, 0
+};
+
+static const u32 std_iv_sha256[SHA256_DIGEST_SIZE / sizeof(u32)] = {
+	SHA256_H0, SHA256_H1, SHA256_H2, SHA256_H3,
+	SHA256_H4, SHA256_H5, SHA256_H6, SHA256_H7
+};
+
+static void qce_aead_done(void *data)
+{
+	struct crypto_async_request *async_req = data;
+	struct aead_request *req = aead_request_cast(async_req);
+	struct qce_aead_reqctx *rctx = aead_request_ctx(req);
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct qce_alg_template *tmpl = to_aead_tmpl(tfm);
+	struct qce_device *qce = tmpl->qce;
+	struct qce_result_dump *result_buf = qce->dma.result_buf;
+	unsigned int authsize = crypto_aead_authsize(tfm);
+	unsigned int totallen = req->assoclen + rctx->cryptlen;
+	u8 tag[SHA256_DIGEST_SIZE];
+	u32 status;
+	int error;
+
+	error = qce_dma_terminate_all(&qce->dma);
+	if (error)
+		dev_dbg(qce->dev, "aead dma termination error (%d)\n", error);
+
+	dma_unmap_sg(qce->dev, rctx->src_sg, rctx->src_nents, DMA_TO_DEVICE);
+	dma_unmap_sg(qce->dev, rctx->dst_sg, rctx->dst_nents, DMA_FROM_DEVICE);
+
+	error = qce_check_status(qce, &status);
+	if (error == -ENXIO)
+		dev_dbg(qce->dev, "aead operation error (%x)\n", status);
+
+	/*
+	 * ccm streams its tag out behind the payload and flags a mismatch in
+	 * the status register; the hmac of authenc is only available from the
+	 * result dump.
+	 */
+	if (!error && !IS_CCM(rctx->flags)) {
+		if (IS_ENCRYPT(rctx->flags)) {
+			scatterwalk_map_and_copy(result_buf->auth_iv, req->dst,
+						 totallen, authsize, 1);
+		} else {
+			scatterwalk_map_and_copy(tag, req->src, totallen,
+						 authsize, 0);
+			if (crypto_memneq(result_buf->auth_iv, tag, authsize))
+				error = -EBADMSG;
+		}
+	}
+
+	qce->async_req_done(qce, error);
+}
+
+static int qce_aead_prepare_buf(struct aead_request *req, gfp_t gfp)
+{
+	struct qce_aead_reqctx *rctx = aead_request_ctx(req);
+	struct qce_alg_template *tmpl = to_aead_tmpl(crypto_aead_reqtfm(req));
+	struct qce_device *qce = tmpl->qce;
+	unsigned int totallen = req->assoclen + rctx->cryptlen;
+	struct scatterlist *sg;
+	int nents, ret;
+
+	nents = sg_nents_for_len(req->src, totallen);
+	if (nents < 0) {
+		dev_err(qce->dev, "Invalid numbers of src SG.\n");
+		return nents;
+	}
+
+	ret = sg_alloc_table(&rctx->src_tbl, nents, gfp);
+	if (ret)
+		return ret;
+
+	sg = qce_sgtable_add(&rctx->src_tbl, req->src, totallen);
+	if (IS_ERR(sg)) {
+		ret = PTR_ERR(sg);
+		goto error_free_src;
+	}
+	sg_mark_end(sg);
+	rctx->src_sg = rctx->src_tbl.sgl;
+	rctx->src_nents = nents;
+
+	nents = sg_nents_for_len(req->dst, totallen);
+	if (nents < 0) {
+		dev_err(qce->dev, "Invalid numbers of dst SG.\n");
+		ret = nents;
+		goto error_free_src;
+	}
+
+	/* the result dump carries the hmac */
+	ret = sg_alloc_table(&rctx->dst_tbl, nents + 1, gfp);
+	if (ret)
+		goto error_free_src;
+
+	sg = qce_sgtable_add(&rctx->dst_tbl, req->dst, totallen);
+	if (IS_ERR(sg)) {
+		ret = PTR_ERR(sg);
+		goto error_free_dst;
+	}
+
+	sg_init_one(&rctx->result_sg, qce->dma.result_buf, QCE_RESULT_BUF_SZ);
+	sg = qce_sgtable_add(&rctx->dst_tbl, &rctx->result_sg,
+			     QCE_RESULT_BUF_SZ);
+	if (IS_ERR(sg)) {
+		ret = PTR_ERR(sg);
+		goto error_free_dst;
+	}
+	sg_mark_end(sg);
+	rctx->dst_sg = rctx->dst_tbl.sgl;
+	rctx->dst_nents = nents + 1;
+
+	return 0;
+
+error_free_dst:
+	sg_free_table(&rctx->dst_tbl);
+error_free_src:
+	sg_free_table(&rctx->src_tbl);
+	return ret;
+}
+
+/*
+ * The engine expects the ccm associated data already formatted as in
+ * RFC 3610: a length header followed by the data, zero padded to a full
+ * block. The same amount of data comes back out of the engine, so a second
+ * buffer of the same size absorbs it and keeps req->dst untouched.
+ */
+static int qce_aead_ccm_prepare_adata(struct aead_request *req, gfp_t gfp)
+{
+	struct qce_aead_reqctx *rctx = aead_request_ctx(req);
+	unsigned int aad_len = rctx->assoclen;
+	unsigned int hdr_len, adata_len;
+
+	if (!aad_len)
+		return 0;
+
+	hdr_len = aad_len < 0xff00 ? 2 : 6;
+	adata_len = ALIGN(hdr_len + aad_len, AES_BLOCK_SIZE);
+
+	rctx->adata = kzalloc(2 * adata_len, gfp);
+	if (!rctx->adata)
+		return -ENOMEM;
+
+	if (hdr_len == 2) {
+		put_unaligned_be16(aad_len, rctx->adata);
+	} else {
+		put_unaligned_be16(0xfffe, rctx->adata);
+		put_unaligned_be32(aad_len, rctx->adata + 2);
+	}
+	scatterwalk_map_and_copy(rctx->adata + hdr_len, req->src, 0, aad_len,
+				 0);
+
+	sg_init_one(&rctx->adata_sg, rctx->adata, adata_len);
+	sg_init_one(&rctx->adata_out_sg, rctx->adata + adata_len, adata_len);
+	rctx->assoclen = adata_len;
+
+	return 0;
+}
+
+static int qce_aead_ccm_prepare_buf(struct aead_request *req, gfp_t gfp)
+{
+	struct qce_aead_reqctx *rctx = aead_request_ctx(req);
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct qce_alg_template *tmpl = to_aead_tmpl(tfm);
+	struct qce_device *qce = tmpl->qce;
+	unsigned int authsize = crypto_aead_authsize(tfm);
+	unsigned int inlen = rctx->cryptlen, outlen = rctx->cryptlen;
+	struct scatterlist *msg_src, *msg_dst, *sg;
+	int src_nents, dst_nents, ret;
+
+	/* the tag goes in with the ciphertext, or comes out after it */
+	if (IS_DECRYPT(rctx->flags))
+		inlen += authsize;
+	else
+		outlen += authsize;
+
+	ret = qce_aead_ccm_prepare_adata(req, gfp);
+	if (ret)
+		return ret;
+
+	msg_src = scatterwalk_ffwd(rctx->src_ffwd, req->src, req->assoclen);
+	msg_dst = scatterwalk_ffwd(rctx->dst_ffwd, req->dst, req->assoclen);
+
+	src_nents = sg_nents_for_len(msg_src, inlen);
+	dst_nents = sg_nents_for_len(msg_dst, outlen);
+	if (src_nents < 0 || dst_nents < 0) {
+		dev_err(qce->dev, "Invalid numbers of SG.\n");
+		ret = -EINVAL;
+		goto error_free_adata;
+	}
+
+	if (rctx->adata) {
+		src_nents++;
+		dst_nents++;
+	}
+
+	/* the result dump trails the payload */
+	dst_nents++;
+
+	ret = sg_alloc_table(&rctx->src_tbl, src_nents, gfp);
+	if (ret)
+		goto error_free_adata;
+
+	ret = sg_alloc_table(&rctx->dst_tbl, dst_nents, gfp);
+	if (ret)
+		goto error_free_src;
+
+	if (rctx->adata) {
+		sg = qce_sgtable_add(&rctx->src_tbl, &rctx->adata_sg,
+				     rctx->assoclen);
+		if (IS_ERR(sg)) {
+			ret = PTR_ERR(sg);
+			goto error_free_dst;
+		}
+
+		sg = qce_sgtable_add(&rctx->dst_tbl, &rctx->adata_out_sg,
+				     rctx->assoclen);
+		if (IS_ERR(sg)) {
+			ret = PTR_ERR(sg);
+			goto error_free_dst;
+		}
+	}
+
+	sg = qce_sgtable_add(&rctx->src_tbl, msg_src, inlen);
+	if (IS_ERR(sg)) {
+		ret = PTR_ERR(sg);
+		goto error_free_dst;
+	}
+	sg_mark_end(sg);
+
+	sg = qce_sgtable_add(&rctx->dst_tbl, msg_dst, outlen);
+	if (IS_ERR(sg)) {
+		ret = PTR_ERR(sg);
+		goto error_free_dst;
+	}
+
+	sg_init_one(&rctx->result_sg, qce->dma.result_buf, QCE_RESULT_BUF_SZ);
+	sg = qce_sgtable_add(&rctx->dst_tbl, &rctx->result_sg,
+			     QCE_RESULT_BUF_SZ);
+	if (IS_ERR(sg)) {
+		ret = PTR_ERR(sg);
+		goto error_free_dst;
+	}
+	sg_mark_end(sg);
+
+	rctx->src_sg = rctx->src_tbl.sgl;
+	rctx->src_nents = src_nents;
+	rctx->dst_sg = rctx->dst_tbl.sgl;
+	rctx->dst_nents = dst_nents;
+
+	return 0;
+
+error_free_dst:
+	sg_free_table(&rctx->dst_tbl);
+error_free_src:
+	sg_free_table(&rctx->src_tbl);
+error_free_adata:
+	kfree_sensitive(rctx->adata);
+	return ret;
+}
+
+static int qce_aead_async_req_prepare(struct crypto_async_request *async_req)
+{
+	struct aead_request *req = aead_request_cast(async_req);
+	struct qce_aead_reqctx *rctx = aead_request_ctx(req);
+	gfp_t gfp;
+
+	gfp = (req->base.flags & CRYPTO_TFM_REQ_MAY_SLEEP) ?
+						GFP_KERNEL : GFP_ATOMIC;
+
+	rctx->adata = NULL;
+	if (IS_CCM(rctx->flags))
+		return qce_aead_ccm_prepare_buf(req, gfp);
+
+	return qce_aead_prepare_buf(req, gfp);
+}
+
+static void
+qce_aead_async_req_unprepare(struct crypto_async_request *async_req)
+{
+	struct aead_request *req = aead_request_cast(async_req);
+	struct qce_aead_reqctx *rctx = aead_request_ctx(req);
+
+	sg_free_table(&rctx->src_tbl);
+	sg_free_table(&rctx->dst_tbl);
+	kfree_sensitive(rctx->adata);
+}
+
+static int qce_aead_async_req_handle(struct crypto_async_request *async_req)
+{
+	struct aead_request *req = aead_request_cast(async_req);
+	struct qce_aead_reqctx *rctx = aead_request_ctx(req);
+	struct qce_alg_template *tmpl = to_aead_tmpl(crypto_aead_reqtfm(req));
+	struct qce_device *qce = tmpl->qce;
+	int ret;
+
+	ret = dma_map_sg(qce->dev, rctx->dst_sg, rctx->dst_nents,
+			 DMA_FROM_DEVICE);
+	if (!ret)
+		return -EIO;
+
+	ret = dma_map_sg(qce->dev, rctx->src_sg, rctx->src_nents,
+			 DMA_TO_DEVICE);
+	if (!ret) {
+		ret = -EIO;
+		goto error_unmap_dst;
+	}
+
+	ret = qce_dma_prep_sgs(&qce->dma, rctx->src_sg, rctx->src_nents,
+			       rctx->dst_sg, rctx->dst_nents,
+			       qce_aead_done, async_req);
+	if (ret)
+		goto error_unmap_src;
+
+	qce_dma_issue_pending(&qce->dma);
+
+	ret = qce_start(async_req, tmpl->crypto_alg_type, 0, 0);
+	if (ret)
+		goto error_terminate;
+
+	return 0;
+
+error_terminate:
+	qce_dma_terminate_all(&qce->dma);
+error_unmap_src:
+	dma_unmap_sg(qce->dev, rctx->src_sg, rctx->src_nents, DMA_TO_DEVICE);
+error_unmap_dst:
+	dma_unmap_sg(qce->dev, rctx->dst_sg, rctx->dst_nents, DMA_FROM_DEVICE);
+	return ret;
+}
+
+/*
+ * Build the B0 block from the request IV: flags, nonce and the message
+ * length. The counter bytes of the IV are cleared, as ccm defines them to
+ * start out as zero and the engine uses the IV as is for counter block 0.
+ */
+static int qce_aead_ccm_prepare_nonce(struct aead_request *req)
+{
+	struct qce_aead_reqctx *rctx = aead_request_ctx(req);
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	unsigned int authsize = crypto_aead_authsize(tfm);
+	unsigned int lsize = rctx->iv[0] + 1;
+	unsigned int i;
+
+	if (lsize < 2 || lsize > 8)
+		return -EINVAL;
+
+	if (lsize < 4 && rctx->cryptlen >> (8 * lsize))
+		return -EOVERFLOW;
+
+	memset(&rctx->iv[AES_BLOCK_SIZE - lsize], 0, lsize);
+	memcpy(rctx->ccm_nonce, rctx->iv, AES_BLOCK_SIZE);
+
+	rctx->ccm_nonce[0] |= ((authsize - 2) / 2) << CCM_NONCE_AUTHSIZE_SHIFT;
+	if (rctx->assoclen)
+		rctx->ccm_nonce[0] |= BIT(CCM_NONCE_ADATA_SHIFT);
+
+	for (i = 0; i < min(lsize, 4U); i++)
+		rctx->ccm_nonce[AES_BLOCK_SIZE - 1 - i] = rctx->cryptlen >> (8 * i);
+
+	return 0;
+}
+
+static int qce_aead_fallback(struct aead_request *req, int encrypt)
+{
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct qce_aead_ctx *ctx = crypto_aead_ctx(tfm);
+	struct qce_aead_reqctx *rctx = aead_request_ctx(req);
+
+	aead_request_set_tfm(&rctx->fallback_req, ctx->fallback);
+	aead_request_set_callback(&rctx->fallback_req, req->base.flags,
+				  req->base.complete, req->base.data);
+	aead_request_set_crypt(&rctx->fallback_req, req->src, req->dst,
+			       req->cryptlen, req->iv);
+	aead_request_set_ad(&rctx->fallback_req, req->assoclen);
+
+	return encrypt ? crypto_aead_encrypt(&rctx->fallback_req) :
+			 crypto_aead_decrypt(&rctx->fallback_req);
+}
+
+static int qce_aead_crypt(struct aead_request *req, int encrypt)
+{
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct qce_aead_ctx *ctx = crypto_aead_ctx(tfm);
+	struct qce_aead_reqctx *rctx = aead_request_ctx(req);
+	struct qce_alg_template *tmpl = to_aead_tmpl(tfm);
+	unsigned int authsize = crypto_aead_authsize(tfm);
+	unsigned int blocksize = crypto_aead_blocksize(tfm);
+	int ret;
+
+	rctx->flags = tmpl->alg_flags;
+	rctx->flags |= encrypt ? QCE_ENCRYPT : QCE_DECRYPT;
+
+	if (!encrypt && req->cryptlen < authsize)
+		return -EINVAL;
+
+	rctx->cryptlen = encrypt ? req->cryptlen : req->cryptlen - authsize;
+	rctx->assoclen = req->assoclen;
+
+	if (IS_CCM_RFC4309(rctx->flags)) {
+		if (crypto_ipsec_check_assoclen(req->assoclen))
+			return -EINVAL;
+		/* the trailing IV is not part of the authenticated data */
+		rctx->assoclen -= CCM_RFC4309_IV_SIZE;
+	}
+
+	/* the engine cannot process empty payloads */
+	if (ctx->need_fallback || !rctx->cryptlen ||
+	    rctx->assoclen > QCE_AEAD_MAX_ASSOCLEN)
+		return qce_aead_fallback(req, encrypt);
+
+	if (IS_CBC(rctx->flags) && !IS_ALIGNED(rctx->cryptlen, blocksize))
+		return -EINVAL;
+
+	if (IS_CCM(rctx->flags)) {
+		if (IS_CCM_RFC4309(rctx->flags)) {
+			rctx->iv = rctx->ccm_rfc4309_iv;
+			memset(rctx->iv, 0, AES_BLOCK_SIZE);
+			/* L' = 3, i.e. a four byte length field */
+			rctx->iv[0] = 3;
+			memcpy(&rctx->iv[1], ctx->ccm4309_salt,
+			       QCE_CCM4309_SALT_SIZE);
+			memcpy(&rctx->iv[1 + QCE_CCM4309_SALT_SIZE], req->iv,
+			       CCM_RFC4309_IV_SIZE);
+		} else {
+			rctx->iv = req->iv;
+		}
+		rctx->ivsize = AES_BLOCK_SIZE;
+
+		ret = qce_aead_ccm_prepare_nonce(req);
+		if (ret)
+			return ret;
+	} else {
+		rctx->iv = req->iv;
+		rctx->ivsize = crypto_aead_ivsize(tfm);
+	}
+
+	return tmpl->qce->async_req_enqueue(tmpl->qce, &req->base);
+}
+
+static int qce_aead_encrypt(struct aead_request *req)
+{
+	return qce_aead_crypt(req, 1);
+}
+
+static int qce_aead_decrypt(struct aead_request *req)
+{
+	return qce_aead_crypt(req, 0);
+}
+
+static int qce_aead_fallback_setkey(struct crypto_aead *tfm, const u8 *key,
+				    unsigned int keylen)
+{
+	struct qce_aead_ctx *ctx = crypto_aead_ctx(tfm);
+
+	crypto_aead_clear_flags(ctx->fallback, CRYPTO_TFM_REQ_MASK);
+	crypto_aead_set_flags(ctx->fallback,
+			      crypto_aead_get_flags(tfm) & CRYPTO_TFM_REQ_MASK);
+
+	return crypto_aead_setkey(ctx->fallback, key, keylen);
+}
+
+static int qce_aead_ccm_setkey(struct crypto_aead *tfm, const u8 *key,
+			       unsigned int keylen)
+{
+	struct qce_aead_ctx *ctx = crypto_aead_ctx(tfm);
+	unsigned long flags = to_aead_tmpl(tfm)->alg_flags;
+	int ret;
+
+	ret = qce_aead_fallback_setkey(tfm, key, keylen);
+	if (ret)
+		return ret;
+
+	if (IS_CCM_RFC4309(flags)) {
+		keylen -= QCE_CCM4309_SALT_SIZE;
+		memcpy(ctx->ccm4309_salt, key + keylen, QCE_CCM4309_SALT_SIZE);
+	}
+
+	/* the engine has no 192 bit aes keys */
+	ctx->need_fallback = keylen != AES_KEYSIZE_128 &&
+			     keylen != AES_KEYSIZE_256;
+	if (ctx->need_fallback)
+		return 0;
+
+	/* ccm authenticates with the cipher key */
+	memcpy(ctx->enc_key, key, keylen);
+	memcpy(ctx->auth_key, key, keylen);
+	ctx->enc_keylen = keylen;
+	ctx->auth_keylen = keylen;
+
+	return 0;
+}
+
+static int qce_aead_authenc_setkey(struct crypto_aead *tfm, const u8 *key,
+				   unsigned int keylen)
+{
+	struct qce_aead_ctx *ctx = crypto_aead_ctx(tfm);
+	struct crypto_authenc_keys authenc_keys;
+	int ret;
+
+	ret = crypto_authenc_extractkeys(&authenc_keys, key, keylen);
+	if (ret)
+		return ret;
+
+	ret = qce_aead_fallback_setkey(tfm, key, keylen);
+	if (ret)
+		goto out;
+
+	/* longer hmac keys would need hashing down first */
+	ctx->need_fallback =
+		(authenc_keys.enckeylen != AES_KEYSIZE_128 &&
+		 authenc_keys.enckeylen != AES_KEYSIZE_256) ||
+		authenc_keys.authkeylen > QCE_SHA_HMAC_KEY_SIZE;
+	if (ctx->need_fallback)
+		goto out;
+
+	memcpy(ctx->enc_key, authenc_keys.enckey, authenc_keys.enckeylen);
+	ctx->enc_keylen = authenc_keys.enckeylen;
+
+	memset(ctx->auth_key, 0, sizeof(ctx->auth_key));
+	memcpy(ctx->auth_key, authenc_keys.authkey, authenc_keys.authkeylen);
+	ctx->auth_keylen = authenc_keys.authkeylen;
+
+out:
+	memzero_explicit(&authenc_keys, sizeof(authenc_keys));
+	return ret;
+}
+
+static int qce_aead_setauthsize(struct crypto_aead *tfm, unsigned int authsize)
+{
+	struct qce_aead_ctx *ctx = crypto_aead_ctx(tfm);
+	unsigned long flags = to_aead_tmpl(tfm)->alg_flags;
+
+	if (IS_CCM_RFC4309(flags)) {
+		if (authsize != 8 && authsize != 12 && authsize != 16)
+			return -EINVAL;
+	} else if (IS_CCM(flags)) {
+		if (authsize < 4 || authsize > 16 || authsize & 1)
+			return -EINVAL;
+	}
+
+	return crypto_aead_setauthsize(ctx->fallback, authsize);
+}
+
+static int qce_aead_init(struct crypto_aead *tfm)
+{
+	struct qce_aead_ctx *ctx = crypto_aead_ctx(tfm);
+
+	qce_init_engine_ctx(&ctx->enginectx);
+
+	ctx->need_fallback = false;
+	ctx->fallback = crypto_alloc_aead(crypto_tfm_alg_name(&tfm->base),
+					  0, CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(ctx->fallback))
+		return PTR_ERR(ctx->fallback);
+
+	crypto_aead_set_reqsize(tfm, sizeof(struct qce_aead_reqctx) +
+				     crypto_aead_reqsize(ctx->fallback));
+	return 0;
+}
+
+static void qce_aead_exit(struct crypto_aead *tfm)
+{
+	struct qce_aead_ctx *ctx = crypto_aead_ctx(tfm);
+
+	crypto_free_aead(ctx->fallback);
+}
+
+struct qce_aead_def {
+	unsigned long flags;
+	const char *name;
+	const char *drv_name;
+	unsigned int blocksize;
+	unsigned int chunksize;
+	unsigned int ivsize;
+	unsigned int maxauthsize;
+	const u32 *std_iv;
+};
+
+static const struct qce_aead_def aead_def[] = {
+	{
+		.flags		= QCE_ALG_AES | QCE_MODE_CBC |
+				  QCE_HASH_SHA1_HMAC,
+		.name		= "authenc(hmac(sha1),cbc(aes))",
+		.drv_name	= "authenc-hmac-sha1-cbc-aes-qce",
+		.blocksize	= AES_BLOCK_SIZE,
+		.ivsize		= AES_BLOCK_SIZE,
+		.maxauthsize	= SHA1_DIGEST_SIZE,
+		.std_iv		= std_iv_sha1,
+	},
+	{
+		.flags		= QCE_ALG_AES | QCE_MODE_CBC |
+				  QCE_HASH_SHA256_HMAC,
+		.name		= "authenc(hmac(sha256),cbc(aes))",
+		.drv_name	= "authenc-hmac-sha256-cbc-aes-qce",
+		.blocksize	= AES_BLOCK_SIZE,
+		.ivsize		= AES_BLOCK_SIZE,
+		.maxauthsize	= SHA256_DIGEST_SIZE,
+		.std_iv		= std_iv_sha256,
+	},
+	{
+		.flags		= QCE_ALG_AES | QCE_MODE_CCM,
+		.name		= "ccm(aes)",
+		.drv_name	= "ccm-aes-qce",
+		.blocksize	= 1,
+		.chunksize	= AES_BLOCK_SIZE,
+		.ivsize		= AES_BLOCK_SIZE,
+		.maxauthsize	= AES_BLOCK_SIZE,
+	},
+	{
+		.flags		= QCE_ALG_AES | QCE_MODE_CCM |
+				  QCE_MODE_CCM_RFC4309,
+		.name		= "rfc4309(ccm(aes))",
+		.drv_name	= "rfc4309-ccm-aes-qce",
+		.blocksize	= 1,
+		.chunksize	= AES_BLOCK_SIZE,
+		.ivsize		= CCM_RFC4309_IV_SIZE,
+		.maxauthsize	= AES_BLOCK_SIZE,
+	},
+};
+
+static int qce_aead_register_one(const struct qce_aead_def *def,
+				 struct qce_device *qce)
+{
+	struct qce_alg_template *tmpl;
+	struct aead_alg *alg;
+	int ret;
+
+	tmpl = kzalloc(sizeof(*tmpl), GFP_KERNEL);
+	if (!tmpl)
+		return -ENOMEM;
+
+	alg = &tmpl->alg.aead;
+
+	snprintf(alg->base.cra_name, CRYPTO_MAX_ALG_NAME, "%s", def->name);
+	snprintf(alg->base.cra_driver_name, CRYPTO_MAX_ALG_NAME, "%s",
+		 def->drv_name);
+
+	alg->base.cra_blocksize		= def->blocksize;
+	alg->chunksize			= def->chunksize;
+	alg->ivsize			= def->ivsize;
+	alg->maxauthsize		= def->maxauthsize;
+	alg->setkey			= IS_CCM(def->flags) ?
+					  qce_aead_ccm_setkey :
+					  qce_aead_authenc_setkey;
+	alg->setauthsize		= qce_aead_setauthsize;
+	alg->encrypt			= qce_aead_encrypt;
+	alg->decrypt			= qce_aead_decrypt;
+	alg->init			= qce_aead_init;
+	alg->exit			= qce_aead_exit;
+
+	alg->base.cra_priority		= 300;
+	alg->base.cra_flags		= CRYPTO_ALG_ASYNC |
+					  CRYPTO_ALG_ALLOCATES_MEMORY |
+					  CRYPTO_ALG_KERN_DRIVER_ONLY |
+					  CRYPTO_ALG_NEED_FALLBACK;
+	alg->base.cra_ctxsize		= sizeof(struct qce_aead_ctx);
+	alg->base.cra_alignmask		= 0;
+	alg->base.cra_module		= THIS_MODULE;
+
+	INIT_LIST_HEAD(&tmpl->entry);
+	tmpl->crypto_alg_type = CRYPTO_ALG_TYPE_AEAD;
+	tmpl->alg_flags = def->flags;
+	tmpl->std_iv = def->std_iv;
+	tmpl->qce = qce;
+
+	ret = crypto_register_aead(alg);
+	if (ret) {
+		kfree(tmpl);
+		dev_err(qce->dev, "%s registration failed\n", alg->base.cra_name);
+		return ret;
+	}
+
+	list_add_tail(&tmpl->entry, &aead_algs);
+	dev_dbg(qce->dev, "%s is registered\n", alg->base.cra_name);
+	return 0;
+}
+
+static void qce_aead_unregister(struct qce_device *qce)
+{
+	struct qce_alg_template *tmpl, *n;
+
+	list_for_each_entry_safe(tmpl, n, &aead_algs, entry) {
+		crypto_unregister_aead(&tmpl->alg.aead);
+		list_del(&tmpl->entry);
+		kfree(tmpl);
+	}
+}
+
+static int qce_aead_register(struct qce_device *qce)
+{
+	int ret, i;
+
+	for (i = 0; i < ARRAY_SIZE(aead_def); i++) {
+		ret = qce_aead_register_one(&aead_def[i], qce);
+		if (ret)
+			goto err;
+	}
+
+	return 0;
+err:
+	qce_aead_unregister(qce);
+	return ret;
+}
+
+const struct qce_algo_ops aead_ops = {
+	.type = CRYPTO_ALG_TYPE_AEAD,
+	.register_algs = qce_aead_register,
+	.unregister_algs = qce_aead_unregister,
+	.async_req_prepare = qce_aead_async_req_prepare,
+	.async_req_unprepare = qce_aead_async_req_unprepare,
+	.async_req_handle = qce_aead_async_req_handle,
+};
@@ -0,0 +1,82 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (c) 2021, The Linux Foundation. All rights reserved.
+ */
+
+#ifndef _AEAD_H_
+#define _AEAD_H_
+
+#include <crypto/authenc.h>
+#include <crypto/internal/aead.h>
+
+#include "common.h"
+#include "core.h"
+
+#define QCE_CCM4309_SALT_SIZE		3
+
+struct qce_aead_ctx {
+	struct crypto_engine_ctx enginectx;	// keep at the beginning
+	u8 enc_key[QCE_MAX_CIPHER_KEY_SIZE];
+	u8 auth_key[QCE_SHA_HMAC_KEY_SIZE];
+	u8 ccm4309_salt[QCE_CCM4309_SALT_SIZE];
+	unsigned int enc_keylen;
+	unsigned int auth_keylen;
+	bool need_fallback;
+	struct crypto_aead *fallback;
+};
+
+/**
+ * struct qce_aead_reqctx - holds private aead objects per request
+ * @flags: operation flags
+ * @iv: pointer to the IV
+ * @ivsize: IV size
+ * @src_nents: source entries
+ * @dst_nents: destination entries
+ * @src_tbl: source sg table
+ * @src_sg: source sg pointer table beginning
+ * @dst_tbl: destination sg table
+ * @dst_sg: destination sg pointer table beginning
+ * @src_ffwd: source sg list positioned past the associated data
+ * @dst_ffwd: destination sg list positioned past the associated data
+ * @result_sg: scatterlist used for result buffer
+ * @adata_sg: scatterlist for the formatted ccm associated data
+ * @adata_out_sg: scatterlist absorbing the associated data written back
+ * @adata: buffer holding the formatted ccm associated data
+ * @cryptlen: payload length, without the authentication tag
+ * @assoclen: associated data length as seen by the engine
+ * @ccm_nonce: ccm B0 block programmed into the nonce registers
+ * @ccm_rfc4309_iv: ccm IV built from the rfc4309 salt and request IV
+ */
+struct qce_aead_reqctx {
+	unsigned long flags;
+	u8 *iv;
+	unsigned int ivsize;
+	int src_nents;
+	int dst_nents;
+	struct sg_table src_tbl;
+	struct scatterlist *src_sg;
+	struct sg_table dst_tbl;
+	struct scatterlist *dst_sg;
+	struct scatterlist src_ffwd[2];
+	struct scatterlist dst_ffwd[2];
+	struct scatterlist result_sg;
+	struct scatterlist adata_sg;
+	struct scatterlist adata_out_sg;
+	u8 *adata;
+	unsigned int cryptlen;
+	unsigned int assoclen;
+	u8 ccm_nonce[QCE_MAX_NONCE];
+	u8 ccm_rfc4309_iv[QCE_MAX_IV_SIZE];
+	struct aead_request fallback_req;	// keep at the end
+};
+
+static inline struct qce_alg_template *to_aead_tmpl(struct crypto_aead *tfm)
+{
+	struct aead_alg *alg = crypto_aead_alg(tfm);
+
+	return container_of(alg, struct qce_alg_template, alg.aead);
+}
+
+extern const struct qce_algo_ops aead_ops;
+
+#endif /* _AEAD_H_ */
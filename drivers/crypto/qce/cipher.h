@@ -12,6 +12,7 @@
 #define QCE_MAX_KEY_SIZE	64
 
 struct qce_cipher_ctx {
+	struct crypto_engine_ctx enginectx;	// keep at the beginning
 	u8 enc_key[QCE_MAX_KEY_SIZE];
 	unsigned int enc_keylen;
 	struct crypto_skcipher *fallback;
@@ -10,6 +10,7 @@
 #include <crypto/sha1.h>
 #include <crypto/sha2.h>
 
+#include "aead.h"
 #include "cipher.h"
 #include "common.h"
 #include "core.h"
@@ -93,8 +94,8 @@ static inline void qce_crypto_go(struct qce_device *qce)
 	qce_write(qce, REG_GOPROC, BIT(GO_SHIFT) | BIT(RESULTS_DUMP_SHIFT));
 }
 
-#ifdef CONFIG_CRYPTO_DEV_QCE_SHA
-static u32 qce_auth_cfg(unsigned long flags, u32 key_size)
+#if defined(CONFIG_CRYPTO_DEV_QCE_SHA) || defined(CONFIG_CRYPTO_DEV_QCE_AEAD)
+static u32 qce_auth_cfg(unsigned long flags, u32 key_size, u32 auth_size)
 {
 	u32 cfg = 0;
 
@@ -116,6 +117,8 @@ static u32 qce_auth_cfg(unsigned long flags, u32 key_size)
 		cfg |= AUTH_SIZE_SHA256 << AUTH_SIZE_SHIFT;
 	else if (IS_CMAC(flags))
 		cfg |= AUTH_SIZE_ENUM_16_BYTES << AUTH_SIZE_SHIFT;
+	else if (IS_CCM(flags))
+		cfg |= (auth_size - 1) << AUTH_SIZE_SHIFT;
 
 	if (IS_SHA1(flags) || IS_SHA256(flags))
 		cfg |= AUTH_MODE_HASH << AUTH_MODE_SHIFT;
@@ -139,7 +142,9 @@ static u32 qce_auth_cfg(unsigned long flags, u32 key_size)
 
 	return cfg;
 }
+#endif
 
+#ifdef CONFIG_CRYPTO_DEV_QCE_SHA
 static int qce_setup_regs_ahash(struct crypto_async_request *async_req,
 				u32 totallen, u32 offset)
 {
@@ -169,7 +174,7 @@ static int qce_setup_regs_ahash(struct crypto_async_request *async_req,
 		qce_clear_array(qce, REG_AUTH_KEY0, 16);
 		qce_clear_array(qce, REG_AUTH_BYTECNT0, 4);
 
-		auth_cfg = qce_auth_cfg(rctx->flags, rctx->authklen);
+		auth_cfg = qce_auth_cfg(rctx->flags, rctx->authklen, 0);
 	}
 
 	if (IS_SHA_HMAC(rctx->flags) || IS_CMAC(rctx->flags)) {
@@ -197,7 +202,7 @@ static int qce_setup_regs_ahash(struct crypto_async_request *async_req,
 		qce_write_array(qce, REG_AUTH_BYTECNT0,
 				(u32 *)rctx->byte_count, 2);
 
-	auth_cfg = qce_auth_cfg(rctx->flags, 0);
+	auth_cfg = qce_auth_cfg(rctx->flags, 0, 0);
 
 	if (rctx->last_blk)
 		auth_cfg |= BIT(AUTH_LAST_SHIFT);
@@ -226,7 +231,7 @@ static int qce_setup_regs_ahash(struct crypto_async_request *async_req,
 }
 #endif
 
-#ifdef CONFIG_CRYPTO_DEV_QCE_SKCIPHER
+#if defined(CONFIG_CRYPTO_DEV_QCE_SKCIPHER) || defined(CONFIG_CRYPTO_DEV_QCE_AEAD)
 static u32 qce_encr_cfg(unsigned long flags, u32 aes_key_size)
 {
 	u32 cfg = 0;
@@ -272,7 +277,9 @@ static u32 qce_encr_cfg(unsigned long flags, u32 aes_key_size)
 
 	return cfg;
 }
+#endif
 
+#ifdef CONFIG_CRYPTO_DEV_QCE_SKCIPHER
 static void qce_xts_swapiv(__be32 *dst, const u8 *src, unsigned int ivsize)
 {
 	u8 swap[QCE_AES_IV_LENGTH];
@@ -388,6 +395,106 @@ static int qce_setup_regs_skcipher(struct crypto_async_request *async_req,
 }
 #endif
 
+#ifdef CONFIG_CRYPTO_DEV_QCE_AEAD
+static int qce_setup_regs_aead(struct crypto_async_request *async_req)
+{
+	struct aead_request *req = aead_request_cast(async_req);
+	struct qce_aead_reqctx *rctx = aead_request_ctx(req);
+	struct qce_aead_ctx *ctx = crypto_tfm_ctx(async_req->tfm);
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct qce_alg_template *tmpl = to_aead_tmpl(tfm);
+	struct qce_device *qce = tmpl->qce;
+	unsigned int authsize = crypto_aead_authsize(tfm);
+	__be32 enckey[QCE_MAX_CIPHER_KEY_SIZE / sizeof(__be32)] = {0};
+	__be32 enciv[QCE_MAX_IV_SIZE / sizeof(__be32)] = {0};
+	__be32 authkey[QCE_SHA_HMAC_KEY_SIZE / sizeof(__be32)] = {0};
+	__be32 authnonce[QCE_MAX_NONCE / sizeof(__be32)] = {0};
+	unsigned int enckey_words, enciv_words, authkey_words;
+	unsigned int authiv_words;
+	unsigned long flags = rctx->flags;
+	u32 encr_cfg, auth_cfg, config, totallen, encrlen;
+
+	qce_setup_config(qce);
+
+	qce_cpu_to_be32p_array(enckey, ctx->enc_key, ctx->enc_keylen);
+	enckey_words = ctx->enc_keylen / sizeof(u32);
+	qce_write_array(qce, REG_ENCR_KEY0, (u32 *)enckey, enckey_words);
+
+	qce_cpu_to_be32p_array(enciv, rctx->iv, rctx->ivsize);
+	enciv_words = rctx->ivsize / sizeof(u32);
+	qce_write_array(qce, REG_CNTR0_IV0, (u32 *)enciv, enciv_words);
+
+	if (IS_CCM(flags)) {
+		/* payload starts at counter 1, counter 0 encrypts the tag */
+		qce_write(qce, REG_CNTR3_IV3,
+			  (__force u32)enciv[enciv_words - 1] + 1);
+		qce_write_array(qce, REG_ENCR_CCM_INT_CNTR0, (u32 *)enciv,
+				enciv_words);
+		qce_write(qce, REG_CNTR_MASK, ~0);
+		qce_write(qce, REG_CNTR_MASK0, ~0);
+		qce_write(qce, REG_CNTR_MASK1, ~0);
+		qce_write(qce, REG_CNTR_MASK2, ~0);
+	}
+
+	qce_clear_array(qce, REG_AUTH_IV0, 16);
+	qce_clear_array(qce, REG_AUTH_KEY0, 16);
+	qce_clear_array(qce, REG_AUTH_BYTECNT0, 4);
+
+	authkey_words = DIV_ROUND_UP(ctx->auth_keylen, sizeof(u32));
+	qce_cpu_to_be32p_array(authkey, ctx->auth_key,
+			       authkey_words * sizeof(u32));
+	qce_write_array(qce, REG_AUTH_KEY0, (u32 *)authkey, authkey_words);
+
+	if (IS_SHA_HMAC(flags)) {
+		authiv_words = IS_SHA1_HMAC(flags) ? 5 : 8;
+		qce_write_array(qce, REG_AUTH_IV0, tmpl->std_iv, authiv_words);
+	} else if (IS_CCM(flags)) {
+		qce_cpu_to_be32p_array(authnonce, rctx->ccm_nonce,
+				       QCE_MAX_NONCE);
+		qce_write_array(qce, REG_AUTH_INFO_NONCE0, (u32 *)authnonce,
+				QCE_MAX_NONCE_WORDS);
+	}
+
+	encr_cfg = qce_encr_cfg(flags, ctx->enc_keylen);
+	if (IS_ENCRYPT(flags))
+		encr_cfg |= BIT(ENCODE_SHIFT);
+	qce_write(qce, REG_ENCR_SEG_CFG, encr_cfg);
+
+	/*
+	 * The MAC is computed over the plaintext for ccm and over the
+	 * ciphertext for authenc, so its position relative to the cipher
+	 * depends on both the mode and the direction.
+	 */
+	auth_cfg = qce_auth_cfg(flags, ctx->auth_keylen, authsize);
+	auth_cfg |= BIT(AUTH_LAST_SHIFT) | BIT(AUTH_FIRST_SHIFT);
+	if ((IS_ENCRYPT(flags) && !IS_CCM(flags)) ||
+	    (IS_DECRYPT(flags) && IS_CCM(flags)))
+		auth_cfg |= AUTH_POS_AFTER << AUTH_POS_SHIFT;
+	qce_write(qce, REG_AUTH_SEG_CFG, auth_cfg);
+
+	totallen = rctx->assoclen + rctx->cryptlen;
+	encrlen = rctx->cryptlen;
+
+	/* ccm decryption also feeds the received tag through the engine */
+	if (IS_CCM(flags) && IS_DECRYPT(flags))
+		encrlen += authsize;
+
+	qce_write(qce, REG_ENCR_SEG_SIZE, encrlen);
+	qce_write(qce, REG_ENCR_SEG_START, rctx->assoclen & 0xffff);
+	qce_write(qce, REG_AUTH_SEG_SIZE, totallen);
+	qce_write(qce, REG_AUTH_SEG_START, 0);
+	qce_write(qce, REG_SEG_SIZE, rctx->assoclen + encrlen);
+
+	/* get little endianness */
+	config = qce_config_reg(qce, 1);
+	qce_write(qce, REG_CONFIG, config);
+
+	qce_crypto_go(qce);
+
+	return 0;
+}
+#endif
+
 int qce_start(struct crypto_async_request *async_req, u32 type, u32 totallen,
 	      u32 offset)
 {
@@ -399,6 +506,10 @@ int qce_start(struct crypto_async_request *async_req, u32 type, u32 totallen,
 #ifdef CONFIG_CRYPTO_DEV_QCE_SHA
 	case CRYPTO_ALG_TYPE_AHASH:
 		return qce_setup_regs_ahash(async_req, totallen, offset);
+#endif
+#ifdef CONFIG_CRYPTO_DEV_QCE_AEAD
+	case CRYPTO_ALG_TYPE_AEAD:
+		return qce_setup_regs_aead(async_req);
 #endif
 	default:
 		return -EINVAL;
@@ -422,6 +533,8 @@ int qce_check_status(struct qce_device *qce, u32 *status)
 	 */
 	if (*status & STATUS_ERRORS || !(*status & BIT(OPERATION_DONE_SHIFT)))
 		ret = -ENXIO;
+	else if (*status & BIT(MAC_FAILED_SHIFT))
+		ret = -EBADMSG;
 
 	return ret;
 }
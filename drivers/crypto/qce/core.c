@@ -4,22 +4,30 @@
  */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
 #include <linux/interrupt.h>
 #include <linux/module.h>
 #include <linux/mod_devicetable.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
 #include <linux/spinlock.h>
 #include <linux/types.h>
 #include <crypto/algapi.h>
+#include <crypto/engine.h>
+#include <crypto/internal/aead.h>
 #include <crypto/internal/hash.h>
+#include <crypto/internal/skcipher.h>
 
+#include "aead.h"
 #include "core.h"
 #include "cipher.h"
 #include "sha.h"
 
 #define QCE_MAJOR_VERSION5	0x05
-#define QCE_QUEUE_LENGTH	1
+#define QCE_QUEUE_LENGTH	32
+
+static struct dentry *qce_debugfs_root;
 
 static const struct qce_algo_ops *qce_ops[] = {
 #ifdef CONFIG_CRYPTO_DEV_QCE_SKCIPHER
@@ -28,6 +36,9 @@ static const struct qce_algo_ops *qce_ops[] = {
 #ifdef CONFIG_CRYPTO_DEV_QCE_SHA
 	&ahash_ops,
 #endif
+#ifdef CONFIG_CRYPTO_DEV_QCE_AEAD
+	&aead_ops,
+#endif
 };
 
 static void qce_unregister_algs(struct qce_device *qce)
@@ -56,95 +67,239 @@ static int qce_register_algs(struct qce_device *qce)
 	return ret;
 }
 
-static int qce_handle_request(struct crypto_async_request *async_req)
+static const struct qce_algo_ops *qce_find_ops(u32 type)
 {
-	int ret = -EINVAL, i;
-	const struct qce_algo_ops *ops;
-	u32 type = crypto_tfm_alg_type(async_req->tfm);
+	int i;
 
 	for (i = 0; i < ARRAY_SIZE(qce_ops); i++) {
-		ops = qce_ops[i];
-		if (type != ops->type)
-			continue;
-		ret = ops->async_req_handle(async_req);
-		break;
+		if (qce_ops[i]->type == type)
+			return qce_ops[i];
 	}
 
-	return ret;
+	return NULL;
+}
+
+static void qce_finalize_request(struct qce_device *qce,
+				 struct crypto_async_request *req, int ret)
+{
+	switch (crypto_tfm_alg_type(req->tfm)) {
+	case CRYPTO_ALG_TYPE_SKCIPHER:
+		crypto_finalize_skcipher_request(qce->engine,
+						 skcipher_request_cast(req), ret);
+		break;
+	case CRYPTO_ALG_TYPE_AHASH:
+		crypto_finalize_hash_request(qce->engine,
+					     ahash_request_cast(req), ret);
+		break;
+	case CRYPTO_ALG_TYPE_AEAD:
+		crypto_finalize_aead_request(qce->engine,
+					     aead_request_cast(req), ret);
+		break;
+	}
 }
 
-static int qce_handle_queue(struct qce_device *qce,
-			    struct crypto_async_request *req)
+/*
+ * Start the oldest prepared request if the hardware is idle. This runs from
+ * the engine thread and from the completion of the previous request, so a
+ * batch of prepared requests goes through the hardware back to back without
+ * a round trip through the engine thread.
+ */
+static void qce_start_next(struct qce_device *qce, bool from_done)
 {
-	struct crypto_async_request *async_req, *backlog;
+	struct crypto_async_request *async_req;
+	const struct qce_algo_ops *ops;
+	struct qce_staged_req *staged;
 	unsigned long flags;
-	int ret = 0, err;
+	ktime_t now;
+	u64 wait;
+	int ret;
 
-	spin_lock_irqsave(&qce->lock, flags);
+	for (;;) {
+		spin_lock_irqsave(&qce->lock, flags);
+		if (qce->req || !qce->nstaged) {
+			spin_unlock_irqrestore(&qce->lock, flags);
+			return;
+		}
 
-	if (req)
-		ret = crypto_enqueue_request(&qce->queue, req);
+		staged = &qce->staged[qce->staged_head];
+		async_req = staged->req;
+		now = ktime_get();
+		wait = ktime_to_ns(ktime_sub(now, staged->queued));
+
+		qce->staged_head = (qce->staged_head + 1) % QCE_BATCH_MAX;
+		qce->nstaged--;
+		qce->req = async_req;
+		qce->req_start = now;
 
-	/* busy, do not dequeue request */
-	if (qce->req) {
+		qce->stats.requests++;
+		qce->stats.wait_ns += wait;
+		qce->stats.max_wait_ns = max(qce->stats.max_wait_ns, wait);
+		if (from_done)
+			qce->stats.batched++;
 		spin_unlock_irqrestore(&qce->lock, flags);
-		return ret;
-	}
 
-	backlog = crypto_get_backlog(&qce->queue);
-	async_req = crypto_dequeue_request(&qce->queue);
-	if (async_req)
-		qce->req = async_req;
+		wake_up(&qce->staged_wq);
 
-	spin_unlock_irqrestore(&qce->lock, flags);
+		ops = qce_find_ops(crypto_tfm_alg_type(async_req->tfm));
+		ret = ops->async_req_handle(async_req);
+		if (!ret)
+			return;
 
-	if (!async_req)
-		return ret;
+		spin_lock_irqsave(&qce->lock, flags);
+		qce->req = NULL;
+		qce->stats.errors++;
+		spin_unlock_irqrestore(&qce->lock, flags);
 
-	if (backlog) {
-		spin_lock_bh(&qce->lock);
-		backlog->complete(backlog, -EINPROGRESS);
-		spin_unlock_bh(&qce->lock);
+		qce_finalize_request(qce, async_req, ret);
 	}
+}
 
-	err = qce_handle_request(async_req);
-	if (err) {
-		qce->result = err;
-		tasklet_schedule(&qce->done_tasklet);
-	}
+static int qce_engine_prepare_request(struct crypto_engine *engine,
+				      void *areq)
+{
+	struct crypto_async_request *async_req = areq;
+	const struct qce_algo_ops *ops;
 
-	return ret;
+	ops = qce_find_ops(crypto_tfm_alg_type(async_req->tfm));
+	if (!ops)
+		return -EINVAL;
+
+	return ops->async_req_prepare(async_req);
 }
 
-static void qce_tasklet_req_done(unsigned long data)
+static int qce_engine_unprepare_request(struct crypto_engine *engine,
+					void *areq)
 {
-	struct qce_device *qce = (struct qce_device *)data;
-	struct crypto_async_request *req;
+	struct crypto_async_request *async_req = areq;
+	const struct qce_algo_ops *ops;
+
+	ops = qce_find_ops(crypto_tfm_alg_type(async_req->tfm));
+	if (ops && ops->async_req_unprepare)
+		ops->async_req_unprepare(async_req);
+
+	return 0;
+}
+
+static int qce_engine_do_one_request(struct crypto_engine *engine, void *areq)
+{
+	struct qce_device *qce = engine->priv_data;
 	unsigned long flags;
+	unsigned int tail;
 
 	spin_lock_irqsave(&qce->lock, flags);
-	req = qce->req;
-	qce->req = NULL;
+	if (qce->nstaged == QCE_BATCH_MAX) {
+		qce->stats.batch_full++;
+		spin_unlock_irqrestore(&qce->lock, flags);
+
+		/*
+		 * Only this thread adds to the ring, so once a slot frees up
+		 * it stays free. The engine queue keeps filling up meanwhile,
+		 * which is what pushes back on the submitters.
+		 */
+		qce_start_next(qce, false);
+		wait_event(qce->staged_wq,
+			   READ_ONCE(qce->nstaged) < QCE_BATCH_MAX);
+
+		spin_lock_irqsave(&qce->lock, flags);
+	}
+
+	tail = (qce->staged_head + qce->nstaged) % QCE_BATCH_MAX;
+	qce->staged[tail].req = areq;
+	qce->staged[tail].queued = ktime_get();
+	qce->nstaged++;
+	qce->stats.max_staged = max(qce->stats.max_staged, qce->nstaged);
 	spin_unlock_irqrestore(&qce->lock, flags);
 
-	if (req)
-		req->complete(req, qce->result);
+	return 0;
+}
 
-	qce_handle_queue(qce, NULL);
+static int qce_engine_do_batch(struct crypto_engine *engine)
+{
+	qce_start_next(engine->priv_data, false);
+	return 0;
+}
+
+void qce_init_engine_ctx(struct crypto_engine_ctx *enginectx)
+{
+	enginectx->op.prepare_request = qce_engine_prepare_request;
+	enginectx->op.unprepare_request = qce_engine_unprepare_request;
+	enginectx->op.do_one_request = qce_engine_do_one_request;
 }
 
 static int qce_async_request_enqueue(struct qce_device *qce,
 				     struct crypto_async_request *req)
 {
-	return qce_handle_queue(qce, req);
+	switch (crypto_tfm_alg_type(req->tfm)) {
+	case CRYPTO_ALG_TYPE_SKCIPHER:
+		return crypto_transfer_skcipher_request_to_engine(qce->engine,
+						skcipher_request_cast(req));
+	case CRYPTO_ALG_TYPE_AHASH:
+		return crypto_transfer_hash_request_to_engine(qce->engine,
+						ahash_request_cast(req));
+	case CRYPTO_ALG_TYPE_AEAD:
+		return crypto_transfer_aead_request_to_engine(qce->engine,
+						aead_request_cast(req));
+	default:
+		return -EINVAL;
+	}
 }
 
 static void qce_async_request_done(struct qce_device *qce, int ret)
 {
-	qce->result = ret;
-	tasklet_schedule(&qce->done_tasklet);
+	struct crypto_async_request *req;
+	unsigned long flags;
+	u64 busy;
+
+	spin_lock_irqsave(&qce->lock, flags);
+	req = qce->req;
+	qce->req = NULL;
+	busy = ktime_to_ns(ktime_sub(ktime_get(), qce->req_start));
+	qce->stats.busy_ns += busy;
+	qce->stats.max_busy_ns = max(qce->stats.max_busy_ns, busy);
+	if (ret)
+		qce->stats.errors++;
+	spin_unlock_irqrestore(&qce->lock, flags);
+
+	/* keep the hardware busy before handing the result back */
+	qce_start_next(qce, true);
+
+	if (req)
+		qce_finalize_request(qce, req, ret);
 }
 
+static int qce_stats_show(struct seq_file *s, void *unused)
+{
+	struct qce_device *qce = s->private;
+	struct qce_stats stats;
+	unsigned int nstaged;
+	unsigned long flags;
+	u64 avg_wait = 0, avg_busy = 0;
+
+	spin_lock_irqsave(&qce->lock, flags);
+	stats = qce->stats;
+	nstaged = qce->nstaged;
+	spin_unlock_irqrestore(&qce->lock, flags);
+
+	if (stats.requests) {
+		avg_wait = div64_u64(stats.wait_ns, stats.requests);
+		avg_busy = div64_u64(stats.busy_ns, stats.requests);
+	}
+
+	seq_printf(s, "requests:    %llu\n", stats.requests);
+	seq_printf(s, "errors:      %llu\n", stats.errors);
+	seq_printf(s, "batched:     %llu\n", stats.batched);
+	seq_printf(s, "batch full:  %llu\n", stats.batch_full);
+	seq_printf(s, "queued:      %u\n", crypto_queue_len(&qce->engine->queue));
+	seq_printf(s, "staged:      %u (max %u)\n", nstaged, stats.max_staged);
+	seq_printf(s, "wait ns:     avg %llu max %llu\n", avg_wait,
+		   stats.max_wait_ns);
+	seq_printf(s, "busy ns:     avg %llu max %llu\n", avg_busy,
+		   stats.max_busy_ns);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(qce_stats);
+
 static int qce_check_version(struct qce_device *qce)
 {
 	u32 major, minor, step;
@@ -235,19 +390,36 @@ static int qce_crypto_probe(struct platform_device *pdev)
 		goto err_clks;
 
 	spin_lock_init(&qce->lock);
-	tasklet_init(&qce->done_tasklet, qce_tasklet_req_done,
-		     (unsigned long)qce);
-	crypto_init_queue(&qce->queue, QCE_QUEUE_LENGTH);
+	init_waitqueue_head(&qce->staged_wq);
+
+	qce->engine = crypto_engine_alloc_init_and_set(dev, true,
+						       qce_engine_do_batch,
+						       false, QCE_QUEUE_LENGTH);
+	if (!qce->engine) {
+		ret = -ENOMEM;
+		goto err_dma;
+	}
+	qce->engine->priv_data = qce;
+
+	ret = crypto_engine_start(qce->engine);
+	if (ret)
+		goto err_engine;
 
 	qce->async_req_enqueue = qce_async_request_enqueue;
 	qce->async_req_done = qce_async_request_done;
 
 	ret = qce_register_algs(qce);
 	if (ret)
-		goto err_dma;
+		goto err_engine;
+
+	qce->debugfs = debugfs_create_dir(dev_name(dev), qce_debugfs_root);
+	debugfs_create_file("stats", 0400, qce->debugfs, qce,
+			    &qce_stats_fops);
 
 	return 0;
 
+err_engine:
+	crypto_engine_exit(qce->engine);
 err_dma:
 	qce_dma_release(&qce->dma);
 err_clks:
@@ -263,8 +435,9 @@ static int qce_crypto_remove(struct platform_device *pdev)
 {
 	struct qce_device *qce = platform_get_drvdata(pdev);
 
-	tasklet_kill(&qce->done_tasklet);
+	debugfs_remove_recursive(qce->debugfs);
 	qce_unregister_algs(qce);
+	crypto_engine_exit(qce->engine);
 	qce_dma_release(&qce->dma);
 	clk_disable_unprepare(qce->bus);
 	clk_disable_unprepare(qce->iface);
@@ -287,7 +460,27 @@ static struct platform_driver qce_crypto_driver = {
 		.of_match_table = qce_crypto_of_match,
 	},
 };
-module_platform_driver(qce_crypto_driver);
+
+static int __init qce_crypto_init(void)
+{
+	int ret;
+
+	qce_debugfs_root = debugfs_create_dir("qcom_qce", NULL);
+
+	ret = platform_driver_register(&qce_crypto_driver);
+	if (ret)
+		debugfs_remove_recursive(qce_debugfs_root);
+
+	return ret;
+}
+module_init(qce_crypto_init);
+
+static void __exit qce_crypto_exit(void)
+{
+	platform_driver_unregister(&qce_crypto_driver);
+	debugfs_remove_recursive(qce_debugfs_root);
+}
+module_exit(qce_crypto_exit);
 
 MODULE_LICENSE("GPL v2");
 MODULE_DESCRIPTION("Qualcomm crypto engine driver");
@@ -6,15 +6,61 @@
 #ifndef _CORE_H_
 #define _CORE_H_
 
+#include <linux/ktime.h>
+#include <linux/wait.h>
+#include <crypto/engine.h>
+
 #include "dma.h"
 
+/* maximum number of prepared requests waiting for the hardware */
+#define QCE_BATCH_MAX		8
+
+/**
+ * struct qce_stats - request queue statistics
+ * @requests: requests handed to the hardware
+ * @errors: requests completed with an error
+ * @batched: requests started straight from the previous completion
+ * @batch_full: times the engine thread waited for a free batch slot
+ * @max_staged: highest number of prepared requests seen waiting
+ * @wait_ns: total time prepared requests waited for the hardware
+ * @max_wait_ns: longest time a prepared request waited for the hardware
+ * @busy_ns: total time the hardware spent on requests
+ * @max_busy_ns: longest time the hardware spent on a single request
+ */
+struct qce_stats {
+	u64 requests;
+	u64 errors;
+	u64 batched;
+	u64 batch_full;
+	unsigned int max_staged;
+	u64 wait_ns;
+	u64 max_wait_ns;
+	u64 busy_ns;
+	u64 max_busy_ns;
+};
+
+/**
+ * struct qce_staged_req - a prepared request waiting for the hardware
+ * @req: the request
+ * @queued: time the request was prepared
+ */
+struct qce_staged_req {
+	struct crypto_async_request *req;
+	ktime_t queued;
+};
+
 /**
  * struct qce_device - crypto engine device structure
- * @queue: crypto request queue
- * @lock: the lock protects queue and req
- * @done_tasklet: done tasklet object
+ * @engine: crypto engine feeding requests to the driver
+ * @lock: the lock protects the staged ring, req and stats
+ * @staged: ring of prepared requests waiting for the hardware
+ * @staged_head: index of the oldest prepared request
+ * @nstaged: number of prepared requests
+ * @staged_wq: wait queue for a free slot in the staged ring
  * @req: current active request
- * @result: result of current transform
+ * @req_start: time the current request was started
+ * @stats: request queue statistics
+ * @debugfs: debugfs directory of the device
  * @base: virtual IO base
  * @dev: pointer to device structure
  * @core: core device clock
@@ -27,11 +73,16 @@
  * @async_req_done: invoked by every algorithm to finish its request
  */
 struct qce_device {
-	struct crypto_queue queue;
+	struct crypto_engine *engine;
 	spinlock_t lock;
-	struct tasklet_struct done_tasklet;
+	struct qce_staged_req staged[QCE_BATCH_MAX];
+	unsigned int staged_head;
+	unsigned int nstaged;
+	wait_queue_head_t staged_wq;
 	struct crypto_async_request *req;
-	int result;
+	ktime_t req_start;
+	struct qce_stats stats;
+	struct dentry *debugfs;
 	void __iomem *base;
 	struct device *dev;
 	struct clk *core, *iface, *bus;
@@ -48,13 +99,22 @@ struct qce_device {
  * @type: should be CRYPTO_ALG_TYPE_XXX
  * @register_algs: invoked by core to register the algorithms
  * @unregister_algs: invoked by core to unregister the algorithms
- * @async_req_handle: invoked by core to handle enqueued request
+ * @async_req_prepare: invoked by core, from the engine thread, to allocate
+ *	and build everything the request needs ahead of starting it
+ * @async_req_unprepare: optional, invoked by core to release what prepare
+ *	allocated
+ * @async_req_handle: invoked by core to start a prepared request on the
+ *	hardware, possibly from the completion of the previous request
  */
 struct qce_algo_ops {
 	u32 type;
 	int (*register_algs)(struct qce_device *qce);
 	void (*unregister_algs)(struct qce_device *qce);
+	int (*async_req_prepare)(struct crypto_async_request *async_req);
+	void (*async_req_unprepare)(struct crypto_async_request *async_req);
 	int (*async_req_handle)(struct crypto_async_request *async_req);
 };
 
+void qce_init_engine_ctx(struct crypto_engine_ctx *enginectx);
+
 #endif /* _CORE_H_ */
@@ -66,7 +66,7 @@ static void qce_ahash_done(void *data)
 	qce->async_req_done(tmpl->qce, error);
 }
 
-static int qce_ahash_async_req_handle(struct crypto_async_request *async_req)
+static int qce_ahash_async_req_prepare(struct crypto_async_request *async_req)
 {
 	struct ahash_request *req = ahash_request_cast(async_req);
 	struct qce_sha_reqctx *rctx = ahash_request_ctx(req);
@@ -74,7 +74,6 @@ static int qce_ahash_async_req_handle(struct crypto_async_request *async_req)
 	struct qce_alg_template *tmpl = to_ahash_tmpl(async_req->tfm);
 	struct qce_device *qce = tmpl->qce;
 	unsigned long flags = rctx->flags;
-	int ret;
 
 	if (IS_SHA_HMAC(flags)) {
 		rctx->authkey = ctx->authkey;
@@ -90,12 +89,23 @@ static int qce_ahash_async_req_handle(struct crypto_async_request *async_req)
 		return rctx->src_nents;
 	}
 
+	sg_init_one(&rctx->result_sg, qce->dma.result_buf, QCE_RESULT_BUF_SZ);
+
+	return 0;
+}
+
+static int qce_ahash_async_req_handle(struct crypto_async_request *async_req)
+{
+	struct ahash_request *req = ahash_request_cast(async_req);
+	struct qce_sha_reqctx *rctx = ahash_request_ctx(req);
+	struct qce_alg_template *tmpl = to_ahash_tmpl(async_req->tfm);
+	struct qce_device *qce = tmpl->qce;
+	int ret;
+
 	ret = dma_map_sg(qce->dev, req->src, rctx->src_nents, DMA_TO_DEVICE);
 	if (ret < 0)
 		return ret;
 
-	sg_init_one(&rctx->result_sg, qce->dma.result_buf, QCE_RESULT_BUF_SZ);
-
 	ret = dma_map_sg(qce->dev, &rctx->result_sg, 1, DMA_FROM_DEVICE);
 	if (ret < 0)
 		goto error_unmap_src;
@@ -430,6 +440,7 @@ static int qce_ahash_cra_init(struct crypto_tfm *tfm)
 
 	crypto_ahash_set_reqsize(ahash, sizeof(struct qce_sha_reqctx));
 	memset(ctx, 0, sizeof(*ctx));
+	qce_init_engine_ctx(&ctx->enginectx);
 	return 0;
 }
 
@@ -574,5 +585,6 @@ const struct qce_algo_ops ahash_ops = {
 	.type = CRYPTO_ALG_TYPE_AHASH,
 	.register_algs = qce_ahash_register,
 	.unregister_algs = qce_ahash_unregister,
+	.async_req_prepare = qce_ahash_async_req_prepare,
 	.async_req_handle = qce_ahash_async_req_handle,
 };
@@ -17,6 +17,7 @@
 #define QCE_SHA_MAX_DIGESTSIZE		SHA256_DIGEST_SIZE
 
 struct qce_sha_ctx {
+	struct crypto_engine_ctx enginectx;	// keep at the beginning
 	u8 authkey[QCE_SHA_MAX_BLOCKSIZE];
 };
 
@@ -49,8 +49,6 @@ static void qce_skcipher_done(void *data)
 		dma_unmap_sg(qce->dev, rctx->src_sg, rctx->src_nents, dir_src);
 	dma_unmap_sg(qce->dev, rctx->dst_sg, rctx->dst_nents, dir_dst);
 
-	sg_free_table(&rctx->dst_tbl);
-
 	error = qce_check_status(qce, &status);
 	if (error < 0)
 		dev_dbg(qce->dev, "skcipher operation error (%x)\n", status);
@@ -60,14 +58,13 @@ static void qce_skcipher_done(void *data)
 }
 
 static int
-qce_skcipher_async_req_handle(struct crypto_async_request *async_req)
+qce_skcipher_async_req_prepare(struct crypto_async_request *async_req)
 {
 	struct skcipher_request *req = skcipher_request_cast(async_req);
 	struct qce_cipher_reqctx *rctx = skcipher_request_ctx(req);
 	struct crypto_skcipher *skcipher = crypto_skcipher_reqtfm(req);
 	struct qce_alg_template *tmpl = to_cipher_tmpl(crypto_skcipher_reqtfm(req));
 	struct qce_device *qce = tmpl->qce;
-	enum dma_data_direction dir_src, dir_dst;
 	struct scatterlist *sg;
 	bool diff_dst;
 	gfp_t gfp;
@@ -78,8 +75,6 @@ qce_skcipher_async_req_handle(struct crypto_async_request *async_req)
 	rctx->cryptlen = req->cryptlen;
 
 	diff_dst = (req->src != req->dst) ? true : false;
-	dir_src = diff_dst ? DMA_TO_DEVICE : DMA_BIDIRECTIONAL;
-	dir_dst = diff_dst ? DMA_FROM_DEVICE : DMA_BIDIRECTIONAL;
 
 	rctx->src_nents = sg_nents_for_len(req->src, req->cryptlen);
 	if (diff_dst)
@@ -121,18 +116,47 @@ qce_skcipher_async_req_handle(struct crypto_async_request *async_req)
 
 	sg_mark_end(sg);
 	rctx->dst_sg = rctx->dst_tbl.sgl;
+	rctx->src_sg = diff_dst ? req->src : rctx->dst_sg;
+
+	return 0;
+
+error_free:
+	sg_free_table(&rctx->dst_tbl);
+	return ret;
+}
+
+static void
+qce_skcipher_async_req_unprepare(struct crypto_async_request *async_req)
+{
+	struct skcipher_request *req = skcipher_request_cast(async_req);
+	struct qce_cipher_reqctx *rctx = skcipher_request_ctx(req);
+
+	sg_free_table(&rctx->dst_tbl);
+}
+
+static int
+qce_skcipher_async_req_handle(struct crypto_async_request *async_req)
+{
+	struct skcipher_request *req = skcipher_request_cast(async_req);
+	struct qce_cipher_reqctx *rctx = skcipher_request_ctx(req);
+	struct qce_alg_template *tmpl = to_cipher_tmpl(crypto_skcipher_reqtfm(req));
+	struct qce_device *qce = tmpl->qce;
+	enum dma_data_direction dir_src, dir_dst;
+	bool diff_dst;
+	int ret;
+
+	diff_dst = (req->src != req->dst) ? true : false;
+	dir_src = diff_dst ? DMA_TO_DEVICE : DMA_BIDIRECTIONAL;
+	dir_dst = diff_dst ? DMA_FROM_DEVICE : DMA_BIDIRECTIONAL;
 
 	ret = dma_map_sg(qce->dev, rctx->dst_sg, rctx->dst_nents, dir_dst);
 	if (ret < 0)
-		goto error_free;
+		return ret;
 
 	if (diff_dst) {
 		ret = dma_map_sg(qce->dev, req->src, rctx->src_nents, dir_src);
 		if (ret < 0)
 			goto error_unmap_dst;
-		rctx->src_sg = req->src;
-	} else {
-		rctx->src_sg = rctx->dst_sg;
 	}
 
 	ret = qce_dma_prep_sgs(&qce->dma, rctx->src_sg, rctx->src_nents,
@@ -156,8 +180,6 @@ qce_skcipher_async_req_handle(struct crypto_async_request *async_req)
 		dma_unmap_sg(qce->dev, req->src, rctx->src_nents, dir_src);
 error_unmap_dst:
 	dma_unmap_sg(qce->dev, rctx->dst_sg, rctx->dst_nents, dir_dst);
-error_free:
-	sg_free_table(&rctx->dst_tbl);
 	return ret;
 }
 
@@ -263,6 +285,10 @@ static int qce_skcipher_decrypt(struct skcipher_request *req)
 
 static int qce_skcipher_init(struct crypto_skcipher *tfm)
 {
+	struct qce_cipher_ctx *ctx = crypto_skcipher_ctx(tfm);
+
+	qce_init_engine_ctx(&ctx->enginectx);
+
 	/* take the size without the fallback skcipher_request at the end */
 	crypto_skcipher_set_reqsize(tfm, offsetof(struct qce_cipher_reqctx,
 						  fallback_req));
@@ -273,6 +299,8 @@ static int qce_skcipher_init_fallback(struct crypto_skcipher *tfm)
 {
 	struct qce_cipher_ctx *ctx = crypto_skcipher_ctx(tfm);
 
+	qce_init_engine_ctx(&ctx->enginectx);
+
 	ctx->fallback = crypto_alloc_skcipher(crypto_tfm_alg_name(&tfm->base),
 					      0, CRYPTO_ALG_NEED_FALLBACK);
 	if (IS_ERR(ctx->fallback))
@@ -469,5 +497,7 @@ const struct qce_algo_ops skcipher_ops = {
 	.type = CRYPTO_ALG_TYPE_SKCIPHER,
 	.register_algs = qce_skcipher_register,
 	.unregister_algs = qce_skcipher_unregister,
+	.async_req_prepare = qce_skcipher_async_req_prepare,
+	.async_req_unprepare = qce_skcipher_async_req_unprepare,
 	.async_req_handle = qce_skcipher_async_req_handle,
 };
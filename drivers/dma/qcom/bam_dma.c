@@ -40,7 +40,9 @@
 #include <linux/circ_buf.h>
 #include <linux/clk.h>
 #include <linux/dmaengine.h>
+#include <linux/dma/qcom_bam_dma.h>
 #include <linux/pm_runtime.h>
+#include <linux/seq_file.h>
 
 #include "../dmaengine.h"
 #include "../virt-dma.h"
@@ -367,6 +369,17 @@ struct bam_chan {
 	unsigned int initialized;	/* is the channel hw initialized? */
 	unsigned int paused;		/* is the channel paused? */
 	unsigned int reconfigure;	/* new slave config? */
+
+	/* interrupt coalescing, see qcom_bam_set_irq_coalesce() */
+	unsigned int irq_every;		/* hw descriptors per interrupt */
+	unsigned int since_irq;		/* hw descriptors queued since INT */
+
+	/* statistics */
+	u64 irq_count;			/* pipe interrupts */
+	u64 poll_count;			/* qcom_bam_poll_completed() calls */
+	u64 desc_count;			/* hw descriptors retired */
+	u64 xfer_count;			/* transactions completed */
+
 	/* list of descriptors currently processed */
 	struct list_head desc_list;
 
@@ -490,6 +503,7 @@ static void bam_chan_init_hw(struct bam_chan *bchan,
 	/* init FIFO pointers */
 	bchan->head = 0;
 	bchan->tail = 0;
+	bchan->since_irq = 0;
 }
 
 static void bam_reset(struct bam_device *bdev);
@@ -559,6 +573,8 @@ static void bam_free_chan(struct dma_chan *chan)
 
 	spin_lock_irqsave(&bchan->vc.lock, flags);
 	bam_reset_channel(bchan);
+	/* the next user of the channel starts without coalescing */
+	bchan->irq_every = 0;
 	spin_unlock_irqrestore(&bchan->vc.lock, flags);
 
 	dma_free_wc(bdev->dev, BAM_DESC_FIFO_SIZE, bchan->fifo_virt,
@@ -795,6 +811,70 @@ static int bam_resume(struct dma_chan *chan)
 	return 0;
 }
 
+/**
+ * bam_process_channel - retire the descriptors the hardware has consumed
+ * @bchan: bam dma channel
+ *
+ * Walks the in-flight transactions of the channel up to the current hardware
+ * FIFO offset.  Transactions that are done get their cookie completed, partly
+ * transferred ones are pushed back to be restarted by the tasklet.
+ *
+ * Returns the number of transactions that were completed.
+ */
+static unsigned int bam_process_channel(struct bam_chan *bchan)
+{
+	struct bam_device *bdev = bchan->bdev;
+	struct bam_async_desc *async_desc, *tmp;
+	unsigned int completed = 0;
+	u32 offset, avail;
+
+	lockdep_assert_held(&bchan->vc.lock);
+
+	offset = readl_relaxed(bam_addr(bdev, bchan->id, BAM_P_SW_OFSTS)) &
+			       P_SW_OFSTS_MASK;
+	offset /= sizeof(struct bam_desc_hw);
+
+	/* Number of bytes available to read */
+	avail = CIRC_CNT(offset, bchan->head, MAX_DESCRIPTORS + 1);
+
+	if (offset < bchan->head)
+		avail--;
+
+	list_for_each_entry_safe(async_desc, tmp,
+				 &bchan->desc_list, desc_node) {
+		/* Not enough data to read */
+		if (avail < async_desc->xfer_len)
+			break;
+
+		/* manage FIFO */
+		bchan->head += async_desc->xfer_len;
+		bchan->head %= MAX_DESCRIPTORS;
+
+		async_desc->num_desc -= async_desc->xfer_len;
+		async_desc->curr_desc += async_desc->xfer_len;
+		avail -= async_desc->xfer_len;
+		bchan->desc_count += async_desc->xfer_len;
+
+		/*
+		 * if complete, process cookie. Otherwise
+		 * push back to front of desc_issued so that
+		 * it gets restarted by the tasklet
+		 */
+		if (!async_desc->num_desc) {
+			vchan_cookie_complete(&async_desc->vd);
+			completed++;
+		} else {
+			list_add(&async_desc->vd.node,
+				 &bchan->vc.desc_issued);
+		}
+		list_del(&async_desc->desc_node);
+	}
+
+	bchan->xfer_count += completed;
+
+	return completed;
+}
+
 /**
  * process_channel_irqs - processes the channel interrupts
  * @bdev: bam controller
@@ -804,9 +884,8 @@ static int bam_resume(struct dma_chan *chan)
  */
 static u32 process_channel_irqs(struct bam_device *bdev)
 {
-	u32 i, srcs, pipe_stts, offset, avail;
+	u32 i, srcs, pipe_stts;
 	unsigned long flags;
-	struct bam_async_desc *async_desc, *tmp;
 
 	srcs = readl_relaxed(bam_addr(bdev, 0, BAM_IRQ_SRCS_EE));
 
@@ -826,45 +905,8 @@ static u32 process_channel_irqs(struct bam_device *bdev)
 		writel_relaxed(pipe_stts, bam_addr(bdev, i, BAM_P_IRQ_CLR));
 
 		spin_lock_irqsave(&bchan->vc.lock, flags);
-
-		offset = readl_relaxed(bam_addr(bdev, i, BAM_P_SW_OFSTS)) &
-				       P_SW_OFSTS_MASK;
-		offset /= sizeof(struct bam_desc_hw);
-
-		/* Number of bytes available to read */
-		avail = CIRC_CNT(offset, bchan->head, MAX_DESCRIPTORS + 1);
-
-		if (offset < bchan->head)
-			avail--;
-
-		list_for_each_entry_safe(async_desc, tmp,
-					 &bchan->desc_list, desc_node) {
-			/* Not enough data to read */
-			if (avail < async_desc->xfer_len)
-				break;
-
-			/* manage FIFO */
-			bchan->head += async_desc->xfer_len;
-			bchan->head %= MAX_DESCRIPTORS;
-
-			async_desc->num_desc -= async_desc->xfer_len;
-			async_desc->curr_desc += async_desc->xfer_len;
-			avail -= async_desc->xfer_len;
-
-			/*
-			 * if complete, process cookie. Otherwise
-			 * push back to front of desc_issued so that
-			 * it gets restarted by the tasklet
-			 */
-			if (!async_desc->num_desc) {
-				vchan_cookie_complete(&async_desc->vd);
-			} else {
-				list_add(&async_desc->vd.node,
-					 &bchan->vc.desc_issued);
-			}
-			list_del(&async_desc->desc_node);
-		}
-
+		bchan->irq_count++;
+		bam_process_channel(bchan);
 		spin_unlock_irqrestore(&bchan->vc.lock, flags);
 	}
 
@@ -1002,6 +1044,7 @@ static void bam_start_dma(struct bam_chan *bchan)
 	int ret;
 	unsigned int avail;
 	struct dmaengine_desc_callback cb;
+	bool irq;
 
 	lockdep_assert_held(&bchan->vc.lock);
 
@@ -1050,12 +1093,32 @@ static void bam_start_dma(struct bam_chan *bchan)
 		 *  - If a callback completion was requested for this DESC,
 		 *     In this case, BAM will deliver the completion callback
 		 *     for this desc and continue processing the next desc.
+		 *     When the client asked for interrupt coalescing, the
+		 *     callbacks are instead batched up until irq_every hw
+		 *     descriptors have been queued, and the last one only
+		 *     gets an interrupt if it has a callback. Others are
+		 *     left to qcom_bam_poll_completed().
+		 * EOT raises its own interrupt, so INT is not needed on top.
 		 */
-		if (((avail <= async_desc->xfer_len) || !vd ||
-		     dmaengine_desc_callback_valid(&cb)) &&
-		    !(async_desc->flags & DESC_FLAG_EOT))
+		bchan->since_irq += async_desc->xfer_len;
+		if (bchan->irq_every)
+			irq = bchan->since_irq >= bchan->irq_every;
+		else
+			irq = dmaengine_desc_callback_valid(&cb);
+
+		if (avail <= async_desc->xfer_len)
+			irq = true;
+		else if (!vd && (!bchan->irq_every ||
+				 dmaengine_desc_callback_valid(&cb)))
+			irq = true;
+
+		if (async_desc->flags & DESC_FLAG_EOT) {
+			bchan->since_irq = 0;
+		} else if (irq) {
 			desc[async_desc->xfer_len - 1].flags |=
 				cpu_to_le16(DESC_FLAG_INT);
+			bchan->since_irq = 0;
+		}
 
 		if (bchan->tail + async_desc->xfer_len > MAX_DESCRIPTORS) {
 			u32 partial = MAX_DESCRIPTORS - bchan->tail;
@@ -1130,6 +1193,127 @@ static void bam_issue_pending(struct dma_chan *chan)
 	spin_unlock_irqrestore(&bchan->vc.lock, flags);
 }
 
+static bool is_bam_chan(struct dma_chan *chan)
+{
+	return chan && chan->device->device_issue_pending == bam_issue_pending;
+}
+
+/**
+ * qcom_bam_set_irq_coalesce - coalesce the completion interrupts of a channel
+ * @chan: bam dma channel
+ * @every: number of hw descriptors per interrupt, 0 to restore the default
+ *
+ * By default an interrupt is requested for every transaction that has a
+ * completion callback.  With coalescing enabled the interrupt is only
+ * requested once @every hw descriptors have been queued, when the descriptor
+ * FIFO fills up or when the last issued transaction has been queued, if that
+ * one has a completion callback.  Transactions prepared with
+ * DMA_PREP_INTERRUPT still complete with EOT.
+ *
+ * Completion callbacks of the transactions in between are delivered in one
+ * batch when the interrupt fires, or earlier through qcom_bam_poll_completed().
+ * Transactions without a callback and without DMA_PREP_INTERRUPT are meant
+ * to be reaped by the client with qcom_bam_poll_completed().
+ *
+ * The setting is dropped when the channel is released.
+ *
+ * Returns 0 on success, -EINVAL if @chan is not a BAM channel.
+ */
+int qcom_bam_set_irq_coalesce(struct dma_chan *chan, unsigned int every)
+{
+	struct bam_chan *bchan;
+	unsigned long flags;
+
+	if (!is_bam_chan(chan))
+		return -EINVAL;
+
+	bchan = to_bam_chan(chan);
+
+	spin_lock_irqsave(&bchan->vc.lock, flags);
+	bchan->irq_every = min_t(unsigned int, every, MAX_DESCRIPTORS);
+	spin_unlock_irqrestore(&bchan->vc.lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(qcom_bam_set_irq_coalesce);
+
+/**
+ * qcom_bam_poll_completed - retire completed transactions without an interrupt
+ * @chan: bam dma channel
+ * @index: if not NULL, returns the hw descriptor FIFO index up to which all
+ *	   descriptors have been retired
+ *
+ * Completes the cookies of all transactions the hardware is done with and
+ * restarts the channel if there is more work queued, allowing clients that
+ * use interrupt coalescing to reap completions from their own context.
+ *
+ * Returns the number of transactions completed or a negative errno.
+ */
+int qcom_bam_poll_completed(struct dma_chan *chan, u32 *index)
+{
+	struct bam_device *bdev;
+	struct bam_chan *bchan;
+	unsigned long flags;
+	int completed;
+	int ret;
+
+	if (!is_bam_chan(chan))
+		return -EINVAL;
+
+	bchan = to_bam_chan(chan);
+	bdev = bchan->bdev;
+
+	ret = bam_pm_runtime_get_sync(bdev->dev);
+	if (ret < 0)
+		return ret;
+
+	spin_lock_irqsave(&bchan->vc.lock, flags);
+
+	bchan->poll_count++;
+	completed = bam_process_channel(bchan);
+
+	if (!list_empty(&bchan->vc.desc_issued) && !IS_BUSY(bchan))
+		bam_start_dma(bchan);
+
+	if (index)
+		*index = bchan->head;
+
+	spin_unlock_irqrestore(&bchan->vc.lock, flags);
+
+	pm_runtime_mark_last_busy(bdev->dev);
+	pm_runtime_put_autosuspend(bdev->dev);
+
+	return completed;
+}
+EXPORT_SYMBOL_GPL(qcom_bam_poll_completed);
+
+#ifdef CONFIG_DEBUG_FS
+static void bam_dbg_summary_show(struct seq_file *s, struct dma_device *dma_dev)
+{
+	struct bam_device *bdev = container_of(dma_dev, struct bam_device,
+					       common);
+	struct bam_chan *bchan;
+	unsigned long flags;
+	u32 i;
+
+	for (i = 0; i < bdev->num_channels; i++) {
+		bchan = &bdev->channels[i];
+
+		if (!bchan->vc.chan.client_count)
+			continue;
+
+		spin_lock_irqsave(&bchan->vc.lock, flags);
+		seq_printf(s, " %-13s| %s (irq_every %u, irqs %llu, polls %llu, descs %llu, xfers %llu)\n",
+			   dma_chan_name(&bchan->vc.chan),
+			   bchan->vc.chan.dbg_client_name ?: "in-use",
+			   bchan->irq_every, bchan->irq_count,
+			   bchan->poll_count, bchan->desc_count,
+			   bchan->xfer_count);
+		spin_unlock_irqrestore(&bchan->vc.lock, flags);
+	}
+}
+#endif /* CONFIG_DEBUG_FS */
+
 /**
  * bam_dma_free_desc - free descriptor memory
  * @vd: virtual descriptor
@@ -1367,6 +1551,9 @@ static int bam_dma_probe(struct platform_device *pdev)
 	bdev->common.device_issue_pending = bam_issue_pending;
 	bdev->common.device_tx_status = bam_tx_status;
 	bdev->common.dev = bdev->dev;
+#ifdef CONFIG_DEBUG_FS
+	bdev->common.dbg_summary_show = bam_dbg_summary_show;
+#endif
 
 	ret = dma_async_device_register(&bdev->common);
 	if (ret) {
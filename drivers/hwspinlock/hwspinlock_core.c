@@ -9,6 +9,7 @@
 
 #define pr_fmt(fmt)    "%s: " fmt, __func__
 
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
@@ -21,12 +22,21 @@
 #include <linux/pm_runtime.h>
 #include <linux/mutex.h>
 #include <linux/of.h>
+#include <linux/seq_file.h>
+#include <linux/timekeeping.h>
 
 #include "hwspinlock_internal.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/hwspinlock.h>
+
 /* retry delay used in atomic context */
 #define HWSPINLOCK_RETRY_DELAY_US	100
 
+/* bounds of the exponential backoff between two attempts to take a lock */
+#define HWSPINLOCK_BACKOFF_MIN_US	1
+#define HWSPINLOCK_BACKOFF_MAX_US	64
+
 /* radix tree tags */
 #define HWSPINLOCK_UNUSED	(0) /* tags an hwspinlock as unused */
 
@@ -56,6 +66,8 @@ static RADIX_TREE(hwspinlock_tree, GFP_KERNEL);
  */
 static DEFINE_MUTEX(hwspinlock_tree_lock);
 
+/* Root of the debugfs directories of the hwspinlock devices */
+static struct dentry *hwspinlock_debugfs_root;
 
 /**
  * __hwspin_trylock() - attempt to lock a specific hwspinlock
@@ -164,10 +176,38 @@ int __hwspin_trylock(struct hwspinlock *hwlock, int mode, unsigned long *flags)
 	 */
 	mb();
 
+	hwlock->locked_at = ktime_get_mono_fast_ns();
+	hwlock->stats.acquired++;
+	trace_hwspinlock_lock(hwlock_to_id(hwlock));
+
 	return 0;
 }
 EXPORT_SYMBOL_GPL(__hwspin_trylock);
 
+static void hwspin_lock_account_wait(struct hwspinlock *hwlock,
+				     unsigned int retries, u64 start)
+{
+	struct hwspinlock_stats *stats = &hwlock->stats;
+	u64 wait_ns = hwlock->locked_at - start;
+
+	stats->contended++;
+	stats->retries += retries;
+	stats->wait_ns += wait_ns;
+	stats->max_wait_ns = max(stats->max_wait_ns, wait_ns);
+
+	trace_hwspinlock_contended(hwlock_to_id(hwlock), retries, wait_ns);
+}
+
+static void hwspin_lock_account_timeout(struct hwspinlock *hwlock,
+					unsigned int retries, u64 start)
+{
+	u64 wait_ns = ktime_get_mono_fast_ns() - start;
+
+	atomic_inc(&hwlock->stats.timeouts);
+
+	trace_hwspinlock_timeout(hwlock_to_id(hwlock), retries, wait_ns);
+}
+
 /**
  * __hwspin_lock_timeout() - lock an hwspinlock with timeout limit
  * @hwlock: the hwspinlock to be locked
@@ -199,6 +239,12 @@ EXPORT_SYMBOL_GPL(__hwspin_trylock);
  * to choose the appropriate @mode of operation, exactly the same way users
  * should decide between spin_lock, spin_lock_irq and spin_lock_irqsave.
  *
+ * If backoff is enabled for the @hwlock, the delay between two attempts to
+ * take it grows exponentially, from HWSPINLOCK_BACKOFF_MIN_US up to
+ * HWSPINLOCK_BACKOFF_MAX_US, instead of the platform-specific relax handler
+ * being used. This does not apply to HWLOCK_IN_ATOMIC, which already waits
+ * HWSPINLOCK_RETRY_DELAY_US between attempts.
+ *
  * Returns 0 when the @hwlock was successfully taken, and an appropriate
  * error code otherwise (most notably -ETIMEDOUT if the @hwlock is still
  * busy after @timeout msecs). The function will never sleep.
@@ -208,6 +254,9 @@ int __hwspin_lock_timeout(struct hwspinlock *hwlock, unsigned int to,
 {
 	int ret;
 	unsigned long expire, atomic_delay = 0;
+	unsigned int backoff = HWSPINLOCK_BACKOFF_MIN_US;
+	unsigned int retries = 0;
+	u64 start = 0;
 
 	expire = msecs_to_jiffies(to) + jiffies;
 
@@ -217,6 +266,9 @@ int __hwspin_lock_timeout(struct hwspinlock *hwlock, unsigned int to,
 		if (ret != -EBUSY)
 			break;
 
+		if (!retries++)
+			start = ktime_get_mono_fast_ns();
+
 		/*
 		 * The lock is already taken, let's check if the user wants
 		 * us to try again
@@ -224,21 +276,35 @@ int __hwspin_lock_timeout(struct hwspinlock *hwlock, unsigned int to,
 		if (mode == HWLOCK_IN_ATOMIC) {
 			udelay(HWSPINLOCK_RETRY_DELAY_US);
 			atomic_delay += HWSPINLOCK_RETRY_DELAY_US;
-			if (atomic_delay > to * 1000)
+			if (atomic_delay > to * 1000) {
+				hwspin_lock_account_timeout(hwlock, retries,
+							    start);
 				return -ETIMEDOUT;
+			}
 		} else {
-			if (time_is_before_eq_jiffies(expire))
+			if (time_is_before_eq_jiffies(expire)) {
+				hwspin_lock_account_timeout(hwlock, retries,
+							    start);
 				return -ETIMEDOUT;
+			}
 		}
 
 		/*
-		 * Allow platform-specific relax handlers to prevent
-		 * hogging the interconnect (no sleeping, though)
+		 * Back off, or allow platform-specific relax handlers to
+		 * prevent hogging the interconnect (no sleeping, though)
 		 */
-		if (hwlock->bank->ops->relax)
+		if (READ_ONCE(hwlock->backoff) && mode != HWLOCK_IN_ATOMIC) {
+			udelay(backoff);
+			backoff = min_t(unsigned int, backoff * 2,
+					HWSPINLOCK_BACKOFF_MAX_US);
+		} else if (hwlock->bank->ops->relax) {
 			hwlock->bank->ops->relax(hwlock);
+		}
 	}
 
+	if (!ret && retries)
+		hwspin_lock_account_wait(hwlock, retries, start);
+
 	return ret;
 }
 EXPORT_SYMBOL_GPL(__hwspin_lock_timeout);
@@ -264,9 +330,19 @@ EXPORT_SYMBOL_GPL(__hwspin_lock_timeout);
  */
 void __hwspin_unlock(struct hwspinlock *hwlock, int mode, unsigned long *flags)
 {
+	struct hwspinlock_stats *stats;
+	u64 hold_ns;
+
 	if (WARN_ON(!hwlock || (!flags && mode == HWLOCK_IRQSTATE)))
 		return;
 
+	/* Account the hold time while we still own the lock */
+	stats = &hwlock->stats;
+	hold_ns = ktime_get_mono_fast_ns() - hwlock->locked_at;
+	stats->hold_ns += hold_ns;
+	stats->max_hold_ns = max(stats->max_hold_ns, hold_ns);
+	trace_hwspinlock_unlock(hwlock_to_id(hwlock), hold_ns);
+
 	/*
 	 * We must make sure that memory operations (both reads and writes),
 	 * done before unlocking the hwspinlock, will not be reordered
@@ -418,6 +494,61 @@ int of_hwspin_lock_get_id_byname(struct device_node *np, const char *name)
 }
 EXPORT_SYMBOL_GPL(of_hwspin_lock_get_id_byname);
 
+#ifdef CONFIG_DEBUG_FS
+static int hwspin_lock_stats_show(struct seq_file *s, void *unused)
+{
+	struct hwspinlock *hwlock = s->private;
+	struct hwspinlock_stats *stats = &hwlock->stats;
+
+	seq_printf(s, "acquired: %llu\n", stats->acquired);
+	seq_printf(s, "contended: %llu\n", stats->contended);
+	seq_printf(s, "retries: %llu\n", stats->retries);
+	seq_printf(s, "timeouts: %d\n", atomic_read(&stats->timeouts));
+	seq_printf(s, "avg wait: %llu ns\n",
+		   stats->contended ?
+		   div64_u64(stats->wait_ns, stats->contended) : 0);
+	seq_printf(s, "max wait: %llu ns\n", stats->max_wait_ns);
+	seq_printf(s, "avg hold: %llu ns\n",
+		   stats->acquired ?
+		   div64_u64(stats->hold_ns, stats->acquired) : 0);
+	seq_printf(s, "max hold: %llu ns\n", stats->max_hold_ns);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(hwspin_lock_stats);
+
+static void hwspin_lock_debugfs_init(struct hwspinlock_device *bank)
+{
+	struct hwspinlock *hwlock;
+	struct dentry *dir;
+	char name[16];
+	int i;
+
+	mutex_lock(&hwspinlock_tree_lock);
+	if (!hwspinlock_debugfs_root)
+		hwspinlock_debugfs_root = debugfs_create_dir("hwspinlock", NULL);
+	mutex_unlock(&hwspinlock_tree_lock);
+
+	bank->debugfs = debugfs_create_dir(dev_name(bank->dev),
+					   hwspinlock_debugfs_root);
+
+	for (i = 0; i < bank->num_locks; i++) {
+		hwlock = &bank->lock[i];
+
+		snprintf(name, sizeof(name), "%d", hwlock_to_id(hwlock));
+		dir = debugfs_create_dir(name, bank->debugfs);
+
+		debugfs_create_file("stats", 0400, dir, hwlock,
+				    &hwspin_lock_stats_fops);
+		debugfs_create_bool("backoff", 0600, dir, &hwlock->backoff);
+	}
+}
+#else
+static void hwspin_lock_debugfs_init(struct hwspinlock_device *bank)
+{
+}
+#endif
+
 static int hwspin_lock_register_single(struct hwspinlock *hwlock, int id)
 {
 	struct hwspinlock *tmp;
@@ -511,6 +642,8 @@ int hwspin_lock_register(struct hwspinlock_device *bank, struct device *dev,
 			goto reg_failed;
 	}
 
+	hwspin_lock_debugfs_init(bank);
+
 	return 0;
 
 reg_failed:
@@ -547,6 +680,8 @@ int hwspin_lock_unregister(struct hwspinlock_device *bank)
 		WARN_ON(tmp != hwlock);
 	}
 
+	debugfs_remove_recursive(bank->debugfs);
+
 	return 0;
 }
 EXPORT_SYMBOL_GPL(hwspin_lock_unregister);
@@ -13,6 +13,7 @@
 #include <linux/spinlock.h>
 #include <linux/device.h>
 
+struct dentry;
 struct hwspinlock_device;
 
 /**
@@ -31,16 +32,48 @@ struct hwspinlock_ops {
 	void (*relax)(struct hwspinlock *lock);
 };
 
+/**
+ * struct hwspinlock_stats - contention statistics of a hwspinlock
+ * @acquired: number of times the lock was taken
+ * @contended: number of acquisitions that found the lock busy at first
+ * @retries: number of failed attempts to take the lock
+ * @timeouts: number of acquisitions that gave up waiting for the lock
+ * @wait_ns: accumulated time spent waiting for the lock
+ * @max_wait_ns: longest time spent waiting for the lock
+ * @hold_ns: accumulated time the lock was held
+ * @max_hold_ns: longest time the lock was held
+ *
+ * All but @timeouts are only updated by the owner of the lock.
+ */
+struct hwspinlock_stats {
+	u64 acquired;
+	u64 contended;
+	u64 retries;
+	atomic_t timeouts;
+	u64 wait_ns;
+	u64 max_wait_ns;
+	u64 hold_ns;
+	u64 max_hold_ns;
+};
+
 /**
  * struct hwspinlock - this struct represents a single hwspinlock instance
  * @bank: the hwspinlock_device structure which owns this lock
  * @lock: initialized and used by hwspinlock core
  * @priv: private data, owned by the underlying platform-specific hwspinlock drv
+ * @backoff: wait with exponentially increasing delays between two attempts
+ *	     to take a busy lock, rather than spinning on it. may be set by the
+ *	     underlying platform-specific hwspinlock drv before registration
+ * @locked_at: time in ns the lock was last taken, used by hwspinlock core
+ * @stats: contention statistics, maintained by hwspinlock core
  */
 struct hwspinlock {
 	struct hwspinlock_device *bank;
 	spinlock_t lock;
 	void *priv;
+	bool backoff;
+	u64 locked_at;
+	struct hwspinlock_stats stats;
 };
 
 /**
@@ -49,6 +82,7 @@ struct hwspinlock {
  * @ops: platform-specific hwspinlock handlers
  * @base_id: id index of the first lock in this device
  * @num_locks: number of locks in this device
+ * @debugfs: debugfs directory of this device
  * @lock: dynamically allocated array of 'struct hwspinlock'
  */
 struct hwspinlock_device {
@@ -56,6 +90,7 @@ struct hwspinlock_device {
 	const struct hwspinlock_ops *ops;
 	int base_id;
 	int num_locks;
+	struct dentry *debugfs;
 	struct hwspinlock lock[];
 };
 
@@ -157,6 +157,12 @@ static int qcom_hwspinlock_probe(struct platform_device *pdev)
 
 		bank->lock[i].priv = devm_regmap_field_alloc(&pdev->dev,
 							     regmap, field);
+
+		/*
+		 * The locks are shared with the modem and DSPs, back off
+		 * rather than hammering the TCSR while they hold one.
+		 */
+		bank->lock[i].backoff = true;
 	}
 
 	return devm_hwspin_lock_register(&pdev->dev, bank, &qcom_hwspinlock_ops,
@@ -8,6 +8,7 @@
 #include <linux/acpi.h>
 #include <linux/atomic.h>
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/dmaengine.h>
 #include <linux/dmapool.h>
@@ -16,11 +17,14 @@
 #include <linux/i2c.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
 #include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 
 /* QUP Registers */
 #define QUP_CONFIG		0x000
@@ -150,10 +154,26 @@
 /* TAG length for DATA READ in RX FIFO  */
 #define READ_RX_TAGS_LEN		2
 
+/* log2(us) transfer latency buckets, the last one is open ended */
+#define QUP_LAT_BUCKETS			16
+
 static unsigned int scl_freq;
 module_param_named(scl_freq, scl_freq, uint, 0444);
 MODULE_PARM_DESC(scl_freq, "SCL frequency override");
 
+static bool dma_chain;
+module_param(dma_chain, bool, 0644);
+MODULE_PARM_DESC(dma_chain,
+		 "Chain multi-message transfers with DMA safe buffers through BAM");
+
+static struct dentry *qup_i2c_debugfs_root;
+
+enum qup_lat_mode {
+	QUP_LAT_FIFO,
+	QUP_LAT_DMA,
+	QUP_LAT_NR,
+};
+
 /*
  * count: no of blocks
  * pos: current block number
@@ -268,6 +288,10 @@ struct qup_i2c_dev {
 	struct			qup_i2c_bam brx;
 	struct			qup_i2c_bam btx;
 
+	/* transfer latency histograms, updated with the adapter locked */
+	u64			lat_hist[QUP_LAT_NR][QUP_LAT_BUCKETS];
+	struct dentry		*debugfs;
+
 	struct completion	xfer;
 	/* function to write data in tx fifo */
 	void (*write_tx_fifo)(struct qup_i2c_dev *qup);
@@ -277,6 +301,16 @@ struct qup_i2c_dev {
 	void (*write_rx_tags)(struct qup_i2c_dev *qup);
 };
 
+static void qup_i2c_account_latency(struct qup_i2c_dev *qup,
+				    enum qup_lat_mode mode, u64 start)
+{
+	u64 us = div_u64(ktime_get_ns() - start, NSEC_PER_USEC);
+	unsigned int bucket = us ? ilog2(us) + 1 : 0;
+
+	qup->lat_hist[mode][min_t(unsigned int, bucket,
+				  QUP_LAT_BUCKETS - 1)]++;
+}
+
 static irqreturn_t qup_i2c_interrupt(int irq, void *dev)
 {
 	struct qup_i2c_dev *qup = dev;
@@ -1064,12 +1098,14 @@ static int qup_i2c_xfer(struct i2c_adapter *adap,
 			int num)
 {
 	struct qup_i2c_dev *qup = i2c_get_adapdata(adap);
+	u64 start;
 	int ret, idx;
 
 	ret = pm_runtime_get_sync(qup->dev);
 	if (ret < 0)
 		goto out;
 
+	start = ktime_get_ns();
 	qup->bus_err = 0;
 	qup->qup_err = 0;
 
@@ -1106,8 +1142,10 @@ static int qup_i2c_xfer(struct i2c_adapter *adap,
 			break;
 	}
 
-	if (ret == 0)
+	if (ret == 0) {
+		qup_i2c_account_latency(qup, QUP_LAT_FIFO, start);
 		ret = num;
+	}
 out:
 
 	pm_runtime_mark_last_busy(qup->dev);
@@ -1504,7 +1542,7 @@ qup_i2c_determine_mode_v2(struct qup_i2c_dev *qup,
 			  struct i2c_msg msgs[], int num)
 {
 	int idx;
-	bool no_dma = false;
+	bool no_dma = false, chain = dma_chain && num > 1;
 	unsigned int max_tx_len = 0, max_rx_len = 0, total_len = 0;
 
 	/* All i2c_msgs should be transferred using either dma or cpu */
@@ -1519,11 +1557,28 @@ qup_i2c_determine_mode_v2(struct qup_i2c_dev *qup,
 		if (is_vmalloc_addr(msgs[idx].buf))
 			no_dma = true;
 
+		/* the BAM chain can't adjust to a length read from the bus */
+		if (qup_i2c_check_msg_len(&msgs[idx]))
+			chain = false;
+
+		/*
+		 * Short messages often live on the stack or in a struct, only
+		 * chain them when the caller vouched for the buffers.
+		 */
+		if (!(msgs[idx].flags & I2C_M_DMA_SAFE))
+			chain = false;
+
 		total_len += msgs[idx].len;
 	}
 
+	/*
+	 * A chained transfer has its tags and data for all the messages in
+	 * one descriptor chain and completes with a single interrupt, which
+	 * beats the per message FIFO servicing even for short messages.
+	 */
 	if (!no_dma && qup->is_dma &&
-	    (total_len > qup->out_fifo_sz || total_len > qup->in_fifo_sz)) {
+	    (chain || total_len > qup->out_fifo_sz ||
+	     total_len > qup->in_fifo_sz)) {
 		qup->use_dma = true;
 	} else {
 		qup->blk.is_tx_blk_mode = max_tx_len > qup->out_fifo_sz -
@@ -1540,7 +1595,9 @@ static int qup_i2c_xfer_v2(struct i2c_adapter *adap,
 			   int num)
 {
 	struct qup_i2c_dev *qup = i2c_get_adapdata(adap);
+	enum qup_lat_mode lat_mode = QUP_LAT_FIFO;
 	int ret, idx = 0;
+	u64 start;
 
 	qup->bus_err = 0;
 	qup->qup_err = 0;
@@ -1549,6 +1606,8 @@ static int qup_i2c_xfer_v2(struct i2c_adapter *adap,
 	if (ret < 0)
 		goto out;
 
+	start = ktime_get_ns();
+
 	ret = qup_i2c_determine_mode_v2(qup, msgs, num);
 	if (ret)
 		goto out;
@@ -1571,6 +1630,7 @@ static int qup_i2c_xfer_v2(struct i2c_adapter *adap,
 		reinit_completion(&qup->xfer);
 		ret = qup_i2c_bam_xfer(adap, &msgs[0], num);
 		qup->use_dma = false;
+		lat_mode = QUP_LAT_DMA;
 	} else {
 		qup_i2c_conf_mode_v2(qup);
 
@@ -1592,8 +1652,10 @@ static int qup_i2c_xfer_v2(struct i2c_adapter *adap,
 	if (!ret)
 		qup_i2c_change_state(qup, QUP_RESET_STATE);
 
-	if (ret == 0)
+	if (ret == 0) {
+		qup_i2c_account_latency(qup, lat_mode, start);
 		ret = num;
+	}
 out:
 	pm_runtime_mark_last_busy(qup->dev);
 	pm_runtime_put_autosuspend(qup->dev);
@@ -1601,6 +1663,30 @@ static int qup_i2c_xfer_v2(struct i2c_adapter *adap,
 	return ret;
 }
 
+static int qup_i2c_latency_show(struct seq_file *s, void *unused)
+{
+	struct qup_i2c_dev *qup = s->private;
+	int i;
+
+	i2c_lock_bus(&qup->adap, I2C_LOCK_ROOT_ADAPTER);
+
+	seq_printf(s, "%-10s %12s %12s\n", "us", "fifo", "dma");
+	for (i = 0; i < QUP_LAT_BUCKETS; i++) {
+		if (i == QUP_LAT_BUCKETS - 1)
+			seq_printf(s, ">=%-8lu", BIT(i - 1));
+		else
+			seq_printf(s, "<%-9lu", BIT(i));
+		seq_printf(s, " %12llu %12llu\n",
+			   qup->lat_hist[QUP_LAT_FIFO][i],
+			   qup->lat_hist[QUP_LAT_DMA][i]);
+	}
+
+	i2c_unlock_bus(&qup->adap, I2C_LOCK_ROOT_ADAPTER);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(qup_i2c_latency);
+
 static u32 qup_i2c_func(struct i2c_adapter *adap)
 {
 	return I2C_FUNC_I2C | (I2C_FUNC_SMBUS_EMUL & ~I2C_FUNC_SMBUS_QUICK);
@@ -1889,6 +1975,11 @@ static int qup_i2c_probe(struct platform_device *pdev)
 	if (ret)
 		goto fail_runtime;
 
+	qup->debugfs = debugfs_create_dir(dev_name(qup->dev),
+					  qup_i2c_debugfs_root);
+	debugfs_create_file("xfer_latency", 0400, qup->debugfs, qup,
+			    &qup_i2c_latency_fops);
+
 	return 0;
 
 fail_runtime:
@@ -1908,6 +1999,8 @@ static int qup_i2c_remove(struct platform_device *pdev)
 {
 	struct qup_i2c_dev *qup = platform_get_drvdata(pdev);
 
+	debugfs_remove_recursive(qup->debugfs);
+
 	if (qup->is_dma) {
 		dma_release_channel(qup->btx.dma);
 		dma_release_channel(qup->brx.dma);
@@ -1987,7 +2080,26 @@ static struct platform_driver qup_i2c_driver = {
 	},
 };
 
-module_platform_driver(qup_i2c_driver);
+static int __init qup_i2c_init(void)
+{
+	int ret;
+
+	qup_i2c_debugfs_root = debugfs_create_dir("i2c_qup", NULL);
+
+	ret = platform_driver_register(&qup_i2c_driver);
+	if (ret)
+		debugfs_remove_recursive(qup_i2c_debugfs_root);
+
+	return ret;
+}
+module_init(qup_i2c_init);
+
+static void __exit qup_i2c_exit(void)
+{
+	platform_driver_unregister(&qup_i2c_driver);
+	debugfs_remove_recursive(qup_i2c_debugfs_root);
+}
+module_exit(qup_i2c_exit);
 
 MODULE_LICENSE("GPL v2");
 MODULE_ALIAS("platform:i2c_qup");
@@ -416,24 +416,27 @@ static struct msm8953_icc_desc msm8953_sysmmnoc = {
 static void msm8953_bimc_node_init(struct msm8953_icc_node *qn,
 				  struct regmap* rmap)
 {
-	int health_lvl;
+	struct reg_update health[3];
+	int health_lvl, i;
 	u32 bke_en = 0;
 
 	switch (qn->qos_mode) {
 	case QOS_FIXED:
 		for (health_lvl = 0; health_lvl < 4; health_lvl++) {
-			regmap_update_bits(rmap, BIMC_BKE_HEALTH_REG(qn->qport, health_lvl),
-						 BIMC_BKE_HEALTH_AREQPRIO_MASK,
-						 qn->prio1 << BIMC_BKE_HEALTH_AREQPRIO_SHIFT);
-
-			regmap_update_bits(rmap, BIMC_BKE_HEALTH_REG(qn->qport, health_lvl),
-						 BIMC_BKE_HEALTH_PRIOLVL_MASK,
-						 qn->prio0 << BIMC_BKE_HEALTH_PRIOLVL_SHIFT);
-
-			if (health_lvl < 3)
-				regmap_update_bits(rmap,
-						   BIMC_BKE_HEALTH_REG(qn->qport, health_lvl),
-						   BIMC_BKE_HEALTH_LIMIT_CMDS_MASK, 0);
+			for (i = 0; i < ARRAY_SIZE(health); i++)
+				health[i].reg = BIMC_BKE_HEALTH_REG(qn->qport,
+								    health_lvl);
+
+			health[0].mask = BIMC_BKE_HEALTH_AREQPRIO_MASK;
+			health[0].val = qn->prio1 << BIMC_BKE_HEALTH_AREQPRIO_SHIFT;
+			health[1].mask = BIMC_BKE_HEALTH_PRIOLVL_MASK;
+			health[1].val = qn->prio0 << BIMC_BKE_HEALTH_PRIOLVL_SHIFT;
+			health[2].mask = BIMC_BKE_HEALTH_LIMIT_CMDS_MASK;
+			health[2].val = 0;
+
+			/* One RMW per level, level 3 has no limit */
+			regmap_multi_reg_update_bits(rmap, health,
+						     health_lvl < 3 ? 3 : 2);
 		}
 		bke_en = 1 << BIMC_BKE_ENA_SHIFT;
 		break;
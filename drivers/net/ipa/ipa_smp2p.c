@@ -91,6 +91,9 @@ static void ipa_smp2p_notify(struct ipa_smp2p *smp2p)
 
 	smp2p->clock_on = ipa_clock_get_additional(smp2p->ipa);
 
+	/* Signal both bits to the modem with a single interrupt */
+	qcom_smem_state_begin(smp2p->enabled_state);
+
 	/* Signal whether the clock is enabled */
 	mask = BIT(smp2p->enabled_bit);
 	value = smp2p->clock_on ? mask : 0;
@@ -101,6 +104,8 @@ static void ipa_smp2p_notify(struct ipa_smp2p *smp2p)
 	value = mask;
 	qcom_smem_state_update_bits(smp2p->valid_state, mask, value);
 
+	qcom_smem_state_commit(smp2p->enabled_state);
+
 	smp2p->notified = true;
 }
 
@@ -330,6 +335,8 @@ void ipa_smp2p_notify_reset(struct ipa *ipa)
 
 	ipa_smp2p_clock_release(ipa);
 
+	qcom_smem_state_begin(smp2p->valid_state);
+
 	/* Reset the clock enabled valid flag */
 	mask = BIT(smp2p->valid_bit);
 	qcom_smem_state_update_bits(smp2p->valid_state, mask, 0);
@@ -338,5 +345,7 @@ void ipa_smp2p_notify_reset(struct ipa *ipa)
 	mask = BIT(smp2p->enabled_bit);
 	qcom_smem_state_update_bits(smp2p->enabled_state, mask, 0);
 
+	qcom_smem_state_commit(smp2p->valid_state);
+
 	smp2p->notified = false;
 }
@@ -6,7 +6,9 @@
 
 #include <linux/delay.h>
 #include <linux/err.h>
+#include <linux/hashtable.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
@@ -34,6 +36,27 @@
 #define MAX_NR_GPIO 300
 #define MAX_NR_TILES 4
 #define PS_HOLD_OFFSET 0x820
+#define CONF_IMAGE_HASH_BITS 6
+
+/**
+ * struct msm_conf_image - group configuration compiled into register values
+ * @node:     entry in the hash of compiled configurations.
+ * @configs:  configuration array the image was compiled from.
+ * @group:    group the configuration applies to.
+ * @ctl_mask: bits of the CTL register affected by the configuration.
+ * @ctl_val:  value of the @ctl_mask bits.
+ * @io_mask:  bits of the IO register affected by the configuration.
+ * @io_val:   value of the @io_mask bits.
+ */
+struct msm_conf_image {
+	struct hlist_node node;
+	const unsigned long *configs;
+	unsigned group;
+	u32 ctl_mask;
+	u32 ctl_val;
+	u32 io_mask;
+	u32 io_val;
+};
 
 /**
  * struct msm_pinctrl - state for a pinctrl-msm device
@@ -54,6 +77,15 @@
  * @soc:            Reference to soc_data of platform specific data.
  * @regs:           Base addresses for the TLMM tiles.
  * @phys_base:      Physical base address
+ * @conf_images:    Configurations of the DT pinctrl maps, compiled into
+ *                  register values as the maps are created.
+ * @stat_settings:  Number of mux and config settings applied. Like the other
+ *                  statistics, only kept with CONFIG_DEBUG_FS.
+ * @stat_apply_ns:  Accumulated time spent applying settings.
+ * @stat_apply_max_ns: Longest time spent applying a setting.
+ * @stat_writes:    Register writes issued by settings.
+ * @stat_elided:    Register writes skipped by settings, as the register
+ *                  already held the value.
  */
 struct msm_pinctrl {
 	struct device *dev;
@@ -76,6 +108,16 @@ struct msm_pinctrl {
 	const struct msm_pinctrl_soc_data *soc;
 	void __iomem *regs[MAX_NR_TILES];
 	u32 phys_base[MAX_NR_TILES];
+
+	DECLARE_HASHTABLE(conf_images, CONF_IMAGE_HASH_BITS);
+
+#ifdef CONFIG_DEBUG_FS
+	u64 stat_settings;
+	u64 stat_apply_ns;
+	u64 stat_apply_max_ns;
+	u64 stat_writes;
+	u64 stat_elided;
+#endif
 };
 
 #define MSM_ACCESSOR(name) \
@@ -96,6 +138,55 @@ MSM_ACCESSOR(intr_cfg)
 MSM_ACCESSOR(intr_status)
 MSM_ACCESSOR(intr_target)
 
+#ifdef CONFIG_DEBUG_FS
+#define msm_stat_inc(pctrl, stat)	((pctrl)->stat_##stat++)
+
+static ktime_t msm_setting_begin(void)
+{
+	return ktime_get();
+}
+
+static void msm_account_setting(struct msm_pinctrl *pctrl, ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	pctrl->stat_settings++;
+	pctrl->stat_apply_ns += ns;
+	pctrl->stat_apply_max_ns = max(pctrl->stat_apply_max_ns, ns);
+}
+#else
+#define msm_stat_inc(pctrl, stat)	do { } while (0)
+
+static ktime_t msm_setting_begin(void)
+{
+	return 0;
+}
+
+static void msm_account_setting(struct msm_pinctrl *pctrl, ktime_t start)
+{
+}
+#endif
+
+/*
+ * Update the @mask bits of a register of a setting to @val, skipping the
+ * write if they already hold it. Must be called with pctrl->lock held.
+ */
+static void msm_update_bits(struct msm_pinctrl *pctrl, void __iomem *reg,
+			    u32 mask, u32 val)
+{
+	u32 old, new;
+
+	old = readl(reg);
+	new = (old & ~mask) | val;
+	if (new == old) {
+		msm_stat_inc(pctrl, elided);
+		return;
+	}
+
+	writel(new, reg);
+	msm_stat_inc(pctrl, writes);
+}
+
 static int msm_get_groups_count(struct pinctrl_dev *pctldev)
 {
 	struct msm_pinctrl *pctrl = pinctrl_dev_get_drvdata(pctldev);
@@ -123,12 +214,114 @@ static int msm_get_group_pins(struct pinctrl_dev *pctldev,
 	return 0;
 }
 
+static int msm_config_compile(struct msm_pinctrl *pctrl,
+			      unsigned group,
+			      const unsigned long *configs,
+			      unsigned num_configs,
+			      struct msm_conf_image *img);
+
+static int msm_find_group(struct msm_pinctrl *pctrl, const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < pctrl->soc->ngroups; i++)
+		if (!strcmp(pctrl->soc->groups[i].name, name))
+			return i;
+
+	return -EINVAL;
+}
+
+static int msm_dt_node_to_map(struct pinctrl_dev *pctldev,
+			      struct device_node *np_config,
+			      struct pinctrl_map **map,
+			      unsigned *num_maps)
+{
+	struct msm_pinctrl *pctrl = pinctrl_dev_get_drvdata(pctldev);
+	struct msm_conf_image *img;
+	struct pinctrl_map *m;
+	unsigned long flags;
+	int group;
+	int ret;
+	int i;
+
+	ret = pinconf_generic_dt_node_to_map_group(pctldev, np_config, map,
+						   num_maps);
+	if (ret)
+		return ret;
+
+	/*
+	 * Compile the configurations once, so that applying them later on
+	 * costs a single update of the registers of each group. Failures
+	 * aren't fatal, the configuration is then compiled as it's applied.
+	 */
+	for (i = 0; i < *num_maps; i++) {
+		m = &(*map)[i];
+		if (m->type != PIN_MAP_TYPE_CONFIGS_GROUP)
+			continue;
+
+		group = msm_find_group(pctrl, m->data.configs.group_or_pin);
+		if (group < 0)
+			continue;
+
+		img = kzalloc(sizeof(*img), GFP_KERNEL);
+		if (!img)
+			continue;
+
+		ret = msm_config_compile(pctrl, group, m->data.configs.configs,
+					 m->data.configs.num_configs, img);
+		if (ret) {
+			kfree(img);
+			continue;
+		}
+
+		raw_spin_lock_irqsave(&pctrl->lock, flags);
+		hash_add(pctrl->conf_images, &img->node,
+			 (unsigned long)img->configs);
+		raw_spin_unlock_irqrestore(&pctrl->lock, flags);
+	}
+
+	return 0;
+}
+
+static void msm_dt_free_map(struct pinctrl_dev *pctldev,
+			    struct pinctrl_map *map,
+			    unsigned num_maps)
+{
+	struct msm_pinctrl *pctrl = pinctrl_dev_get_drvdata(pctldev);
+	struct msm_conf_image *img;
+	unsigned long *configs;
+	unsigned long flags;
+	int i;
+
+	for (i = 0; i < num_maps; i++) {
+		if (map[i].type != PIN_MAP_TYPE_CONFIGS_GROUP)
+			continue;
+
+		configs = map[i].data.configs.configs;
+
+		raw_spin_lock_irqsave(&pctrl->lock, flags);
+		hash_for_each_possible(pctrl->conf_images, img, node,
+				       (unsigned long)configs) {
+			if (img->configs == configs) {
+				hash_del(&img->node);
+				break;
+			}
+		}
+		raw_spin_unlock_irqrestore(&pctrl->lock, flags);
+
+		/* The loop cursor is NULL if nothing was found */
+		kfree(img);
+	}
+
+	pinctrl_utils_free_map(pctldev, map, num_maps);
+}
+
 static const struct pinctrl_ops msm_pinctrl_ops = {
 	.get_groups_count	= msm_get_groups_count,
 	.get_group_name		= msm_get_group_name,
 	.get_group_pins		= msm_get_group_pins,
-	.dt_node_to_map		= pinconf_generic_dt_node_to_map_group,
-	.dt_free_map		= pinctrl_utils_free_map,
+	.dt_node_to_map		= msm_dt_node_to_map,
+	.dt_free_map		= msm_dt_free_map,
 };
 
 static int msm_pinmux_request(struct pinctrl_dev *pctldev, unsigned offset)
@@ -172,8 +365,9 @@ static int msm_pinmux_set_mux(struct pinctrl_dev *pctldev,
 {
 	struct msm_pinctrl *pctrl = pinctrl_dev_get_drvdata(pctldev);
 	const struct msm_pingroup *g;
+	ktime_t start = msm_setting_begin();
 	unsigned long flags;
-	u32 val, mask;
+	u32 mask;
 	int i;
 
 	g = &pctrl->soc->groups[group];
@@ -189,10 +383,9 @@ static int msm_pinmux_set_mux(struct pinctrl_dev *pctldev,
 
 	raw_spin_lock_irqsave(&pctrl->lock, flags);
 
-	val = msm_readl_ctl(pctrl, g);
-	val &= ~mask;
-	val |= i << g->mux_bit;
-	msm_writel_ctl(val, pctrl, g);
+	msm_update_bits(pctrl, pctrl->regs[g->tile] + g->ctl_reg, mask,
+			i << g->mux_bit);
+	msm_account_setting(pctrl, start);
 
 	raw_spin_unlock_irqrestore(&pctrl->lock, flags);
 
@@ -350,24 +543,33 @@ static int msm_config_group_get(struct pinctrl_dev *pctldev,
 	return 0;
 }
 
-static int msm_config_group_set(struct pinctrl_dev *pctldev,
-				unsigned group,
-				unsigned long *configs,
-				unsigned num_configs)
+/*
+ * Compile a list of configurations of a group into the final values of the
+ * affected CTL and IO register bits.
+ */
+static int msm_config_compile(struct msm_pinctrl *pctrl,
+			      unsigned group,
+			      const unsigned long *configs,
+			      unsigned num_configs,
+			      struct msm_conf_image *img)
 {
 	const struct msm_pingroup *g;
-	struct msm_pinctrl *pctrl = pinctrl_dev_get_drvdata(pctldev);
-	unsigned long flags;
 	unsigned param;
 	unsigned mask;
 	unsigned arg;
 	unsigned bit;
 	int ret;
-	u32 val;
 	int i;
 
 	g = &pctrl->soc->groups[group];
 
+	img->configs = configs;
+	img->group = group;
+	img->ctl_mask = 0;
+	img->ctl_val = 0;
+	img->io_mask = 0;
+	img->io_val = 0;
+
 	for (i = 0; i < num_configs; i++) {
 		param = pinconf_to_config_param(configs[i]);
 		arg = pinconf_to_config_argument(configs[i]);
@@ -408,14 +610,11 @@ static int msm_config_group_set(struct pinctrl_dev *pctldev,
 			break;
 		case PIN_CONFIG_OUTPUT:
 			/* set output value */
-			raw_spin_lock_irqsave(&pctrl->lock, flags);
-			val = msm_readl_io(pctrl, g);
+			img->io_mask |= BIT(g->out_bit);
 			if (arg)
-				val |= BIT(g->out_bit);
+				img->io_val |= BIT(g->out_bit);
 			else
-				val &= ~BIT(g->out_bit);
-			msm_writel_io(val, pctrl, g);
-			raw_spin_unlock_irqrestore(&pctrl->lock, flags);
+				img->io_val &= ~BIT(g->out_bit);
 
 			/* enable output */
 			arg = 1;
@@ -436,14 +635,67 @@ static int msm_config_group_set(struct pinctrl_dev *pctldev,
 			return -EINVAL;
 		}
 
-		raw_spin_lock_irqsave(&pctrl->lock, flags);
-		val = msm_readl_ctl(pctrl, g);
-		val &= ~(mask << bit);
-		val |= arg << bit;
-		msm_writel_ctl(val, pctrl, g);
+		img->ctl_mask |= mask << bit;
+		img->ctl_val &= ~(mask << bit);
+		img->ctl_val |= arg << bit;
+	}
+
+	return 0;
+}
+
+static int msm_config_group_set(struct pinctrl_dev *pctldev,
+				unsigned group,
+				unsigned long *configs,
+				unsigned num_configs)
+{
+	const struct msm_pingroup *g;
+	struct msm_pinctrl *pctrl = pinctrl_dev_get_drvdata(pctldev);
+	const struct msm_conf_image *img = NULL;
+	struct msm_conf_image *iter;
+	struct msm_conf_image tmp;
+	ktime_t start = msm_setting_begin();
+	unsigned long flags;
+	void __iomem *base;
+	int ret;
+
+	g = &pctrl->soc->groups[group];
+	base = pctrl->regs[g->tile];
+
+	raw_spin_lock_irqsave(&pctrl->lock, flags);
+
+	hash_for_each_possible(pctrl->conf_images, iter, node,
+			       (unsigned long)configs) {
+		if (iter->configs == configs && iter->group == group) {
+			img = iter;
+			break;
+		}
+	}
+
+	/* Not a DT map, compile the configuration on the spot */
+	if (!img) {
 		raw_spin_unlock_irqrestore(&pctrl->lock, flags);
+
+		ret = msm_config_compile(pctrl, group, configs, num_configs,
+					 &tmp);
+		if (ret < 0)
+			return ret;
+
+		img = &tmp;
+		raw_spin_lock_irqsave(&pctrl->lock, flags);
 	}
 
+	/* The output value goes first, as output is enabled in CTL */
+	if (img->io_mask)
+		msm_update_bits(pctrl, base + g->io_reg, img->io_mask,
+				img->io_val);
+	if (img->ctl_mask)
+		msm_update_bits(pctrl, base + g->ctl_reg, img->ctl_mask,
+				img->ctl_val);
+
+	msm_account_setting(pctrl, start);
+
+	raw_spin_unlock_irqrestore(&pctrl->lock, flags);
+
 	return 0;
 }
 
@@ -548,6 +800,7 @@ static void msm_gpio_set(struct gpio_chip *chip, unsigned offset, int value)
 }
 
 #ifdef CONFIG_DEBUG_FS
+#include <linux/debugfs.h>
 #include <linux/seq_file.h>
 
 static void msm_gpio_dbg_show_one(struct seq_file *s,
@@ -614,8 +867,43 @@ static void msm_gpio_dbg_show(struct seq_file *s, struct gpio_chip *chip)
 		msm_gpio_dbg_show_one(s, NULL, chip, i, gpio);
 }
 
+static int msm_pinctrl_stats_show(struct seq_file *s, void *unused)
+{
+	struct msm_pinctrl *pctrl = s->private;
+	unsigned long flags;
+	u64 settings, apply_ns, apply_max_ns, writes, elided;
+
+	raw_spin_lock_irqsave(&pctrl->lock, flags);
+	settings = pctrl->stat_settings;
+	apply_ns = pctrl->stat_apply_ns;
+	apply_max_ns = pctrl->stat_apply_max_ns;
+	writes = pctrl->stat_writes;
+	elided = pctrl->stat_elided;
+	raw_spin_unlock_irqrestore(&pctrl->lock, flags);
+
+	seq_printf(s, "settings applied: %llu\n", settings);
+	seq_printf(s, "average apply time: %llu ns\n",
+		   settings ? div64_u64(apply_ns, settings) : 0);
+	seq_printf(s, "max apply time: %llu ns\n", apply_max_ns);
+	seq_printf(s, "register writes: %llu\n", writes);
+	seq_printf(s, "elided writes: %llu\n", elided);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(msm_pinctrl_stats);
+
+static void msm_pinctrl_debugfs_init(struct msm_pinctrl *pctrl)
+{
+	debugfs_create_file("msm-stats", 0400, pctrl->pctrl->device_root,
+			    pctrl, &msm_pinctrl_stats_fops);
+}
+
 #else
 #define msm_gpio_dbg_show NULL
+
+static void msm_pinctrl_debugfs_init(struct msm_pinctrl *pctrl)
+{
+}
 #endif
 
 static int msm_gpio_init_valid_mask(struct gpio_chip *gc,
@@ -1387,6 +1675,7 @@ int msm_pinctrl_probe(struct platform_device *pdev,
 					"qcom,ipq8064-pinctrl");
 
 	raw_spin_lock_init(&pctrl->lock);
+	hash_init(pctrl->conf_images);
 
 	if (soc_data->tiles) {
 		for (i = 0; i < soc_data->ntiles; i++) {
@@ -1429,6 +1718,8 @@ int msm_pinctrl_probe(struct platform_device *pdev,
 	if (ret)
 		return ret;
 
+	msm_pinctrl_debugfs_init(pctrl);
+
 	platform_set_drvdata(pdev, pctrl);
 
 	dev_dbg(&pdev->dev, "Probed Qualcomm pinctrl driver\n");
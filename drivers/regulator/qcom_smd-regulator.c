@@ -4,12 +4,29 @@
  * Copyright (c) 2012-2013, The Linux Foundation. All rights reserved.
  */
 
+#include <linux/debugfs.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/driver.h>
+#include <linux/seq_file.h>
 #include <linux/soc/qcom/smd-rpm.h>
+#include <linux/workqueue.h>
+
+/*
+ * Window during which requests that lower the voltage or load of an enabled
+ * regulator are held back, to be merged with the requests following them.
+ */
+#define RPM_REG_COALESCE_MS	10
+
+enum {
+	RPM_REG_SWEN,
+	RPM_REG_UV,
+	RPM_REG_MA,
+	RPM_REG_NUM_KEYS,
+};
 
 struct qcom_rpm_reg {
 	struct device *dev;
@@ -21,6 +38,9 @@ struct qcom_rpm_reg {
 
 	struct regulator_desc desc;
 
+	struct mutex lock;
+	struct delayed_work flush_work;
+
 	int is_enabled;
 	int uV;
 	u32 load;
@@ -28,6 +48,14 @@ struct qcom_rpm_reg {
 	unsigned int enabled_updated:1;
 	unsigned int uv_updated:1;
 	unsigned int load_updated:1;
+
+	/* Last values acknowledged by the RPM, valid if set in acked_valid */
+	u32 acked[RPM_REG_NUM_KEYS];
+	unsigned long acked_valid;
+
+	u64 stat_sent;
+	u64 stat_suppressed;
+	u64 stat_deferred;
 };
 
 struct rpm_regulator_req {
@@ -40,41 +68,96 @@ struct rpm_regulator_req {
 #define RPM_KEY_UV	0x00007675 /* "uv" */
 #define RPM_KEY_MA	0x0000616d /* "ma" */
 
+static const u32 rpm_reg_keys[RPM_REG_NUM_KEYS] = {
+	[RPM_REG_SWEN] = RPM_KEY_SWEN,
+	[RPM_REG_UV] = RPM_KEY_UV,
+	[RPM_REG_MA] = RPM_KEY_MA,
+};
+
+static bool rpm_reg_is_acked(struct qcom_rpm_reg *vreg, int idx, u32 value)
+{
+	return test_bit(idx, &vreg->acked_valid) && vreg->acked[idx] == value;
+}
+
+static void rpm_reg_add_req(struct qcom_rpm_reg *vreg,
+			    struct rpm_regulator_req *req, int *reqlen,
+			    u32 *values, int idx, u32 value)
+{
+	/* The RPM already holds this value, don't ask for it again */
+	if (rpm_reg_is_acked(vreg, idx, value))
+		return;
+
+	req[*reqlen].key = cpu_to_le32(rpm_reg_keys[idx]);
+	req[*reqlen].nbytes = cpu_to_le32(sizeof(u32));
+	req[*reqlen].value = cpu_to_le32(value);
+	(*reqlen)++;
+
+	values[idx] = value;
+}
+
+/* Must be called with vreg->lock held */
 static int rpm_reg_write_active(struct qcom_rpm_reg *vreg)
 {
-	struct rpm_regulator_req req[3];
+	struct rpm_regulator_req req[RPM_REG_NUM_KEYS];
+	u32 values[RPM_REG_NUM_KEYS];
+	unsigned long sent = 0;
+	bool pending;
 	int reqlen = 0;
 	int ret;
+	int i;
+
+	/* Any request held back goes out with this one */
+	cancel_delayed_work(&vreg->flush_work);
+
+	pending = vreg->enabled_updated ||
+		  (vreg->is_enabled && (vreg->uv_updated || vreg->load_updated));
 
 	if (vreg->enabled_updated) {
-		req[reqlen].key = cpu_to_le32(RPM_KEY_SWEN);
-		req[reqlen].nbytes = cpu_to_le32(sizeof(u32));
-		req[reqlen].value = cpu_to_le32(vreg->is_enabled);
-		reqlen++;
+		rpm_reg_add_req(vreg, req, &reqlen, values, RPM_REG_SWEN,
+				vreg->is_enabled);
+		if (reqlen)
+			__set_bit(RPM_REG_SWEN, &sent);
 	}
 
 	if (vreg->uv_updated && vreg->is_enabled) {
-		req[reqlen].key = cpu_to_le32(RPM_KEY_UV);
-		req[reqlen].nbytes = cpu_to_le32(sizeof(u32));
-		req[reqlen].value = cpu_to_le32(vreg->uV);
-		reqlen++;
+		i = reqlen;
+		rpm_reg_add_req(vreg, req, &reqlen, values, RPM_REG_UV,
+				vreg->uV);
+		if (reqlen != i)
+			__set_bit(RPM_REG_UV, &sent);
 	}
 
 	if (vreg->load_updated && vreg->is_enabled) {
-		req[reqlen].key = cpu_to_le32(RPM_KEY_MA);
-		req[reqlen].nbytes = cpu_to_le32(sizeof(u32));
-		req[reqlen].value = cpu_to_le32(vreg->load / 1000);
-		reqlen++;
+		i = reqlen;
+		rpm_reg_add_req(vreg, req, &reqlen, values, RPM_REG_MA,
+				vreg->load / 1000);
+		if (reqlen != i)
+			__set_bit(RPM_REG_MA, &sent);
 	}
 
-	if (!reqlen)
-		return 0;
+	if (!reqlen) {
+		if (pending)
+			vreg->stat_suppressed++;
+		ret = 0;
+		goto out;
+	}
 
 	ret = qcom_rpm_smd_write(vreg->rpm, QCOM_SMD_RPM_ACTIVE_STATE,
 				 vreg->type, vreg->id,
 				 req, sizeof(req[0]) * reqlen);
-	if (!ret) {
-		vreg->enabled_updated = 0;
+	if (ret)
+		return ret;
+
+	vreg->stat_sent++;
+
+	for_each_set_bit(i, &sent, RPM_REG_NUM_KEYS) {
+		vreg->acked[i] = values[i];
+		__set_bit(i, &vreg->acked_valid);
+	}
+
+out:
+	vreg->enabled_updated = 0;
+	if (vreg->is_enabled) {
 		vreg->uv_updated = 0;
 		vreg->load_updated = 0;
 	}
@@ -82,11 +165,51 @@ static int rpm_reg_write_active(struct qcom_rpm_reg *vreg)
 	return ret;
 }
 
+static void rpm_reg_flush_work(struct work_struct *work)
+{
+	struct qcom_rpm_reg *vreg = container_of(to_delayed_work(work),
+						 struct qcom_rpm_reg,
+						 flush_work);
+	int ret;
+
+	mutex_lock(&vreg->lock);
+	ret = rpm_reg_write_active(vreg);
+	mutex_unlock(&vreg->lock);
+
+	if (ret)
+		dev_err(vreg->dev, "failed to send deferred request for %s: %d\n",
+			vreg->desc.name, ret);
+}
+
+/*
+ * Lowering the voltage or load of an enabled regulator can be held back for a
+ * short while without harm, so that a following change supersedes it or goes
+ * out in the same message. Anything else is sent right away.
+ */
+static bool rpm_reg_can_defer(struct qcom_rpm_reg *vreg, int idx, u32 value)
+{
+	if (!vreg->is_enabled || !test_bit(idx, &vreg->acked_valid))
+		return false;
+
+	return value < vreg->acked[idx];
+}
+
+static int rpm_reg_defer(struct qcom_rpm_reg *vreg)
+{
+	vreg->stat_deferred++;
+	schedule_delayed_work(&vreg->flush_work,
+			      msecs_to_jiffies(RPM_REG_COALESCE_MS));
+
+	return 0;
+}
+
 static int rpm_reg_enable(struct regulator_dev *rdev)
 {
 	struct qcom_rpm_reg *vreg = rdev_get_drvdata(rdev);
 	int ret;
 
+	mutex_lock(&vreg->lock);
+
 	vreg->is_enabled = 1;
 	vreg->enabled_updated = 1;
 
@@ -94,6 +217,8 @@ static int rpm_reg_enable(struct regulator_dev *rdev)
 	if (ret)
 		vreg->is_enabled = 0;
 
+	mutex_unlock(&vreg->lock);
+
 	return ret;
 }
 
@@ -109,6 +234,8 @@ static int rpm_reg_disable(struct regulator_dev *rdev)
 	struct qcom_rpm_reg *vreg = rdev_get_drvdata(rdev);
 	int ret;
 
+	mutex_lock(&vreg->lock);
+
 	vreg->is_enabled = 0;
 	vreg->enabled_updated = 1;
 
@@ -116,6 +243,8 @@ static int rpm_reg_disable(struct regulator_dev *rdev)
 	if (ret)
 		vreg->is_enabled = 1;
 
+	mutex_unlock(&vreg->lock);
+
 	return ret;
 }
 
@@ -133,30 +262,53 @@ static int rpm_reg_set_voltage(struct regulator_dev *rdev,
 {
 	struct qcom_rpm_reg *vreg = rdev_get_drvdata(rdev);
 	int ret;
-	int old_uV = vreg->uV;
+	int old_uV;
+
+	mutex_lock(&vreg->lock);
 
+	old_uV = vreg->uV;
 	vreg->uV = min_uV;
 	vreg->uv_updated = 1;
 
+	if (rpm_reg_can_defer(vreg, RPM_REG_UV, min_uV)) {
+		ret = rpm_reg_defer(vreg);
+		goto out;
+	}
+
 	ret = rpm_reg_write_active(vreg);
 	if (ret)
 		vreg->uV = old_uV;
 
+out:
+	mutex_unlock(&vreg->lock);
+
 	return ret;
 }
 
 static int rpm_reg_set_load(struct regulator_dev *rdev, int load_uA)
 {
 	struct qcom_rpm_reg *vreg = rdev_get_drvdata(rdev);
-	u32 old_load = vreg->load;
+	u32 old_load;
 	int ret;
 
+	mutex_lock(&vreg->lock);
+
+	old_load = vreg->load;
 	vreg->load = load_uA;
 	vreg->load_updated = 1;
+
+	if (rpm_reg_can_defer(vreg, RPM_REG_MA, load_uA / 1000)) {
+		ret = rpm_reg_defer(vreg);
+		goto out;
+	}
+
 	ret = rpm_reg_write_active(vreg);
 	if (ret)
 		vreg->load = old_load;
 
+out:
+	mutex_unlock(&vreg->lock);
+
 	return ret;
 }
 
@@ -1107,6 +1259,41 @@ static const struct of_device_id rpm_of_match[] = {
 };
 MODULE_DEVICE_TABLE(of, rpm_of_match);
 
+#ifdef CONFIG_DEBUG_FS
+static int rpm_reg_stats_show(struct seq_file *s, void *unused)
+{
+	struct qcom_rpm_reg *vreg = s->private;
+
+	mutex_lock(&vreg->lock);
+	seq_printf(s, "sent: %llu\n", vreg->stat_sent);
+	seq_printf(s, "suppressed: %llu\n", vreg->stat_suppressed);
+	seq_printf(s, "deferred: %llu\n", vreg->stat_deferred);
+	mutex_unlock(&vreg->lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(rpm_reg_stats);
+
+static void rpm_reg_debugfs_init(struct qcom_rpm_reg *vreg,
+				 struct regulator_dev *rdev)
+{
+	debugfs_create_file("rpm_stats", 0400, rdev->debugfs, vreg,
+			    &rpm_reg_stats_fops);
+}
+#else
+static void rpm_reg_debugfs_init(struct qcom_rpm_reg *vreg,
+				 struct regulator_dev *rdev)
+{
+}
+#endif
+
+static void rpm_reg_cancel_flush(void *data)
+{
+	struct qcom_rpm_reg *vreg = data;
+
+	cancel_delayed_work_sync(&vreg->flush_work);
+}
+
 static int rpm_reg_probe(struct platform_device *pdev)
 {
 	const struct rpm_regulator_data *reg;
@@ -1115,6 +1302,7 @@ static int rpm_reg_probe(struct platform_device *pdev)
 	struct regulator_dev *rdev;
 	struct qcom_rpm_reg *vreg;
 	struct qcom_smd_rpm *rpm;
+	int ret;
 
 	rpm = dev_get_drvdata(pdev->dev.parent);
 	if (!rpm) {
@@ -1137,6 +1325,13 @@ static int rpm_reg_probe(struct platform_device *pdev)
 		vreg->type = reg->type;
 		vreg->id = reg->id;
 		vreg->rpm = rpm;
+		mutex_init(&vreg->lock);
+		INIT_DELAYED_WORK(&vreg->flush_work, rpm_reg_flush_work);
+
+		ret = devm_add_action_or_reset(&pdev->dev, rpm_reg_cancel_flush,
+					       vreg);
+		if (ret)
+			return ret;
 
 		memcpy(&vreg->desc, reg->desc, sizeof(vreg->desc));
 
@@ -1154,6 +1349,8 @@ static int rpm_reg_probe(struct platform_device *pdev)
 			dev_err(&pdev->dev, "failed to register %s\n", reg->name);
 			return PTR_ERR(rdev);
 		}
+
+		rpm_reg_debugfs_init(vreg, rdev);
 	}
 
 	return 0;
@@ -1353,10 +1353,14 @@ EXPORT_SYMBOL(rproc_resource_cleanup);
 
 static int rproc_start(struct rproc *rproc, const struct firmware *fw)
 {
+	struct rproc_boot_timing *timing = &rproc->boot_timing;
 	struct resource_table *loaded_table;
 	struct device *dev = &rproc->dev;
+	ktime_t t;
 	int ret;
 
+	t = ktime_get();
+
 	/* load the ELF segments to memory */
 	ret = rproc_load_segments(rproc, fw);
 	if (ret) {
@@ -1364,6 +1368,8 @@ static int rproc_start(struct rproc *rproc, const struct firmware *fw)
 		return ret;
 	}
 
+	timing->load = ktime_sub(ktime_get(), t);
+
 	/*
 	 * The starting device has been given the rproc->cached_table as the
 	 * resource table. The address of the vring along with the other
@@ -1378,6 +1384,8 @@ static int rproc_start(struct rproc *rproc, const struct firmware *fw)
 		rproc->table_ptr = loaded_table;
 	}
 
+	t = ktime_get();
+
 	ret = rproc_prepare_subdevices(rproc);
 	if (ret) {
 		dev_err(dev, "failed to prepare subdevices for %s: %d\n",
@@ -1385,6 +1393,9 @@ static int rproc_start(struct rproc *rproc, const struct firmware *fw)
 		goto reset_table_ptr;
 	}
 
+	timing->subdevs = ktime_sub(ktime_get(), t);
+	t = ktime_get();
+
 	/* power up the remote processor */
 	ret = rproc->ops->start(rproc);
 	if (ret) {
@@ -1392,6 +1403,9 @@ static int rproc_start(struct rproc *rproc, const struct firmware *fw)
 		goto unprepare_subdevices;
 	}
 
+	timing->start = ktime_sub(ktime_get(), t);
+	t = ktime_get();
+
 	/* Start any subdevices for the remote processor */
 	ret = rproc_start_subdevices(rproc);
 	if (ret) {
@@ -1400,9 +1414,13 @@ static int rproc_start(struct rproc *rproc, const struct firmware *fw)
 		goto stop_rproc;
 	}
 
+	timing->subdevs = ktime_add(timing->subdevs, ktime_sub(ktime_get(), t));
+	timing->total = ktime_sub(ktime_get(), timing->begin);
+
 	rproc->state = RPROC_RUNNING;
 
-	dev_info(dev, "remote processor %s is now up\n", rproc->name);
+	dev_info(dev, "remote processor %s is now up (%lld ms)\n", rproc->name,
+		 ktime_to_ms(timing->total));
 
 	return 0;
 
@@ -1465,6 +1483,7 @@ static int rproc_fw_boot(struct rproc *rproc, const struct firmware *fw)
 {
 	struct device *dev = &rproc->dev;
 	const char *name = rproc->firmware;
+	ktime_t t = ktime_get();
 	int ret;
 
 	ret = rproc_fw_sanity_check(rproc, fw);
@@ -1518,6 +1537,8 @@ static int rproc_fw_boot(struct rproc *rproc, const struct firmware *fw)
 		goto clean_up_resources;
 	}
 
+	rproc->boot_timing.prepare = ktime_sub(ktime_get(), t);
+
 	ret = rproc_start(rproc, fw);
 	if (ret)
 		goto clean_up_resources;
@@ -1594,6 +1615,8 @@ static int rproc_actuate(struct rproc *rproc)
 	return ret;
 }
 
+static int __rproc_boot(struct rproc *rproc, const struct firmware *fw);
+
 /*
  * take a firmware and boot it up.
  *
@@ -1601,12 +1624,16 @@ static int rproc_actuate(struct rproc *rproc)
  * remote processor (so we must wait until it completes before we try
  * to unregister the device. one other option is just to use kref here,
  * that might be cleaner).
+ *
+ * The firmware loaded by the asynchronous request is handed to the boot
+ * path, so independent remote processors load and authenticate their images
+ * concurrently and each image is only read once.
  */
 static void rproc_auto_boot_callback(const struct firmware *fw, void *context)
 {
 	struct rproc *rproc = context;
 
-	rproc_boot(rproc);
+	__rproc_boot(rproc, fw);
 
 	release_firmware(fw);
 }
@@ -1628,6 +1655,7 @@ static int rproc_trigger_auto_boot(struct rproc *rproc)
 	 * We're initiating an asynchronous firmware loading, so we can
 	 * be built-in kernel code, without hanging the boot process.
 	 */
+	rproc->boot_timing.begin = ktime_get();
 	ret = request_firmware_nowait(THIS_MODULE, FW_ACTION_HOTPLUG,
 				      rproc->firmware, &rproc->dev, GFP_KERNEL,
 				      rproc, rproc_auto_boot_callback);
@@ -1707,12 +1735,17 @@ int rproc_trigger_recovery(struct rproc *rproc)
 	rproc->ops->coredump(rproc);
 
 	/* load firmware */
+	rproc->boot_timing.begin = ktime_get();
 	ret = request_firmware(&firmware_p, rproc->firmware, dev);
 	if (ret < 0) {
 		dev_err(dev, "request_firmware failed: %d\n", ret);
 		goto unlock_mutex;
 	}
 
+	rproc->boot_timing.firmware = ktime_sub(ktime_get(),
+						rproc->boot_timing.begin);
+	rproc->boot_timing.prepare = 0;
+
 	/* boot the remote processor up again */
 	ret = rproc_start(rproc, firmware_p);
 
@@ -1757,20 +1790,13 @@ static void rproc_crash_handler_work(struct work_struct *work)
 	pm_relax(rproc->dev.parent);
 }
 
-/**
- * rproc_boot() - boot a remote processor
- * @rproc: handle of a remote processor
- *
- * Boot a remote processor (i.e. load its firmware, power it on, ...).
- *
- * If the remote processor is already powered on, this function immediately
- * returns (successfully).
- *
- * Returns 0 on success, and an appropriate error value otherwise.
+/*
+ * Boot the remote processor using @fw, or with a freshly requested firmware
+ * image if @fw is NULL.
  */
-int rproc_boot(struct rproc *rproc)
+static int __rproc_boot(struct rproc *rproc, const struct firmware *fw)
 {
-	const struct firmware *firmware_p;
+	const struct firmware *firmware_p = fw;
 	struct device *dev;
 	int ret;
 
@@ -1807,15 +1833,22 @@ int rproc_boot(struct rproc *rproc)
 		dev_info(dev, "powering up %s\n", rproc->name);
 
 		/* load firmware */
-		ret = request_firmware(&firmware_p, rproc->firmware, dev);
-		if (ret < 0) {
-			dev_err(dev, "request_firmware failed: %d\n", ret);
-			goto downref_rproc;
+		if (!firmware_p) {
+			rproc->boot_timing.begin = ktime_get();
+			ret = request_firmware(&firmware_p, rproc->firmware, dev);
+			if (ret < 0) {
+				dev_err(dev, "request_firmware failed: %d\n", ret);
+				goto downref_rproc;
+			}
 		}
 
+		rproc->boot_timing.firmware = ktime_sub(ktime_get(),
+							rproc->boot_timing.begin);
+
 		ret = rproc_fw_boot(rproc, firmware_p);
 
-		release_firmware(firmware_p);
+		if (firmware_p != fw)
+			release_firmware(firmware_p);
 	}
 
 downref_rproc:
@@ -1825,6 +1858,22 @@ int rproc_boot(struct rproc *rproc)
 	mutex_unlock(&rproc->lock);
 	return ret;
 }
+
+/**
+ * rproc_boot() - boot a remote processor
+ * @rproc: handle of a remote processor
+ *
+ * Boot a remote processor (i.e. load its firmware, power it on, ...).
+ *
+ * If the remote processor is already powered on, this function immediately
+ * returns (successfully).
+ *
+ * Returns 0 on success, and an appropriate error value otherwise.
+ */
+int rproc_boot(struct rproc *rproc)
+{
+	return __rproc_boot(rproc, NULL);
+}
 EXPORT_SYMBOL(rproc_boot);
 
 /**
@@ -378,6 +378,26 @@ static int rproc_carveouts_show(struct seq_file *seq, void *p)
 
 DEFINE_SHOW_ATTRIBUTE(rproc_carveouts);
 
+/* Expose the timing breakdown of the last boot via debugfs */
+static int rproc_boot_timing_show(struct seq_file *seq, void *p)
+{
+	struct rproc *rproc = seq->private;
+	struct rproc_boot_timing *timing = &rproc->boot_timing;
+
+	mutex_lock(&rproc->lock);
+	seq_printf(seq, "firmware: %lld us\n", ktime_to_us(timing->firmware));
+	seq_printf(seq, "prepare: %lld us\n", ktime_to_us(timing->prepare));
+	seq_printf(seq, "load: %lld us\n", ktime_to_us(timing->load));
+	seq_printf(seq, "start: %lld us\n", ktime_to_us(timing->start));
+	seq_printf(seq, "subdevices: %lld us\n", ktime_to_us(timing->subdevs));
+	seq_printf(seq, "total: %lld us\n", ktime_to_us(timing->total));
+	mutex_unlock(&rproc->lock);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(rproc_boot_timing);
+
 void rproc_remove_trace_file(struct dentry *tfile)
 {
 	debugfs_remove(tfile);
@@ -426,6 +446,8 @@ void rproc_create_debug_dir(struct rproc *rproc)
 			    rproc, &rproc_carveouts_fops);
 	debugfs_create_file("coredump", 0600, rproc->dbg_dir,
 			    rproc, &rproc_coredump_fops);
+	debugfs_create_file("boot_timing", 0400, rproc->dbg_dir,
+			    rproc, &rproc_boot_timing_fops);
 }
 
 void __init rproc_init_debugfs(void)
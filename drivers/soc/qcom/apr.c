@@ -34,6 +34,19 @@ struct apr_rx_buf {
 	uint8_t buf[];
 };
 
+static int __apr_send_pkt(struct apr_device *adev, struct apr_pkt *pkt)
+{
+	struct apr *apr = dev_get_drvdata(adev->dev.parent);
+	struct apr_hdr *hdr = &pkt->hdr;
+
+	hdr->src_domain = APR_DOMAIN_APPS;
+	hdr->src_svc = adev->svc_id;
+	hdr->dest_domain = adev->domain_id;
+	hdr->dest_svc = adev->svc_id;
+
+	return rpmsg_trysend(apr->ch, pkt, hdr->pkt_size);
+}
+
 /**
  * apr_send_pkt() - Send a apr message from apr device
  *
@@ -44,25 +57,139 @@ struct apr_rx_buf {
  */
 int apr_send_pkt(struct apr_device *adev, struct apr_pkt *pkt)
 {
-	struct apr *apr = dev_get_drvdata(adev->dev.parent);
-	struct apr_hdr *hdr;
 	unsigned long flags;
 	int ret;
 
 	spin_lock_irqsave(&adev->lock, flags);
+	ret = __apr_send_pkt(adev, pkt);
+	spin_unlock_irqrestore(&adev->lock, flags);
 
-	hdr = &pkt->hdr;
-	hdr->src_domain = APR_DOMAIN_APPS;
-	hdr->src_svc = adev->svc_id;
-	hdr->dest_domain = adev->domain_id;
-	hdr->dest_svc = adev->svc_id;
+	return ret ? ret : pkt->hdr.pkt_size;
+}
+EXPORT_SYMBOL_GPL(apr_send_pkt);
 
-	ret = rpmsg_trysend(apr->ch, pkt, hdr->pkt_size);
+/**
+ * apr_send_pkt_async() - Send a apr command and track its response
+ *
+ * @adev: Pointer to previously registered apr device.
+ * @pkt: Pointer to apr packet to send
+ * @req: Request to track the command with, owned by the caller
+ * @rsp_opcode: Opcode of the dedicated response of the command, or 0
+ *
+ * Unlike apr_send_pkt() this doesn't require the client to match the
+ * response to the command itself, so any number of commands can be in
+ * flight on a service at once. The packet is sent unmodified, the response
+ * is matched to @req by its opcode and the token the remote echoes back,
+ * oldest request first. The response is still handed to the driver
+ * callback before @req is completed. Every request sent successfully must
+ * be waited for with apr_wait_request() before @req goes away.
+ *
+ * Return: Will be an negative value on failure or zero on success.
+ */
+int apr_send_pkt_async(struct apr_device *adev, struct apr_pkt *pkt,
+		       struct apr_request *req, uint32_t rsp_opcode)
+{
+	struct apr_hdr *hdr = &pkt->hdr;
+	unsigned long flags;
+	int ret;
+
+	init_completion(&req->done);
+	req->opcode = hdr->opcode;
+	req->rsp_opcode = rsp_opcode;
+	req->token = hdr->token;
+	req->status = 0;
+
+	spin_lock_irqsave(&adev->lock, flags);
+	req->sent = ktime_get();
+	list_add_tail(&req->node, &adev->reqs);
+
+	ret = __apr_send_pkt(adev, pkt);
+	if (ret)
+		list_del(&req->node);
 	spin_unlock_irqrestore(&adev->lock, flags);
 
-	return ret ? ret : hdr->pkt_size;
+	return ret;
+}
+EXPORT_SYMBOL_GPL(apr_send_pkt_async);
+
+/**
+ * apr_wait_request() - Wait for the response of a tracked apr command
+ *
+ * @adev: Pointer to previously registered apr device.
+ * @req: Request passed to apr_send_pkt_async()
+ * @timeout: Timeout in jiffies
+ *
+ * On success the status returned by the remote is left in @req->status.
+ * A response showing up after the timeout is handed to the driver callback
+ * like any untracked packet.
+ *
+ * Return: Will be -ETIMEDOUT if no response came in time or zero on
+ * success.
+ */
+int apr_wait_request(struct apr_device *adev, struct apr_request *req,
+		     unsigned long timeout)
+{
+	unsigned long flags;
+	bool pending;
+
+	if (wait_for_completion_timeout(&req->done, timeout))
+		return 0;
+
+	spin_lock_irqsave(&adev->lock, flags);
+	pending = !list_empty(&req->node);
+	if (pending)
+		list_del_init(&req->node);
+	spin_unlock_irqrestore(&adev->lock, flags);
+
+	if (pending)
+		return -ETIMEDOUT;
+
+	/* The response raced with the timeout, let its callback finish */
+	wait_for_completion(&req->done);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(apr_wait_request);
+
+static bool apr_request_match(struct apr_request *req,
+			      struct apr_resp_pkt *resp)
+{
+	struct aprv2_ibasic_rsp_result_t *result = resp->payload;
+
+	if (resp->hdr.token != req->token)
+		return false;
+
+	if (req->rsp_opcode && resp->hdr.opcode == req->rsp_opcode)
+		return true;
+
+	return resp->hdr.opcode == APR_BASIC_RSP_RESULT &&
+	       resp->payload_size >= sizeof(*result) &&
+	       result->opcode == req->opcode;
+}
+
+/* Return the oldest tracked request completed by @resp, if any */
+static struct apr_request *apr_claim_request(struct apr_device *adev,
+					     struct apr_resp_pkt *resp)
+{
+	struct aprv2_ibasic_rsp_result_t *result = resp->payload;
+	struct apr_request *req, *found = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&adev->lock, flags);
+	list_for_each_entry(req, &adev->reqs, node) {
+		if (apr_request_match(req, resp)) {
+			list_del_init(&req->node);
+			found = req;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&adev->lock, flags);
+
+	if (found && resp->hdr.opcode == APR_BASIC_RSP_RESULT)
+		found->status = result->status;
+
+	return found;
 }
-EXPORT_SYMBOL_GPL(apr_send_pkt);
 
 static void apr_dev_release(struct device *dev)
 {
@@ -106,6 +233,7 @@ static int apr_do_rx_callback(struct apr *apr, struct apr_rx_buf *abuf)
 	uint16_t hdr_size, msg_type, ver, svc_id;
 	struct apr_device *svc = NULL;
 	struct apr_driver *adrv = NULL;
+	struct apr_request *req;
 	struct apr_resp_pkt resp;
 	struct apr_hdr *hdr;
 	unsigned long flags;
@@ -164,8 +292,16 @@ static int apr_do_rx_callback(struct apr *apr, struct apr_rx_buf *abuf)
 	if (resp.payload_size > 0)
 		resp.payload = buf + hdr_size;
 
+	req = apr_claim_request(svc, &resp);
 	adrv->callback(svc, &resp);
 
+	if (req) {
+		dev_dbg(&svc->dev, "cmd 0x%x done in %lld us, status 0x%x\n",
+			req->opcode, ktime_us_delta(ktime_get(), req->sent),
+			req->status);
+		complete(&req->done);
+	}
+
 	return 0;
 }
 
@@ -268,6 +404,7 @@ static int apr_add_device(struct device *dev, struct device_node *np,
 		return -ENOMEM;
 
 	spin_lock_init(&adev->lock);
+	INIT_LIST_HEAD(&adev->reqs);
 
 	adev->svc_id = id->svc_id;
 	adev->domain_id = id->domain_id;
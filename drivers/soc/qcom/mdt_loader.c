@@ -7,6 +7,7 @@
  * Copyright (c) 2012-2013, The Linux Foundation. All rights reserved.
  */
 
+#include <linux/async.h>
 #include <linux/device.h>
 #include <linux/elf.h>
 #include <linux/firmware.h>
@@ -17,6 +18,37 @@
 #include <linux/slab.h>
 #include <linux/soc/qcom/mdt_loader.h>
 
+/**
+ * struct qcom_mdt_seg_load - split segment being loaded asynchronously
+ * @dev:	device handle to associate resources with
+ * @fw_name:	name of the segment's firmware file
+ * @ptr:	destination of the segment in the memory region
+ * @size:	size of the segment in the firmware file
+ * @ret:	result of the load
+ */
+struct qcom_mdt_seg_load {
+	struct device *dev;
+	char *fw_name;
+	void *ptr;
+	size_t size;
+	int ret;
+};
+
+static void qcom_mdt_load_segment(void *data, async_cookie_t cookie)
+{
+	struct qcom_mdt_seg_load *seg = data;
+	const struct firmware *seg_fw;
+
+	seg->ret = request_firmware_into_buf(&seg_fw, seg->fw_name, seg->dev,
+					     seg->ptr, seg->size);
+	if (seg->ret) {
+		dev_err(seg->dev, "failed to load %s\n", seg->fw_name);
+		return;
+	}
+
+	release_firmware(seg_fw);
+}
+
 static bool mdt_phdr_valid(const struct elf32_phdr *phdr)
 {
 	if (phdr->p_type != PT_LOAD)
@@ -131,10 +163,11 @@ static int __qcom_mdt_load(struct device *dev, const struct firmware *fw,
 			   phys_addr_t mem_phys, size_t mem_size,
 			   phys_addr_t *reloc_base, bool pas_init)
 {
+	ASYNC_DOMAIN_EXCLUSIVE(seg_domain);
+	struct qcom_mdt_seg_load *segs;
 	const struct elf32_phdr *phdrs;
 	const struct elf32_phdr *phdr;
 	const struct elf32_hdr *ehdr;
-	const struct firmware *seg_fw;
 	phys_addr_t mem_reloc;
 	phys_addr_t min_addr = PHYS_ADDR_MAX;
 	phys_addr_t max_addr = 0;
@@ -162,6 +195,12 @@ static int __qcom_mdt_load(struct device *dev, const struct firmware *fw,
 	if (!fw_name)
 		return -ENOMEM;
 
+	segs = kcalloc(ehdr->e_phnum, sizeof(*segs), GFP_KERNEL);
+	if (!segs) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
 	if (pas_init) {
 		metadata = qcom_mdt_read_metadata(fw, &metadata_len);
 		if (IS_ERR(metadata)) {
@@ -244,26 +283,42 @@ static int __qcom_mdt_load(struct device *dev, const struct firmware *fw,
 
 			memcpy(ptr, fw->data + phdr->p_offset, phdr->p_filesz);
 		} else if (phdr->p_filesz) {
-			/* Firmware not large enough, load split-out segments */
+			/*
+			 * Firmware not large enough, load split-out segments.
+			 * The segment files are independent, so they are read
+			 * straight into the memory region concurrently.
+			 */
 			sprintf(fw_name + fw_name_len - 3, "b%02d", i);
-			ret = request_firmware_into_buf(&seg_fw, fw_name, dev,
-							ptr, phdr->p_filesz);
-			if (ret) {
-				dev_err(dev, "failed to load %s\n", fw_name);
+			segs[i].fw_name = kstrdup(fw_name, GFP_KERNEL);
+			if (!segs[i].fw_name) {
+				ret = -ENOMEM;
 				break;
 			}
 
-			release_firmware(seg_fw);
+			segs[i].dev = dev;
+			segs[i].ptr = ptr;
+			segs[i].size = phdr->p_filesz;
+			async_schedule_domain(qcom_mdt_load_segment, &segs[i],
+					      &seg_domain);
 		}
 
 		if (phdr->p_memsz > phdr->p_filesz)
 			memset(ptr + phdr->p_filesz, 0, phdr->p_memsz - phdr->p_filesz);
 	}
 
+	async_synchronize_full_domain(&seg_domain);
+
+	for (i = 0; i < ehdr->e_phnum; i++) {
+		if (!ret && segs[i].ret)
+			ret = segs[i].ret;
+		kfree(segs[i].fw_name);
+	}
+
 	if (reloc_base)
 		*reloc_base = mem_reloc;
 
 out:
+	kfree(segs);
 	kfree(fw_name);
 
 	return ret;
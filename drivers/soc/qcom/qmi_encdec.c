@@ -8,6 +8,10 @@
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/errno.h>
+#include <linux/hashtable.h>
+#include <linux/notifier.h>
+#include <linux/rculist.h>
+#include <linux/spinlock.h>
 #include <linux/string.h>
 #include <linux/soc/qcom/qmi.h>
 
@@ -701,6 +705,351 @@ static int qmi_decode(struct qmi_elem_info *ei_array, void *out_c_struct,
 	return decoded_bytes;
 }
 
+/**
+ * struct qmi_encdec_op - single copy operation of a precompiled message
+ * @tlv:	whether a TLV header is emitted ahead of the data
+ * @tlv_type:	type of the TLV started by this op
+ * @tlv_len:	length of the TLV started by this op
+ * @offset:	offset of the data in the C structure
+ * @size:	number of bytes to copy
+ */
+struct qmi_encdec_op {
+	u8 tlv;
+	u8 tlv_type;
+	u16 tlv_len;
+	u32 offset;
+	u32 size;
+};
+
+/**
+ * struct qmi_encdec_plan - precompiled encoding of a fixed size message
+ * @node:	entry in qmi_encdec_plans
+ * @rcu:	rcu head for freeing the plan
+ * @ei:		element info the plan was compiled from
+ * @wire_len:	size of the encoded message, excluding the QMI header
+ * @num_ops:	number of entries in @ops, 0 if @ei can't be precompiled
+ * @ops:	copy operations, in wire order
+ *
+ * Messages without optional elements, variable length arrays or strings
+ * always encode to the same layout, which means that the recursive walk of
+ * the qmi_elem_info tree can be replaced by a list of memcpy operations
+ * between the C structure and the wire buffer. Plans are compiled on first
+ * use and cached until the module holding the qmi_elem_info array goes away;
+ * a plan with no ops records that the message must go through the
+ * interpreter.
+ */
+struct qmi_encdec_plan {
+	struct hlist_node node;
+	struct rcu_head rcu;
+	const struct qmi_elem_info *ei;
+	u32 wire_len;
+	unsigned int num_ops;
+	struct qmi_encdec_op ops[];
+};
+
+/**
+ * struct qmi_plan_ctx - state of a plan being compiled
+ * @plan:	plan to fill in, NULL when only counting the ops needed
+ * @num_ops:	number of ops emitted so far
+ * @tlv_op:	index of the first op of the current TLV
+ */
+struct qmi_plan_ctx {
+	struct qmi_encdec_plan *plan;
+	unsigned int num_ops;
+	unsigned int tlv_op;
+};
+
+#define QMI_ENCDEC_PLAN_HASH_BITS	6
+
+static DEFINE_HASHTABLE(qmi_encdec_plans, QMI_ENCDEC_PLAN_HASH_BITS);
+static DEFINE_SPINLOCK(qmi_encdec_plans_lock);
+
+/**
+ * qmi_plan_add_op() - append a copy to the plan being compiled
+ * @ctx:	compilation state
+ * @offset:	offset of the data in the C structure
+ * @size:	number of bytes to copy
+ *
+ * Copies that are contiguous in the C structure and belong to the same TLV
+ * are merged into a single op.
+ */
+static void qmi_plan_add_op(struct qmi_plan_ctx *ctx, u32 offset, u32 size)
+{
+	struct qmi_encdec_plan *plan = ctx->plan;
+	struct qmi_encdec_op *op;
+
+	if (!plan) {
+		ctx->num_ops++;
+		return;
+	}
+
+	plan->wire_len += size;
+
+	if (ctx->num_ops > ctx->tlv_op) {
+		op = &plan->ops[ctx->num_ops - 1];
+		if (op->offset + op->size == offset) {
+			op->size += size;
+			return;
+		}
+	}
+
+	op = &plan->ops[ctx->num_ops++];
+	op->offset = offset;
+	op->size = size;
+}
+
+/**
+ * qmi_plan_compile() - flatten a qmi_elem_info tree into copy operations
+ * @ctx:	compilation state
+ * @ei_array:	element info to compile
+ * @base:	offset of the structure described by @ei_array
+ * @level:	depth of the nested structure, 1 for the message itself
+ *
+ * Return: 0 on success, -EOPNOTSUPP if @ei_array does not describe a fixed
+ * size message.
+ */
+static int qmi_plan_compile(struct qmi_plan_ctx *ctx,
+			    struct qmi_elem_info *ei_array, u32 base,
+			    int level)
+{
+	struct qmi_encdec_plan *plan = ctx->plan;
+	struct qmi_elem_info *temp_ei;
+	struct qmi_encdec_op *op;
+	u32 tlv_start = 0;
+	u32 tlv_len;
+	u32 count;
+	u32 i;
+	int rc;
+
+	if (!ei_array)
+		return -EOPNOTSUPP;
+
+	for (temp_ei = ei_array; temp_ei->data_type != QMI_EOTI; temp_ei++) {
+		if (temp_ei->array_type == VAR_LEN_ARRAY)
+			return -EOPNOTSUPP;
+
+		count = temp_ei->array_type == NO_ARRAY ? 1 : temp_ei->elem_len;
+
+		/* Every top level element is a TLV of its own */
+		if (level == 1) {
+			ctx->tlv_op = ctx->num_ops;
+			if (plan) {
+				plan->wire_len += TLV_TYPE_SIZE + TLV_LEN_SIZE;
+				tlv_start = plan->wire_len;
+			}
+		}
+
+		switch (temp_ei->data_type) {
+		case QMI_UNSIGNED_1_BYTE:
+		case QMI_UNSIGNED_2_BYTE:
+		case QMI_UNSIGNED_4_BYTE:
+		case QMI_UNSIGNED_8_BYTE:
+		case QMI_SIGNED_2_BYTE_ENUM:
+		case QMI_SIGNED_4_BYTE_ENUM:
+			qmi_plan_add_op(ctx, base + temp_ei->offset,
+					count * temp_ei->elem_size);
+			break;
+		case QMI_STRUCT:
+			for (i = 0; i < count; i++) {
+				rc = qmi_plan_compile(ctx, temp_ei->ei_array,
+						      base + temp_ei->offset +
+						      i * temp_ei->elem_size,
+						      level + 1);
+				if (rc < 0)
+					return rc;
+			}
+			break;
+		default:
+			/* Optional elements, data lengths and strings */
+			return -EOPNOTSUPP;
+		}
+
+		if (level != 1 || !plan)
+			continue;
+
+		tlv_len = plan->wire_len - tlv_start;
+		if (ctx->num_ops == ctx->tlv_op || tlv_len > U16_MAX)
+			return -EOPNOTSUPP;
+
+		op = &plan->ops[ctx->tlv_op];
+		op->tlv = 1;
+		op->tlv_type = temp_ei->tlv_type;
+		op->tlv_len = tlv_len;
+	}
+
+	return 0;
+}
+
+/**
+ * qmi_plan_cacheable() - check that a plan may be cached for @ei
+ * @ei:		element info of the message
+ *
+ * Plans are keyed on the @ei pointer, so only element info arrays that live
+ * as long as the kernel image or their module may be cached. The kernel's own
+ * data sections can only be told apart when the helpers are built in, in
+ * which case no modular user of them exists either.
+ */
+static bool qmi_plan_cacheable(struct qmi_elem_info *ei)
+{
+	unsigned long addr = (unsigned long)ei;
+	struct module *mod;
+	bool ret;
+
+	if (IS_BUILTIN(CONFIG_QCOM_QMI_HELPERS) && core_kernel_data(addr))
+		return true;
+
+	preempt_disable();
+	mod = __module_address(addr);
+	ret = mod && within_module_core(addr, mod);
+	preempt_enable();
+
+	return ret;
+}
+
+/**
+ * qmi_plan_get() - find or compile the plan for a message
+ * @ei:		element info of the message
+ *
+ * Plans are only cached for element info arrays that are part of the kernel
+ * or module image, qmi_plan_module_notify() drops them as the owning module
+ * is unloaded.
+ *
+ * Return: plan with at least one op, or NULL if the message has to be
+ * handled by the interpreter
+ */
+static const struct qmi_encdec_plan *qmi_plan_get(struct qmi_elem_info *ei)
+{
+	struct qmi_encdec_plan *plan;
+	struct qmi_encdec_plan *old;
+	unsigned long addr = (unsigned long)ei;
+	struct qmi_plan_ctx ctx;
+
+	rcu_read_lock();
+	hash_for_each_possible_rcu(qmi_encdec_plans, plan, node, addr) {
+		if (plan->ei == ei) {
+			rcu_read_unlock();
+			return plan->num_ops ? plan : NULL;
+		}
+	}
+	rcu_read_unlock();
+
+	if (!qmi_plan_cacheable(ei))
+		return NULL;
+
+	/* Size the plan without merging, then compile it for real */
+	memset(&ctx, 0, sizeof(ctx));
+	if (qmi_plan_compile(&ctx, ei, 0, 1) < 0)
+		ctx.num_ops = 0;
+
+	plan = kzalloc(struct_size(plan, ops, ctx.num_ops), GFP_KERNEL);
+	if (!plan)
+		return NULL;
+
+	plan->ei = ei;
+	if (ctx.num_ops) {
+		memset(&ctx, 0, sizeof(ctx));
+		ctx.plan = plan;
+		if (qmi_plan_compile(&ctx, ei, 0, 1) < 0)
+			ctx.num_ops = 0;
+		plan->num_ops = ctx.num_ops;
+		if (!plan->num_ops)
+			plan->wire_len = 0;
+	}
+
+	spin_lock(&qmi_encdec_plans_lock);
+	hash_for_each_possible(qmi_encdec_plans, old, node, addr) {
+		if (old->ei == ei) {
+			spin_unlock(&qmi_encdec_plans_lock);
+			kfree(plan);
+			return old->num_ops ? old : NULL;
+		}
+	}
+	hash_add_rcu(qmi_encdec_plans, &plan->node, addr);
+	spin_unlock(&qmi_encdec_plans_lock);
+
+	return plan->num_ops ? plan : NULL;
+}
+
+/**
+ * qmi_plan_encode() - encode a fixed size message using its plan
+ * @plan:	precompiled plan of the message
+ * @out_buf:	buffer of at least @plan->wire_len bytes
+ * @in_c_struct: C structure to encode
+ *
+ * Return: number of bytes encoded
+ */
+static int qmi_plan_encode(const struct qmi_encdec_plan *plan, void *out_buf,
+			   const void *in_c_struct)
+{
+	const struct qmi_encdec_op *op;
+	u8 *buf_dst = out_buf;
+	unsigned int i;
+
+	for (i = 0; i < plan->num_ops; i++) {
+		op = &plan->ops[i];
+		if (op->tlv)
+			QMI_ENCDEC_ENCODE_TLV(op->tlv_type, op->tlv_len, buf_dst);
+		memcpy(buf_dst, in_c_struct + op->offset, op->size);
+		buf_dst += op->size;
+	}
+
+	return plan->wire_len;
+}
+
+/**
+ * qmi_plan_decode() - decode a fixed size message using its plan
+ * @plan:	precompiled plan of the message
+ * @out_c_struct: C structure to decode into
+ * @in_buf:	encoded message, excluding the QMI header
+ * @in_buf_len:	length of @in_buf
+ *
+ * The fast path only applies when the remote laid out the TLVs exactly as
+ * we would have encoded them; anything else, such as reordered or unknown
+ * TLVs, is left to the interpreter.
+ *
+ * Return: number of bytes decoded, or -EAGAIN if the message has to be
+ * handled by the interpreter
+ */
+static int qmi_plan_decode(const struct qmi_encdec_plan *plan,
+			   void *out_c_struct, const void *in_buf,
+			   u32 in_buf_len)
+{
+	const struct qmi_encdec_op *op;
+	const u8 *buf_src = in_buf;
+	const u8 *tlv_pointer;
+	unsigned int i;
+	u32 tlv_type;
+	u32 tlv_len;
+
+	if (in_buf_len != plan->wire_len)
+		return -EAGAIN;
+
+	/* Validate all TLV headers before touching the C structure */
+	for (i = 0; i < plan->num_ops; i++) {
+		op = &plan->ops[i];
+		if (!op->tlv)
+			continue;
+
+		tlv_pointer = buf_src;
+		QMI_ENCDEC_DECODE_TLV(&tlv_type, &tlv_len, tlv_pointer);
+		if (tlv_type != op->tlv_type || tlv_len != op->tlv_len)
+			return -EAGAIN;
+
+		buf_src += TLV_TYPE_SIZE + TLV_LEN_SIZE + op->tlv_len;
+	}
+
+	buf_src = in_buf;
+	for (i = 0; i < plan->num_ops; i++) {
+		op = &plan->ops[i];
+		if (op->tlv)
+			buf_src += TLV_TYPE_SIZE + TLV_LEN_SIZE;
+		memcpy(out_c_struct + op->offset, buf_src, op->size);
+		buf_src += op->size;
+	}
+
+	return plan->wire_len;
+}
+
 /**
  * qmi_encode_message() - Encode C structure as QMI encoded message
  * @type:	Type of QMI message
@@ -716,6 +1065,7 @@ void *qmi_encode_message(int type, unsigned int msg_id, size_t *len,
 			 unsigned int txn_id, struct qmi_elem_info *ei,
 			 const void *c_struct)
 {
+	const struct qmi_encdec_plan *plan;
 	struct qmi_header *hdr;
 	ssize_t msglen = 0;
 	void *msg;
@@ -736,7 +1086,10 @@ void *qmi_encode_message(int type, unsigned int msg_id, size_t *len,
 		return ERR_PTR(-ENOMEM);
 
 	/* Encode message, if we have a message */
-	if (c_struct) {
+	plan = c_struct ? qmi_plan_get(ei) : NULL;
+	if (plan && plan->wire_len <= *len) {
+		msglen = qmi_plan_encode(plan, msg + sizeof(*hdr), c_struct);
+	} else if (c_struct) {
 		msglen = qmi_encode(ei, msg + sizeof(*hdr), c_struct, *len, 1);
 		if (msglen < 0) {
 			kfree(msg);
@@ -769,17 +1122,78 @@ EXPORT_SYMBOL(qmi_encode_message);
 int qmi_decode_message(const void *buf, size_t len,
 		       struct qmi_elem_info *ei, void *c_struct)
 {
+	const struct qmi_encdec_plan *plan;
+	int ret;
+
 	if (!ei)
 		return -EINVAL;
 
 	if (!c_struct || !buf || !len)
 		return -EINVAL;
 
+	plan = qmi_plan_get(ei);
+	if (plan) {
+		ret = qmi_plan_decode(plan, c_struct,
+				      buf + sizeof(struct qmi_header),
+				      len - sizeof(struct qmi_header));
+		if (ret != -EAGAIN)
+			return ret;
+	}
+
 	return qmi_decode(ei, c_struct, buf + sizeof(struct qmi_header),
 			  len - sizeof(struct qmi_header), 1);
 }
 EXPORT_SYMBOL(qmi_decode_message);
 
+static int qmi_plan_module_notify(struct notifier_block *nb,
+				  unsigned long action, void *data)
+{
+	struct qmi_encdec_plan *plan;
+	struct module *mod = data;
+	struct hlist_node *tmp;
+	int bkt;
+
+	if (action != MODULE_STATE_GOING)
+		return NOTIFY_DONE;
+
+	spin_lock(&qmi_encdec_plans_lock);
+	hash_for_each_safe(qmi_encdec_plans, bkt, tmp, plan, node) {
+		if (!within_module((unsigned long)plan->ei, mod))
+			continue;
+
+		hash_del_rcu(&plan->node);
+		kfree_rcu(plan, rcu);
+	}
+	spin_unlock(&qmi_encdec_plans_lock);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block qmi_plan_module_nb = {
+	.notifier_call = qmi_plan_module_notify,
+};
+
+static int __init qmi_encdec_init(void)
+{
+	return register_module_notifier(&qmi_plan_module_nb);
+}
+module_init(qmi_encdec_init);
+
+static void __exit qmi_encdec_exit(void)
+{
+	struct qmi_encdec_plan *plan;
+	struct hlist_node *tmp;
+	int bkt;
+
+	unregister_module_notifier(&qmi_plan_module_nb);
+
+	hash_for_each_safe(qmi_encdec_plans, bkt, tmp, plan, node) {
+		hash_del(&plan->node);
+		kfree(plan);
+	}
+}
+module_exit(qmi_encdec_exit);
+
 /* Common header in all QMI responses */
 struct qmi_elem_info qmi_response_type_v01_ei[] = {
 	{
@@ -812,5 +1226,9 @@ struct qmi_elem_info qmi_response_type_v01_ei[] = {
 };
 EXPORT_SYMBOL(qmi_response_type_v01_ei);
 
+#ifdef CONFIG_QCOM_QMI_ENCDEC_KUNIT_TEST
+#include "qmi_encdec_test.c"
+#endif /* CONFIG_QCOM_QMI_ENCDEC_KUNIT_TEST */
+
 MODULE_DESCRIPTION("QMI encoder/decoder helper");
 MODULE_LICENSE("GPL v2");
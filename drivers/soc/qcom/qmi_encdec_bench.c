@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * KUnit benchmark of the precompiled QMI encoder/decoder plans.
+ *
+ * Only the exported message helpers are used: a message whose element info
+ * is static data goes through its cached plan, while an identical copy of
+ * the element info on the heap is never cached and is handled by the
+ * qmi_elem_info interpreter.
+ */
+
+#include <kunit/test.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
+#include <linux/soc/qcom/qmi.h>
+
+#define QMI_BENCH_ITERATIONS	10000
+#define QMI_BENCH_MSG_ID	0x20
+#define QMI_BENCH_BUF_LEN	128
+
+struct qmi_bench_pair {
+	u32 x;
+	u32 y;
+};
+
+struct qmi_bench_msg {
+	u32 id;
+	u16 flags;
+	struct qmi_bench_pair pair[2];
+	struct qmi_response_type_v01 resp;
+};
+
+static struct qmi_elem_info qmi_bench_pair_ei[] = {
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0,
+		.offset		= offsetof(struct qmi_bench_pair, x),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0,
+		.offset		= offsetof(struct qmi_bench_pair, y),
+	},
+	{}
+};
+
+static struct qmi_elem_info qmi_bench_msg_ei[] = {
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x01,
+		.offset		= offsetof(struct qmi_bench_msg, id),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_2_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u16),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x02,
+		.offset		= offsetof(struct qmi_bench_msg, flags),
+	},
+	{
+		.data_type	= QMI_STRUCT,
+		.elem_len	= 2,
+		.elem_size	= sizeof(struct qmi_bench_pair),
+		.array_type	= STATIC_ARRAY,
+		.tlv_type	= 0x03,
+		.offset		= offsetof(struct qmi_bench_msg, pair),
+		.ei_array	= qmi_bench_pair_ei,
+	},
+	{
+		.data_type	= QMI_STRUCT,
+		.elem_len	= 1,
+		.elem_size	= sizeof(struct qmi_response_type_v01),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x04,
+		.offset		= offsetof(struct qmi_bench_msg, resp),
+		.ei_array	= qmi_response_type_v01_ei,
+	},
+	{}
+};
+
+static const struct qmi_bench_msg qmi_bench = {
+	.id = 0x11223344,
+	.flags = 0x5566,
+	.pair = { { 1, 2 }, { 3, 4 } },
+	.resp = { QMI_RESULT_FAILURE_V01, QMI_ERR_INVALID_ID_V01 },
+};
+
+/* Encode and decode @qmi_bench with @ei, return the average ns per message */
+static u64 qmi_bench_run(struct kunit *test, struct qmi_elem_info *ei,
+			 struct qmi_bench_msg *out)
+{
+	size_t len;
+	void *msg;
+	u64 start;
+	int ret;
+	int i;
+
+	start = ktime_get_ns();
+	for (i = 0; i < QMI_BENCH_ITERATIONS; i++) {
+		len = QMI_BENCH_BUF_LEN;
+		msg = qmi_encode_message(QMI_REQUEST, QMI_BENCH_MSG_ID, &len,
+					 1, ei, &qmi_bench);
+		if (IS_ERR(msg)) {
+			KUNIT_FAIL(test, "encode failed: %ld", PTR_ERR(msg));
+			return 0;
+		}
+
+		ret = qmi_decode_message(msg, len, ei, out);
+		kfree(msg);
+		if (ret < 0) {
+			KUNIT_FAIL(test, "decode failed: %d", ret);
+			return 0;
+		}
+	}
+
+	return div_u64(ktime_get_ns() - start, QMI_BENCH_ITERATIONS);
+}
+
+static void qmi_encdec_bench_fixed_msg(struct kunit *test)
+{
+	struct qmi_elem_info *heap_ei;
+	struct qmi_bench_msg *out;
+	u64 interp_ns, plan_ns;
+
+	out = kunit_kzalloc(test, sizeof(*out), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, out);
+
+	/* A heap copy of the element info is never given a plan */
+	heap_ei = kunit_kmalloc(test, sizeof(qmi_bench_msg_ei), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, heap_ei);
+	memcpy(heap_ei, qmi_bench_msg_ei, sizeof(qmi_bench_msg_ei));
+
+	interp_ns = qmi_bench_run(test, heap_ei, out);
+	KUNIT_EXPECT_EQ(test, 0, memcmp(out, &qmi_bench, sizeof(*out)));
+
+	memset(out, 0, sizeof(*out));
+	plan_ns = qmi_bench_run(test, qmi_bench_msg_ei, out);
+	KUNIT_EXPECT_EQ(test, 0, memcmp(out, &qmi_bench, sizeof(*out)));
+
+	kunit_info(test, "encode+decode: interpreter %llu ns/msg, plan %llu ns/msg\n",
+		   interp_ns, plan_ns);
+}
+
+static struct kunit_case qmi_encdec_bench_cases[] = {
+	KUNIT_CASE(qmi_encdec_bench_fixed_msg),
+	{},
+};
+
+static struct kunit_suite qmi_encdec_bench_suite = {
+	.name = "qmi_encdec_bench",
+	.test_cases = qmi_encdec_bench_cases,
+};
+
+kunit_test_suite(qmi_encdec_bench_suite);
+
+MODULE_LICENSE("GPL v2");
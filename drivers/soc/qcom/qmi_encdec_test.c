@@ -0,0 +1,222 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * KUnit tests for the precompiled QMI encoder/decoder plans.
+ */
+
+#include <kunit/test.h>
+
+#define QMI_TEST_BUF_LEN		128
+
+struct qmi_test_pair {
+	u32 x;
+	u32 y;
+};
+
+struct qmi_test_fixed_msg {
+	u32 id;
+	u16 flags;
+	struct qmi_test_pair pair[2];
+	struct qmi_response_type_v01 resp;
+};
+
+struct qmi_test_opt_msg {
+	u32 id;
+	u8 name_valid;
+	u32 name;
+};
+
+static struct qmi_elem_info qmi_test_pair_ei[] = {
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0,
+		.offset		= offsetof(struct qmi_test_pair, x),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0,
+		.offset		= offsetof(struct qmi_test_pair, y),
+	},
+	{}
+};
+
+static struct qmi_elem_info qmi_test_fixed_msg_ei[] = {
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x01,
+		.offset		= offsetof(struct qmi_test_fixed_msg, id),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_2_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u16),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x02,
+		.offset		= offsetof(struct qmi_test_fixed_msg, flags),
+	},
+	{
+		.data_type	= QMI_STRUCT,
+		.elem_len	= 2,
+		.elem_size	= sizeof(struct qmi_test_pair),
+		.array_type	= STATIC_ARRAY,
+		.tlv_type	= 0x03,
+		.offset		= offsetof(struct qmi_test_fixed_msg, pair),
+		.ei_array	= qmi_test_pair_ei,
+	},
+	{
+		.data_type	= QMI_STRUCT,
+		.elem_len	= 1,
+		.elem_size	= sizeof(struct qmi_response_type_v01),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x04,
+		.offset		= offsetof(struct qmi_test_fixed_msg, resp),
+		.ei_array	= qmi_response_type_v01_ei,
+	},
+	{}
+};
+
+static struct qmi_elem_info qmi_test_opt_msg_ei[] = {
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x01,
+		.offset		= offsetof(struct qmi_test_opt_msg, id),
+	},
+	{
+		.data_type	= QMI_OPT_FLAG,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x10,
+		.offset		= offsetof(struct qmi_test_opt_msg, name_valid),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x10,
+		.offset		= offsetof(struct qmi_test_opt_msg, name),
+	},
+	{}
+};
+
+static const struct qmi_test_fixed_msg qmi_test_fixed = {
+	.id = 0x11223344,
+	.flags = 0x5566,
+	.pair = { { 1, 2 }, { 3, 4 } },
+	.resp = { QMI_RESULT_FAILURE_V01, QMI_ERR_INVALID_ID_V01 },
+};
+
+static void qmi_encdec_test_plan_matches_interpreter(struct kunit *test)
+{
+	const struct qmi_encdec_plan *plan;
+	u8 *interp = kunit_kzalloc(test, QMI_TEST_BUF_LEN, GFP_KERNEL);
+	u8 *fast = kunit_kzalloc(test, QMI_TEST_BUF_LEN, GFP_KERNEL);
+	int interp_len;
+	int fast_len;
+
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, interp);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, fast);
+
+	plan = qmi_plan_get(qmi_test_fixed_msg_ei);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, plan);
+
+	interp_len = qmi_encode(qmi_test_fixed_msg_ei, interp, &qmi_test_fixed,
+				QMI_TEST_BUF_LEN, 1);
+	fast_len = qmi_plan_encode(plan, fast, &qmi_test_fixed);
+
+	KUNIT_EXPECT_EQ(test, interp_len, fast_len);
+	KUNIT_EXPECT_EQ(test, (u32)fast_len, plan->wire_len);
+	KUNIT_EXPECT_EQ(test, 0, memcmp(interp, fast, QMI_TEST_BUF_LEN));
+
+	/* id, flags, the pair array and the response each form one copy */
+	KUNIT_EXPECT_EQ(test, 4U, plan->num_ops);
+}
+
+static void qmi_encdec_test_plan_roundtrip(struct kunit *test)
+{
+	struct qmi_test_fixed_msg *out;
+	size_t len = QMI_TEST_BUF_LEN;
+	void *msg;
+	int ret;
+
+	out = kunit_kzalloc(test, sizeof(*out), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, out);
+
+	msg = qmi_encode_message(QMI_REQUEST, 0x20, &len, 1,
+				 qmi_test_fixed_msg_ei, &qmi_test_fixed);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, msg);
+
+	ret = qmi_decode_message(msg, len, qmi_test_fixed_msg_ei, out);
+	KUNIT_EXPECT_EQ(test, (size_t)ret, len - sizeof(struct qmi_header));
+	KUNIT_EXPECT_EQ(test, 0, memcmp(out, &qmi_test_fixed, sizeof(*out)));
+
+	kfree(msg);
+}
+
+static void qmi_encdec_test_reordered_tlvs(struct kunit *test)
+{
+	const struct qmi_encdec_plan *plan;
+	struct qmi_test_fixed_msg *out;
+	u8 *buf;
+	u8 *swapped;
+	int len;
+
+	buf = kunit_kzalloc(test, QMI_TEST_BUF_LEN, GFP_KERNEL);
+	swapped = kunit_kzalloc(test, QMI_TEST_BUF_LEN, GFP_KERNEL);
+	out = kunit_kzalloc(test, sizeof(*out), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, buf);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, swapped);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, out);
+
+	plan = qmi_plan_get(qmi_test_fixed_msg_ei);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, plan);
+
+	len = qmi_plan_encode(plan, buf, &qmi_test_fixed);
+
+	/* Move the 7 byte "id" TLV behind the 5 byte "flags" TLV */
+	memcpy(swapped, buf + 7, 5);
+	memcpy(swapped + 5, buf, 7);
+	memcpy(swapped + 12, buf + 12, len - 12);
+
+	KUNIT_EXPECT_EQ(test, -EAGAIN,
+			qmi_plan_decode(plan, out, swapped, len));
+
+	/* The interpreter still handles it */
+	KUNIT_EXPECT_EQ(test, len,
+			qmi_decode(qmi_test_fixed_msg_ei, out, swapped, len, 1));
+	KUNIT_EXPECT_EQ(test, 0, memcmp(out, &qmi_test_fixed, sizeof(*out)));
+}
+
+static void qmi_encdec_test_optional_not_compiled(struct kunit *test)
+{
+	const struct qmi_encdec_plan *null_plan = NULL;
+
+	KUNIT_EXPECT_PTR_EQ(test, null_plan, qmi_plan_get(qmi_test_opt_msg_ei));
+}
+
+static struct kunit_case qmi_encdec_test_cases[] = {
+	KUNIT_CASE(qmi_encdec_test_plan_matches_interpreter),
+	KUNIT_CASE(qmi_encdec_test_plan_roundtrip),
+	KUNIT_CASE(qmi_encdec_test_reordered_tlvs),
+	KUNIT_CASE(qmi_encdec_test_optional_not_compiled),
+	{},
+};
+
+static struct kunit_suite qmi_encdec_test_suite = {
+	.name = "qmi_encdec",
+	.test_cases = qmi_encdec_test_cases,
+};
+
+kunit_test_suite(qmi_encdec_test_suite);
@@ -16,6 +16,8 @@
 #include <linux/io.h>
 #include <linux/qcom_scm.h>
 
+#include "rmtfs_server.h"
+
 #define QCOM_RMTFS_MEM_DEV_MAX	(MINORMASK + 1)
 
 static dev_t qcom_rmtfs_mem_major;
@@ -31,6 +33,8 @@ struct qcom_rmtfs_mem {
 	unsigned int client_id;
 
 	unsigned int perms;
+
+	struct qcom_rmtfs_server *server;
 };
 
 static ssize_t qcom_rmtfs_mem_show(struct device *dev,
@@ -250,6 +254,16 @@ static int qcom_rmtfs_mem_probe(struct platform_device *pdev)
 		}
 	}
 
+	if (client_id == QCOM_RMTFS_SERVER_CLIENT_ID) {
+		rmtfs_mem->server = qcom_rmtfs_server_start(&rmtfs_mem->dev,
+							    rmtfs_mem->base,
+							    rmtfs_mem->addr,
+							    rmtfs_mem->size);
+		if (IS_ERR(rmtfs_mem->server))
+			dev_warn(&pdev->dev, "failed to start rmtfs server: %ld\n",
+				 PTR_ERR(rmtfs_mem->server));
+	}
+
 	dev_set_drvdata(&pdev->dev, rmtfs_mem);
 
 	return 0;
@@ -267,6 +281,8 @@ static int qcom_rmtfs_mem_remove(struct platform_device *pdev)
 	struct qcom_rmtfs_mem *rmtfs_mem = dev_get_drvdata(&pdev->dev);
 	struct qcom_scm_vmperm perm;
 
+	qcom_rmtfs_server_stop(rmtfs_mem->server);
+
 	if (rmtfs_mem->perms) {
 		perm.vmid = QCOM_SCM_VMID_HLOS;
 		perm.perm = QCOM_SCM_PERM_RW;
@@ -0,0 +1,991 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * In-kernel server for the Qualcomm remote filesystem (rmtfs) QMI service.
+ *
+ * The modem keeps its EFS in a handful of eMMC/UFS partitions, but has no
+ * access to the storage itself. It asks the rmtfs service to move sectors
+ * between these partitions and the rmtfs shared memory region instead. This
+ * implements the service on top of the block layer, so that requests are
+ * served without bouncing the data through a userspace daemon.
+ */
+
+#include <linux/bio.h>
+#include <linux/blkdev.h>
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
+#include <linux/mount.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/soc/qcom/qmi.h>
+
+#include "rmtfs_server.h"
+
+#define RMTFS_QMI_SERVICE		14
+#define RMTFS_QMI_VERSION		1
+#define RMTFS_QMI_INSTANCE		0
+
+#define RMTFS_QMI_OPEN			0x01
+#define RMTFS_QMI_CLOSE			0x02
+#define RMTFS_QMI_RW_IOVEC		0x03
+#define RMTFS_QMI_ALLOC_BUFF		0x04
+#define RMTFS_QMI_GET_DEV_ERROR		0x05
+
+#define RMTFS_PATH_MAX			255
+#define RMTFS_IOVEC_MAX			255
+
+#define RMTFS_OPEN_REQ_MAX_LEN		258
+#define RMTFS_RW_IOVEC_REQ_MAX_LEN	3079
+#define RMTFS_OPEN_RESP_MAX_LEN		14
+#define RMTFS_CLOSE_RESP_MAX_LEN	7
+#define RMTFS_RW_IOVEC_RESP_MAX_LEN	7
+#define RMTFS_ALLOC_BUFF_RESP_MAX_LEN	18
+#define RMTFS_DEV_ERROR_RESP_MAX_LEN	11
+
+#define RMTFS_DIRECTION_READ		0
+#define RMTFS_DIRECTION_WRITE		1
+
+/* Size of the bounce buffer, and of the largest bio issued */
+#define RMTFS_BOUNCE_SIZE		SZ_64K
+
+struct rmtfs_open_req {
+	char path[RMTFS_PATH_MAX + 1];
+};
+
+struct rmtfs_open_resp {
+	struct qmi_response_type_v01 resp;
+	u8 caller_id_valid;
+	u32 caller_id;
+};
+
+struct rmtfs_close_req {
+	u32 caller_id;
+};
+
+struct rmtfs_close_resp {
+	struct qmi_response_type_v01 resp;
+};
+
+struct rmtfs_iovec_entry {
+	u32 sector_addr;
+	u32 phys_offset;
+	u32 num_sector;
+};
+
+struct rmtfs_rw_iovec_req {
+	u32 caller_id;
+	u8 direction;
+	u8 iovec_len;
+	struct rmtfs_iovec_entry iovec[RMTFS_IOVEC_MAX];
+	u8 is_force_sync;
+};
+
+struct rmtfs_rw_iovec_resp {
+	struct qmi_response_type_v01 resp;
+};
+
+struct rmtfs_alloc_buff_req {
+	u32 caller_id;
+	u32 buff_size;
+};
+
+struct rmtfs_alloc_buff_resp {
+	struct qmi_response_type_v01 resp;
+	u8 buff_address_valid;
+	u64 buff_address;
+};
+
+struct rmtfs_dev_error_req {
+	u32 caller_id;
+};
+
+struct rmtfs_dev_error_resp {
+	struct qmi_response_type_v01 resp;
+	u8 status_valid;
+	u8 status;
+};
+
+static struct qmi_elem_info rmtfs_open_req_ei[] = {
+	{
+		.data_type	= QMI_STRING,
+		.elem_len	= RMTFS_PATH_MAX + 1,
+		.elem_size	= sizeof(char),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x01,
+		.offset		= offsetof(struct rmtfs_open_req, path),
+	},
+	{}
+};
+
+static struct qmi_elem_info rmtfs_open_resp_ei[] = {
+	{
+		.data_type	= QMI_STRUCT,
+		.elem_len	= 1,
+		.elem_size	= sizeof(struct qmi_response_type_v01),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x02,
+		.offset		= offsetof(struct rmtfs_open_resp, resp),
+		.ei_array	= qmi_response_type_v01_ei,
+	},
+	{
+		.data_type	= QMI_OPT_FLAG,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x10,
+		.offset		= offsetof(struct rmtfs_open_resp,
+					   caller_id_valid),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x10,
+		.offset		= offsetof(struct rmtfs_open_resp, caller_id),
+	},
+	{}
+};
+
+static struct qmi_elem_info rmtfs_close_req_ei[] = {
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x01,
+		.offset		= offsetof(struct rmtfs_close_req, caller_id),
+	},
+	{}
+};
+
+static struct qmi_elem_info rmtfs_close_resp_ei[] = {
+	{
+		.data_type	= QMI_STRUCT,
+		.elem_len	= 1,
+		.elem_size	= sizeof(struct qmi_response_type_v01),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x02,
+		.offset		= offsetof(struct rmtfs_close_resp, resp),
+		.ei_array	= qmi_response_type_v01_ei,
+	},
+	{}
+};
+
+static struct qmi_elem_info rmtfs_iovec_entry_ei[] = {
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0,
+		.offset		= offsetof(struct rmtfs_iovec_entry,
+					   sector_addr),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0,
+		.offset		= offsetof(struct rmtfs_iovec_entry,
+					   phys_offset),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0,
+		.offset		= offsetof(struct rmtfs_iovec_entry,
+					   num_sector),
+	},
+	{}
+};
+
+static struct qmi_elem_info rmtfs_rw_iovec_req_ei[] = {
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x01,
+		.offset		= offsetof(struct rmtfs_rw_iovec_req, caller_id),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_1_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x02,
+		.offset		= offsetof(struct rmtfs_rw_iovec_req, direction),
+	},
+	{
+		.data_type	= QMI_DATA_LEN,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x03,
+		.offset		= offsetof(struct rmtfs_rw_iovec_req, iovec_len),
+	},
+	{
+		.data_type	= QMI_STRUCT,
+		.elem_len	= RMTFS_IOVEC_MAX,
+		.elem_size	= sizeof(struct rmtfs_iovec_entry),
+		.array_type	= VAR_LEN_ARRAY,
+		.tlv_type	= 0x03,
+		.offset		= offsetof(struct rmtfs_rw_iovec_req, iovec),
+		.ei_array	= rmtfs_iovec_entry_ei,
+	},
+	{
+		.data_type	= QMI_UNSIGNED_1_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x04,
+		.offset		= offsetof(struct rmtfs_rw_iovec_req,
+					   is_force_sync),
+	},
+	{}
+};
+
+static struct qmi_elem_info rmtfs_rw_iovec_resp_ei[] = {
+	{
+		.data_type	= QMI_STRUCT,
+		.elem_len	= 1,
+		.elem_size	= sizeof(struct qmi_response_type_v01),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x02,
+		.offset		= offsetof(struct rmtfs_rw_iovec_resp, resp),
+		.ei_array	= qmi_response_type_v01_ei,
+	},
+	{}
+};
+
+static struct qmi_elem_info rmtfs_alloc_buff_req_ei[] = {
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x01,
+		.offset		= offsetof(struct rmtfs_alloc_buff_req, caller_id),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x02,
+		.offset		= offsetof(struct rmtfs_alloc_buff_req, buff_size),
+	},
+	{}
+};
+
+static struct qmi_elem_info rmtfs_alloc_buff_resp_ei[] = {
+	{
+		.data_type	= QMI_STRUCT,
+		.elem_len	= 1,
+		.elem_size	= sizeof(struct qmi_response_type_v01),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x02,
+		.offset		= offsetof(struct rmtfs_alloc_buff_resp, resp),
+		.ei_array	= qmi_response_type_v01_ei,
+	},
+	{
+		.data_type	= QMI_OPT_FLAG,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x10,
+		.offset		= offsetof(struct rmtfs_alloc_buff_resp,
+					   buff_address_valid),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_8_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u64),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x10,
+		.offset		= offsetof(struct rmtfs_alloc_buff_resp,
+					   buff_address),
+	},
+	{}
+};
+
+static struct qmi_elem_info rmtfs_dev_error_req_ei[] = {
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x01,
+		.offset		= offsetof(struct rmtfs_dev_error_req, caller_id),
+	},
+	{}
+};
+
+static struct qmi_elem_info rmtfs_dev_error_resp_ei[] = {
+	{
+		.data_type	= QMI_STRUCT,
+		.elem_len	= 1,
+		.elem_size	= sizeof(struct qmi_response_type_v01),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x02,
+		.offset		= offsetof(struct rmtfs_dev_error_resp, resp),
+		.ei_array	= qmi_response_type_v01_ei,
+	},
+	{
+		.data_type	= QMI_OPT_FLAG,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x10,
+		.offset		= offsetof(struct rmtfs_dev_error_resp,
+					   status_valid),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_1_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x10,
+		.offset		= offsetof(struct rmtfs_dev_error_resp, status),
+	},
+	{}
+};
+
+/**
+ * struct rmtfs_partition - file known to the modem and its backing partition
+ * @path:	path requested by the modem
+ * @partlabel:	label of the partition backing @path
+ */
+struct rmtfs_partition {
+	const char *path;
+	const char *partlabel;
+};
+
+static const struct rmtfs_partition rmtfs_partitions[] = {
+	{ .path = "/boot/modem_fs1", .partlabel = "modemst1" },
+	{ .path = "/boot/modem_fs2", .partlabel = "modemst2" },
+	{ .path = "/boot/modem_fsc", .partlabel = "fsc" },
+	{ .path = "/boot/modem_fsg", .partlabel = "fsg" },
+};
+
+enum rmtfs_server_op {
+	RMTFS_OP_OPEN,
+	RMTFS_OP_CLOSE,
+	RMTFS_OP_READ,
+	RMTFS_OP_WRITE,
+	RMTFS_OP_ALLOC_BUFF,
+	RMTFS_OP_DEV_ERROR,
+	RMTFS_OP_COUNT,
+};
+
+static const char * const rmtfs_server_op_names[RMTFS_OP_COUNT] = {
+	[RMTFS_OP_OPEN] = "open",
+	[RMTFS_OP_CLOSE] = "close",
+	[RMTFS_OP_READ] = "read",
+	[RMTFS_OP_WRITE] = "write",
+	[RMTFS_OP_ALLOC_BUFF] = "alloc_buff",
+	[RMTFS_OP_DEV_ERROR] = "dev_error",
+};
+
+/**
+ * struct rmtfs_server_stat - latency statistics of one type of request
+ * @count:	number of requests handled
+ * @errors:	number of requests failed
+ * @bytes:	number of bytes transferred
+ * @total_ns:	accumulated handling time
+ * @max_ns:	longest handling time
+ */
+struct rmtfs_server_stat {
+	u64 count;
+	u64 errors;
+	u64 bytes;
+	u64 total_ns;
+	u64 max_ns;
+};
+
+/**
+ * struct rmtfs_caller - an opened file
+ * @sq:		address of the client that opened the file
+ * @bdev:	backing block device, NULL if not opened
+ * @dev_error:	an I/O error occurred since the last GET_DEV_ERROR request
+ */
+struct rmtfs_caller {
+	struct sockaddr_qrtr sq;
+	struct block_device *bdev;
+	bool dev_error;
+};
+
+/**
+ * struct qcom_rmtfs_server - server context
+ * @dev:	rmtfs memory device
+ * @qmi:	QMI handle of the service
+ * @base:	kernel mapping of the shared memory region
+ * @addr:	physical address of the shared memory region
+ * @size:	size of the shared memory region
+ * @direct:	the region has struct pages, so bios target it directly
+ * @bounce:	bounce buffer, for regions outside of the kernel's memory map
+ * @callers:	opened files, the caller id is the index plus one
+ * @lock:	protects @stats from concurrent readers
+ * @stats:	latency statistics per type of request
+ * @debugfs:	debugfs directory of the server
+ */
+struct qcom_rmtfs_server {
+	struct device *dev;
+	struct qmi_handle qmi;
+
+	void *base;
+	phys_addr_t addr;
+	phys_addr_t size;
+
+	bool direct;
+	void *bounce;
+
+	struct rmtfs_caller callers[ARRAY_SIZE(rmtfs_partitions)];
+
+	struct mutex lock;
+	struct rmtfs_server_stat stats[RMTFS_OP_COUNT];
+
+	struct dentry *debugfs;
+};
+
+static inline struct qcom_rmtfs_server *to_rmtfs_server(struct qmi_handle *qmi)
+{
+	return container_of(qmi, struct qcom_rmtfs_server, qmi);
+}
+
+static void rmtfs_server_account(struct qcom_rmtfs_server *server,
+				 enum rmtfs_server_op op, ktime_t start,
+				 size_t bytes, int ret)
+{
+	struct rmtfs_server_stat *stat = &server->stats[op];
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	mutex_lock(&server->lock);
+	stat->count++;
+	stat->bytes += bytes;
+	stat->total_ns += ns;
+	stat->max_ns = max(stat->max_ns, ns);
+	if (ret)
+		stat->errors++;
+	mutex_unlock(&server->lock);
+
+	dev_dbg(server->dev, "%s: %zu bytes in %llu us, ret %d\n",
+		rmtfs_server_op_names[op], bytes, div_u64(ns, NSEC_PER_USEC),
+		ret);
+}
+
+static void rmtfs_server_set_error(struct qmi_response_type_v01 *resp,
+				   int ret)
+{
+	if (!ret)
+		return;
+
+	resp->result = QMI_RESULT_FAILURE_V01;
+	resp->error = ret == -EINVAL ? QMI_ERR_MALFORMED_MSG_V01 :
+				       QMI_ERR_INTERNAL_V01;
+}
+
+static struct rmtfs_caller *
+rmtfs_server_get_caller(struct qcom_rmtfs_server *server, u32 caller_id)
+{
+	struct rmtfs_caller *caller;
+
+	if (!caller_id || caller_id > ARRAY_SIZE(server->callers))
+		return NULL;
+
+	caller = &server->callers[caller_id - 1];
+
+	return caller->bdev ? caller : NULL;
+}
+
+static void rmtfs_server_close_caller(struct rmtfs_caller *caller)
+{
+	if (!caller->bdev)
+		return;
+
+	blkdev_put(caller->bdev, FMODE_READ | FMODE_WRITE);
+	caller->bdev = NULL;
+	caller->dev_error = false;
+}
+
+static int rmtfs_server_bio(struct block_device *bdev, sector_t sector,
+			    phys_addr_t phys, size_t len, unsigned int op)
+{
+	unsigned int nr_pages = DIV_ROUND_UP(offset_in_page(phys) + len,
+					     PAGE_SIZE);
+	struct bio *bio;
+	size_t n;
+	int ret;
+
+	bio = bio_alloc(GFP_KERNEL, nr_pages);
+	bio_set_dev(bio, bdev);
+	bio->bi_iter.bi_sector = sector;
+	bio->bi_opf = op | REQ_SYNC;
+
+	while (len) {
+		n = min_t(size_t, len, PAGE_SIZE - offset_in_page(phys));
+		if (bio_add_page(bio, pfn_to_page(PHYS_PFN(phys)), n,
+				 offset_in_page(phys)) != n) {
+			ret = -EIO;
+			goto out;
+		}
+
+		phys += n;
+		len -= n;
+	}
+
+	ret = submit_bio_wait(bio);
+out:
+	bio_put(bio);
+
+	return ret;
+}
+
+/*
+ * Move @len bytes between the partition at @sector and @offset in the shared
+ * memory region, in chunks of at most RMTFS_BOUNCE_SIZE.
+ */
+static int rmtfs_server_transfer(struct qcom_rmtfs_server *server,
+				 struct rmtfs_caller *caller, sector_t sector,
+				 size_t offset, size_t len, bool write)
+{
+	unsigned int op = write ? REQ_OP_WRITE : REQ_OP_READ;
+	phys_addr_t phys;
+	size_t n;
+	int ret;
+
+	while (len) {
+		n = min_t(size_t, len, RMTFS_BOUNCE_SIZE);
+
+		if (server->direct) {
+			phys = server->addr + offset;
+		} else {
+			phys = virt_to_phys(server->bounce);
+			if (write)
+				memcpy(server->bounce, server->base + offset, n);
+		}
+
+		ret = rmtfs_server_bio(caller->bdev, sector, phys, n, op);
+		if (ret)
+			return ret;
+
+		if (!server->direct && !write)
+			memcpy(server->base + offset, server->bounce, n);
+
+		sector += n >> SECTOR_SHIFT;
+		offset += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+static void rmtfs_server_open(struct qmi_handle *qmi, struct sockaddr_qrtr *sq,
+			      struct qmi_txn *txn, const void *data)
+{
+	struct qcom_rmtfs_server *server = to_rmtfs_server(qmi);
+	const struct rmtfs_open_req *req = data;
+	struct rmtfs_open_resp resp = {};
+	struct rmtfs_caller *caller = NULL;
+	struct block_device *bdev;
+	ktime_t start = ktime_get();
+	char name[32];
+	dev_t devt;
+	int ret = -ENOENT;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(rmtfs_partitions); i++) {
+		if (!strcmp(req->path, rmtfs_partitions[i].path)) {
+			caller = &server->callers[i];
+			break;
+		}
+	}
+	if (!caller) {
+		dev_err(server->dev, "unknown file \"%s\"\n", req->path);
+		goto respond;
+	}
+
+	/* Reopening a file hands out the same caller id */
+	if (!caller->bdev) {
+		snprintf(name, sizeof(name), "PARTLABEL=%s",
+			 rmtfs_partitions[i].partlabel);
+
+		devt = name_to_dev_t(name);
+		if (!devt) {
+			dev_err(server->dev, "no partition labeled %s\n",
+				rmtfs_partitions[i].partlabel);
+			goto respond;
+		}
+
+		bdev = blkdev_get_by_dev(devt, FMODE_READ | FMODE_WRITE, NULL);
+		if (IS_ERR(bdev)) {
+			ret = PTR_ERR(bdev);
+			dev_err(server->dev, "failed to open %s: %d\n",
+				rmtfs_partitions[i].partlabel, ret);
+			goto respond;
+		}
+
+		caller->bdev = bdev;
+	}
+
+	caller->sq = *sq;
+	resp.caller_id_valid = 1;
+	resp.caller_id = i + 1;
+	ret = 0;
+
+respond:
+	rmtfs_server_set_error(&resp.resp, ret);
+	qmi_send_response(qmi, sq, txn, RMTFS_QMI_OPEN, RMTFS_OPEN_RESP_MAX_LEN,
+			  rmtfs_open_resp_ei, &resp);
+
+	rmtfs_server_account(server, RMTFS_OP_OPEN, start, 0, ret);
+}
+
+static void rmtfs_server_close(struct qmi_handle *qmi, struct sockaddr_qrtr *sq,
+			       struct qmi_txn *txn, const void *data)
+{
+	struct qcom_rmtfs_server *server = to_rmtfs_server(qmi);
+	const struct rmtfs_close_req *req = data;
+	struct rmtfs_close_resp resp = {};
+	struct rmtfs_caller *caller;
+	ktime_t start = ktime_get();
+	int ret = 0;
+
+	caller = rmtfs_server_get_caller(server, req->caller_id);
+	if (caller)
+		rmtfs_server_close_caller(caller);
+	else
+		ret = -EINVAL;
+
+	rmtfs_server_set_error(&resp.resp, ret);
+	qmi_send_response(qmi, sq, txn, RMTFS_QMI_CLOSE,
+			  RMTFS_CLOSE_RESP_MAX_LEN, rmtfs_close_resp_ei, &resp);
+
+	rmtfs_server_account(server, RMTFS_OP_CLOSE, start, 0, ret);
+}
+
+static void rmtfs_server_rw_iovec(struct qmi_handle *qmi,
+				  struct sockaddr_qrtr *sq,
+				  struct qmi_txn *txn, const void *data)
+{
+	struct qcom_rmtfs_server *server = to_rmtfs_server(qmi);
+	const struct rmtfs_rw_iovec_req *req = data;
+	const struct rmtfs_iovec_entry *entry;
+	struct rmtfs_rw_iovec_resp resp = {};
+	bool write = req->direction == RMTFS_DIRECTION_WRITE;
+	struct rmtfs_caller *caller;
+	ktime_t start = ktime_get();
+	size_t total = 0;
+	u64 sector, phys, len;
+	int ret = 0;
+	int i;
+
+	caller = rmtfs_server_get_caller(server, req->caller_id);
+	if (!caller || req->iovec_len > RMTFS_IOVEC_MAX) {
+		ret = -EINVAL;
+		goto respond;
+	}
+
+	for (i = 0; i < req->iovec_len; ) {
+		entry = &req->iovec[i++];
+		sector = entry->sector_addr;
+		phys = entry->phys_offset;
+		len = (u64)entry->num_sector << SECTOR_SHIFT;
+
+		/* Merge entries contiguous both on disk and in memory */
+		for (; i < req->iovec_len; i++) {
+			entry = &req->iovec[i];
+			if (entry->sector_addr != sector + (len >> SECTOR_SHIFT) ||
+			    entry->phys_offset != phys + len)
+				break;
+
+			len += (u64)entry->num_sector << SECTOR_SHIFT;
+		}
+
+		/* phys_offset is the physical address within the region */
+		if (phys < server->addr ||
+		    phys + len > server->addr + server->size) {
+			dev_err(server->dev, "iovec outside of rmtfs region\n");
+			ret = -EINVAL;
+			break;
+		}
+
+		ret = rmtfs_server_transfer(server, caller, sector,
+					    phys - server->addr, len, write);
+		if (ret) {
+			caller->dev_error = true;
+			break;
+		}
+
+		total += len;
+	}
+
+	if (!ret && write && req->is_force_sync) {
+		ret = blkdev_issue_flush(caller->bdev, GFP_KERNEL);
+		if (ret)
+			caller->dev_error = true;
+	}
+
+respond:
+	rmtfs_server_set_error(&resp.resp, ret);
+	qmi_send_response(qmi, sq, txn, RMTFS_QMI_RW_IOVEC,
+			  RMTFS_RW_IOVEC_RESP_MAX_LEN, rmtfs_rw_iovec_resp_ei,
+			  &resp);
+
+	rmtfs_server_account(server, write ? RMTFS_OP_WRITE : RMTFS_OP_READ,
+			     start, total, ret);
+}
+
+static void rmtfs_server_alloc_buff(struct qmi_handle *qmi,
+				    struct sockaddr_qrtr *sq,
+				    struct qmi_txn *txn, const void *data)
+{
+	struct qcom_rmtfs_server *server = to_rmtfs_server(qmi);
+	const struct rmtfs_alloc_buff_req *req = data;
+	struct rmtfs_alloc_buff_resp resp = {};
+	ktime_t start = ktime_get();
+	int ret = 0;
+
+	/* The whole region serves as the one and only buffer */
+	if (!rmtfs_server_get_caller(server, req->caller_id))
+		ret = -EINVAL;
+	else if (req->buff_size > server->size)
+		ret = -ENOMEM;
+
+	if (!ret) {
+		resp.buff_address_valid = 1;
+		resp.buff_address = server->addr;
+	}
+
+	rmtfs_server_set_error(&resp.resp, ret);
+	qmi_send_response(qmi, sq, txn, RMTFS_QMI_ALLOC_BUFF,
+			  RMTFS_ALLOC_BUFF_RESP_MAX_LEN,
+			  rmtfs_alloc_buff_resp_ei, &resp);
+
+	rmtfs_server_account(server, RMTFS_OP_ALLOC_BUFF, start, 0, ret);
+}
+
+static void rmtfs_server_dev_error(struct qmi_handle *qmi,
+				   struct sockaddr_qrtr *sq,
+				   struct qmi_txn *txn, const void *data)
+{
+	struct qcom_rmtfs_server *server = to_rmtfs_server(qmi);
+	const struct rmtfs_dev_error_req *req = data;
+	struct rmtfs_dev_error_resp resp = {};
+	struct rmtfs_caller *caller;
+	ktime_t start = ktime_get();
+	int ret = 0;
+
+	caller = rmtfs_server_get_caller(server, req->caller_id);
+	if (caller) {
+		resp.status_valid = 1;
+		resp.status = caller->dev_error;
+		caller->dev_error = false;
+	} else {
+		ret = -EINVAL;
+	}
+
+	rmtfs_server_set_error(&resp.resp, ret);
+	qmi_send_response(qmi, sq, txn, RMTFS_QMI_GET_DEV_ERROR,
+			  RMTFS_DEV_ERROR_RESP_MAX_LEN, rmtfs_dev_error_resp_ei,
+			  &resp);
+
+	rmtfs_server_account(server, RMTFS_OP_DEV_ERROR, start, 0, ret);
+}
+
+static const struct qmi_msg_handler rmtfs_server_handlers[] = {
+	{
+		.type = QMI_REQUEST,
+		.msg_id = RMTFS_QMI_OPEN,
+		.ei = rmtfs_open_req_ei,
+		.decoded_size = sizeof(struct rmtfs_open_req),
+		.fn = rmtfs_server_open,
+	},
+	{
+		.type = QMI_REQUEST,
+		.msg_id = RMTFS_QMI_CLOSE,
+		.ei = rmtfs_close_req_ei,
+		.decoded_size = sizeof(struct rmtfs_close_req),
+		.fn = rmtfs_server_close,
+	},
+	{
+		.type = QMI_REQUEST,
+		.msg_id = RMTFS_QMI_RW_IOVEC,
+		.ei = rmtfs_rw_iovec_req_ei,
+		.decoded_size = sizeof(struct rmtfs_rw_iovec_req),
+		.fn = rmtfs_server_rw_iovec,
+	},
+	{
+		.type = QMI_REQUEST,
+		.msg_id = RMTFS_QMI_ALLOC_BUFF,
+		.ei = rmtfs_alloc_buff_req_ei,
+		.decoded_size = sizeof(struct rmtfs_alloc_buff_req),
+		.fn = rmtfs_server_alloc_buff,
+	},
+	{
+		.type = QMI_REQUEST,
+		.msg_id = RMTFS_QMI_GET_DEV_ERROR,
+		.ei = rmtfs_dev_error_req_ei,
+		.decoded_size = sizeof(struct rmtfs_dev_error_req),
+		.fn = rmtfs_server_dev_error,
+	},
+	{}
+};
+
+static void rmtfs_server_del_client(struct qmi_handle *qmi,
+				    unsigned int node, unsigned int port)
+{
+	struct qcom_rmtfs_server *server = to_rmtfs_server(qmi);
+	struct rmtfs_caller *caller;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(server->callers); i++) {
+		caller = &server->callers[i];
+		if (caller->sq.sq_node == node && caller->sq.sq_port == port)
+			rmtfs_server_close_caller(caller);
+	}
+}
+
+static void rmtfs_server_bye(struct qmi_handle *qmi, unsigned int node)
+{
+	struct qcom_rmtfs_server *server = to_rmtfs_server(qmi);
+	struct rmtfs_caller *caller;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(server->callers); i++) {
+		caller = &server->callers[i];
+		if (caller->sq.sq_node == node)
+			rmtfs_server_close_caller(caller);
+	}
+}
+
+static const struct qmi_ops rmtfs_server_ops = {
+	.del_client = rmtfs_server_del_client,
+	.bye = rmtfs_server_bye,
+};
+
+static int rmtfs_server_stats_show(struct seq_file *s, void *unused)
+{
+	struct qcom_rmtfs_server *server = s->private;
+	struct rmtfs_server_stat *stat;
+	int i;
+
+	seq_printf(s, "%-10s %10s %8s %12s %10s %10s\n", "request", "count",
+		   "errors", "bytes", "avg_us", "max_us");
+
+	mutex_lock(&server->lock);
+	for (i = 0; i < RMTFS_OP_COUNT; i++) {
+		stat = &server->stats[i];
+		seq_printf(s, "%-10s %10llu %8llu %12llu %10llu %10llu\n",
+			   rmtfs_server_op_names[i], stat->count, stat->errors,
+			   stat->bytes,
+			   stat->count ? div64_u64(stat->total_ns, stat->count) /
+					 NSEC_PER_USEC : 0,
+			   div_u64(stat->max_ns, NSEC_PER_USEC));
+	}
+	mutex_unlock(&server->lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(rmtfs_server_stats);
+
+/**
+ * qcom_rmtfs_server_start() - serve the rmtfs QMI service from the kernel
+ * @dev:	rmtfs memory device
+ * @base:	kernel mapping of the shared memory region
+ * @addr:	physical address of the shared memory region
+ * @size:	size of the shared memory region
+ *
+ * Returns a handle to be passed to qcom_rmtfs_server_stop(), or ERR_PTR().
+ */
+struct qcom_rmtfs_server *qcom_rmtfs_server_start(struct device *dev,
+						  void *base,
+						  phys_addr_t addr,
+						  phys_addr_t size)
+{
+	struct qcom_rmtfs_server *server;
+	int ret;
+
+	server = kzalloc(sizeof(*server), GFP_KERNEL);
+	if (!server)
+		return ERR_PTR(-ENOMEM);
+
+	server->dev = dev;
+	server->base = base;
+	server->addr = addr;
+	server->size = size;
+	mutex_init(&server->lock);
+
+	server->direct = pfn_valid(PHYS_PFN(addr)) &&
+			 pfn_valid(PHYS_PFN(addr + size - 1));
+	if (!server->direct) {
+		server->bounce = (void *)__get_free_pages(GFP_KERNEL,
+						get_order(RMTFS_BOUNCE_SIZE));
+		if (!server->bounce) {
+			ret = -ENOMEM;
+			goto free_server;
+		}
+	}
+
+	ret = qmi_handle_init(&server->qmi, RMTFS_RW_IOVEC_REQ_MAX_LEN,
+			      &rmtfs_server_ops, rmtfs_server_handlers);
+	if (ret < 0)
+		goto free_bounce;
+
+	ret = qmi_add_server(&server->qmi, RMTFS_QMI_SERVICE,
+			     RMTFS_QMI_VERSION, RMTFS_QMI_INSTANCE);
+	if (ret < 0)
+		goto release_qmi;
+
+	server->debugfs = debugfs_create_dir("qcom_rmtfs_server", NULL);
+	debugfs_create_file("stats", 0400, server->debugfs, server,
+			    &rmtfs_server_stats_fops);
+
+	dev_info(dev, "serving rmtfs requests from the kernel%s\n",
+		 server->direct ? "" : " through a bounce buffer");
+
+	return server;
+
+release_qmi:
+	qmi_handle_release(&server->qmi);
+free_bounce:
+	if (server->bounce)
+		free_pages((unsigned long)server->bounce,
+			   get_order(RMTFS_BOUNCE_SIZE));
+free_server:
+	kfree(server);
+
+	return ERR_PTR(ret);
+}
+
+/**
+ * qcom_rmtfs_server_stop() - stop serving the rmtfs QMI service
+ * @server:	handle returned by qcom_rmtfs_server_start()
+ */
+void qcom_rmtfs_server_stop(struct qcom_rmtfs_server *server)
+{
+	int i;
+
+	if (IS_ERR_OR_NULL(server))
+		return;
+
+	debugfs_remove_recursive(server->debugfs);
+
+	/* No requests are handled once the QMI handle is released */
+	qmi_handle_release(&server->qmi);
+
+	for (i = 0; i < ARRAY_SIZE(server->callers); i++)
+		rmtfs_server_close_caller(&server->callers[i]);
+
+	if (server->bounce)
+		free_pages((unsigned long)server->bounce,
+			   get_order(RMTFS_BOUNCE_SIZE));
+	kfree(server);
+}
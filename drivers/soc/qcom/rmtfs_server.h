@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef __QCOM_RMTFS_SERVER_H__
+#define __QCOM_RMTFS_SERVER_H__
+
+#include <linux/err.h>
+#include <linux/types.h>
+
+struct device;
+struct qcom_rmtfs_server;
+
+/* The remote filesystem service operates on the region of client id 1 */
+#define QCOM_RMTFS_SERVER_CLIENT_ID	1
+
+#if IS_ENABLED(CONFIG_QCOM_RMTFS_SERVER)
+
+struct qcom_rmtfs_server *qcom_rmtfs_server_start(struct device *dev,
+						  void *base,
+						  phys_addr_t addr,
+						  phys_addr_t size);
+void qcom_rmtfs_server_stop(struct qcom_rmtfs_server *server);
+
+#else
+
+static inline struct qcom_rmtfs_server *
+qcom_rmtfs_server_start(struct device *dev, void *base, phys_addr_t addr,
+			phys_addr_t size)
+{
+	return NULL;
+}
+
+static inline void qcom_rmtfs_server_stop(struct qcom_rmtfs_server *server)
+{
+}
+
+#endif
+
+#endif
@@ -1,9 +1,11 @@
 // SPDX-License-Identifier: GPL-2.0
 /* Copyright (c) 2017-2018, The Linux Foundation. All rights reserved. */
 
+#include <linux/debugfs.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/pm_domain.h>
@@ -11,6 +13,7 @@
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
 #include <linux/pm_opp.h>
+#include <linux/seq_file.h>
 #include <linux/soc/qcom/smd-rpm.h>
 
 #include <dt-bindings/power/qcom-rpmpd.h>
@@ -94,6 +97,12 @@ struct rpmpd_req {
 	__le32 value;
 };
 
+struct rpmpd_latency {
+	u64 count;
+	u64 max_ns;
+	u64 total_ns;
+};
+
 struct rpmpd {
 	struct generic_pm_domain pd;
 	struct rpmpd *peer;
@@ -106,15 +115,19 @@ struct rpmpd {
 	struct qcom_smd_rpm *rpm;
 	unsigned int max_state;
 	__le32 key;
+	struct rpmpd_latency on_latency;
+	struct rpmpd_latency off_latency;
 };
 
 struct rpmpd_desc {
 	struct rpmpd **rpmpds;
 	size_t num_pds;
 	unsigned int max_state;
+	bool latency_gov;
 };
 
 static DEFINE_MUTEX(rpmpd_lock);
+static struct dentry *rpmpd_debugfs_root;
 
 /* msm8939 RPM Power Domains */
 DEFINE_RPMPD_PAIR(msm8939, vddmd, vddmd_ao, SMPA, CORNER, 1);
@@ -183,6 +196,7 @@ static const struct rpmpd_desc msm8953_desc = {
 	.rpmpds = msm8953_rpmpds,
 	.num_pds = ARRAY_SIZE(msm8953_rpmpds),
 	.max_state = RPM_SMD_LEVEL_TURBO,
+	.latency_gov = true,
 };
 
 /* msm8976 RPM Power Domains */
@@ -394,10 +408,20 @@ static int rpmpd_aggregate_corner(struct rpmpd *pd)
 	return rpmpd_send_corner(pd, QCOM_SMD_RPM_SLEEP_STATE, sleep_corner);
 }
 
+static void rpmpd_account(struct rpmpd_latency *lat, ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	lat->count++;
+	lat->max_ns = max(lat->max_ns, ns);
+	lat->total_ns += ns;
+}
+
 static int rpmpd_power_on(struct generic_pm_domain *domain)
 {
 	int ret;
 	struct rpmpd *pd = domain_to_rpmpd(domain);
+	ktime_t start = ktime_get();
 
 	mutex_lock(&rpmpd_lock);
 
@@ -410,6 +434,9 @@ static int rpmpd_power_on(struct generic_pm_domain *domain)
 	if (pd->corner)
 		ret = rpmpd_aggregate_corner(pd);
 
+	if (!ret)
+		rpmpd_account(&pd->on_latency, start);
+
 out:
 	mutex_unlock(&rpmpd_lock);
 
@@ -420,12 +447,15 @@ static int rpmpd_power_off(struct generic_pm_domain *domain)
 {
 	int ret;
 	struct rpmpd *pd = domain_to_rpmpd(domain);
+	ktime_t start = ktime_get();
 
 	mutex_lock(&rpmpd_lock);
 
 	ret = rpmpd_send_enable(pd, false);
-	if (!ret)
+	if (!ret) {
 		pd->enabled = false;
+		rpmpd_account(&pd->off_latency, start);
+	}
 
 	mutex_unlock(&rpmpd_lock);
 
@@ -464,6 +494,58 @@ static unsigned int rpmpd_get_performance(struct generic_pm_domain *genpd,
 	return dev_pm_opp_get_level(opp);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static void rpmpd_latency_show(struct seq_file *s, const char *name,
+			       const struct rpmpd_latency *lat)
+{
+	seq_printf(s, "%s: count %llu max %llu ns avg %llu ns\n",
+		   name, lat->count, lat->max_ns,
+		   lat->count ? div64_u64(lat->total_ns, lat->count) : 0);
+}
+
+static int rpmpd_timing_show(struct seq_file *s, void *unused)
+{
+	struct rpmpd *pd = s->private;
+
+	mutex_lock(&rpmpd_lock);
+	rpmpd_latency_show(s, "on", &pd->on_latency);
+	rpmpd_latency_show(s, "off", &pd->off_latency);
+	mutex_unlock(&rpmpd_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(rpmpd_timing);
+
+static void rpmpd_debugfs_remove(void *data)
+{
+	debugfs_remove_recursive(data);
+}
+
+static void rpmpd_debugfs_init(struct device *dev, struct rpmpd **rpmpds,
+			       size_t num)
+{
+	struct dentry *root;
+	int i;
+
+	root = debugfs_create_dir(dev_name(dev), rpmpd_debugfs_root);
+	if (devm_add_action_or_reset(dev, rpmpd_debugfs_remove, root))
+		return;
+
+	for (i = 0; i < num; i++) {
+		if (!rpmpds[i])
+			continue;
+
+		debugfs_create_file(rpmpds[i]->pd.name, 0400, root, rpmpds[i],
+				    &rpmpd_timing_fops);
+	}
+}
+#else
+static void rpmpd_debugfs_init(struct device *dev, struct rpmpd **rpmpds,
+			       size_t num)
+{
+}
+#endif
+
 static int rpmpd_probe(struct platform_device *pdev)
 {
 	int i;
@@ -472,6 +554,8 @@ static int rpmpd_probe(struct platform_device *pdev)
 	struct qcom_smd_rpm *rpm;
 	struct rpmpd **rpmpds;
 	const struct rpmpd_desc *desc;
+	struct dev_power_governor *gov = NULL;
+	int ret;
 
 	rpm = dev_get_drvdata(pdev->dev.parent);
 	if (!rpm) {
@@ -494,6 +578,10 @@ static int rpmpd_probe(struct platform_device *pdev)
 				     GFP_KERNEL);
 	data->num_domains = num;
 
+	/* simple_qos_governor isn't exported, so modular builds go without */
+	if (desc->latency_gov && IS_BUILTIN(CONFIG_QCOM_RPMPD))
+		gov = &simple_qos_governor;
+
 	for (i = 0; i < num; i++) {
 		if (!rpmpds[i]) {
 			dev_warn(&pdev->dev, "rpmpds[] with empty entry at index=%d\n",
@@ -507,7 +595,7 @@ static int rpmpd_probe(struct platform_device *pdev)
 		rpmpds[i]->pd.power_on = rpmpd_power_on;
 		rpmpds[i]->pd.set_performance_state = rpmpd_set_performance;
 		rpmpds[i]->pd.opp_to_performance_state = rpmpd_get_performance;
-		pm_genpd_init(&rpmpds[i]->pd, NULL, true);
+		pm_genpd_init(&rpmpds[i]->pd, gov, true);
 		rpmpds[i]->pd.domain.ops.resume_early =	rpmpds[i]->pd.domain.ops.resume_noirq;
 		rpmpds[i]->pd.domain.ops.suspend_late =	rpmpds[i]->pd.domain.ops.suspend_noirq;;
 		rpmpds[i]->pd.domain.ops.resume_noirq = NULL;
@@ -516,7 +604,13 @@ static int rpmpd_probe(struct platform_device *pdev)
 		data->domains[i] = &rpmpds[i]->pd;
 	}
 
-	return of_genpd_add_provider_onecell(pdev->dev.of_node, data);
+	ret = of_genpd_add_provider_onecell(pdev->dev.of_node, data);
+	if (ret)
+		return ret;
+
+	rpmpd_debugfs_init(&pdev->dev, rpmpds, num);
+
+	return 0;
 }
 
 static struct platform_driver rpmpd_driver = {
@@ -530,7 +624,15 @@ static struct platform_driver rpmpd_driver = {
 
 static int __init rpmpd_init(void)
 {
-	return platform_driver_register(&rpmpd_driver);
+	int ret;
+
+	rpmpd_debugfs_root = debugfs_create_dir("qcom_rpmpd", NULL);
+
+	ret = platform_driver_register(&rpmpd_driver);
+	if (ret)
+		debugfs_remove_recursive(rpmpd_debugfs_root);
+
+	return ret;
 }
 core_initcall(rpmpd_init);
 
@@ -245,6 +245,38 @@ struct smem_region {
 	size_t size;
 };
 
+/**
+ * struct smem_item_entry - location of an item in a private partition
+ * @ptr:	pointer to the item data, NULL while the item isn't indexed
+ * @size:	size of the item data, excluding padding
+ */
+struct smem_item_entry {
+	void *ptr;
+	size_t size;
+};
+
+/**
+ * struct smem_item_index - directory of the items in a private partition
+ * @items:	array of item_count entries, indexed by item number
+ * @uncached:	next uncached entry to be indexed
+ * @cached:	next cached entry to be indexed
+ * @free_uncached: value of offset_free_uncached when last indexed
+ * @free_cached: value of offset_free_cached when last indexed
+ *
+ * Items are never freed, so an indexed entry stays valid for the lifetime of
+ * the partition. The index is filled lazily, by resuming the walk of the two
+ * lists where it previously ended once the free offsets of the partition show
+ * that any host allocated new items. Entries are added with the hwspinlock
+ * held and looked up without it.
+ */
+struct smem_item_index {
+	struct smem_item_entry *items;
+	struct smem_private_entry *uncached;
+	struct smem_private_entry *cached;
+	u32 free_uncached;
+	u32 free_cached;
+};
+
 /**
  * struct qcom_smem - device data for the smem device
  * @dev:	device pointer
@@ -254,6 +286,8 @@ struct smem_region {
  * @partitions:	list of pointers to partitions affecting the current
  *		processor/host
  * @cacheline:	list of cacheline sizes for each host
+ * @global_index: item index of the global partition
+ * @index:	item index of each partition in @partitions
  * @item_count: max accepted item number
  * @socinfo:	platform device pointer
  * @num_regions: number of @regions
@@ -268,6 +302,8 @@ struct qcom_smem {
 	size_t global_cacheline;
 	struct smem_partition_header *partitions[SMEM_HOST_COUNT];
 	size_t cacheline[SMEM_HOST_COUNT];
+	struct smem_item_index global_index;
+	struct smem_item_index index[SMEM_HOST_COUNT];
 	u32 item_count;
 	struct platform_device *socinfo;
 
@@ -346,27 +382,136 @@ static struct qcom_smem *__smem;
 /* Timeout (ms) for the trylock of remote spinlocks */
 #define HWSPINLOCK_TIMEOUT	1000
 
+static void qcom_smem_index_reset(struct smem_item_index *idx,
+				  struct smem_partition_header *phdr,
+				  size_t cacheline)
+{
+	idx->uncached = phdr_to_first_uncached_entry(phdr);
+	idx->cached = phdr_to_first_cached_entry(phdr, cacheline);
+	idx->free_uncached = 0;
+	idx->free_cached = 0;
+}
+
+static void qcom_smem_index_add(struct qcom_smem *smem,
+				struct smem_item_index *idx,
+				struct smem_private_entry *e,
+				void *ptr)
+{
+	struct smem_item_entry *entry;
+	unsigned item = le16_to_cpu(e->item);
+
+	if (item >= smem->item_count)
+		return;
+
+	/* The first entry found wins, as it did for the linear walk */
+	entry = &idx->items[item];
+	if (entry->ptr)
+		return;
+
+	entry->size = le32_to_cpu(e->size) - le16_to_cpu(e->padding_data);
+	smp_store_release(&entry->ptr, ptr);
+}
+
+/*
+ * Index the entries allocated since the last update of @idx. Must be called
+ * with the hwspinlock held.
+ */
+static int qcom_smem_index_update(struct qcom_smem *smem,
+				  struct smem_partition_header *phdr,
+				  size_t cacheline,
+				  struct smem_item_index *idx)
+{
+	struct smem_private_entry *e, *end;
+	u32 free_uncached, free_cached;
+
+	free_uncached = le32_to_cpu(READ_ONCE(phdr->offset_free_uncached));
+	free_cached = le32_to_cpu(READ_ONCE(phdr->offset_free_cached));
+
+	e = idx->uncached;
+	end = (void *)phdr + free_uncached;
+
+	while (e < end) {
+		if (e->canary != SMEM_PRIVATE_CANARY)
+			goto invalid_canary;
+
+		qcom_smem_index_add(smem, idx, e, uncached_entry_to_item(e));
+		e = uncached_entry_next(e);
+	}
+	idx->uncached = e;
+
+	e = idx->cached;
+	end = (void *)phdr + free_cached;
+
+	while (e > end) {
+		if (e->canary != SMEM_PRIVATE_CANARY)
+			goto invalid_canary;
+
+		qcom_smem_index_add(smem, idx, e, cached_entry_to_item(e));
+		e = cached_entry_next(e, cacheline);
+	}
+	idx->cached = e;
+
+	/*
+	 * Publish the new offsets after the entries, lockless lookups that see
+	 * the index as up to date are then guaranteed to see the entries too.
+	 */
+	smp_store_release(&idx->free_uncached, free_uncached);
+	smp_store_release(&idx->free_cached, free_cached);
+
+	return 0;
+
+invalid_canary:
+	dev_err(smem->dev, "Found invalid canary in hosts %hu:%hu partition\n",
+			le16_to_cpu(phdr->host0), le16_to_cpu(phdr->host1));
+
+	return -EINVAL;
+}
+
+/* Check if any host allocated items since the last update of @idx */
+static bool qcom_smem_index_stale(struct smem_partition_header *phdr,
+				  struct smem_item_index *idx)
+{
+	return smp_load_acquire(&idx->free_uncached) !=
+	       le32_to_cpu(READ_ONCE(phdr->offset_free_uncached)) ||
+	       smp_load_acquire(&idx->free_cached) !=
+	       le32_to_cpu(READ_ONCE(phdr->offset_free_cached));
+}
+
+static void *qcom_smem_index_find(struct smem_item_index *idx,
+				  unsigned item,
+				  size_t *size)
+{
+	struct smem_item_entry *entry = &idx->items[item];
+	void *ptr;
+
+	ptr = smp_load_acquire(&entry->ptr);
+	if (ptr && size != NULL)
+		*size = entry->size;
+
+	return ptr;
+}
+
 static int qcom_smem_alloc_private(struct qcom_smem *smem,
 				   struct smem_partition_header *phdr,
+				   size_t cacheline,
+				   struct smem_item_index *idx,
 				   unsigned item,
 				   size_t size)
 {
-	struct smem_private_entry *hdr, *end;
+	struct smem_private_entry *hdr;
 	size_t alloc_size;
 	void *cached;
+	int ret;
 
-	hdr = phdr_to_first_uncached_entry(phdr);
-	end = phdr_to_last_uncached_entry(phdr);
-	cached = phdr_to_last_cached_entry(phdr);
+	ret = qcom_smem_index_update(smem, phdr, cacheline, idx);
+	if (ret)
+		return ret;
 
-	while (hdr < end) {
-		if (hdr->canary != SMEM_PRIVATE_CANARY)
-			goto bad_canary;
-		if (le16_to_cpu(hdr->item) == item)
-			return -EEXIST;
+	if (qcom_smem_index_find(idx, item, NULL))
+		return -EEXIST;
 
-		hdr = uncached_entry_next(hdr);
-	}
+	hdr = phdr_to_last_uncached_entry(phdr);
+	cached = phdr_to_last_cached_entry(phdr);
 
 	/* Check that we don't grow into the cached region */
 	alloc_size = sizeof(*hdr) + ALIGN(size, 8);
@@ -390,11 +535,6 @@ static int qcom_smem_alloc_private(struct qcom_smem *smem,
 	le32_add_cpu(&phdr->offset_free_uncached, alloc_size);
 
 	return 0;
-bad_canary:
-	dev_err(smem->dev, "Found invalid canary in hosts %hu:%hu partition\n",
-		le16_to_cpu(phdr->host0), le16_to_cpu(phdr->host1));
-
-	return -EINVAL;
 }
 
 static int qcom_smem_alloc_global(struct qcom_smem *smem,
@@ -442,7 +582,9 @@ static int qcom_smem_alloc_global(struct qcom_smem *smem,
 int qcom_smem_alloc(unsigned host, unsigned item, size_t size)
 {
 	struct smem_partition_header *phdr;
+	struct smem_item_index *idx;
 	unsigned long flags;
+	size_t cacheln;
 	int ret;
 
 	if (!__smem)
@@ -465,10 +607,16 @@ int qcom_smem_alloc(unsigned host, unsigned item, size_t size)
 
 	if (host < SMEM_HOST_COUNT && __smem->partitions[host]) {
 		phdr = __smem->partitions[host];
-		ret = qcom_smem_alloc_private(__smem, phdr, item, size);
+		cacheln = __smem->cacheline[host];
+		idx = &__smem->index[host];
+		ret = qcom_smem_alloc_private(__smem, phdr, cacheln, idx,
+					      item, size);
 	} else if (__smem->global_partition) {
 		phdr = __smem->global_partition;
-		ret = qcom_smem_alloc_private(__smem, phdr, item, size);
+		cacheln = __smem->global_cacheline;
+		idx = &__smem->global_index;
+		ret = qcom_smem_alloc_private(__smem, phdr, cacheln, idx,
+					      item, size);
 	} else {
 		ret = qcom_smem_alloc_global(__smem, item, size);
 	}
@@ -494,6 +642,9 @@ static void *qcom_smem_get_global(struct qcom_smem *smem,
 	if (!entry->allocated)
 		return ERR_PTR(-ENXIO);
 
+	/* Pairs with the wmb() before the remote marks the item allocated */
+	rmb();
+
 	aux_base = le32_to_cpu(entry->aux_base) & AUX_BASE_MASK;
 
 	for (i = 0; i < smem->num_regions; i++) {
@@ -512,56 +663,42 @@ static void *qcom_smem_get_global(struct qcom_smem *smem,
 static void *qcom_smem_get_private(struct qcom_smem *smem,
 				   struct smem_partition_header *phdr,
 				   size_t cacheline,
+				   struct smem_item_index *idx,
 				   unsigned item,
 				   size_t *size)
 {
-	struct smem_private_entry *e, *end;
-
-	e = phdr_to_first_uncached_entry(phdr);
-	end = phdr_to_last_uncached_entry(phdr);
-
-	while (e < end) {
-		if (e->canary != SMEM_PRIVATE_CANARY)
-			goto invalid_canary;
-
-		if (le16_to_cpu(e->item) == item) {
-			if (size != NULL)
-				*size = le32_to_cpu(e->size) -
-					le16_to_cpu(e->padding_data);
-
-			return uncached_entry_to_item(e);
-		}
-
-		e = uncached_entry_next(e);
-	}
-
-	/* Item was not found in the uncached list, search the cached list */
+	unsigned long flags;
+	void *ptr;
+	int ret;
 
-	e = phdr_to_first_cached_entry(phdr, cacheline);
-	end = phdr_to_last_cached_entry(phdr);
+	ptr = qcom_smem_index_find(idx, item, size);
+	if (ptr)
+		return ptr;
 
-	while (e > end) {
-		if (e->canary != SMEM_PRIVATE_CANARY)
-			goto invalid_canary;
+	/*
+	 * Nothing was allocated since the index was last updated, but the item
+	 * might have been indexed by someone else after the lookup above.
+	 */
+	if (!qcom_smem_index_stale(phdr, idx))
+		goto out;
 
-		if (le16_to_cpu(e->item) == item) {
-			if (size != NULL)
-				*size = le32_to_cpu(e->size) -
-					le16_to_cpu(e->padding_data);
+	ret = hwspin_lock_timeout_irqsave(smem->hwlock,
+					  HWSPINLOCK_TIMEOUT,
+					  &flags);
+	if (ret)
+		return ERR_PTR(ret);
 
-			return cached_entry_to_item(e);
-		}
+	ret = qcom_smem_index_update(smem, phdr, cacheline, idx);
 
-		e = cached_entry_next(e, cacheline);
-	}
+	hwspin_unlock_irqrestore(smem->hwlock, &flags);
 
-	return ERR_PTR(-ENOENT);
+	if (ret)
+		return ERR_PTR(ret);
 
-invalid_canary:
-	dev_err(smem->dev, "Found invalid canary in hosts %hu:%hu partition\n",
-			le16_to_cpu(phdr->host0), le16_to_cpu(phdr->host1));
+out:
+	ptr = qcom_smem_index_find(idx, item, size);
 
-	return ERR_PTR(-EINVAL);
+	return ptr ? ptr : ERR_PTR(-ENOENT);
 }
 
 /**
@@ -572,13 +709,15 @@ static void *qcom_smem_get_private(struct qcom_smem *smem,
  *
  * Looks up smem item and returns pointer to it. Size of smem
  * item is returned in @size.
+ *
+ * Items that have been looked up before are resolved without taking the
+ * hwspinlock, which is only needed to index newly allocated items.
  */
 void *qcom_smem_get(unsigned host, unsigned item, size_t *size)
 {
 	struct smem_partition_header *phdr;
-	unsigned long flags;
+	struct smem_item_index *idx;
 	size_t cacheln;
-	int ret;
 	void *ptr = ERR_PTR(-EPROBE_DEFER);
 
 	if (!__smem)
@@ -587,28 +726,23 @@ void *qcom_smem_get(unsigned host, unsigned item, size_t *size)
 	if (WARN_ON(item >= __smem->item_count))
 		return ERR_PTR(-EINVAL);
 
-	ret = hwspin_lock_timeout_irqsave(__smem->hwlock,
-					  HWSPINLOCK_TIMEOUT,
-					  &flags);
-	if (ret)
-		return ERR_PTR(ret);
-
 	if (host < SMEM_HOST_COUNT && __smem->partitions[host]) {
 		phdr = __smem->partitions[host];
 		cacheln = __smem->cacheline[host];
-		ptr = qcom_smem_get_private(__smem, phdr, cacheln, item, size);
+		idx = &__smem->index[host];
+		ptr = qcom_smem_get_private(__smem, phdr, cacheln, idx,
+					    item, size);
 	} else if (__smem->global_partition) {
 		phdr = __smem->global_partition;
 		cacheln = __smem->global_cacheline;
-		ptr = qcom_smem_get_private(__smem, phdr, cacheln, item, size);
+		idx = &__smem->global_index;
+		ptr = qcom_smem_get_private(__smem, phdr, cacheln, idx,
+					    item, size);
 	} else {
 		ptr = qcom_smem_get_global(__smem, item, size);
 	}
 
-	hwspin_unlock_irqrestore(__smem->hwlock, &flags);
-
 	return ptr;
-
 }
 EXPORT_SYMBOL(qcom_smem_get);
 
@@ -865,6 +999,21 @@ qcom_smem_enumerate_partitions(struct qcom_smem *smem, u16 local_host)
 	return 0;
 }
 
+static int qcom_smem_init_index(struct qcom_smem *smem,
+				struct smem_partition_header *phdr,
+				size_t cacheline,
+				struct smem_item_index *idx)
+{
+	idx->items = devm_kcalloc(smem->dev, smem->item_count,
+				  sizeof(*idx->items), GFP_KERNEL);
+	if (!idx->items)
+		return -ENOMEM;
+
+	qcom_smem_index_reset(idx, phdr, cacheline);
+
+	return 0;
+}
+
 static int qcom_smem_map_memory(struct qcom_smem *smem, struct device *dev,
 				const char *name, int i)
 {
@@ -903,6 +1052,7 @@ static int qcom_smem_probe(struct platform_device *pdev)
 	int hwlock_id;
 	u32 version;
 	int ret;
+	int i;
 
 	num_regions = 1;
 	if (of_find_property(pdev->dev.of_node, "qcom,rpm-msg-ram", NULL))
@@ -952,6 +1102,24 @@ static int qcom_smem_probe(struct platform_device *pdev)
 	if (ret < 0 && ret != -ENOENT)
 		return ret;
 
+	if (smem->global_partition) {
+		ret = qcom_smem_init_index(smem, smem->global_partition,
+					   smem->global_cacheline,
+					   &smem->global_index);
+		if (ret)
+			return ret;
+	}
+
+	for (i = 0; i < SMEM_HOST_COUNT; i++) {
+		if (!smem->partitions[i])
+			continue;
+
+		ret = qcom_smem_init_index(smem, smem->partitions[i],
+					   smem->cacheline[i], &smem->index[i]);
+		if (ret)
+			return ret;
+	}
+
 	hwlock_id = of_hwspin_lock_get_id(pdev->dev.of_node, 0);
 	if (hwlock_id < 0) {
 		if (hwlock_id != -EPROBE_DEFER)
@@ -1012,6 +1180,10 @@ static void __exit qcom_smem_exit(void)
 }
 module_exit(qcom_smem_exit)
 
+#ifdef CONFIG_QCOM_SMEM_KUNIT_TEST
+#include "smem_test.c"
+#endif /* CONFIG_QCOM_SMEM_KUNIT_TEST */
+
 MODULE_AUTHOR("Bjorn Andersson <bjorn.andersson@sonymobile.com>");
 MODULE_DESCRIPTION("Qualcomm Shared Memory Manager");
 MODULE_LICENSE("GPL v2");
@@ -56,6 +56,49 @@ int qcom_smem_state_update_bits(struct qcom_smem_state *state,
 }
 EXPORT_SYMBOL_GPL(qcom_smem_state_update_bits);
 
+/**
+ * qcom_smem_state_begin() - start a transaction of state updates
+ * @state:	state handle acquired by calling qcom_smem_state_get()
+ *
+ * Updates made to @state, or to any other state signalled through the same
+ * remote, until the matching qcom_smem_state_commit() are notified to the
+ * remote at once when the transaction is committed. Transactions may nest,
+ * and should be kept short as they hold off notifications of all clients of
+ * the remote. States that don't support transactions notify each update
+ * immediately.
+ *
+ * Returns 0 on success, otherwise negative errno.
+ */
+int qcom_smem_state_begin(struct qcom_smem_state *state)
+{
+	if (state->orphan)
+		return -ENXIO;
+
+	if (!state->ops.begin)
+		return 0;
+
+	return state->ops.begin(state->priv);
+}
+EXPORT_SYMBOL_GPL(qcom_smem_state_begin);
+
+/**
+ * qcom_smem_state_commit() - commit a transaction of state updates
+ * @state:	state handle passed to qcom_smem_state_begin()
+ *
+ * Returns 0 on success, otherwise negative errno.
+ */
+int qcom_smem_state_commit(struct qcom_smem_state *state)
+{
+	if (state->orphan)
+		return -ENXIO;
+
+	if (!state->ops.commit)
+		return 0;
+
+	return state->ops.commit(state->priv);
+}
+EXPORT_SYMBOL_GPL(qcom_smem_state_commit);
+
 static struct qcom_smem_state *of_node_to_state(struct device_node *np)
 {
 	struct qcom_smem_state *state;
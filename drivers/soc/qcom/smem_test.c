@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * KUnit tests for the item index of private smem partitions.
+ */
+
+#include <kunit/test.h>
+
+#define SMEM_TEST_PART_SIZE		SZ_8K
+#define SMEM_TEST_CACHELINE		64
+
+struct smem_test_ctx {
+	struct qcom_smem *smem;
+	struct smem_partition_header *phdr;
+	struct smem_item_index idx;
+};
+
+static int smem_test_init(struct kunit *test)
+{
+	struct smem_test_ctx *ctx;
+
+	ctx = kunit_kzalloc(test, sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	ctx->smem = kunit_kzalloc(test, sizeof(*ctx->smem), GFP_KERNEL);
+	ctx->phdr = kunit_kzalloc(test, SMEM_TEST_PART_SIZE, GFP_KERNEL);
+	ctx->idx.items = kunit_kcalloc(test, SMEM_ITEM_COUNT,
+				       sizeof(*ctx->idx.items), GFP_KERNEL);
+	if (!ctx->smem || !ctx->phdr || !ctx->idx.items)
+		return -ENOMEM;
+
+	ctx->smem->item_count = SMEM_ITEM_COUNT;
+
+	memcpy(ctx->phdr->magic, SMEM_PART_MAGIC, sizeof(ctx->phdr->magic));
+	ctx->phdr->size = cpu_to_le32(SMEM_TEST_PART_SIZE);
+	ctx->phdr->offset_free_uncached = cpu_to_le32(sizeof(*ctx->phdr));
+	ctx->phdr->offset_free_cached = cpu_to_le32(SMEM_TEST_PART_SIZE);
+
+	qcom_smem_index_reset(&ctx->idx, ctx->phdr, SMEM_TEST_CACHELINE);
+
+	test->priv = ctx;
+
+	return 0;
+}
+
+/* Allocate an uncached item the way a remote host would, bypassing the index */
+static void *smem_test_remote_alloc(struct smem_partition_header *phdr,
+				    unsigned item, size_t size)
+{
+	struct smem_private_entry *e = phdr_to_last_uncached_entry(phdr);
+
+	e->canary = SMEM_PRIVATE_CANARY;
+	e->item = cpu_to_le16(item);
+	e->size = cpu_to_le32(ALIGN(size, 8));
+	e->padding_data = cpu_to_le16(ALIGN(size, 8) - size);
+	e->padding_hdr = 0;
+	le32_add_cpu(&phdr->offset_free_uncached, sizeof(*e) + ALIGN(size, 8));
+
+	return uncached_entry_to_item(e);
+}
+
+static void *smem_test_remote_alloc_cached(struct smem_partition_header *phdr,
+					   unsigned item, size_t size)
+{
+	struct smem_private_entry *e;
+	size_t hdr_size = ALIGN(sizeof(*e), SMEM_TEST_CACHELINE);
+
+	size = ALIGN(size, SMEM_TEST_CACHELINE);
+	e = phdr_to_last_cached_entry(phdr) - hdr_size;
+
+	e->canary = SMEM_PRIVATE_CANARY;
+	e->item = cpu_to_le16(item);
+	e->size = cpu_to_le32(size);
+	e->padding_data = 0;
+	e->padding_hdr = 0;
+	le32_add_cpu(&phdr->offset_free_cached, -(hdr_size + size));
+
+	return cached_entry_to_item(e);
+}
+
+static void smem_test_lookup(struct kunit *test)
+{
+	struct smem_test_ctx *ctx = test->priv;
+	void *uncached, *cached;
+	size_t size = 0;
+
+	KUNIT_ASSERT_EQ(test, 0, qcom_smem_alloc_private(ctx->smem, ctx->phdr,
+							 SMEM_TEST_CACHELINE,
+							 &ctx->idx, 10, 13));
+	uncached = smem_test_remote_alloc(ctx->phdr, 11, 32);
+	cached = smem_test_remote_alloc_cached(ctx->phdr, 20, 100);
+
+	KUNIT_EXPECT_TRUE(test, qcom_smem_index_stale(ctx->phdr, &ctx->idx));
+	KUNIT_ASSERT_EQ(test, 0, qcom_smem_index_update(ctx->smem, ctx->phdr,
+							SMEM_TEST_CACHELINE,
+							&ctx->idx));
+	KUNIT_EXPECT_FALSE(test, qcom_smem_index_stale(ctx->phdr, &ctx->idx));
+
+	KUNIT_EXPECT_NOT_ERR_OR_NULL(test,
+				     qcom_smem_index_find(&ctx->idx, 10, &size));
+	KUNIT_EXPECT_EQ(test, (size_t)13, size);
+
+	KUNIT_EXPECT_PTR_EQ(test, uncached,
+			    qcom_smem_index_find(&ctx->idx, 11, &size));
+	KUNIT_EXPECT_EQ(test, (size_t)32, size);
+
+	KUNIT_EXPECT_PTR_EQ(test, cached,
+			    qcom_smem_index_find(&ctx->idx, 20, &size));
+	KUNIT_EXPECT_EQ(test, (size_t)128, size);
+
+	KUNIT_EXPECT_PTR_EQ(test, NULL,
+			    qcom_smem_index_find(&ctx->idx, 12, NULL));
+}
+
+static void smem_test_incremental_update(struct kunit *test)
+{
+	struct smem_test_ctx *ctx = test->priv;
+	struct smem_private_entry *resume, *e;
+	void *first, *second;
+
+	first = smem_test_remote_alloc(ctx->phdr, 30, 16);
+	KUNIT_ASSERT_EQ(test, 0, qcom_smem_index_update(ctx->smem, ctx->phdr,
+							SMEM_TEST_CACHELINE,
+							&ctx->idx));
+	resume = ctx->idx.uncached;
+
+	second = smem_test_remote_alloc(ctx->phdr, 31, 16);
+	KUNIT_EXPECT_TRUE(test, qcom_smem_index_stale(ctx->phdr, &ctx->idx));
+	KUNIT_EXPECT_PTR_EQ(test, NULL,
+			    qcom_smem_index_find(&ctx->idx, 31, NULL));
+
+	/* Corrupting an indexed entry goes unnoticed, it's not walked again */
+	e = phdr_to_first_uncached_entry(ctx->phdr);
+	e->canary = 0;
+
+	KUNIT_ASSERT_EQ(test, 0, qcom_smem_index_update(ctx->smem, ctx->phdr,
+							SMEM_TEST_CACHELINE,
+							&ctx->idx));
+	KUNIT_EXPECT_PTR_NE(test, resume, ctx->idx.uncached);
+	KUNIT_EXPECT_PTR_EQ(test, first,
+			    qcom_smem_index_find(&ctx->idx, 30, NULL));
+	KUNIT_EXPECT_PTR_EQ(test, second,
+			    qcom_smem_index_find(&ctx->idx, 31, NULL));
+}
+
+static void smem_test_alloc_existing(struct kunit *test)
+{
+	struct smem_test_ctx *ctx = test->priv;
+
+	KUNIT_ASSERT_EQ(test, 0, qcom_smem_alloc_private(ctx->smem, ctx->phdr,
+							 SMEM_TEST_CACHELINE,
+							 &ctx->idx, 40, 8));
+	KUNIT_EXPECT_EQ(test, -EEXIST,
+			qcom_smem_alloc_private(ctx->smem, ctx->phdr,
+						SMEM_TEST_CACHELINE,
+						&ctx->idx, 40, 8));
+
+	/* Items allocated remotely in the cached list are found as well */
+	smem_test_remote_alloc_cached(ctx->phdr, 41, 8);
+	KUNIT_EXPECT_EQ(test, -EEXIST,
+			qcom_smem_alloc_private(ctx->smem, ctx->phdr,
+						SMEM_TEST_CACHELINE,
+						&ctx->idx, 41, 8));
+}
+
+static void smem_test_bad_canary(struct kunit *test)
+{
+	struct smem_test_ctx *ctx = test->priv;
+	struct smem_private_entry *e;
+
+	smem_test_remote_alloc(ctx->phdr, 50, 8);
+	e = phdr_to_first_uncached_entry(ctx->phdr);
+	e->canary = 0;
+
+	KUNIT_EXPECT_EQ(test, -EINVAL,
+			qcom_smem_index_update(ctx->smem, ctx->phdr,
+					       SMEM_TEST_CACHELINE,
+					       &ctx->idx));
+	KUNIT_EXPECT_TRUE(test, qcom_smem_index_stale(ctx->phdr, &ctx->idx));
+}
+
+static struct kunit_case smem_test_cases[] = {
+	KUNIT_CASE(smem_test_lookup),
+	KUNIT_CASE(smem_test_incremental_update),
+	KUNIT_CASE(smem_test_alloc_existing),
+	KUNIT_CASE(smem_test_bad_canary),
+	{},
+};
+
+static struct kunit_suite smem_test_suite = {
+	.name = "qcom_smem",
+	.init = smem_test_init,
+	.test_cases = smem_test_cases,
+};
+
+kunit_test_suite(smem_test_suite);
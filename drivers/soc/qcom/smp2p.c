@@ -4,6 +4,8 @@
  * Copyright (c) 2012-2013, The Linux Foundation. All rights reserved.
  */
 
+#include <linux/debugfs.h>
+#include <linux/hrtimer.h>
 #include <linux/interrupt.h>
 #include <linux/list.h>
 #include <linux/io.h>
@@ -15,6 +17,7 @@
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/regmap.h>
+#include <linux/seq_file.h>
 #include <linux/soc/qcom/smem.h>
 #include <linux/soc/qcom/smem_state.h>
 #include <linux/spinlock.h>
@@ -34,6 +37,10 @@
  * The driver uses the Linux GPIO and interrupt framework to expose a virtual
  * GPIO for each outbound entry and a virtual interrupt controller for each
  * inbound entry.
+ *
+ * Every change of an outbound entry is signalled by kicking the remote, which
+ * wakes it up. Updates made within a transaction, or within the optional kick
+ * delay window of the edge, are signalled with a single kick.
  */
 
 #define SMP2P_MAX_ENTRY 16
@@ -86,6 +93,9 @@ struct smp2p_smem_item {
  * @irq_falling:bitmap to mark irq bits for falling detection
  * @state:	smem state handle
  * @lock:	spinlock to protect read-modify-write of the value
+ * @kick_pending: outbound value changed since the last kick
+ * @stat_updates: number of changes of the outbound value
+ * @stat_kicks:	number of kicks signalling changes of the outbound value
  */
 struct smp2p_entry {
 	struct list_head node;
@@ -103,6 +113,10 @@ struct smp2p_entry {
 	struct qcom_smem_state *state;
 
 	spinlock_t lock;
+
+	bool kick_pending;
+	u64 stat_updates;
+	u64 stat_kicks;
 };
 
 #define SMP2P_INBOUND	0
@@ -124,6 +138,13 @@ struct smp2p_entry {
  * @mbox_chan:	apcs ipc mailbox channel handle
  * @inbound:	list of inbound entries
  * @outbound:	list of outbound entries
+ * @kick_lock:	lock protecting the kick state and statistics
+ * @kick_pending: outbound entries changed since the last kick
+ * @txn_depth:	nesting level of open update transactions
+ * @kick_timer:	timer for deferred kicks
+ * @kick_delay_us: window for coalescing kicks outside transactions, 0 to kick
+ *		immediately
+ * @debugfs:	debugfs directory of the edge
  */
 struct qcom_smp2p {
 	struct device *dev;
@@ -147,8 +168,18 @@ struct qcom_smp2p {
 
 	struct list_head inbound;
 	struct list_head outbound;
+
+	spinlock_t kick_lock;
+	bool kick_pending;
+	unsigned int txn_depth;
+	struct hrtimer kick_timer;
+	u32 kick_delay_us;
+
+	struct dentry *debugfs;
 };
 
+static struct dentry *smp2p_debugfs_root;
+
 static void qcom_smp2p_kick(struct qcom_smp2p *smp2p)
 {
 	/* Make sure any updated data is written before the kick */
@@ -162,6 +193,42 @@ static void qcom_smp2p_kick(struct qcom_smp2p *smp2p)
 	}
 }
 
+/* Kick the remote on behalf of all changed entries, with kick_lock held */
+static void qcom_smp2p_flush_kick(struct qcom_smp2p *smp2p)
+{
+	struct smp2p_entry *entry;
+
+	lockdep_assert_held(&smp2p->kick_lock);
+
+	if (!smp2p->kick_pending)
+		return;
+
+	list_for_each_entry(entry, &smp2p->outbound, node) {
+		if (entry->kick_pending) {
+			entry->kick_pending = false;
+			entry->stat_kicks++;
+		}
+	}
+	smp2p->kick_pending = false;
+
+	qcom_smp2p_kick(smp2p);
+}
+
+static enum hrtimer_restart qcom_smp2p_kick_timer(struct hrtimer *timer)
+{
+	struct qcom_smp2p *smp2p = container_of(timer, struct qcom_smp2p,
+						kick_timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(&smp2p->kick_lock, flags);
+	/* An open transaction kicks when it's committed */
+	if (!smp2p->txn_depth)
+		qcom_smp2p_flush_kick(smp2p);
+	spin_unlock_irqrestore(&smp2p->kick_lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
 /**
  * qcom_smp2p_intr() - interrupt handler for incoming notifications
  * @irq:	unused
@@ -319,6 +386,7 @@ static int qcom_smp2p_inbound_entry(struct qcom_smp2p *smp2p,
 static int smp2p_update_bits(void *data, u32 mask, u32 value)
 {
 	struct smp2p_entry *entry = data;
+	struct qcom_smp2p *smp2p = entry->smp2p;
 	unsigned long flags;
 	u32 orig;
 	u32 val;
@@ -330,16 +398,106 @@ static int smp2p_update_bits(void *data, u32 mask, u32 value)
 	writel(val, entry->value);
 	spin_unlock_irqrestore(&entry->lock, flags);
 
-	if (val != orig)
-		qcom_smp2p_kick(entry->smp2p);
+	if (val == orig)
+		return 0;
+
+	spin_lock_irqsave(&smp2p->kick_lock, flags);
+	entry->stat_updates++;
+	entry->kick_pending = true;
+	smp2p->kick_pending = true;
+
+	if (smp2p->txn_depth) {
+		/* Kicked when the transaction is committed */
+	} else if (smp2p->kick_delay_us) {
+		if (!hrtimer_is_queued(&smp2p->kick_timer))
+			hrtimer_start(&smp2p->kick_timer,
+				      us_to_ktime(smp2p->kick_delay_us),
+				      HRTIMER_MODE_REL);
+	} else {
+		qcom_smp2p_flush_kick(smp2p);
+	}
+	spin_unlock_irqrestore(&smp2p->kick_lock, flags);
 
 	return 0;
 }
 
+static int smp2p_begin(void *data)
+{
+	struct smp2p_entry *entry = data;
+	struct qcom_smp2p *smp2p = entry->smp2p;
+	unsigned long flags;
+
+	spin_lock_irqsave(&smp2p->kick_lock, flags);
+	smp2p->txn_depth++;
+	spin_unlock_irqrestore(&smp2p->kick_lock, flags);
+
+	return 0;
+}
+
+static int smp2p_commit(void *data)
+{
+	struct smp2p_entry *entry = data;
+	struct qcom_smp2p *smp2p = entry->smp2p;
+	unsigned long flags;
+	int ret = 0;
+
+	spin_lock_irqsave(&smp2p->kick_lock, flags);
+	if (WARN_ON(!smp2p->txn_depth))
+		ret = -EINVAL;
+	else if (!--smp2p->txn_depth)
+		qcom_smp2p_flush_kick(smp2p);
+	spin_unlock_irqrestore(&smp2p->kick_lock, flags);
+
+	return ret;
+}
+
 static const struct qcom_smem_state_ops smp2p_state_ops = {
 	.update_bits = smp2p_update_bits,
+	.begin = smp2p_begin,
+	.commit = smp2p_commit,
 };
 
+static int smp2p_stats_show(struct seq_file *s, void *unused)
+{
+	struct qcom_smp2p *smp2p = s->private;
+	struct smp2p_entry *entry;
+	unsigned long flags;
+
+	seq_printf(s, "%-16s %12s %12s\n", "entry", "updates", "kicks");
+
+	spin_lock_irqsave(&smp2p->kick_lock, flags);
+	list_for_each_entry(entry, &smp2p->outbound, node)
+		seq_printf(s, "%-16s %12llu %12llu\n", entry->name,
+			   entry->stat_updates, entry->stat_kicks);
+	spin_unlock_irqrestore(&smp2p->kick_lock, flags);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(smp2p_stats);
+
+static void qcom_smp2p_debugfs_init(struct qcom_smp2p *smp2p)
+{
+	smp2p->debugfs = debugfs_create_dir(dev_name(smp2p->dev),
+					    smp2p_debugfs_root);
+
+	debugfs_create_file("stats", 0400, smp2p->debugfs, smp2p,
+			    &smp2p_stats_fops);
+	debugfs_create_u32("kick_delay_us", 0600, smp2p->debugfs,
+			   &smp2p->kick_delay_us);
+}
+
+/* Stop deferring kicks and send any kick still owed to the remote */
+static void qcom_smp2p_stop_kicks(struct qcom_smp2p *smp2p)
+{
+	unsigned long flags;
+
+	hrtimer_cancel(&smp2p->kick_timer);
+
+	spin_lock_irqsave(&smp2p->kick_lock, flags);
+	qcom_smp2p_flush_kick(smp2p);
+	spin_unlock_irqrestore(&smp2p->kick_lock, flags);
+}
+
 static int qcom_smp2p_outbound_entry(struct qcom_smp2p *smp2p,
 				     struct smp2p_entry *entry,
 				     struct device_node *node)
@@ -456,6 +614,9 @@ static int qcom_smp2p_probe(struct platform_device *pdev)
 	smp2p->dev = &pdev->dev;
 	INIT_LIST_HEAD(&smp2p->inbound);
 	INIT_LIST_HEAD(&smp2p->outbound);
+	spin_lock_init(&smp2p->kick_lock);
+	hrtimer_init(&smp2p->kick_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	smp2p->kick_timer.function = qcom_smp2p_kick_timer;
 
 	platform_set_drvdata(pdev, smp2p);
 
@@ -538,6 +699,7 @@ static int qcom_smp2p_probe(struct platform_device *pdev)
 		goto unwind_interfaces;
 	}
 
+	qcom_smp2p_debugfs_init(smp2p);
 
 	return 0;
 
@@ -548,6 +710,8 @@ static int qcom_smp2p_probe(struct platform_device *pdev)
 	list_for_each_entry(entry, &smp2p->outbound, node)
 		qcom_smem_state_unregister(entry->state);
 
+	qcom_smp2p_stop_kicks(smp2p);
+
 	smp2p->out->valid_entries = 0;
 
 release_mbox:
@@ -565,12 +729,16 @@ static int qcom_smp2p_remove(struct platform_device *pdev)
 	struct qcom_smp2p *smp2p = platform_get_drvdata(pdev);
 	struct smp2p_entry *entry;
 
+	debugfs_remove_recursive(smp2p->debugfs);
+
 	list_for_each_entry(entry, &smp2p->inbound, node)
 		irq_domain_remove(entry->domain);
 
 	list_for_each_entry(entry, &smp2p->outbound, node)
 		qcom_smem_state_unregister(entry->state);
 
+	qcom_smp2p_stop_kicks(smp2p);
+
 	mbox_free_channel(smp2p->mbox_chan);
 
 	smp2p->out->valid_entries = 0;
@@ -592,7 +760,27 @@ static struct platform_driver qcom_smp2p_driver = {
 		.of_match_table = qcom_smp2p_of_match,
 	},
 };
-module_platform_driver(qcom_smp2p_driver);
+
+static int __init qcom_smp2p_init(void)
+{
+	int ret;
+
+	smp2p_debugfs_root = debugfs_create_dir("qcom_smp2p", NULL);
+
+	ret = platform_driver_register(&qcom_smp2p_driver);
+	if (ret)
+		debugfs_remove_recursive(smp2p_debugfs_root);
+
+	return ret;
+}
+module_init(qcom_smp2p_init);
+
+static void __exit qcom_smp2p_exit(void)
+{
+	platform_driver_unregister(&qcom_smp2p_driver);
+	debugfs_remove_recursive(smp2p_debugfs_root);
+}
+module_exit(qcom_smp2p_exit);
 
 MODULE_DESCRIPTION("Qualcomm Shared Memory Point to Point driver");
 MODULE_LICENSE("GPL v2");
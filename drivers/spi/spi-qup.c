@@ -4,16 +4,23 @@
  */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
+#include <linux/dma/qcom_bam_dma.h>
 #include <linux/err.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/iopoll.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
+#include <linux/log2.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
+#include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 #include <linux/spi/spi.h>
 #include <linux/dmaengine.h>
 #include <linux/dma-mapping.h>
@@ -122,6 +129,40 @@
 #define SPI_DELAY_THRESHOLD		1
 #define SPI_DELAY_RETRY			10
 
+/* max scatterlist entries per direction of a chained BAM transfer */
+#define SPI_QUP_CHAIN_SG		32
+
+/* chains expected to be done within this are polled for, not waited on */
+#define SPI_QUP_POLL_US			20
+#define SPI_QUP_POLL_TIMEOUT_US		1000
+
+/* log2(us) transfer latency buckets, the last one is open ended */
+#define SPI_QUP_LAT_BUCKETS		16
+
+static bool dma_chain;
+module_param(dma_chain, bool, 0444);
+MODULE_PARM_DESC(dma_chain,
+		 "Move runs of transfers of a message through one BAM descriptor chain");
+
+static struct dentry *spi_qup_debugfs_root;
+
+enum spi_qup_lat_mode {
+	SPI_QUP_LAT_FIFO,
+	SPI_QUP_LAT_BLOCK,
+	SPI_QUP_LAT_DMA,
+	SPI_QUP_LAT_CHAIN,
+	SPI_QUP_LAT_POLL,
+	SPI_QUP_LAT_NR,
+};
+
+static const char * const spi_qup_lat_names[SPI_QUP_LAT_NR] = {
+	[SPI_QUP_LAT_FIFO]	= "fifo",
+	[SPI_QUP_LAT_BLOCK]	= "block",
+	[SPI_QUP_LAT_DMA]	= "dma",
+	[SPI_QUP_LAT_CHAIN]	= "chain",
+	[SPI_QUP_LAT_POLL]	= "poll",
+};
+
 struct spi_qup {
 	void __iomem		*base;
 	struct device		*dev;
@@ -149,6 +190,17 @@ struct spi_qup {
 	int			mode;
 	struct dma_slave_config	rx_conf;
 	struct dma_slave_config	tx_conf;
+
+	/* chaining of consecutive transfers into one BAM transfer */
+	bool			chain;
+	bool			chain_poll;
+	struct spi_transfer	*chain_end;
+	struct scatterlist	chain_tx_sg[SPI_QUP_CHAIN_SG];
+	struct scatterlist	chain_rx_sg[SPI_QUP_CHAIN_SG];
+
+	/* transfer latency histograms, updated from the message pump */
+	u64			lat_hist[SPI_QUP_LAT_NR][SPI_QUP_LAT_BUCKETS];
+	struct dentry		*debugfs;
 };
 
 static int spi_qup_io_config(struct spi_device *spi, struct spi_transfer *xfer);
@@ -401,6 +453,10 @@ static int spi_qup_prep_sg(struct spi_master *master, struct scatterlist *sgl,
 	else
 		chan = master->dma_rx;
 
+	/* polled for by spi_qup_dma_poll(), so don't ask for an interrupt */
+	if (dir == DMA_DEV_TO_MEM && !callback)
+		flags &= ~DMA_PREP_INTERRUPT;
+
 	desc = dmaengine_prep_slave_sg(chan, sgl, nents, dir, flags);
 	if (IS_ERR_OR_NULL(desc))
 		return desc ? PTR_ERR(desc) : -EINVAL;
@@ -442,23 +498,36 @@ static u32 spi_qup_sgl_get_nents_len(struct scatterlist *sgl, u32 max,
 	return total;
 }
 
+/* Reap the RX transaction of a chain, which was issued without a callback */
+static int spi_qup_dma_poll(struct spi_master *master)
+{
+	int done;
+	int ret;
+
+	ret = read_poll_timeout(qcom_bam_poll_completed, done, done, 0,
+				SPI_QUP_POLL_TIMEOUT_US, false,
+				master->dma_rx, NULL);
+	if (ret)
+		return ret;
+
+	return done < 0 ? done : 0;
+}
+
 static int spi_qup_do_dma(struct spi_device *spi, struct spi_transfer *xfer,
+			  struct scatterlist *tx_sgl,
+			  struct scatterlist *rx_sgl, bool poll,
 			  unsigned long timeout)
 {
 	dma_async_tx_callback rx_done = NULL, tx_done = NULL;
 	struct spi_master *master = spi->master;
 	struct spi_qup *qup = spi_master_get_devdata(master);
-	struct scatterlist *tx_sgl, *rx_sgl;
 	int ret;
 
-	if (xfer->rx_buf)
+	if (rx_sgl && !poll)
 		rx_done = spi_qup_dma_done;
-	else if (xfer->tx_buf)
+	else if (tx_sgl && !rx_sgl)
 		tx_done = spi_qup_dma_done;
 
-	rx_sgl = xfer->rx_sg.sgl;
-	tx_sgl = xfer->tx_sg.sgl;
-
 	do {
 		u32 rx_nents = 0, tx_nents = 0;
 
@@ -498,8 +567,13 @@ static int spi_qup_do_dma(struct spi_device *spi, struct spi_transfer *xfer,
 			dma_async_issue_pending(master->dma_tx);
 		}
 
-		if (!wait_for_completion_timeout(&qup->done, timeout))
+		if (poll) {
+			ret = spi_qup_dma_poll(master);
+			if (ret)
+				return ret;
+		} else if (!wait_for_completion_timeout(&qup->done, timeout)) {
 			return -ETIMEDOUT;
+		}
 
 		for (; rx_sgl && rx_nents--; rx_sgl = sg_next(rx_sgl))
 			;
@@ -842,21 +916,173 @@ static int spi_qup_io_config(struct spi_device *spi, struct spi_transfer *xfer)
 	return 0;
 }
 
+static bool spi_qup_chainable(struct spi_master *master,
+			      struct spi_device *spi,
+			      struct spi_transfer *first,
+			      struct spi_transfer *xfer)
+{
+	if (!xfer->tx_buf || !xfer->rx_buf ||
+	    !xfer->tx_sg.nents || !xfer->rx_sg.nents)
+		return false;
+
+	if (xfer->speed_hz != first->speed_hz ||
+	    xfer->bits_per_word != first->bits_per_word)
+		return false;
+
+	return master->can_dma(master, spi, xfer);
+}
+
+/*
+ * Find the last transfer of the run starting at @first which can be moved
+ * through a single BAM transfer: same clock and word size, chip select held
+ * and no delays in between. Returns NULL if there is nothing to chain.
+ */
+static struct spi_transfer *spi_qup_chain_end(struct spi_master *master,
+					      struct spi_device *spi,
+					      struct spi_transfer *first)
+{
+	struct spi_qup *controller = spi_master_get_devdata(master);
+	struct list_head *transfers = &master->cur_msg->transfers;
+	struct spi_transfer *xfer = first, *last = NULL;
+	unsigned int len = 0, tx_nents = 0, rx_nents = 0;
+
+	if (!controller->chain || !master->cur_msg_mapped ||
+	    spi->mode & SPI_LOOP)
+		return NULL;
+
+	list_for_each_entry_from(xfer, transfers, transfer_list) {
+		if (!spi_qup_chainable(master, spi, first, xfer))
+			break;
+
+		len += xfer->len;
+		tx_nents += xfer->tx_sg.nents;
+		rx_nents += xfer->rx_sg.nents;
+		if (len > SPI_MAX_XFER || tx_nents > SPI_QUP_CHAIN_SG ||
+		    rx_nents > SPI_QUP_CHAIN_SG)
+			break;
+
+		last = xfer;
+
+		if (xfer->cs_change || xfer->delay_usecs ||
+		    xfer->delay.value || xfer->word_delay.value ||
+		    list_is_last(&xfer->transfer_list, transfers))
+			break;
+	}
+
+	return last != first ? last : NULL;
+}
+
+static unsigned int spi_qup_chain_sg(struct scatterlist *dst, unsigned int n,
+				     struct sg_table *sgt)
+{
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sg(sgt->sgl, sg, sgt->nents, i) {
+		sg_unmark_end(&dst[n]);
+		sg_dma_address(&dst[n]) = sg_dma_address(sg);
+		sg_dma_len(&dst[n]) = sg_dma_len(sg);
+		n++;
+	}
+
+	return n;
+}
+
+/* Concatenate the mapped buffers of @first up to @last, returns the length */
+static unsigned int spi_qup_build_chain(struct spi_master *master,
+					struct spi_transfer *first,
+					struct spi_transfer *last)
+{
+	struct spi_qup *controller = spi_master_get_devdata(master);
+	struct spi_transfer *xfer = first;
+	unsigned int tx_nents = 0, rx_nents = 0, len = 0;
+
+	list_for_each_entry_from(xfer, &master->cur_msg->transfers,
+				 transfer_list) {
+		tx_nents = spi_qup_chain_sg(controller->chain_tx_sg, tx_nents,
+					    &xfer->tx_sg);
+		rx_nents = spi_qup_chain_sg(controller->chain_rx_sg, rx_nents,
+					    &xfer->rx_sg);
+		len += xfer->len;
+
+		if (xfer == last)
+			break;
+	}
+
+	sg_mark_end(&controller->chain_tx_sg[tx_nents - 1]);
+	sg_mark_end(&controller->chain_rx_sg[rx_nents - 1]);
+
+	return len;
+}
+
+static void spi_qup_account_latency(struct spi_qup *controller,
+				    enum spi_qup_lat_mode mode, u64 start)
+{
+	u64 us = div_u64(ktime_get_ns() - start, NSEC_PER_USEC);
+	unsigned int bucket = us ? ilog2(us) + 1 : 0;
+
+	controller->lat_hist[mode][min_t(unsigned int, bucket,
+					 SPI_QUP_LAT_BUCKETS - 1)]++;
+}
+
 static int spi_qup_transfer_one(struct spi_master *master,
 			      struct spi_device *spi,
 			      struct spi_transfer *xfer)
 {
 	struct spi_qup *controller = spi_master_get_devdata(master);
+	struct scatterlist *tx_sgl, *rx_sgl;
+	enum spi_qup_lat_mode lat_mode;
+	struct spi_transfer *last;
 	unsigned long timeout, flags;
+	bool poll = false;
+	unsigned int len;
+	u64 start;
 	int ret;
 
+	/* Already moved by the chain of an earlier transfer of the message */
+	if (controller->chain_end) {
+		if (xfer == controller->chain_end)
+			controller->chain_end = NULL;
+		return 0;
+	}
+
+	start = ktime_get_ns();
+
 	ret = spi_qup_io_prep(spi, xfer);
 	if (ret)
 		return ret;
 
+	len = xfer->len;
+	tx_sgl = xfer->tx_sg.sgl;
+	rx_sgl = xfer->rx_sg.sgl;
+
+	last = spi_qup_chain_end(master, spi, xfer);
+	if (last) {
+		len = spi_qup_build_chain(master, xfer, last);
+		controller->n_words = len / controller->w_size;
+		controller->mode = QUP_IO_M_MODE_BAM;
+		tx_sgl = controller->chain_tx_sg;
+		rx_sgl = controller->chain_rx_sg;
+		lat_mode = SPI_QUP_LAT_CHAIN;
+
+		/* spinning beats the interrupt and wakeup for short chains */
+		if (controller->chain_poll &&
+		    DIV_ROUND_UP_ULL((u64)len * 8 * USEC_PER_SEC,
+				     xfer->speed_hz) <= SPI_QUP_POLL_US) {
+			poll = true;
+			lat_mode = SPI_QUP_LAT_POLL;
+		}
+	} else if (spi_qup_is_dma_xfer(controller->mode)) {
+		lat_mode = SPI_QUP_LAT_DMA;
+	} else if (controller->mode == QUP_IO_M_MODE_BLOCK) {
+		lat_mode = SPI_QUP_LAT_BLOCK;
+	} else {
+		lat_mode = SPI_QUP_LAT_FIFO;
+	}
+
 	timeout = DIV_ROUND_UP(xfer->speed_hz, MSEC_PER_SEC);
 	timeout = DIV_ROUND_UP(min_t(unsigned long, SPI_MAX_XFER,
-				     xfer->len) * 8, timeout);
+				     len) * 8, timeout);
 	timeout = 100 * msecs_to_jiffies(timeout);
 
 	reinit_completion(&controller->done);
@@ -869,7 +1095,7 @@ static int spi_qup_transfer_one(struct spi_master *master,
 	spin_unlock_irqrestore(&controller->lock, flags);
 
 	if (spi_qup_is_dma_xfer(controller->mode))
-		ret = spi_qup_do_dma(spi, xfer, timeout);
+		ret = spi_qup_do_dma(spi, xfer, tx_sgl, rx_sgl, poll, timeout);
 	else
 		ret = spi_qup_do_pio(spi, xfer, timeout);
 
@@ -882,9 +1108,25 @@ static int spi_qup_transfer_one(struct spi_master *master,
 	if (ret && spi_qup_is_dma_xfer(controller->mode))
 		spi_qup_dma_terminate(master, xfer);
 
+	if (!ret) {
+		controller->chain_end = last;
+		spi_qup_account_latency(controller, lat_mode, start);
+	}
+
 	return ret;
 }
 
+static int spi_qup_prepare_message(struct spi_master *master,
+				   struct spi_message *msg)
+{
+	struct spi_qup *controller = spi_master_get_devdata(master);
+
+	/* a chain never outlives the message it was built for */
+	controller->chain_end = NULL;
+
+	return 0;
+}
+
 static bool spi_qup_can_dma(struct spi_master *master, struct spi_device *spi,
 			    struct spi_transfer *xfer)
 {
@@ -908,6 +1150,10 @@ static bool spi_qup_can_dma(struct spi_master *master, struct spi_device *spi,
 			return false;
 	}
 
+	/* short transfers still get mapped so they can become part of a chain */
+	if (qup->chain)
+		return true;
+
 	n_words = xfer->len / DIV_ROUND_UP(xfer->bits_per_word, 8);
 	if (n_words <= (qup->in_fifo_sz / sizeof(u32)))
 		return false;
@@ -974,6 +1220,31 @@ static int spi_qup_init_dma(struct spi_master *master, resource_size_t base)
 	return ret;
 }
 
+static int spi_qup_latency_show(struct seq_file *s, void *unused)
+{
+	struct spi_qup *controller = s->private;
+	int i, j;
+
+	seq_printf(s, "%-10s", "us");
+	for (j = 0; j < SPI_QUP_LAT_NR; j++)
+		seq_printf(s, " %12s", spi_qup_lat_names[j]);
+	seq_putc(s, '\n');
+
+	for (i = 0; i < SPI_QUP_LAT_BUCKETS; i++) {
+		if (i == SPI_QUP_LAT_BUCKETS - 1)
+			seq_printf(s, ">=%-8lu", BIT(i - 1));
+		else
+			seq_printf(s, "<%-9lu", BIT(i));
+		for (j = 0; j < SPI_QUP_LAT_NR; j++)
+			seq_printf(s, " %12llu",
+				   READ_ONCE(controller->lat_hist[j][i]));
+		seq_putc(s, '\n');
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(spi_qup_latency);
+
 static void spi_qup_set_cs(struct spi_device *spi, bool val)
 {
 	struct spi_qup *controller;
@@ -1089,6 +1360,27 @@ static int spi_qup_probe(struct platform_device *pdev)
 	if (!controller->qup_v1)
 		master->set_cs = spi_qup_set_cs;
 
+	/*
+	 * Chained transfers need every transfer to be full duplex, so that
+	 * QUP_CONFIG doesn't have to change in the middle of the chain.
+	 */
+	if (dma_chain && master->can_dma && !controller->qup_v1) {
+		controller->chain = true;
+		master->flags |= SPI_MASTER_MUST_RX | SPI_MASTER_MUST_TX;
+		master->prepare_message = spi_qup_prepare_message;
+		sg_init_table(controller->chain_tx_sg, SPI_QUP_CHAIN_SG);
+		sg_init_table(controller->chain_rx_sg, SPI_QUP_CHAIN_SG);
+
+		/*
+		 * Short chains are reaped with qcom_bam_poll_completed(), their
+		 * RX transactions only raise an interrupt every full chain's
+		 * worth of descriptors.
+		 */
+		controller->chain_poll =
+			!qcom_bam_set_irq_coalesce(master->dma_rx,
+						   SPI_QUP_CHAIN_SG);
+	}
+
 	spin_lock_init(&controller->lock);
 	init_completion(&controller->done);
 
@@ -1156,6 +1448,11 @@ static int spi_qup_probe(struct platform_device *pdev)
 	if (ret)
 		goto disable_pm;
 
+	controller->debugfs = debugfs_create_dir(dev_name(dev),
+						 spi_qup_debugfs_root);
+	debugfs_create_file("xfer_latency", 0400, controller->debugfs,
+			    controller, &spi_qup_latency_fops);
+
 	return 0;
 
 disable_pm:
@@ -1263,6 +1560,8 @@ static int spi_qup_remove(struct platform_device *pdev)
 	struct spi_qup *controller = spi_master_get_devdata(master);
 	int ret;
 
+	debugfs_remove_recursive(controller->debugfs);
+
 	ret = pm_runtime_get_sync(&pdev->dev);
 	if (ret < 0)
 		return ret;
@@ -1306,7 +1605,27 @@ static struct platform_driver spi_qup_driver = {
 	.probe = spi_qup_probe,
 	.remove = spi_qup_remove,
 };
-module_platform_driver(spi_qup_driver);
+
+static int __init spi_qup_init(void)
+{
+	int ret;
+
+	spi_qup_debugfs_root = debugfs_create_dir("spi_qup", NULL);
+
+	ret = platform_driver_register(&spi_qup_driver);
+	if (ret)
+		debugfs_remove_recursive(spi_qup_debugfs_root);
+
+	return ret;
+}
+module_init(spi_qup_init);
+
+static void __exit spi_qup_exit(void)
+{
+	platform_driver_unregister(&spi_qup_driver);
+	debugfs_remove_recursive(spi_qup_debugfs_root);
+}
+module_exit(spi_qup_exit);
 
 MODULE_LICENSE("GPL v2");
 MODULE_ALIAS("platform:spi_qup");
@@ -3,6 +3,7 @@
  * Copyright (c) 2012-2015, 2017, The Linux Foundation. All rights reserved.
  */
 #include <linux/bitmap.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/err.h>
 #include <linux/interrupt.h>
@@ -11,9 +12,11 @@
 #include <linux/irqdomain.h>
 #include <linux/irq.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/spmi.h>
 
@@ -94,6 +97,10 @@ enum pmic_arb_channel {
 #define PMIC_ARB_TIMEOUT_US		100
 #define PMIC_ARB_MAX_TRANS_BYTES	(8)
 
+/* Batched commands: channels busy at once, commands per lock hold */
+#define PMIC_ARB_BATCH_MAX_INFLIGHT	8
+#define PMIC_ARB_BATCH_MAX_LOCKED	32
+
 #define PMIC_ARB_APID_MASK		0xFF
 #define PMIC_ARB_PPID_MASK		0xFFF
 
@@ -111,12 +118,35 @@ enum pmic_arb_channel {
 #define hwirq_to_irq(hwirq)  (((hwirq) >> 16) & 0x7)
 #define hwirq_to_apid(hwirq) (((hwirq) >> 0)  & 0x1FF)
 
+/* Index of a peripheral interrupt in the per-irq bitmaps */
+#define PMIC_ARB_IRQ_BIT(apid, irq)	((apid) * 8 + (irq))
+#define PMIC_ARB_MAX_IRQS		(PMIC_ARB_MAX_PERIPHS * 8)
+
 struct pmic_arb_ver_ops;
 
 struct apid_data {
 	u16		ppid;
 	u8		write_ee;
 	u8		irq_ee;
+	u32		irq_count;
+	u32		irq_count_last;
+	u32		irq_hw_masks;
+};
+
+/**
+ * struct pmic_arb_batch_stats - statistics of the batched command path
+ * @batches:	calls of pmic_arb_batch_cmd()
+ * @cmds:	commands issued by them
+ * @waits:	times a batch waited for its commands in flight
+ * @ns:		time spent in pmic_arb_batch_cmd()
+ * @max_ns:	longest call of pmic_arb_batch_cmd()
+ */
+struct pmic_arb_batch_stats {
+	u64	batches;
+	u64	cmds;
+	u64	waits;
+	u64	ns;
+	u64	max_ns;
 };
 
 /**
@@ -137,6 +167,18 @@ struct apid_data {
  * @spmic:		SPMI controller object
  * @ver_ops:		version dependent operations.
  * @ppid_to_apid	in-memory copy of PPID -> APID mapping table.
+ * @irq_lock:		serializes lazy masking against peripheral interrupts.
+ * @irq_en:		interrupts known to be enabled in their peripheral.
+ * @irq_lazy_masked:	interrupts masked by the irq core, but left enabled in
+ *			their peripheral until they fire.
+ * @irq_acked:		interrupts acknowledged by the chained handler ahead
+ *			of their flow handler.
+ * @ack_cmds:		SPMI commands of the chained handler's ack burst.
+ * @debugfs:		debugfs directory of the arbiter.
+ * @stats_last:		time the interrupt statistics were last shown.
+ * @batch_inflight:	max commands a batch keeps in flight, 1 makes it wait
+ *			for every command.
+ * @batch_stats:	statistics of the batched command path.
  */
 struct spmi_pmic_arb {
 	void __iomem		*rd_base;
@@ -159,6 +201,15 @@ struct spmi_pmic_arb {
 	u16			*ppid_to_apid;
 	u16			last_apid;
 	struct apid_data	apid_data[PMIC_ARB_MAX_PERIPHS];
+	raw_spinlock_t		irq_lock;
+	DECLARE_BITMAP(irq_en, PMIC_ARB_MAX_IRQS);
+	DECLARE_BITMAP(irq_lazy_masked, PMIC_ARB_MAX_IRQS);
+	DECLARE_BITMAP(irq_acked, PMIC_ARB_MAX_IRQS);
+	struct spmi_batch_cmd	ack_cmds[32];
+	struct dentry		*debugfs;
+	ktime_t			stats_last;
+	u32			batch_inflight;
+	struct pmic_arb_batch_stats batch_stats;
 };
 
 /**
@@ -239,21 +290,29 @@ static void pmic_arb_write_data(struct spmi_pmic_arb *pmic_arb, const u8 *buf,
 	__raw_writel(data, pmic_arb->wr_base + reg);
 }
 
+/**
+ * pmic_arb_read_fifo: copy the 1..8 bytes returned by a read command to buf
+ * @offset:	offset of the channel the command was issued on
+ * @bc:		byte count -1. range: 0..7
+ * @buf:	output parameter, length must be bc + 1
+ */
+static void pmic_arb_read_fifo(struct spmi_pmic_arb *pmic_arb, u8 *buf,
+			       u32 offset, u8 bc)
+{
+	pmic_arb_read_data(pmic_arb, buf, offset + PMIC_ARB_RDATA0,
+		     min_t(u8, bc, 3));
+
+	if (bc > 3)
+		pmic_arb_read_data(pmic_arb, buf + 4, offset + PMIC_ARB_RDATA1,
+					bc - 4);
+}
+
 static int pmic_arb_wait_for_done(struct spmi_controller *ctrl,
-				  void __iomem *base, u8 sid, u16 addr,
-				  enum pmic_arb_channel ch_type)
+				  void __iomem *base, u32 offset)
 {
-	struct spmi_pmic_arb *pmic_arb = spmi_controller_get_drvdata(ctrl);
 	u32 status = 0;
 	u32 timeout = PMIC_ARB_TIMEOUT_US;
-	u32 offset;
-	int rc;
 
-	rc = pmic_arb->ver_ops->offset(pmic_arb, sid, addr, ch_type);
-	if (rc < 0)
-		return rc;
-
-	offset = rc;
 	offset += PMIC_ARB_STATUS;
 
 	while (timeout--) {
@@ -306,8 +365,7 @@ pmic_arb_non_data_cmd_v1(struct spmi_controller *ctrl, u8 opc, u8 sid)
 
 	raw_spin_lock_irqsave(&pmic_arb->lock, flags);
 	pmic_arb_base_write(pmic_arb, offset + PMIC_ARB_CMD, cmd);
-	rc = pmic_arb_wait_for_done(ctrl, pmic_arb->wr_base, sid, 0,
-				    PMIC_ARB_CHANNEL_RW);
+	rc = pmic_arb_wait_for_done(ctrl, pmic_arb->wr_base, offset);
 	raw_spin_unlock_irqrestore(&pmic_arb->lock, flags);
 
 	return rc;
@@ -333,24 +391,35 @@ static int pmic_arb_cmd(struct spmi_controller *ctrl, u8 opc, u8 sid)
 	return pmic_arb->ver_ops->non_data_cmd(ctrl, opc, sid);
 }
 
-static int pmic_arb_read_cmd(struct spmi_controller *ctrl, u8 opc, u8 sid,
-			     u16 addr, u8 *buf, size_t len)
+static bool pmic_arb_opc_is_read(u8 opc)
 {
-	struct spmi_pmic_arb *pmic_arb = spmi_controller_get_drvdata(ctrl);
-	unsigned long flags;
+	return (opc >= 0x60 && opc <= 0x7F) ||
+	       (opc >= 0x20 && opc <= 0x2F) ||
+	       (opc >= 0x38 && opc <= 0x3F);
+}
+
+/*
+ * Resolve the channel a read or write command is issued on and format the
+ * command word for it.
+ */
+static int pmic_arb_fmt_xfer_cmd(struct spmi_pmic_arb *pmic_arb, u8 opc,
+				 u8 sid, u16 addr, size_t len, u32 *offset,
+				 u32 *cmd)
+{
+	enum pmic_arb_channel ch_type;
 	u8 bc = len - 1;
-	u32 cmd;
 	int rc;
-	u32 offset;
 
-	rc = pmic_arb->ver_ops->offset(pmic_arb, sid, addr,
-				       PMIC_ARB_CHANNEL_OBS);
+	ch_type = pmic_arb_opc_is_read(opc) ? PMIC_ARB_CHANNEL_OBS :
+					      PMIC_ARB_CHANNEL_RW;
+
+	rc = pmic_arb->ver_ops->offset(pmic_arb, sid, addr, ch_type);
 	if (rc < 0)
 		return rc;
 
-	offset = rc;
+	*offset = rc;
 	if (bc >= PMIC_ARB_MAX_TRANS_BYTES) {
-		dev_err(&ctrl->dev, "pmic-arb supports 1..%d bytes per trans, but:%zu requested",
+		dev_err(&pmic_arb->spmic->dev, "pmic-arb supports 1..%d bytes per trans, but:%zu requested",
 			PMIC_ARB_MAX_TRANS_BYTES, len);
 		return  -EINVAL;
 	}
@@ -362,27 +431,63 @@ static int pmic_arb_read_cmd(struct spmi_controller *ctrl, u8 opc, u8 sid,
 		opc = PMIC_ARB_OP_EXT_READ;
 	else if (opc >= 0x38 && opc <= 0x3F)
 		opc = PMIC_ARB_OP_EXT_READL;
+	else if (opc >= 0x40 && opc <= 0x5F)
+		opc = PMIC_ARB_OP_WRITE;
+	else if (opc <= 0x0F)
+		opc = PMIC_ARB_OP_EXT_WRITE;
+	else if (opc >= 0x30 && opc <= 0x37)
+		opc = PMIC_ARB_OP_EXT_WRITEL;
+	else if (opc >= 0x80)
+		opc = PMIC_ARB_OP_ZERO_WRITE;
 	else
 		return -EINVAL;
 
-	cmd = pmic_arb->ver_ops->fmt_cmd(opc, sid, addr, bc);
+	*cmd = pmic_arb->ver_ops->fmt_cmd(opc, sid, addr, bc);
 
-	raw_spin_lock_irqsave(&pmic_arb->lock, flags);
-	pmic_arb_set_rd_cmd(pmic_arb, offset + PMIC_ARB_CMD, cmd);
-	rc = pmic_arb_wait_for_done(ctrl, pmic_arb->rd_base, sid, addr,
-				    PMIC_ARB_CHANNEL_OBS);
-	if (rc)
-		goto done;
+	return 0;
+}
 
-	pmic_arb_read_data(pmic_arb, buf, offset + PMIC_ARB_RDATA0,
-		     min_t(u8, bc, 3));
+/* Fill the write FIFOs and start the command, with the lock held */
+static void pmic_arb_start_write(struct spmi_pmic_arb *pmic_arb, u32 offset,
+				 u32 cmd, const u8 *buf, size_t len)
+{
+	u8 bc = len - 1;
 
+	/* Write data to FIFOs */
+	pmic_arb_write_data(pmic_arb, buf, offset + PMIC_ARB_WDATA0,
+				min_t(u8, bc, 3));
 	if (bc > 3)
-		pmic_arb_read_data(pmic_arb, buf + 4, offset + PMIC_ARB_RDATA1,
+		pmic_arb_write_data(pmic_arb, buf + 4, offset + PMIC_ARB_WDATA1,
 					bc - 4);
 
-done:
+	/* Start the transaction */
+	pmic_arb_base_write(pmic_arb, offset + PMIC_ARB_CMD, cmd);
+}
+
+static int pmic_arb_read_cmd(struct spmi_controller *ctrl, u8 opc, u8 sid,
+			     u16 addr, u8 *buf, size_t len)
+{
+	struct spmi_pmic_arb *pmic_arb = spmi_controller_get_drvdata(ctrl);
+	unsigned long flags;
+	u32 cmd;
+	int rc;
+	u32 offset;
+
+	if (!pmic_arb_opc_is_read(opc))
+		return -EINVAL;
+
+	rc = pmic_arb_fmt_xfer_cmd(pmic_arb, opc, sid, addr, len, &offset,
+				   &cmd);
+	if (rc)
+		return rc;
+
+	raw_spin_lock_irqsave(&pmic_arb->lock, flags);
+	pmic_arb_set_rd_cmd(pmic_arb, offset + PMIC_ARB_CMD, cmd);
+	rc = pmic_arb_wait_for_done(ctrl, pmic_arb->rd_base, offset);
+	if (!rc)
+		pmic_arb_read_fifo(pmic_arb, buf, offset, len - 1);
 	raw_spin_unlock_irqrestore(&pmic_arb->lock, flags);
+
 	return rc;
 }
 
@@ -391,49 +496,171 @@ static int pmic_arb_write_cmd(struct spmi_controller *ctrl, u8 opc, u8 sid,
 {
 	struct spmi_pmic_arb *pmic_arb = spmi_controller_get_drvdata(ctrl);
 	unsigned long flags;
-	u8 bc = len - 1;
 	u32 cmd;
 	int rc;
 	u32 offset;
 
-	rc = pmic_arb->ver_ops->offset(pmic_arb, sid, addr,
-					PMIC_ARB_CHANNEL_RW);
-	if (rc < 0)
+	if (pmic_arb_opc_is_read(opc))
+		return -EINVAL;
+
+	rc = pmic_arb_fmt_xfer_cmd(pmic_arb, opc, sid, addr, len, &offset,
+				   &cmd);
+	if (rc)
 		return rc;
 
-	offset = rc;
-	if (bc >= PMIC_ARB_MAX_TRANS_BYTES) {
-		dev_err(&ctrl->dev, "pmic-arb supports 1..%d bytes per trans, but:%zu requested",
-			PMIC_ARB_MAX_TRANS_BYTES, len);
-		return  -EINVAL;
+	raw_spin_lock_irqsave(&pmic_arb->lock, flags);
+	pmic_arb_start_write(pmic_arb, offset, cmd, buf, len);
+	rc = pmic_arb_wait_for_done(ctrl, pmic_arb->wr_base, offset);
+	raw_spin_unlock_irqrestore(&pmic_arb->lock, flags);
+
+	return rc;
+}
+
+/**
+ * struct pmic_arb_batch_slot - a batched command occupying a channel
+ * @cmd:	the command
+ * @base:	register base the channel lives in
+ * @offset:	offset of the channel
+ * @ppid:	peripheral the command targets
+ * @is_read:	whether the command is a read
+ */
+struct pmic_arb_batch_slot {
+	struct spmi_batch_cmd	*cmd;
+	void __iomem		*base;
+	u32			offset;
+	u16			ppid;
+	bool			is_read;
+};
+
+/*
+ * Wait for the in-flight commands in order, collecting read data, and
+ * return the first error encountered.
+ */
+static int pmic_arb_batch_drain(struct spmi_controller *ctrl,
+				struct pmic_arb_batch_slot *slots,
+				unsigned int nslots)
+{
+	struct spmi_pmic_arb *pmic_arb = spmi_controller_get_drvdata(ctrl);
+	struct pmic_arb_batch_slot *slot;
+	unsigned int i;
+	int ret = 0;
+	int rc;
+
+	if (nslots)
+		pmic_arb->batch_stats.waits++;
+
+	for (i = 0; i < nslots; i++) {
+		slot = &slots[i];
+		rc = pmic_arb_wait_for_done(ctrl, slot->base, slot->offset);
+		if (!rc && slot->is_read)
+			pmic_arb_read_fifo(pmic_arb, slot->cmd->buf,
+					   slot->offset, slot->cmd->len - 1);
+		if (rc && !ret)
+			ret = rc;
 	}
 
-	/* Check the opcode */
-	if (opc >= 0x40 && opc <= 0x5F)
-		opc = PMIC_ARB_OP_WRITE;
-	else if (opc <= 0x0F)
-		opc = PMIC_ARB_OP_EXT_WRITE;
-	else if (opc >= 0x30 && opc <= 0x37)
-		opc = PMIC_ARB_OP_EXT_WRITEL;
-	else if (opc >= 0x80)
-		opc = PMIC_ARB_OP_ZERO_WRITE;
-	else
-		return -EINVAL;
+	return ret;
+}
+
+/*
+ * Every channel executes a single command at a time, but the arbiter serves
+ * all channels of the EE: so rather than waiting for each command before
+ * issuing the next one, keep issuing until the next command needs a channel
+ * that is still busy, or targets a peripheral with a command in flight, and
+ * only then wait. The latter keeps commands to a peripheral ordered: on v2
+ * reads and writes go through different channels, which the arbiter does
+ * not order against each other. On v1 arbiters all commands share the EE's
+ * channel and this degrades to one wait per command, still saving the
+ * per-command locking.
+ */
+static int pmic_arb_batch_cmd(struct spmi_controller *ctrl, u8 sid,
+			      struct spmi_batch_cmd *cmds, unsigned int ncmds)
+{
+	struct spmi_pmic_arb *pmic_arb = spmi_controller_get_drvdata(ctrl);
+	struct pmic_arb_batch_slot slots[PMIC_ARB_BATCH_MAX_INFLIGHT];
+	struct pmic_arb_batch_stats *stats = &pmic_arb->batch_stats;
+	u64 start = ktime_get_ns();
+	struct spmi_batch_cmd *bcmd;
+	unsigned int nslots = 0;
+	unsigned int nlocked = 0;
+	unsigned int inflight;
+	unsigned long flags;
+	void __iomem *base;
+	unsigned int i, j;
+	bool is_read;
+	u32 offset;
+	u16 ppid;
+	u32 cmd;
+	int ret;
+	int rc = 0;
 
-	cmd = pmic_arb->ver_ops->fmt_cmd(opc, sid, addr, bc);
+	inflight = clamp_t(u32, READ_ONCE(pmic_arb->batch_inflight), 1,
+			   PMIC_ARB_BATCH_MAX_INFLIGHT);
 
-	/* Write data to FIFOs */
 	raw_spin_lock_irqsave(&pmic_arb->lock, flags);
-	pmic_arb_write_data(pmic_arb, buf, offset + PMIC_ARB_WDATA0,
-				min_t(u8, bc, 3));
-	if (bc > 3)
-		pmic_arb_write_data(pmic_arb, buf + 4, offset + PMIC_ARB_WDATA1,
-					bc - 4);
 
-	/* Start the transaction */
-	pmic_arb_base_write(pmic_arb, offset + PMIC_ARB_CMD, cmd);
-	rc = pmic_arb_wait_for_done(ctrl, pmic_arb->wr_base, sid, addr,
-				    PMIC_ARB_CHANNEL_RW);
+	for (i = 0; i < ncmds; i++) {
+		bcmd = &cmds[i];
+
+		rc = pmic_arb_fmt_xfer_cmd(pmic_arb, bcmd->opcode, sid,
+					   bcmd->addr, bcmd->len, &offset,
+					   &cmd);
+		if (rc)
+			break;
+
+		is_read = pmic_arb_opc_is_read(bcmd->opcode);
+		base = is_read ? pmic_arb->rd_base : pmic_arb->wr_base;
+		ppid = (sid << 8) | (bcmd->addr >> 8);
+
+		for (j = 0; j < nslots; j++)
+			if (slots[j].ppid == ppid ||
+			    (slots[j].base == base && slots[j].offset == offset))
+				break;
+
+		if (j < nslots || nslots == inflight) {
+			rc = pmic_arb_batch_drain(ctrl, slots, nslots);
+			nslots = 0;
+			if (rc)
+				break;
+		}
+
+		/* Bound the time spent with interrupts disabled */
+		if (nlocked == PMIC_ARB_BATCH_MAX_LOCKED) {
+			rc = pmic_arb_batch_drain(ctrl, slots, nslots);
+			nslots = 0;
+			if (rc)
+				break;
+
+			raw_spin_unlock_irqrestore(&pmic_arb->lock, flags);
+			raw_spin_lock_irqsave(&pmic_arb->lock, flags);
+			nlocked = 0;
+		}
+
+		if (is_read)
+			pmic_arb_set_rd_cmd(pmic_arb, offset + PMIC_ARB_CMD, cmd);
+		else
+			pmic_arb_start_write(pmic_arb, offset, cmd, bcmd->wbuf,
+					     bcmd->len);
+
+		slots[nslots].cmd = bcmd;
+		slots[nslots].base = base;
+		slots[nslots].offset = offset;
+		slots[nslots].ppid = ppid;
+		slots[nslots].is_read = is_read;
+		nslots++;
+		nlocked++;
+	}
+
+	ret = pmic_arb_batch_drain(ctrl, slots, nslots);
+	if (!rc)
+		rc = ret;
+
+	stats->batches++;
+	stats->cmds += i;
+	start = ktime_get_ns() - start;
+	stats->ns += start;
+	stats->max_ns = max(stats->max_ns, start);
+
 	raw_spin_unlock_irqrestore(&pmic_arb->lock, flags);
 
 	return rc;
@@ -500,27 +727,171 @@ static void cleanup_irq(struct spmi_pmic_arb *pmic_arb, u16 apid, int id)
 			       (per << 8) + QPNPINT_REG_EN_CLR, &irq_mask, 1))
 		dev_err_ratelimited(&pmic_arb->spmic->dev, "failed to ack irq_mask = 0x%x for ppid = %x\n",
 				irq_mask, ppid);
+
+	clear_bit(PMIC_ARB_IRQ_BIT(apid, id), pmic_arb->irq_en);
+	clear_bit(PMIC_ARB_IRQ_BIT(apid, id), pmic_arb->irq_lazy_masked);
 }
 
-static void periph_interrupt(struct spmi_pmic_arb *pmic_arb, u16 apid)
+/*
+ * Disable in their peripheral the lazily masked interrupts in irq_mask,
+ * returns the ones that were still lazily masked and got disabled.
+ */
+static u8 pmic_arb_lazy_mask(struct spmi_pmic_arb *pmic_arb, u16 apid,
+			     u8 irq_mask)
 {
-	unsigned int irq;
-	u32 status;
+	u16 ppid = pmic_arb->apid_data[apid].ppid;
+	unsigned long flags;
+	u8 data = 0;
 	int id;
+
+	raw_spin_lock_irqsave(&pmic_arb->irq_lock, flags);
+
+	for (id = 0; id < 8; id++) {
+		if (!(irq_mask & BIT(id)))
+			continue;
+
+		if (test_and_clear_bit(PMIC_ARB_IRQ_BIT(apid, id),
+				       pmic_arb->irq_lazy_masked)) {
+			clear_bit(PMIC_ARB_IRQ_BIT(apid, id), pmic_arb->irq_en);
+			data |= BIT(id);
+		}
+	}
+
+	if (data) {
+		pmic_arb->apid_data[apid].irq_hw_masks += hweight8(data);
+		if (pmic_arb_write_cmd(pmic_arb->spmic, SPMI_CMD_EXT_WRITEL,
+				       ppid >> 8,
+				       ((ppid & 0xFF) << 8) + QPNPINT_REG_EN_CLR,
+				       &data, 1))
+			dev_err_ratelimited(&pmic_arb->spmic->dev, "failed to mask irq_mask = 0x%x for ppid = %x\n",
+					    data, ppid);
+	}
+
+	raw_spin_unlock_irqrestore(&pmic_arb->irq_lock, flags);
+
+	return data;
+}
+
+/*
+ * Returns the interrupts of status to dispatch, cleaning up the ones without
+ * a mapping and disabling in the peripheral the ones which fired while
+ * masked. A level interrupt that fired while masked is not dispatched: it
+ * fires again once unmasked if still asserted. An edge
+ * interrupt is dispatched so the irq core can replay it.
+ *
+ * Whether an interrupt was masked is only decided by pmic_arb_lazy_mask(),
+ * under irq_lock: one unmasked in the meantime is dispatched as usual.
+ */
+static u8 periph_interrupt_prepare(struct spmi_pmic_arb *pmic_arb, u16 apid,
+				  u8 status)
+{
 	u8 sid = (pmic_arb->apid_data[apid].ppid >> 8) & 0xF;
 	u8 per = pmic_arb->apid_data[apid].ppid & 0xFF;
+	unsigned int irq;
+	u8 lazy = 0;
+	u8 level = 0;
+	u8 mapped = 0;
+	u8 skip;
+	int id;
 
-	status = readl_relaxed(pmic_arb->ver_ops->irq_status(pmic_arb, apid));
 	while (status) {
 		id = ffs(status) - 1;
 		status &= ~BIT(id);
 		irq = irq_find_mapping(pmic_arb->domain,
-					spec_to_hwirq(sid, per, id, apid));
+				       spec_to_hwirq(sid, per, id, apid));
 		if (irq == 0) {
 			cleanup_irq(pmic_arb, apid, id);
 			continue;
 		}
+
+		mapped |= BIT(id);
+		if (test_bit(PMIC_ARB_IRQ_BIT(apid, id),
+			     pmic_arb->irq_lazy_masked)) {
+			lazy |= BIT(id);
+			if (irqd_is_level_type(irq_get_irq_data(irq)))
+				level |= BIT(id);
+		}
+	}
+
+	if (lazy) {
+		skip = pmic_arb_lazy_mask(pmic_arb, apid, lazy) & level;
+		mapped &= ~skip;
+
+		/* Don't let the arbiter re-raise the skipped ones */
+		if (skip)
+			writel_relaxed(skip,
+				pmic_arb->ver_ops->irq_clear(pmic_arb, apid));
+	}
+
+	return mapped;
+}
+
+/*
+ * Acknowledge the pending interrupts of several peripherals, one SPMI batch
+ * per slave, ahead of running their flow handlers. Both the edge and the
+ * level flow handler acknowledge before calling the interrupt handlers, so
+ * this doesn't change what an interrupt handler can observe.
+ */
+static void pmic_arb_ack_burst(struct spmi_pmic_arb *pmic_arb,
+			       const u16 *apids, const u8 *acks, unsigned int n)
+{
+	struct spmi_batch_cmd *cmds = pmic_arb->ack_cmds;
+	unsigned int first = 0;
+	unsigned int i, j;
+	u16 ppid;
+	int id;
+
+	for (i = 0; i < n; i++) {
+		ppid = pmic_arb->apid_data[apids[i]].ppid;
+
+		writel_relaxed(acks[i],
+			       pmic_arb->ver_ops->irq_clear(pmic_arb, apids[i]));
+
+		cmds[i].opcode = SPMI_CMD_EXT_WRITEL;
+		cmds[i].addr = ((ppid & 0xFF) << 8) + QPNPINT_REG_LATCHED_CLR;
+		cmds[i].wbuf = &acks[i];
+		cmds[i].len = 1;
+
+		if (i + 1 < n &&
+		    pmic_arb->apid_data[apids[i + 1]].ppid >> 8 == ppid >> 8)
+			continue;
+
+		if (pmic_arb_batch_cmd(pmic_arb->spmic, ppid >> 8,
+				       &cmds[first], i + 1 - first)) {
+			dev_err_ratelimited(&pmic_arb->spmic->dev, "failed to ack interrupts of sid %u\n",
+					    ppid >> 8);
+			/* Leave it to the flow handlers */
+			first = i + 1;
+			continue;
+		}
+
+		for (j = first; j <= i; j++)
+			for (id = 0; id < 8; id++)
+				if (acks[j] & BIT(id))
+					set_bit(PMIC_ARB_IRQ_BIT(apids[j], id),
+						pmic_arb->irq_acked);
+		first = i + 1;
+	}
+}
+
+static void periph_interrupt(struct spmi_pmic_arb *pmic_arb, u16 apid,
+			     u8 status)
+{
+	unsigned int irq;
+	int id;
+	u8 sid = (pmic_arb->apid_data[apid].ppid >> 8) & 0xF;
+	u8 per = pmic_arb->apid_data[apid].ppid & 0xFF;
+
+	while (status) {
+		id = ffs(status) - 1;
+		status &= ~BIT(id);
+		irq = irq_find_mapping(pmic_arb->domain,
+					spec_to_hwirq(sid, per, id, apid));
+		pmic_arb->apid_data[apid].irq_count++;
 		generic_handle_irq(irq);
+
+		/* In case the flow handler didn't ack it */
+		clear_bit(PMIC_ARB_IRQ_BIT(apid, id), pmic_arb->irq_acked);
 	}
 }
 
@@ -534,21 +905,37 @@ static void pmic_arb_chained_irq(struct irq_desc *desc)
 	u8 ee = pmic_arb->ee;
 	u32 status, enable;
 	int i, id, apid;
+	u16 apids[32];
+	u8 pending[32];
+	unsigned int n, j;
 
 	chained_irq_enter(chip, desc);
 
 	for (i = first; i <= last; ++i) {
 		status = readl_relaxed(
 				ver_ops->owner_acc_status(pmic_arb, ee, i));
+		n = 0;
 		while (status) {
 			id = ffs(status) - 1;
 			status &= ~BIT(id);
 			apid = id + i * 32;
 			enable = readl_relaxed(
 					ver_ops->acc_enable(pmic_arb, apid));
-			if (enable & SPMI_PIC_ACC_ENABLE_BIT)
-				periph_interrupt(pmic_arb, apid);
+			if (!(enable & SPMI_PIC_ACC_ENABLE_BIT))
+				continue;
+
+			pending[n] = readl_relaxed(
+					ver_ops->irq_status(pmic_arb, apid));
+			pending[n] = periph_interrupt_prepare(pmic_arb, apid,
+							      pending[n]);
+			if (pending[n])
+				apids[n++] = apid;
 		}
+
+		pmic_arb_ack_burst(pmic_arb, apids, pending, n);
+
+		for (j = 0; j < n; j++)
+			periph_interrupt(pmic_arb, apids[j], pending[j]);
 	}
 
 	chained_irq_exit(chip, desc);
@@ -561,18 +948,36 @@ static void qpnpint_irq_ack(struct irq_data *d)
 	u16 apid = hwirq_to_apid(d->hwirq);
 	u8 data;
 
+	/* Already done by the chained handler's ack burst */
+	if (test_and_clear_bit(PMIC_ARB_IRQ_BIT(apid, irq),
+			       pmic_arb->irq_acked))
+		return;
+
 	writel_relaxed(BIT(irq), pmic_arb->ver_ops->irq_clear(pmic_arb, apid));
 
 	data = BIT(irq);
 	qpnpint_spmi_write(d, QPNPINT_REG_LATCHED_CLR, &data, 1);
 }
 
+/*
+ * Masking is lazy: an interrupt enabled in its peripheral stays enabled and
+ * is only disabled there if it fires while masked, saving the SPMI writes
+ * of the mask/unmask pair the flow handlers and disable_irq() do.
+ */
 static void qpnpint_irq_mask(struct irq_data *d)
 {
+	struct spmi_pmic_arb *pmic_arb = irq_data_get_irq_chip_data(d);
 	u8 irq = hwirq_to_irq(d->hwirq);
+	u16 apid = hwirq_to_apid(d->hwirq);
+	unsigned long flags;
 	u8 data = BIT(irq);
 
-	qpnpint_spmi_write(d, QPNPINT_REG_EN_CLR, &data, 1);
+	raw_spin_lock_irqsave(&pmic_arb->irq_lock, flags);
+	if (test_bit(PMIC_ARB_IRQ_BIT(apid, irq), pmic_arb->irq_en))
+		set_bit(PMIC_ARB_IRQ_BIT(apid, irq), pmic_arb->irq_lazy_masked);
+	else
+		qpnpint_spmi_write(d, QPNPINT_REG_EN_CLR, &data, 1);
+	raw_spin_unlock_irqrestore(&pmic_arb->irq_lock, flags);
 }
 
 static void qpnpint_irq_unmask(struct irq_data *d)
@@ -581,11 +986,19 @@ static void qpnpint_irq_unmask(struct irq_data *d)
 	const struct pmic_arb_ver_ops *ver_ops = pmic_arb->ver_ops;
 	u8 irq = hwirq_to_irq(d->hwirq);
 	u16 apid = hwirq_to_apid(d->hwirq);
+	unsigned long flags;
 	u8 buf[2];
 
 	writel_relaxed(SPMI_PIC_ACC_ENABLE_BIT,
 			ver_ops->acc_enable(pmic_arb, apid));
 
+	raw_spin_lock_irqsave(&pmic_arb->irq_lock, flags);
+
+	/* Still enabled in the peripheral */
+	if (test_and_clear_bit(PMIC_ARB_IRQ_BIT(apid, irq),
+			       pmic_arb->irq_lazy_masked))
+		goto out;
+
 	qpnpint_spmi_read(d, QPNPINT_REG_EN_SET, &buf[0], 1);
 	if (!(buf[0] & BIT(irq))) {
 		/*
@@ -597,6 +1010,10 @@ static void qpnpint_irq_unmask(struct irq_data *d)
 		buf[1] = BIT(irq);
 		qpnpint_spmi_write(d, QPNPINT_REG_LATCHED_CLR, &buf, 2);
 	}
+	set_bit(PMIC_ARB_IRQ_BIT(apid, irq), pmic_arb->irq_en);
+
+out:
+	raw_spin_unlock_irqrestore(&pmic_arb->irq_lock, flags);
 }
 
 static int qpnpint_irq_set_type(struct irq_data *d, unsigned int flow_type)
@@ -1153,6 +1570,63 @@ static const struct irq_domain_ops pmic_arb_irq_domain_ops = {
 	.translate = qpnpint_irq_domain_translate,
 };
 
+static int pmic_arb_irq_stats_show(struct seq_file *s, void *unused)
+{
+	struct spmi_pmic_arb *pmic_arb = s->private;
+	struct apid_data *apidd;
+	ktime_t now = ktime_get();
+	s64 elapsed = ktime_ms_delta(now, pmic_arb->stats_last);
+	u64 rate;
+	u32 count;
+	u16 apid;
+
+	seq_puts(s, "APID  PPID       IRQS  IRQS/S  HW_MASKS\n");
+
+	for (apid = pmic_arb->min_apid; apid <= pmic_arb->max_apid; apid++) {
+		apidd = &pmic_arb->apid_data[apid];
+		count = READ_ONCE(apidd->irq_count);
+		if (!count && !apidd->irq_hw_masks)
+			continue;
+
+		/* Rate since the statistics were last shown */
+		rate = 0;
+		if (elapsed > 0)
+			rate = div64_u64((u64)(count - apidd->irq_count_last) *
+					 MSEC_PER_SEC, elapsed);
+		apidd->irq_count_last = count;
+
+		seq_printf(s, "%4u %#5x %10u %7llu %9u\n", apid, apidd->ppid,
+			   count, rate, READ_ONCE(apidd->irq_hw_masks));
+	}
+
+	pmic_arb->stats_last = now;
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(pmic_arb_irq_stats);
+
+static int pmic_arb_batch_stats_show(struct seq_file *s, void *unused)
+{
+	struct spmi_pmic_arb *pmic_arb = s->private;
+	struct pmic_arb_batch_stats stats;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&pmic_arb->lock, flags);
+	stats = pmic_arb->batch_stats;
+	raw_spin_unlock_irqrestore(&pmic_arb->lock, flags);
+
+	seq_printf(s, "batches: %llu\ncommands: %llu\nwaits: %llu\n",
+		   stats.batches, stats.cmds, stats.waits);
+	seq_printf(s, "ns/command: %llu\nmax ns/batch: %llu\n",
+		   stats.cmds ? div64_u64(stats.ns, stats.cmds) : 0,
+		   stats.max_ns);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(pmic_arb_batch_stats);
+
+static struct dentry *pmic_arb_debugfs_root;
+
 static int spmi_pmic_arb_probe(struct platform_device *pdev)
 {
 	struct spmi_pmic_arb *pmic_arb;
@@ -1286,10 +1760,14 @@ static int spmi_pmic_arb_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, ctrl);
 	raw_spin_lock_init(&pmic_arb->lock);
+	raw_spin_lock_init(&pmic_arb->irq_lock);
 
 	ctrl->cmd = pmic_arb_cmd;
 	ctrl->read_cmd = pmic_arb_read_cmd;
 	ctrl->write_cmd = pmic_arb_write_cmd;
+	ctrl->batch_cmd = pmic_arb_batch_cmd;
+	ctrl->max_xfer_len = PMIC_ARB_MAX_TRANS_BYTES;
+	pmic_arb->batch_inflight = PMIC_ARB_BATCH_MAX_INFLIGHT;
 
 	if (hw_ver >= PMIC_ARB_VERSION_V5_MIN) {
 		err = pmic_arb_read_apid_map_v5(pmic_arb);
@@ -1315,6 +1793,16 @@ static int spmi_pmic_arb_probe(struct platform_device *pdev)
 	if (err)
 		goto err_domain_remove;
 
+	pmic_arb->stats_last = ktime_get();
+	pmic_arb->debugfs = debugfs_create_dir(dev_name(&pdev->dev),
+					       pmic_arb_debugfs_root);
+	debugfs_create_file("irq_stats", 0400, pmic_arb->debugfs, pmic_arb,
+			    &pmic_arb_irq_stats_fops);
+	debugfs_create_file("batch_stats", 0400, pmic_arb->debugfs, pmic_arb,
+			    &pmic_arb_batch_stats_fops);
+	debugfs_create_u32("batch_inflight", 0600, pmic_arb->debugfs,
+			   &pmic_arb->batch_inflight);
+
 	return 0;
 
 err_domain_remove:
@@ -1329,6 +1817,8 @@ static int spmi_pmic_arb_remove(struct platform_device *pdev)
 {
 	struct spmi_controller *ctrl = platform_get_drvdata(pdev);
 	struct spmi_pmic_arb *pmic_arb = spmi_controller_get_drvdata(ctrl);
+
+	debugfs_remove_recursive(pmic_arb->debugfs);
 	spmi_controller_remove(ctrl);
 	irq_set_chained_handler_and_data(pmic_arb->irq, NULL, NULL);
 	irq_domain_remove(pmic_arb->domain);
@@ -1336,6 +1826,26 @@ static int spmi_pmic_arb_remove(struct platform_device *pdev)
 	return 0;
 }
 
+/*
+ * Interrupts masked on suspend are only masked lazily: disable them in their
+ * peripheral so they can't wake the system up.
+ */
+static int __maybe_unused spmi_pmic_arb_suspend_noirq(struct device *dev)
+{
+	struct spmi_controller *ctrl = dev_get_drvdata(dev);
+	struct spmi_pmic_arb *pmic_arb = spmi_controller_get_drvdata(ctrl);
+	unsigned int bit;
+
+	for_each_set_bit(bit, pmic_arb->irq_lazy_masked, PMIC_ARB_MAX_IRQS)
+		pmic_arb_lazy_mask(pmic_arb, bit / 8, BIT(bit % 8));
+
+	return 0;
+}
+
+static const struct dev_pm_ops spmi_pmic_arb_pm_ops = {
+	SET_NOIRQ_SYSTEM_SLEEP_PM_OPS(spmi_pmic_arb_suspend_noirq, NULL)
+};
+
 static const struct of_device_id spmi_pmic_arb_match_table[] = {
 	{ .compatible = "qcom,spmi-pmic-arb", },
 	{},
@@ -1348,9 +1858,30 @@ static struct platform_driver spmi_pmic_arb_driver = {
 	.driver		= {
 		.name	= "spmi_pmic_arb",
 		.of_match_table = spmi_pmic_arb_match_table,
+		.pm	= &spmi_pmic_arb_pm_ops,
 	},
 };
-module_platform_driver(spmi_pmic_arb_driver);
+
+static int __init spmi_pmic_arb_init(void)
+{
+	int ret;
+
+	pmic_arb_debugfs_root = debugfs_create_dir("spmi_pmic_arb", NULL);
+
+	ret = platform_driver_register(&spmi_pmic_arb_driver);
+	if (ret)
+		debugfs_remove_recursive(pmic_arb_debugfs_root);
+
+	return ret;
+}
+module_init(spmi_pmic_arb_init);
+
+static void __exit spmi_pmic_arb_exit(void)
+{
+	platform_driver_unregister(&spmi_pmic_arb_driver);
+	debugfs_remove_recursive(pmic_arb_debugfs_root);
+}
+module_exit(spmi_pmic_arb_exit);
 
 MODULE_LICENSE("GPL v2");
 MODULE_ALIAS("platform:spmi_pmic_arb");
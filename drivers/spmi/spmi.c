@@ -271,6 +271,149 @@ int spmi_ext_register_writel(struct spmi_device *sdev, u16 addr, const u8 *buf,
 }
 EXPORT_SYMBOL_GPL(spmi_ext_register_writel);
 
+static bool spmi_batch_cmd_is_read(const struct spmi_batch_cmd *cmd)
+{
+	return cmd->opcode == SPMI_CMD_READ ||
+	       cmd->opcode == SPMI_CMD_EXT_READ ||
+	       cmd->opcode == SPMI_CMD_EXT_READL;
+}
+
+/**
+ * spmi_max_xfer_len() - largest payload of a single read or write command
+ * @sdev:	SPMI device.
+ * @opcode:	SPMI read or write command.
+ *
+ * Returns the number of bytes one @opcode command can move to or from
+ * @sdev, taking the limits of the bus controller into account, or 0 if
+ * @opcode does not transfer data.
+ */
+size_t spmi_max_xfer_len(struct spmi_device *sdev, u8 opcode)
+{
+	size_t len;
+
+	switch (opcode) {
+	case SPMI_CMD_READ:
+	case SPMI_CMD_WRITE:
+	case SPMI_CMD_ZERO_WRITE:
+		return 1;
+	case SPMI_CMD_EXT_READ:
+	case SPMI_CMD_EXT_WRITE:
+		len = 16;
+		break;
+	case SPMI_CMD_EXT_READL:
+	case SPMI_CMD_EXT_WRITEL:
+		len = 8;
+		break;
+	default:
+		return 0;
+	}
+
+	if (sdev->ctrl->max_xfer_len)
+		len = min(len, sdev->ctrl->max_xfer_len);
+
+	return len;
+}
+EXPORT_SYMBOL_GPL(spmi_max_xfer_len);
+
+static bool spmi_batch_cmd_valid(struct spmi_device *sdev,
+				 const struct spmi_batch_cmd *cmd)
+{
+	if (cmd->len == 0 || cmd->len > spmi_max_xfer_len(sdev, cmd->opcode))
+		return false;
+
+	switch (cmd->opcode) {
+	case SPMI_CMD_READ:
+	case SPMI_CMD_WRITE:
+		/* 5-bit register address */
+		return cmd->addr <= 0x1F;
+	case SPMI_CMD_ZERO_WRITE:
+		return cmd->addr == 0;
+	case SPMI_CMD_EXT_READ:
+	case SPMI_CMD_EXT_WRITE:
+		/* 8-bit register address */
+		return cmd->addr <= 0xFF;
+	default:
+		return true;
+	}
+}
+
+/**
+ * spmi_batch() - issue a sequence of register accesses
+ * @sdev:	SPMI device.
+ * @cmds:	register read and write commands.
+ * @ncmds:	number of entries in @cmds.
+ *
+ * Hands the whole sequence to the bus controller at once, letting it keep
+ * the bus busy and only wait for completion when a command depends on an
+ * earlier one, rather than waiting after every command.  Controllers which
+ * can't do that get the commands one by one.
+ *
+ * Commands to the same peripheral, that is with the same upper byte of
+ * their 16-bit register address, are executed in the order of @cmds.
+ * Commands to different peripherals may be executed in any order, callers
+ * which depend on their ordering have to split the sequence into several
+ * batches.
+ *
+ * Returns 0 on success or the error of the first failing command, in which
+ * case the commands following it may or may not have been executed.
+ */
+int spmi_batch(struct spmi_device *sdev, struct spmi_batch_cmd *cmds,
+	       unsigned int ncmds)
+{
+	struct spmi_controller *ctrl = sdev->ctrl;
+	struct spmi_batch_cmd *cmd;
+	unsigned int i;
+	int ret = 0;
+
+	if (!ctrl || ctrl->dev.type != &spmi_ctrl_type)
+		return -EINVAL;
+
+	for (i = 0; i < ncmds; i++)
+		if (!spmi_batch_cmd_valid(sdev, &cmds[i]))
+			return -EINVAL;
+
+	if (!ctrl->batch_cmd) {
+		for (i = 0; i < ncmds && !ret; i++) {
+			cmd = &cmds[i];
+			if (spmi_batch_cmd_is_read(cmd))
+				ret = spmi_read_cmd(ctrl, cmd->opcode,
+						    sdev->usid, cmd->addr,
+						    cmd->buf, cmd->len);
+			else
+				ret = spmi_write_cmd(ctrl, cmd->opcode,
+						     sdev->usid, cmd->addr,
+						     cmd->wbuf, cmd->len);
+		}
+
+		return ret;
+	}
+
+	for (i = 0; i < ncmds; i++) {
+		cmd = &cmds[i];
+		if (spmi_batch_cmd_is_read(cmd))
+			trace_spmi_read_begin(cmd->opcode, sdev->usid,
+					      cmd->addr);
+		else
+			trace_spmi_write_begin(cmd->opcode, sdev->usid,
+					       cmd->addr, cmd->len, cmd->wbuf);
+	}
+
+	ret = ctrl->batch_cmd(ctrl, sdev->usid, cmds, ncmds);
+
+	for (i = 0; i < ncmds; i++) {
+		cmd = &cmds[i];
+		if (spmi_batch_cmd_is_read(cmd))
+			trace_spmi_read_end(cmd->opcode, sdev->usid, cmd->addr,
+					    ret, cmd->len, cmd->buf);
+		else
+			trace_spmi_write_end(cmd->opcode, sdev->usid,
+					     cmd->addr, ret);
+	}
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(spmi_batch);
+
 /**
  * spmi_command_reset() - sends RESET command to the specified slave
  * @sdev:	SPMI device.
@@ -16,7 +16,9 @@
 #include <linux/pm.h>
 #include <linux/regmap.h>
 #include <linux/slab.h>
+#include <linux/sched/topology.h>
 #include <linux/thermal.h>
+#include <linux/topology.h>
 #include "tsens.h"
 
 /**
@@ -437,6 +439,63 @@ static irqreturn_t tsens_critical_irq_thread(int irq, void *data)
 	return IRQ_HANDLED;
 }
 
+/* Must be called with ul_lock held */
+static void tsens_write_thresholds(struct tsens_sensor *s, int low, int high)
+{
+	struct tsens_priv *priv = s->priv;
+	u32 hw_id = s->hw_id;
+
+	low = clamp_val(low, -40000, 120000);
+	high = clamp_val(high, -40000, 120000);
+
+	/* Write the new thresholds and clear the status */
+	regmap_field_write(priv->rf[LOW_THRESH_0 + hw_id],
+			   tsens_mC_to_hw(s, low));
+	regmap_field_write(priv->rf[UP_THRESH_0 + hw_id],
+			   tsens_mC_to_hw(s, high));
+	tsens_set_interrupt(priv, hw_id, LOWER, true);
+	tsens_set_interrupt(priv, hw_id, UPPER, true);
+
+	dev_dbg(priv->dev, "[%u] %s: (%d:%d)\n", hw_id, __func__, low, high);
+}
+
+/**
+ * tsens_arm_window - Program the thresholds of a sensor around its temperature
+ * @s: Pointer to sensor struct
+ * @temp: current temperature in millidegC
+ *
+ * Rather than only interrupting when the thermal core's trip boundaries are
+ * crossed, arm thresholds at most @s->window away from @temp so the thermal
+ * zone keeps getting updated without being polled. Must be called with
+ * ul_lock held.
+ */
+static void tsens_arm_window(struct tsens_sensor *s, int temp)
+{
+	tsens_write_thresholds(s, max(s->trip_low, temp - s->window),
+			       min(s->trip_high, temp + s->window));
+}
+
+/**
+ * tsens_adapt_window - Resize the threshold window of a sensor
+ * @s: Pointer to sensor struct
+ *
+ * Called on each threshold crossing: a temperature moving fast widens the
+ * window to bound the interrupt rate, a slowly moving one narrows it to keep
+ * the thermal zone accurate.
+ */
+static void tsens_adapt_window(struct tsens_sensor *s)
+{
+	ktime_t now = ktime_get();
+	s64 elapsed = ktime_ms_delta(now, s->last_update);
+
+	if (elapsed < TSENS_WINDOW_FAST_MS)
+		s->window = min(s->window * 2, TSENS_WINDOW_MAX);
+	else if (elapsed > TSENS_WINDOW_SLOW_MS)
+		s->window = max(s->window / 2, TSENS_WINDOW_MIN);
+
+	s->last_update = now;
+}
+
 /**
  * tsens_irq_thread - Threaded interrupt handler for uplow interrupts
  * @irq: irq number
@@ -444,7 +503,10 @@ static irqreturn_t tsens_critical_irq_thread(int irq, void *data)
  *
  * Check all sensors to find ones that violated their threshold limits. If the
  * temperature is still outside the limits, call thermal_zone_device_update() to
- * update the thresholds, else re-enable the interrupts.
+ * update the thermal zone, else re-enable the interrupts. A crossing that stays
+ * within the thermal core's trip boundaries only left the window armed by
+ * tsens_arm_window(), which is re-armed around the new temperature here since
+ * the thermal core won't call set_trips() for it.
  *
  * The level-triggered interrupt might deassert if the temperature returned to
  * within the threshold limits by the time the handler got scheduled. We
@@ -462,7 +524,7 @@ static irqreturn_t tsens_irq_thread(int irq, void *data)
 
 	for (i = 0; i < priv->num_sensors; i++) {
 		bool trigger = false;
-		const struct tsens_sensor *s = &priv->sensor[i];
+		struct tsens_sensor *s = &priv->sensor[i];
 		u32 hw_id = s->hw_id;
 
 		if (IS_ERR(s->tzd))
@@ -504,6 +566,12 @@ static irqreturn_t tsens_irq_thread(int irq, void *data)
 			}
 		}
 
+		if (trigger) {
+			tsens_adapt_window(s);
+			if (temp > s->trip_low && temp < s->trip_high)
+				tsens_arm_window(s, temp);
+		}
+
 		spin_unlock_irqrestore(&priv->ul_lock, flags);
 
 		if (trigger) {
@@ -527,32 +595,31 @@ static int tsens_set_trips(void *_sensor, int low, int high)
 	struct device *dev = priv->dev;
 	struct tsens_irq_data d;
 	unsigned long flags;
-	int high_val, low_val, cl_high, cl_low;
 	u32 hw_id = s->hw_id;
+	int temp, ret;
 
 	dev_dbg(dev, "[%u] %s: proposed thresholds: (%d:%d)\n",
 		hw_id, __func__, low, high);
 
-	cl_high = clamp_val(high, -40000, 120000);
-	cl_low  = clamp_val(low, -40000, 120000);
-
-	high_val = tsens_mC_to_hw(s, cl_high);
-	low_val  = tsens_mC_to_hw(s, cl_low);
+	ret = priv->ops->get_temp(s, &temp);
 
 	spin_lock_irqsave(&priv->ul_lock, flags);
 
 	tsens_read_irq_state(priv, hw_id, s, &d);
 
-	/* Write the new thresholds and clear the status */
-	regmap_field_write(priv->rf[LOW_THRESH_0 + hw_id], low_val);
-	regmap_field_write(priv->rf[UP_THRESH_0 + hw_id], high_val);
-	tsens_set_interrupt(priv, hw_id, LOWER, true);
-	tsens_set_interrupt(priv, hw_id, UPPER, true);
+	s->trip_low = low;
+	s->trip_high = high;
+
+	/* Without a temperature, arm the trip boundaries themselves */
+	if (ret)
+		tsens_write_thresholds(s, low, high);
+	else
+		tsens_arm_window(s, temp);
 
 	spin_unlock_irqrestore(&priv->ul_lock, flags);
 
-	dev_dbg(dev, "[%u] %s: (%d:%d)->(%d:%d)\n",
-		hw_id, __func__, d.low_thresh, d.up_thresh, cl_low, cl_high);
+	dev_dbg(dev, "[%u] %s: previously (%d:%d)\n",
+		hw_id, __func__, d.low_thresh, d.up_thresh);
 
 	return 0;
 }
@@ -852,12 +919,166 @@ int __init init_common(struct tsens_priv *priv)
 	return ret;
 }
 
+/*
+ * Find the CPUs cooled by the thermal zone of a sensor, from the cooling maps
+ * of its zone in the DT, extended to the cluster of each CPU. This runs before
+ * the cpufreq policies are created, so use the CPU topology for the latter.
+ */
+static void tsens_resolve_cpus(struct tsens_sensor *s)
+{
+	struct device_node *np = s->priv->dev->of_node;
+	struct device_node *zones, *zone, *maps, *map;
+	struct of_phandle_args args;
+	int i, cpu;
+
+	zones = of_find_node_by_name(NULL, "thermal-zones");
+	if (!zones)
+		return;
+
+	for_each_available_child_of_node(zones, zone) {
+		if (of_parse_phandle_with_args(zone, "thermal-sensors",
+					       "#thermal-sensor-cells", 0,
+					       &args))
+			continue;
+		of_node_put(args.np);
+
+		if (args.np == np &&
+		    (!args.args_count || args.args[0] == s->hw_id))
+			break;
+	}
+	of_node_put(zones);
+	if (!zone)
+		return;
+
+	maps = of_get_child_by_name(zone, "cooling-maps");
+	of_node_put(zone);
+	if (!maps)
+		return;
+
+	for_each_child_of_node(maps, map) {
+		for (i = 0; !of_parse_phandle_with_args(map, "cooling-device",
+							"#cooling-cells", i,
+							&args); i++) {
+			cpu = of_cpu_node_to_id(args.np);
+			of_node_put(args.np);
+			if (cpu < 0)
+				continue;
+
+			cpumask_or(&s->cpus, &s->cpus,
+				   topology_core_cpumask(cpu));
+		}
+	}
+	of_node_put(maps);
+}
+
+static int tsens_passive_trip_temp(struct thermal_zone_device *tz,
+				   int *trip_temp)
+{
+	enum thermal_trip_type type;
+	int i;
+
+	for (i = 0; i < tz->trips; i++) {
+		if (tz->ops->get_trip_type(tz, i, &type))
+			continue;
+		if (type == THERMAL_TRIP_PASSIVE)
+			return tz->ops->get_trip_temp(tz, i, trip_temp);
+	}
+
+	return -ENODEV;
+}
+
+/**
+ * tsens_update_pressure - Predict the thermal pressure on a sensor's CPUs
+ * @s: Pointer to sensor struct
+ * @temp: current temperature in millidegC
+ *
+ * Extrapolate the temperature TSENS_PRESSURE_HORIZON_MS ahead from its
+ * smoothed slope and, as the prediction enters the TSENS_PRESSURE_RAMP below
+ * the zone's passive trip, report a growing share of the CPUs' capacity as
+ * thermal pressure. The scheduler then starts moving load off the heating
+ * cluster before cpufreq cooling has to cap it, which takes over once it
+ * does. Called with tz->lock held.
+ */
+static void tsens_update_pressure(struct tsens_sensor *s, int temp)
+{
+	struct tsens_priv *priv = s->priv;
+	unsigned long max_capacity;
+	unsigned long pressure = 0;
+	ktime_t now = ktime_get();
+	s64 elapsed = ktime_ms_delta(now, s->last_sample);
+	int trip_temp, predicted, slope, i;
+
+	if (!s->last_sample) {
+		s->last_temp = temp;
+		s->last_sample = now;
+	} else if (elapsed >= TSENS_SLOPE_MIN_MS) {
+		slope = div64_s64((s64)(temp - s->last_temp) * MSEC_PER_SEC,
+				  elapsed);
+		s->slope = (3 * s->slope + slope) / 4;
+		s->last_temp = temp;
+		s->last_sample = now;
+	}
+
+	if (tsens_passive_trip_temp(s->tzd, &trip_temp))
+		return;
+
+	predicted = temp + max(s->slope, 0) * TSENS_PRESSURE_HORIZON_MS /
+			   MSEC_PER_SEC;
+	if (predicted > trip_temp - TSENS_PRESSURE_RAMP) {
+		max_capacity = arch_scale_cpu_capacity(cpumask_first(&s->cpus));
+		pressure = (max_capacity >> TSENS_PRESSURE_MAX_SHIFT) *
+			   min(predicted - trip_temp + TSENS_PRESSURE_RAMP,
+			       TSENS_PRESSURE_RAMP) / TSENS_PRESSURE_RAMP;
+	}
+
+	/* Don't publish or re-arm once tsens_remove() has stopped us */
+	spin_lock(&priv->pressure_lock);
+	if (!priv->pressure_enabled) {
+		spin_unlock(&priv->pressure_lock);
+		return;
+	}
+
+	WRITE_ONCE(s->pressure, pressure);
+
+	/* Several sensors may sit in the same cluster, the hottest wins */
+	for (i = 0; i < priv->num_sensors; i++)
+		if (cpumask_equal(&priv->sensor[i].cpus, &s->cpus))
+			pressure = max(pressure,
+				       READ_ONCE(priv->sensor[i].pressure));
+
+	arch_set_thermal_pressure_hint(&s->cpus, pressure);
+
+	/* Zones are only updated on threshold crossings, keep sampling */
+	if (s->pressure)
+		mod_delayed_work(system_freezable_power_efficient_wq,
+				 &s->pressure_work,
+				 msecs_to_jiffies(TSENS_PRESSURE_HORIZON_MS));
+	spin_unlock(&priv->pressure_lock);
+}
+
+static void tsens_pressure_work(struct work_struct *work)
+{
+	struct tsens_sensor *s = container_of(to_delayed_work(work),
+					      struct tsens_sensor,
+					      pressure_work);
+
+	thermal_zone_device_update(s->tzd, THERMAL_EVENT_UNSPECIFIED);
+}
+
 static int tsens_get_temp(void *data, int *temp)
 {
 	struct tsens_sensor *s = data;
 	struct tsens_priv *priv = s->priv;
+	int ret;
+
+	ret = priv->ops->get_temp(s, temp);
+	if (ret || IS_ERR_OR_NULL(s->tzd) || !READ_ONCE(priv->pressure_enabled))
+		return ret;
 
-	return priv->ops->get_temp(s, temp);
+	if (!cpumask_empty(&s->cpus))
+		tsens_update_pressure(s, *temp);
+
+	return 0;
 }
 
 static int tsens_get_trend(void *data, int trip, enum thermal_trend *trend)
@@ -965,20 +1186,34 @@ static int tsens_register(struct tsens_priv *priv)
 
 	for (i = 0;  i < priv->num_sensors; i++) {
 		priv->sensor[i].priv = priv;
+		priv->sensor[i].trip_low = -INT_MAX;
+		priv->sensor[i].trip_high = INT_MAX;
+		priv->sensor[i].window = TSENS_WINDOW_INIT;
+		priv->sensor[i].last_update = ktime_get();
+		INIT_DELAYED_WORK(&priv->sensor[i].pressure_work,
+				  tsens_pressure_work);
 		tzd = devm_thermal_zone_of_sensor_register(priv->dev, priv->sensor[i].hw_id,
 							   &priv->sensor[i],
 							   &tsens_of_ops);
 		if (IS_ERR(tzd))
 			continue;
 		priv->sensor[i].tzd = tzd;
+		tsens_resolve_cpus(&priv->sensor[i]);
 		if (priv->ops->enable)
 			priv->ops->enable(priv, i);
 	}
 
+	/*
+	 * The uplow interrupt keeps the zones updated, so their DT may set a
+	 * zero polling-delay and only poll at the passive delay while a trip
+	 * is being mitigated.
+	 */
 	ret = tsens_register_irq(priv, "uplow", tsens_irq_thread);
 	if (ret < 0)
 		return ret;
 
+	WRITE_ONCE(priv->pressure_enabled, true);
+
 	if (priv->feat->crit_int)
 		ret = tsens_register_irq(priv, "critical",
 					 tsens_critical_irq_thread);
@@ -1026,6 +1261,7 @@ static int tsens_probe(struct platform_device *pdev)
 		return -ENOMEM;
 
 	priv->dev = dev;
+	spin_lock_init(&priv->pressure_lock);
 	priv->num_sensors = num_sensors;
 	priv->ops = data->ops;
 	for (i = 0;  i < priv->num_sensors; i++) {
@@ -1063,6 +1299,23 @@ static int tsens_probe(struct platform_device *pdev)
 static int tsens_remove(struct platform_device *pdev)
 {
 	struct tsens_priv *priv = platform_get_drvdata(pdev);
+	struct tsens_sensor *s;
+	int i;
+
+	/*
+	 * Once the flag is cleared under the lock, tsens_update_pressure()
+	 * can no longer queue the work, so cancelling it below is final.
+	 */
+	spin_lock(&priv->pressure_lock);
+	WRITE_ONCE(priv->pressure_enabled, false);
+	spin_unlock(&priv->pressure_lock);
+
+	for (i = 0; i < priv->num_sensors; i++) {
+		s = &priv->sensor[i];
+		cancel_delayed_work_sync(&s->pressure_work);
+		if (!cpumask_empty(&s->cpus))
+			arch_set_thermal_pressure_hint(&s->cpus, 0);
+	}
 
 	debugfs_remove_recursive(priv->debug_root);
 	tsens_disable_irq(priv);
@@ -16,7 +16,25 @@
 #define THRESHOLD_MAX_ADC_CODE	0x3ff
 #define THRESHOLD_MIN_ADC_CODE	0x0
 
+/* Threshold window armed around the temperature, in mC */
+#define TSENS_WINDOW_MIN	1000
+#define TSENS_WINDOW_INIT	3000
+#define TSENS_WINDOW_MAX	12000
+/* Crossing intervals, in ms, that widen or narrow the window */
+#define TSENS_WINDOW_FAST_MS	500
+#define TSENS_WINDOW_SLOW_MS	5000
+
+/* Predicted thermal pressure: look-ahead in ms, ramp below the trip in mC */
+#define TSENS_PRESSURE_HORIZON_MS	1000
+#define TSENS_PRESSURE_RAMP		5000
+/* The prediction never takes more than capacity >> shift off the CPUs */
+#define TSENS_PRESSURE_MAX_SHIFT	2
+/* Samples closer together than this don't update the slope, in ms */
+#define TSENS_SLOPE_MIN_MS		100
+
+#include <linux/cpumask.h>
 #include <linux/interrupt.h>
+#include <linux/ktime.h>
 #include <linux/thermal.h>
 #include <linux/regmap.h>
 #include <linux/slab.h>
@@ -44,6 +62,16 @@ enum tsens_irq_type {
  * @hw_id: HW ID can be used in case of platform-specific IDs
  * @slope: slope of temperature adjustment curve
  * @status: 8960-specific variable to track 8960 and 8660 status register offset
+ * @trip_low: lower temperature boundary requested by the thermal core
+ * @trip_high: upper temperature boundary requested by the thermal core
+ * @window: half-width of the threshold window armed around the temperature
+ * @last_update: time of the last threshold crossing
+ * @cpus: CPUs cooled by the thermal zone of the sensor
+ * @last_temp: temperature of the last slope sample, in millidegC
+ * @last_sample: time of the last slope sample
+ * @slope: smoothed temperature slope, in millidegC per second
+ * @pressure: thermal pressure predicted for @cpus
+ * @pressure_work: keeps sampling while a pressure is predicted
  */
 struct tsens_sensor {
 	struct tsens_priv		*priv;
@@ -52,6 +80,16 @@ struct tsens_sensor {
 	unsigned int			hw_id;
 	int				slope;
 	u32				status;
+	int				trip_low;
+	int				trip_high;
+	int				window;
+	ktime_t				last_update;
+	struct cpumask			cpus;
+	int				last_temp;
+	ktime_t				last_sample;
+	int				slope;
+	unsigned long			pressure;
+	struct delayed_work		pressure_work;
 };
 
 /**
@@ -572,6 +610,11 @@ struct tsens_priv {
 	struct dentry			*debug_root;
 	struct dentry			*debug;
 
+	/* predicted thermal pressure is being fed to the scheduler */
+	bool				pressure_enabled;
+	/* serializes pressure_enabled against re-arming the pressure work */
+	spinlock_t			pressure_lock;
+
 	struct tsens_sensor		sensor[];
 };
 
@@ -11,6 +11,7 @@
 #include <linux/atomic.h>
 #include <linux/dma-mapping.h>
 #include <linux/dmaengine.h>
+#include <linux/hrtimer.h>
 #include <linux/module.h>
 #include <linux/io.h>
 #include <linux/ioport.h>
@@ -20,6 +21,7 @@
 #include <linux/tty.h>
 #include <linux/tty_flip.h>
 #include <linux/serial_core.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/clk.h>
 #include <linux/platform_device.h>
@@ -147,7 +149,8 @@
 #define UARTDM_BURST_SIZE		16   /* in bytes */
 #define UARTDM_TX_AIGN(x)		((x) & ~0x3) /* valid for > 1p3 */
 #define UARTDM_TX_MAX			256   /* in bytes, valid for <= 1p3 */
-#define UARTDM_RX_SIZE			(UART_XMIT_SIZE / 4)
+#define UARTDM_RX_SIZE			SZ_4K /* per RX DMA buffer */
+#define UARTDM_RX_BUFS			2
 
 enum {
 	UARTDM_1P1 = 1,
@@ -161,6 +164,7 @@ struct msm_dma {
 	enum dma_data_direction dir;
 	dma_addr_t		phys;
 	unsigned char		*virt;
+	unsigned int		cur;	/* RX buffer owned by the hardware */
 	dma_cookie_t		cookie;
 	u32			enable_bit;
 	unsigned int		count;
@@ -178,6 +182,8 @@ struct msm_port {
 	bool			break_detected;
 	struct msm_dma		tx_dma;
 	struct msm_dma		rx_dma;
+	struct hrtimer		rx_flush_timer;
+	ktime_t			rx_flush_period;
 };
 
 #define UART_TO_MSM(uart_port)	container_of(uart_port, struct msm_port, uart)
@@ -262,6 +268,9 @@ static void msm_stop_dma(struct uart_port *port, struct msm_dma *dma)
 
 	if (mapped)
 		dma_unmap_single(dev, dma->phys, mapped, dma->dir);
+
+	if (dma == &UART_TO_MSM(port)->rx_dma)
+		hrtimer_try_to_cancel(&UART_TO_MSM(port)->rx_flush_timer);
 }
 
 static void msm_release_dma(struct msm_port *msm_port)
@@ -279,6 +288,7 @@ static void msm_release_dma(struct msm_port *msm_port)
 	dma = &msm_port->rx_dma;
 	if (dma->chan) {
 		msm_stop_dma(&msm_port->uart, dma);
+		hrtimer_cancel(&msm_port->rx_flush_timer);
 		dma_release_channel(dma->chan);
 		kfree(dma->virt);
 	}
@@ -346,7 +356,7 @@ static void msm_request_rx_dma(struct msm_port *msm_port, resource_size_t base)
 
 	of_property_read_u32(dev->of_node, "qcom,rx-crci", &crci);
 
-	dma->virt = kzalloc(UARTDM_RX_SIZE, GFP_KERNEL);
+	dma->virt = kzalloc(UARTDM_RX_SIZE * UARTDM_RX_BUFS, GFP_KERNEL);
 	if (!dma->virt)
 		goto rel_rx;
 
@@ -528,13 +538,23 @@ static int msm_handle_tx_dma(struct msm_port *msm_port, unsigned int count)
 	return ret;
 }
 
+static bool msm_rx_sysrq_pending(struct uart_port *port)
+{
+#ifdef CONFIG_MAGIC_SYSRQ_SERIAL
+	return port->sysrq;
+#else
+	return false;
+#endif
+}
+
 static void msm_complete_rx_dma(void *args)
 {
 	struct msm_port *msm_port = args;
 	struct uart_port *port = &msm_port->uart;
 	struct tty_port *tport = &port->state->port;
 	struct msm_dma *dma = &msm_port->rx_dma;
-	int count = 0, i, sysrq;
+	int count = 0, copied, i, sysrq;
+	unsigned char *buf;
 	unsigned long flags;
 	u32 val;
 
@@ -544,6 +564,8 @@ static void msm_complete_rx_dma(void *args)
 	if (!dma->count)
 		goto done;
 
+	hrtimer_try_to_cancel(&msm_port->rx_flush_timer);
+
 	val = msm_read(port, UARTDM_DMEN);
 	val &= ~dma->enable_bit;
 	msm_write(port, val, UARTDM_DMEN);
@@ -562,10 +584,26 @@ static void msm_complete_rx_dma(void *args)
 
 	dma_unmap_single(port->dev, dma->phys, UARTDM_RX_SIZE, dma->dir);
 
+	/*
+	 * Give the other buffer to the hardware before copying this one out,
+	 * at high baud rates the RX FIFO fills up quickly while DMA is off.
+	 */
+	buf = dma->virt + dma->cur * UARTDM_RX_SIZE;
+	dma->cur = (dma->cur + 1) % UARTDM_RX_BUFS;
+	msm_start_rx_dma(msm_port);
+
+	/* Without a break or sysrq to look for the chunk goes in as is */
+	if (!msm_port->break_detected && !msm_rx_sysrq_pending(port)) {
+		copied = tty_insert_flip_string(tport, buf, count);
+		if (copied < count)
+			port->icount.buf_overrun += count - copied;
+		goto done;
+	}
+
 	for (i = 0; i < count; i++) {
 		char flag = TTY_NORMAL;
 
-		if (msm_port->break_detected && dma->virt[i] == 0) {
+		if (msm_port->break_detected && buf[i] == 0) {
 			port->icount.brk++;
 			flag = TTY_BREAK;
 			msm_port->break_detected = false;
@@ -577,13 +615,11 @@ static void msm_complete_rx_dma(void *args)
 			flag = TTY_NORMAL;
 
 		spin_unlock_irqrestore(&port->lock, flags);
-		sysrq = uart_handle_sysrq_char(port, dma->virt[i]);
+		sysrq = uart_handle_sysrq_char(port, buf[i]);
 		spin_lock_irqsave(&port->lock, flags);
-		if (!sysrq)
-			tty_insert_flip_char(tport, dma->virt[i], flag);
+		if (!sysrq && !tty_insert_flip_char(tport, buf[i], flag))
+			port->icount.buf_overrun++;
 	}
-
-	msm_start_rx_dma(msm_port);
 done:
 	spin_unlock_irqrestore(&port->lock, flags);
 
@@ -591,6 +627,26 @@ static void msm_complete_rx_dma(void *args)
 		tty_flip_buffer_push(tport);
 }
 
+/*
+ * The stale event only fires once the line goes idle, so a continuous
+ * stream would sit in the buffer until it fills up. Force the transfer to
+ * end periodically to bound the latency.
+ */
+static enum hrtimer_restart msm_rx_flush_timer(struct hrtimer *timer)
+{
+	struct msm_port *msm_port = container_of(timer, struct msm_port,
+						 rx_flush_timer);
+	struct uart_port *port = &msm_port->uart;
+	unsigned long flags;
+
+	spin_lock_irqsave(&port->lock, flags);
+	if (msm_port->rx_dma.count)
+		msm_write(port, UART_CR_CMD_FORCE_STALE, UART_CR);
+	spin_unlock_irqrestore(&port->lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
 static void msm_start_rx_dma(struct msm_port *msm_port)
 {
 	struct msm_dma *dma = &msm_port->rx_dma;
@@ -601,7 +657,8 @@ static void msm_start_rx_dma(struct msm_port *msm_port)
 	if (!dma->chan)
 		return;
 
-	dma->phys = dma_map_single(uart->dev, dma->virt,
+	dma->phys = dma_map_single(uart->dev,
+				   dma->virt + dma->cur * UARTDM_RX_SIZE,
 				   UARTDM_RX_SIZE, dma->dir);
 	ret = dma_mapping_error(uart->dev, dma->phys);
 	if (ret)
@@ -653,6 +710,10 @@ static void msm_start_rx_dma(struct msm_port *msm_port)
 	if (msm_port->is_uartdm > UARTDM_1P3)
 		msm_write(uart, val, UARTDM_DMEN);
 
+	if (msm_port->rx_flush_period)
+		hrtimer_start(&msm_port->rx_flush_timer,
+			      msm_port->rx_flush_period, HRTIMER_MODE_REL);
+
 	return;
 unmap:
 	dma_unmap_single(uart->dev, dma->phys, UARTDM_RX_SIZE, dma->dir);
@@ -1213,6 +1274,10 @@ static int msm_startup(struct uart_port *port)
 	msm_write(port, data, UART_MR1);
 
 	if (msm_port->is_uartdm) {
+		hrtimer_init(&msm_port->rx_flush_timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL);
+		msm_port->rx_flush_timer.function = msm_rx_flush_timer;
+
 		msm_request_tx_dma(msm_port, msm_port->uart.mapbase);
 		msm_request_rx_dma(msm_port, msm_port->uart.mapbase);
 	}
@@ -1326,6 +1391,11 @@ static void msm_set_termios(struct uart_port *port, struct ktermios *termios,
 
 	uart_update_timeout(port, termios->c_cflag, baud);
 
+	/* Flush the RX DMA buffer at least every half buffer of characters */
+	msm_port->rx_flush_period =
+		ns_to_ktime(div_u64((u64)UARTDM_RX_SIZE / 2 * 10 * NSEC_PER_SEC,
+				    baud));
+
 	/* Try to use DMA */
 	msm_start_rx_dma(msm_port);
 
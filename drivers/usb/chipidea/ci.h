@@ -83,6 +83,8 @@ enum ci_hw_regs {
  * @ci: pointer to the controller
  * @lock: pointer to controller's spinlock
  * @td_pool: pointer to controller's TD pool
+ * @stat_reqs: number of requests completed successfully
+ * @stat_bytes: number of bytes moved by the completed requests
  */
 struct ci_hw_ep {
 	struct usb_ep				ep;
@@ -102,6 +104,10 @@ struct ci_hw_ep {
 	spinlock_t				*lock;
 	struct dma_pool				*td_pool;
 	struct td_node				*pending_td;
+
+	/* statistics */
+	u64					stat_reqs;
+	u64					stat_bytes;
 };
 
 enum ci_role {
@@ -182,6 +188,10 @@ struct hw_bank {
  * @ep0_dir: ep0 direction
  * @ep0out: pointer to ep0 OUT endpoint
  * @ep0in: pointer to ep0 IN endpoint
+ * @complete_work: gives back completed requests of non-control endpoints
+ * @ep_complete: endpoints with completions pending for @complete_work
+ * @stat_complete_irqs: interrupts which deferred completions
+ * @stat_complete_runs: runs of @complete_work
  * @status: ep0 status request
  * @setaddr: if we should set the address on status completion
  * @address: usb address received from the host
@@ -233,6 +243,10 @@ struct ci_hdrc {
 	struct ci_hw_ep			ci_hw_ep[ENDPT_MAX];
 	u32				ep0_dir;
 	struct ci_hw_ep			*ep0out, *ep0in;
+	struct work_struct		complete_work;
+	unsigned long			ep_complete;
+	u64				stat_complete_irqs;
+	u64				stat_complete_runs;
 
 	struct usb_request		*status;
 	bool				setaddr;
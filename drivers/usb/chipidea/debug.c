@@ -184,6 +184,37 @@ static int ci_requests_show(struct seq_file *s, void *data)
 }
 DEFINE_SHOW_ATTRIBUTE(ci_requests);
 
+/*
+ * ci_ep_stats_show: completed requests and bytes of all endpoints
+ */
+static int ci_ep_stats_show(struct seq_file *s, void *data)
+{
+	struct ci_hdrc *ci = s->private;
+	unsigned long flags;
+	unsigned i;
+
+	if (ci->role != CI_ROLE_GADGET) {
+		seq_printf(s, "not in gadget mode\n");
+		return 0;
+	}
+
+	spin_lock_irqsave(&ci->lock, flags);
+	for (i = 0; i < ci->hw_ep_max; i++) {
+		struct ci_hw_ep *hwep = &ci->ci_hw_ep[i];
+
+		seq_printf(s, "EP=%02i %s: reqs=%llu bytes=%llu\n",
+			   i % (ci->hw_ep_max / 2),
+			   (i < ci->hw_ep_max/2) ? "RX" : "TX",
+			   hwep->stat_reqs, hwep->stat_bytes);
+	}
+	seq_printf(s, "deferred completions: irqs=%llu runs=%llu\n",
+		   ci->stat_complete_irqs, ci->stat_complete_runs);
+	spin_unlock_irqrestore(&ci->lock, flags);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(ci_ep_stats);
+
 static int ci_otg_show(struct seq_file *s, void *unused)
 {
 	struct ci_hdrc *ci = s->private;
@@ -352,6 +383,8 @@ void dbg_create_files(struct ci_hdrc *ci)
 			    &ci_qheads_fops);
 	debugfs_create_file("requests", S_IRUGO, ci->debugfs, ci,
 			    &ci_requests_fops);
+	debugfs_create_file("ep_stats", S_IRUGO, ci->debugfs, ci,
+			    &ci_ep_stats_fops);
 
 	if (ci_otg_is_fsm_mode(ci)) {
 		debugfs_create_file("otg", S_IRUGO, ci->debugfs, ci,
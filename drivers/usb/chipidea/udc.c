@@ -1082,16 +1082,14 @@ static int isr_setup_status_phase(struct ci_hdrc *ci)
 /**
  * isr_tr_complete_low: transaction complete low level handler
  * @hwep: endpoint
+ * @done: list collecting the completed requests to give back
  *
  * This function returns an error code
  * Caller must hold lock
  */
-static int isr_tr_complete_low(struct ci_hw_ep *hwep)
-__releases(hwep->lock)
-__acquires(hwep->lock)
+static int isr_tr_complete_low(struct ci_hw_ep *hwep, struct list_head *done)
 {
 	struct ci_hw_req *hwreq, *hwreqtemp;
-	struct ci_hw_ep *hweptemp = hwep;
 	int retval = 0;
 
 	list_for_each_entry_safe(hwreq, hwreqtemp, &hwep->qh.queue,
@@ -1099,15 +1097,14 @@ __acquires(hwep->lock)
 		retval = _hardware_dequeue(hwep, hwreq);
 		if (retval < 0)
 			break;
-		list_del_init(&hwreq->queue);
-		if (hwreq->req.complete != NULL) {
-			spin_unlock(hwep->lock);
-			if ((hwep->type == USB_ENDPOINT_XFER_CONTROL) &&
-					hwreq->req.length)
-				hweptemp = hwep->ci->ep0in;
-			usb_gadget_giveback_request(&hweptemp->ep, &hwreq->req);
-			spin_lock(hwep->lock);
-		}
+
+		hwep->stat_reqs++;
+		hwep->stat_bytes += hwreq->req.actual;
+
+		if (hwreq->req.complete != NULL)
+			list_move_tail(&hwreq->queue, done);
+		else
+			list_del_init(&hwreq->queue);
 	}
 
 	if (retval == -EBUSY)
@@ -1116,6 +1113,66 @@ __acquires(hwep->lock)
 	return retval;
 }
 
+/**
+ * isr_tr_giveback: gives back the requests collected by isr_tr_complete_low
+ * @hwep: endpoint
+ * @done: list of completed requests
+ *
+ * Caller must not hold lock
+ */
+static void isr_tr_giveback(struct ci_hw_ep *hwep, struct list_head *done)
+{
+	struct ci_hw_req *hwreq, *hwreqtemp;
+	struct ci_hw_ep *hweptemp = hwep;
+
+	list_for_each_entry_safe(hwreq, hwreqtemp, done, queue) {
+		list_del_init(&hwreq->queue);
+		if ((hwep->type == USB_ENDPOINT_XFER_CONTROL) &&
+				hwreq->req.length)
+			hweptemp = hwep->ci->ep0in;
+		usb_gadget_giveback_request(&hweptemp->ep, &hwreq->req);
+	}
+}
+
+/**
+ * ci_udc_complete_work: completes the requests of non-control endpoints
+ * @work: work of the controller
+ *
+ * Runs the completions of all the endpoints flagged by the interrupt
+ * handler in one pass from process context, so that a high rate of bulk
+ * completions doesn't keep the CPU in hard interrupt context. Gadget
+ * drivers expect their completion callbacks to run with local interrupts
+ * disabled, so only the lock is dropped around the giveback.
+ */
+static void ci_udc_complete_work(struct work_struct *work)
+{
+	struct ci_hdrc *ci = container_of(work, struct ci_hdrc, complete_work);
+	unsigned long pending;
+	unsigned int i;
+
+	spin_lock_irq(&ci->lock);
+	pending = ci->ep_complete;
+	ci->ep_complete = 0;
+	ci->stat_complete_runs++;
+
+	for_each_set_bit(i, &pending, ci->hw_ep_max) {
+		struct ci_hw_ep *hwep = &ci->ci_hw_ep[i];
+		LIST_HEAD(done);
+
+		if (hwep->ep.desc == NULL)
+			continue;
+
+		isr_tr_complete_low(hwep, &done);
+		if (list_empty(&done))
+			continue;
+
+		spin_unlock(&ci->lock);
+		isr_tr_giveback(hwep, &done);
+		spin_lock(&ci->lock);
+	}
+	spin_unlock_irq(&ci->lock);
+}
+
 static int otg_a_alt_hnp_support(struct ci_hdrc *ci)
 {
 	dev_warn(&ci->gadget.dev,
@@ -1303,35 +1360,53 @@ static void isr_tr_complete_handler(struct ci_hdrc *ci)
 __releases(ci->lock)
 __acquires(ci->lock)
 {
+	unsigned long deferred = 0;
 	unsigned i;
 	int err;
 
 	for (i = 0; i < ci->hw_ep_max; i++) {
 		struct ci_hw_ep *hwep  = &ci->ci_hw_ep[i];
+		LIST_HEAD(done);
 
 		if (hwep->ep.desc == NULL)
 			continue;   /* not configured */
 
-		if (hw_test_and_clear_complete(ci, i)) {
-			err = isr_tr_complete_low(hwep);
-			if (hwep->type == USB_ENDPOINT_XFER_CONTROL) {
-				if (err > 0)   /* needs status phase */
-					err = isr_setup_status_phase(ci);
-				if (err < 0) {
-					spin_unlock(&ci->lock);
-					if (_ep_set_halt(&hwep->ep, 1, false))
-						dev_err(ci->dev,
-						"error: _ep_set_halt\n");
-					spin_lock(&ci->lock);
-				}
-			}
+		if (!hw_test_and_clear_complete(ci, i))
+			goto setup;
+
+		/* Data endpoints complete from ci_udc_complete_work() */
+		if (hwep->type != USB_ENDPOINT_XFER_CONTROL) {
+			deferred |= BIT(i);
+			continue;
+		}
+
+		err = isr_tr_complete_low(hwep, &done);
+		if (!list_empty(&done)) {
+			spin_unlock(&ci->lock);
+			isr_tr_giveback(hwep, &done);
+			spin_lock(&ci->lock);
+		}
+		if (err > 0)   /* needs status phase */
+			err = isr_setup_status_phase(ci);
+		if (err < 0) {
+			spin_unlock(&ci->lock);
+			if (_ep_set_halt(&hwep->ep, 1, false))
+				dev_err(ci->dev, "error: _ep_set_halt\n");
+			spin_lock(&ci->lock);
 		}
 
+setup:
 		/* Only handle setup packet below */
 		if (i == 0 &&
 			hw_test_and_clear(ci, OP_ENDPTSETUPSTAT, BIT(0)))
 			isr_setup_packet_handler(ci);
 	}
+
+	if (deferred) {
+		ci->ep_complete |= deferred;
+		ci->stat_complete_irqs++;
+		queue_work(system_highpri_wq, &ci->complete_work);
+	}
 }
 
 /******************************************************************************
@@ -1969,6 +2044,8 @@ static int ci_udc_stop(struct usb_gadget *gadget)
 
 	spin_unlock_irqrestore(&ci->lock, flags);
 
+	cancel_work_sync(&ci->complete_work);
+
 	ci_udc_stop_for_otg_fsm(ci);
 	return 0;
 }
@@ -2070,6 +2147,7 @@ static int udc_start(struct ci_hdrc *ci)
 		ci->gadget.is_otg = 1;
 
 	INIT_LIST_HEAD(&ci->gadget.ep_list);
+	INIT_WORK(&ci->complete_work, ci_udc_complete_work);
 
 	/* alloc resources */
 	ci->qh_pool = dma_pool_create("ci_hw_qh", dev->parent,
@@ -2119,6 +2197,8 @@ void ci_hdrc_gadget_destroy(struct ci_hdrc *ci)
 
 	usb_del_gadget_udc(&ci->gadget);
 
+	cancel_work_sync(&ci->complete_work);
+
 	destroy_eps(ci);
 
 	dma_pool_destroy(ci->td_pool);
@@ -2150,6 +2230,9 @@ static void udc_id_switch_for_host(struct ci_hdrc *ci)
 
 	ci->vbus_active = 0;
 
+	/* The work may still touch the device controller registers */
+	cancel_work_sync(&ci->complete_work);
+
 	if (ci->platdata->pins_device && ci->platdata->pins_default)
 		pinctrl_select_state(ci->platdata->pctl,
 				     ci->platdata->pins_default);
@@ -45,6 +45,8 @@ static inline unsigned long topology_get_thermal_pressure(int cpu)
 
 void topology_set_thermal_pressure(const struct cpumask *cpus,
 				   unsigned long th_pressure);
+void topology_set_thermal_pressure_hint(const struct cpumask *cpus,
+					unsigned long th_pressure);
 
 struct cpu_topology {
 	int thread_id;
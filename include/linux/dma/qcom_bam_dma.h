@@ -7,6 +7,9 @@
 #define _QCOM_BAM_DMA_H
 
 #include <asm/byteorder.h>
+#include <linux/errno.h>
+
+struct dma_chan;
 
 /*
  * This data type corresponds to the native Command Element
@@ -68,4 +71,20 @@ bam_prep_ce(struct bam_cmd_element *bam_ce, u32 addr,
 {
 	bam_prep_ce_le32(bam_ce, addr, cmd, cpu_to_le32(data));
 }
+
+#if IS_ENABLED(CONFIG_QCOM_BAM_DMA)
+int qcom_bam_set_irq_coalesce(struct dma_chan *chan, unsigned int every);
+int qcom_bam_poll_completed(struct dma_chan *chan, u32 *index);
+#else
+static inline int qcom_bam_set_irq_coalesce(struct dma_chan *chan,
+					    unsigned int every)
+{
+	return -ENODEV;
+}
+
+static inline int qcom_bam_poll_completed(struct dma_chan *chan, u32 *index)
+{
+	return -ENODEV;
+}
+#endif
 #endif
@@ -74,6 +74,19 @@ struct reg_sequence {
 	unsigned int delay_us;
 };
 
+/**
+ * struct reg_update - An individual read/modify/write of a register.
+ *
+ * @reg: Register address.
+ * @mask: Bitmask to change.
+ * @val: New value for bitmask.
+ */
+struct reg_update {
+	unsigned int reg;
+	unsigned int mask;
+	unsigned int val;
+};
+
 #define REG_SEQ(_reg, _def, _delay_us) {		\
 				.reg = _reg,		\
 				.def = _def,		\
@@ -1104,6 +1117,9 @@ int regmap_bulk_read(struct regmap *map, unsigned int reg, void *val,
 int regmap_update_bits_base(struct regmap *map, unsigned int reg,
 			    unsigned int mask, unsigned int val,
 			    bool *change, bool async, bool force);
+int regmap_multi_reg_update_bits(struct regmap *map,
+				 const struct reg_update *updates,
+				 int num_updates);
 
 static inline int regmap_update_bits(struct regmap *map, unsigned int reg,
 				     unsigned int mask, unsigned int val)
@@ -1580,6 +1596,14 @@ static inline int regmap_update_bits_base(struct regmap *map, unsigned int reg,
 	return -EINVAL;
 }
 
+static inline int regmap_multi_reg_update_bits(struct regmap *map,
+					       const struct reg_update *updates,
+					       int num_updates)
+{
+	WARN_ONCE(1, "regmap API is disabled");
+	return -EINVAL;
+}
+
 static inline int regmap_set_bits(struct regmap *map,
 				  unsigned int reg, unsigned int bits)
 {
@@ -41,6 +41,7 @@
 #include <linux/cdev.h>
 #include <linux/completion.h>
 #include <linux/idr.h>
+#include <linux/ktime.h>
 #include <linux/of.h>
 
 /**
@@ -477,6 +478,26 @@ struct rproc_dump_segment {
 	loff_t offset;
 };
 
+/**
+ * struct rproc_boot_timing - time spent in the phases of the last boot
+ * @begin: time at which the boot was requested
+ * @firmware: requesting the firmware image
+ * @prepare: preparing the device and handling the firmware resources
+ * @load: loading the firmware segments into memory
+ * @start: powering up the remote processor, including authentication
+ * @subdevs: preparing and starting the subdevices
+ * @total: from the boot request until the remote processor is running
+ */
+struct rproc_boot_timing {
+	ktime_t begin;
+	ktime_t firmware;
+	ktime_t prepare;
+	ktime_t load;
+	ktime_t start;
+	ktime_t subdevs;
+	ktime_t total;
+};
+
 /**
  * struct rproc - represents a physical remote processor device
  * @node: list node of this rproc object
@@ -514,6 +535,7 @@ struct rproc_dump_segment {
  * @nb_vdev: number of vdev currently handled by rproc
  * @char_dev: character device of the rproc
  * @cdev_put_on_release: flag to indicate if remoteproc should be shutdown on @char_dev release
+ * @boot_timing: timing breakdown of the last boot
  */
 struct rproc {
 	struct list_head node;
@@ -553,6 +575,7 @@ struct rproc {
 	u16 elf_machine;
 	struct cdev cdev;
 	bool cdev_put_on_release;
+	struct rproc_boot_timing boot_timing;
 };
 
 /**
@@ -266,6 +266,13 @@ void arch_set_thermal_pressure(const struct cpumask *cpus,
 { }
 #endif
 
+#ifndef arch_set_thermal_pressure_hint
+static __always_inline
+void arch_set_thermal_pressure_hint(const struct cpumask *cpus,
+				    unsigned long th_pressure)
+{ }
+#endif
+
 static inline int task_node(const struct task_struct *p)
 {
 	return cpu_to_node(task_cpu(p));
@@ -4,7 +4,9 @@
 #define __QCOM_APR_H_
 
 #include <linux/spinlock.h>
+#include <linux/completion.h>
 #include <linux/device.h>
+#include <linux/ktime.h>
 #include <linux/mod_devicetable.h>
 #include <dt-bindings/soc/qcom,apr.h>
 
@@ -88,6 +90,28 @@ struct apr_device {
 	const char *service_path;
 	spinlock_t	lock;
 	struct list_head node;
+	struct list_head reqs;
+};
+
+/**
+ * struct apr_request - command whose response is tracked by the apr core
+ * @opcode: opcode of the command
+ * @rsp_opcode: opcode of the dedicated response of the command, or 0 if
+ *		the remote only answers with APR_BASIC_RSP_RESULT
+ * @token: token of the command as set by the client
+ * @status: status returned by the remote, 0 on success
+ * @node: entry in the list of requests in flight on the device
+ * @sent: time the command was sent
+ * @done: completed once the response went through the driver callback
+ */
+struct apr_request {
+	uint32_t opcode;
+	uint32_t rsp_opcode;
+	uint32_t token;
+	uint32_t status;
+	struct list_head node;
+	ktime_t sent;
+	struct completion done;
 };
 
 #define to_apr_device(d) container_of(d, struct apr_device, dev)
@@ -125,5 +149,9 @@ void apr_driver_unregister(struct apr_driver *drv);
 			apr_driver_unregister)
 
 int apr_send_pkt(struct apr_device *adev, struct apr_pkt *pkt);
+int apr_send_pkt_async(struct apr_device *adev, struct apr_pkt *pkt,
+		       struct apr_request *req, uint32_t rsp_opcode);
+int apr_wait_request(struct apr_device *adev, struct apr_request *req,
+		     unsigned long timeout);
 
 #endif /* __QCOM_APR_H_ */
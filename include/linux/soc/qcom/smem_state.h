@@ -9,6 +9,8 @@ struct qcom_smem_state;
 
 struct qcom_smem_state_ops {
 	int (*update_bits)(void *, u32, u32);
+	int (*begin)(void *);
+	int (*commit)(void *);
 };
 
 #ifdef CONFIG_QCOM_SMEM_STATE
@@ -17,6 +19,8 @@ struct qcom_smem_state *qcom_smem_state_get(struct device *dev, const char *con_
 void qcom_smem_state_put(struct qcom_smem_state *);
 
 int qcom_smem_state_update_bits(struct qcom_smem_state *state, u32 mask, u32 value);
+int qcom_smem_state_begin(struct qcom_smem_state *state);
+int qcom_smem_state_commit(struct qcom_smem_state *state);
 
 struct qcom_smem_state *qcom_smem_state_register(struct device_node *of_node, const struct qcom_smem_state_ops *ops, void *data);
 void qcom_smem_state_unregister(struct qcom_smem_state *state);
@@ -39,6 +43,16 @@ static inline int qcom_smem_state_update_bits(struct qcom_smem_state *state,
 	return -EINVAL;
 }
 
+static inline int qcom_smem_state_begin(struct qcom_smem_state *state)
+{
+	return -EINVAL;
+}
+
+static inline int qcom_smem_state_commit(struct qcom_smem_state *state)
+{
+	return -EINVAL;
+}
+
 static inline struct qcom_smem_state *qcom_smem_state_register(struct device_node *of_node,
 	const struct qcom_smem_state_ops *ops, void *data)
 {
@@ -69,22 +69,48 @@ int spmi_device_add(struct spmi_device *sdev);
 
 void spmi_device_remove(struct spmi_device *sdev);
 
+/**
+ * struct spmi_batch_cmd - one register access within an SPMI batch
+ * @opcode:	SPMI read or write command (SPMI_CMD_READ, SPMI_CMD_EXT_WRITEL...)
+ * @addr:	slave register address.
+ * @buf:	buffer populated by a read command.
+ * @wbuf:	buffer holding the data of a write command.
+ * @len:	number of bytes to transfer.
+ */
+struct spmi_batch_cmd {
+	u8		opcode;
+	u16		addr;
+	union {
+		u8		*buf;
+		const u8	*wbuf;
+	};
+	size_t		len;
+};
+
 /**
  * struct spmi_controller - interface to the SPMI master controller
  * @dev:	Driver model representation of the device.
  * @nr:		board-specific number identifier for this controller/bus
+ * @max_xfer_len: largest payload moved by a single read or write command,
+ *		zero if the controller supports the protocol maximum.
  * @cmd:	sends a non-data command sequence on the SPMI bus.
  * @read_cmd:	sends a register read command sequence on the SPMI bus.
  * @write_cmd:	sends a register write command sequence on the SPMI bus.
+ * @batch_cmd:	optional; sends a sequence of register read and write commands
+ *		on the SPMI bus, keeping the commands to each peripheral in
+ *		order and only waiting for the bus when it has to.
  */
 struct spmi_controller {
 	struct device		dev;
 	unsigned int		nr;
+	size_t			max_xfer_len;
 	int	(*cmd)(struct spmi_controller *ctrl, u8 opcode, u8 sid);
 	int	(*read_cmd)(struct spmi_controller *ctrl, u8 opcode,
 			    u8 sid, u16 addr, u8 *buf, size_t len);
 	int	(*write_cmd)(struct spmi_controller *ctrl, u8 opcode,
 			     u8 sid, u16 addr, const u8 *buf, size_t len);
+	int	(*batch_cmd)(struct spmi_controller *ctrl, u8 sid,
+			     struct spmi_batch_cmd *cmds, unsigned int ncmds);
 };
 
 static inline struct spmi_controller *to_spmi_controller(struct device *d)
@@ -175,6 +201,9 @@ int spmi_ext_register_write(struct spmi_device *sdev, u8 addr,
 			    const u8 *buf, size_t len);
 int spmi_ext_register_writel(struct spmi_device *sdev, u16 addr,
 			     const u8 *buf, size_t len);
+int spmi_batch(struct spmi_device *sdev, struct spmi_batch_cmd *cmds,
+	       unsigned int ncmds);
+size_t spmi_max_xfer_len(struct spmi_device *sdev, u8 opcode);
 int spmi_command_reset(struct spmi_device *sdev);
 int spmi_command_sleep(struct spmi_device *sdev);
 int spmi_command_wakeup(struct spmi_device *sdev);
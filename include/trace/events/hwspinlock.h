@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM hwspinlock
+
+#if !defined(_TRACE_HWSPINLOCK_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_HWSPINLOCK_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(hwspinlock_lock,
+
+	TP_PROTO(int id),
+
+	TP_ARGS(id),
+
+	TP_STRUCT__entry(
+		__field(	int,		id		)
+	),
+
+	TP_fast_assign(
+		__entry->id = id;
+	),
+
+	TP_printk("id=%d", __entry->id)
+);
+
+DECLARE_EVENT_CLASS(hwspinlock_wait,
+
+	TP_PROTO(int id, unsigned int retries, u64 wait_ns),
+
+	TP_ARGS(id, retries, wait_ns),
+
+	TP_STRUCT__entry(
+		__field(	int,		id		)
+		__field(	unsigned int,	retries		)
+		__field(	u64,		wait_ns		)
+	),
+
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->retries = retries;
+		__entry->wait_ns = wait_ns;
+	),
+
+	TP_printk("id=%d retries=%u wait_ns=%llu",
+		  __entry->id, __entry->retries, __entry->wait_ns)
+);
+
+DEFINE_EVENT(hwspinlock_wait, hwspinlock_contended,
+
+	TP_PROTO(int id, unsigned int retries, u64 wait_ns),
+
+	TP_ARGS(id, retries, wait_ns)
+);
+
+DEFINE_EVENT(hwspinlock_wait, hwspinlock_timeout,
+
+	TP_PROTO(int id, unsigned int retries, u64 wait_ns),
+
+	TP_ARGS(id, retries, wait_ns)
+);
+
+TRACE_EVENT(hwspinlock_unlock,
+
+	TP_PROTO(int id, u64 hold_ns),
+
+	TP_ARGS(id, hold_ns),
+
+	TP_STRUCT__entry(
+		__field(	int,		id		)
+		__field(	u64,		hold_ns		)
+	),
+
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->hold_ns = hold_ns;
+	),
+
+	TP_printk("id=%d hold_ns=%llu", __entry->id, __entry->hold_ns)
+);
+
+#endif /* _TRACE_HWSPINLOCK_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -4599,6 +4599,7 @@ struct module *__module_address(unsigned long addr)
 	}
 	return mod;
 }
+EXPORT_SYMBOL_GPL(__module_address);
 
 /**
  * is_module_text_address() - is this address inside module code?
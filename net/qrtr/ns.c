@@ -5,6 +5,7 @@
  * Copyright (c) 2020, Linaro Ltd.
  */
 
+#include <linux/hashtable.h>
 #include <linux/module.h>
 #include <linux/qrtr.h>
 #include <linux/workqueue.h>
@@ -17,10 +18,14 @@
 
 static RADIX_TREE(nodes, GFP_KERNEL);
 
+/* servers and lookups are additionally indexed by service id */
+#define QRTR_NS_HASH_BITS	6
+
 static struct {
 	struct socket *sock;
 	struct sockaddr_qrtr bcast_sq;
-	struct list_head lookups;
+	DECLARE_HASHTABLE(servers, QRTR_NS_HASH_BITS);
+	DECLARE_HASHTABLE(lookups, QRTR_NS_HASH_BITS);
 	struct workqueue_struct *workqueue;
 	struct work_struct work;
 	int local_node;
@@ -50,7 +55,7 @@ struct qrtr_lookup {
 	unsigned int instance;
 
 	struct sockaddr_qrtr sq;
-	struct list_head li;
+	struct hlist_node hli;
 };
 
 struct qrtr_server {
@@ -60,7 +65,7 @@ struct qrtr_server {
 	unsigned int node;
 	unsigned int port;
 
-	struct list_head qli;
+	struct hlist_node hli;
 };
 
 struct qrtr_node {
@@ -187,6 +192,30 @@ static void lookup_notify(struct sockaddr_qrtr *to, struct qrtr_server *srv,
 		pr_err("failed to send lookup notification\n");
 }
 
+/* Notify the observers of @srv's service and the wildcard observers */
+static void lookup_notify_observers(struct qrtr_server *srv, bool new)
+{
+	struct qrtr_lookup *lookup;
+
+	hash_for_each_possible(qrtr_ns.lookups, lookup, hli, srv->service) {
+		if (lookup->service != srv->service)
+			continue;
+		if (lookup->instance && lookup->instance != srv->instance)
+			continue;
+
+		lookup_notify(&lookup->sq, srv, new);
+	}
+
+	hash_for_each_possible(qrtr_ns.lookups, lookup, hli, 0) {
+		if (lookup->service)
+			continue;
+		if (lookup->instance && lookup->instance != srv->instance)
+			continue;
+
+		lookup_notify(&lookup->sq, srv, new);
+	}
+}
+
 static int announce_servers(struct sockaddr_qrtr *sq)
 {
 	struct radix_tree_iter iter;
@@ -255,10 +284,12 @@ static struct qrtr_server *server_add(unsigned int service,
 	old = radix_tree_lookup(&node->servers, port);
 	if (old) {
 		radix_tree_delete(&node->servers, port);
+		hash_del(&old->hli);
 		kfree(old);
 	}
 
 	radix_tree_insert(&node->servers, port, srv);
+	hash_add(qrtr_ns.servers, &srv->hli, srv->service);
 
 	trace_qrtr_ns_server_add(srv->service, srv->instance,
 				 srv->node, srv->port);
@@ -272,30 +303,21 @@ static struct qrtr_server *server_add(unsigned int service,
 
 static int server_del(struct qrtr_node *node, unsigned int port)
 {
-	struct qrtr_lookup *lookup;
 	struct qrtr_server *srv;
-	struct list_head *li;
 
 	srv = radix_tree_lookup(&node->servers, port);
 	if (!srv)
 		return -ENOENT;
 
 	radix_tree_delete(&node->servers, port);
+	hash_del(&srv->hli);
 
 	/* Broadcast the removal of local servers */
 	if (srv->node == qrtr_ns.local_node)
 		service_announce_del(&qrtr_ns.bcast_sq, srv);
 
 	/* Announce the service's disappearance to observers */
-	list_for_each(li, &qrtr_ns.lookups) {
-		lookup = container_of(li, struct qrtr_lookup, li);
-		if (lookup->service && lookup->service != srv->service)
-			continue;
-		if (lookup->instance && lookup->instance != srv->instance)
-			continue;
-
-		lookup_notify(&lookup->sq, srv, false);
-	}
+	lookup_notify_observers(srv, false);
 
 	kfree(srv);
 
@@ -426,10 +448,10 @@ static int ctrl_cmd_del_client(struct sockaddr_qrtr *from,
 	struct qrtr_server *srv;
 	struct sockaddr_qrtr sq;
 	struct qrtr_node *node;
-	struct list_head *tmp;
-	struct list_head *li;
+	struct hlist_node *tmp;
 	void __rcu **slot;
 	struct kvec iv;
+	int bkt;
 	int ret;
 
 	iv.iov_base = &pkt;
@@ -444,14 +466,13 @@ static int ctrl_cmd_del_client(struct sockaddr_qrtr *from,
 		return -EINVAL;
 
 	/* Remove any lookups by this client */
-	list_for_each_safe(li, tmp, &qrtr_ns.lookups) {
-		lookup = container_of(li, struct qrtr_lookup, li);
+	hash_for_each_safe(qrtr_ns.lookups, bkt, tmp, lookup, hli) {
 		if (lookup->sq.sq_node != node_id)
 			continue;
 		if (lookup->sq.sq_port != port)
 			continue;
 
-		list_del(&lookup->li);
+		hash_del(&lookup->hli);
 		kfree(lookup);
 	}
 
@@ -506,9 +527,7 @@ static int ctrl_cmd_new_server(struct sockaddr_qrtr *from,
 			       unsigned int service, unsigned int instance,
 			       unsigned int node_id, unsigned int port)
 {
-	struct qrtr_lookup *lookup;
 	struct qrtr_server *srv;
-	struct list_head *li;
 	int ret = 0;
 
 	/* Ignore specified node and port for local servers */
@@ -530,15 +549,7 @@ static int ctrl_cmd_new_server(struct sockaddr_qrtr *from,
 	}
 
 	/* Notify any potential lookups about the new server */
-	list_for_each(li, &qrtr_ns.lookups) {
-		lookup = container_of(li, struct qrtr_lookup, li);
-		if (lookup->service && lookup->service != service)
-			continue;
-		if (lookup->instance && lookup->instance != instance)
-			continue;
-
-		lookup_notify(&lookup->sq, srv, true);
-	}
+	lookup_notify_observers(srv, true);
 
 	return ret;
 }
@@ -573,6 +584,7 @@ static int ctrl_cmd_new_lookup(struct sockaddr_qrtr *from,
 	struct qrtr_server_filter filter;
 	struct radix_tree_iter srv_iter;
 	struct qrtr_lookup *lookup;
+	struct qrtr_server *srv;
 	struct qrtr_node *node;
 	void __rcu **node_slot;
 	void __rcu **srv_slot;
@@ -588,12 +600,25 @@ static int ctrl_cmd_new_lookup(struct sockaddr_qrtr *from,
 	lookup->sq = *from;
 	lookup->service = service;
 	lookup->instance = instance;
-	list_add_tail(&lookup->li, &qrtr_ns.lookups);
+	hash_add(qrtr_ns.lookups, &lookup->hli, service);
 
 	memset(&filter, 0, sizeof(filter));
 	filter.service = service;
 	filter.instance = instance;
 
+	/*
+	 * Lookups for a specific service only need to visit the servers
+	 * hashed to that service. The index is only modified from this
+	 * worker, so it is stable across the notifications.
+	 */
+	if (service) {
+		hash_for_each_possible(qrtr_ns.servers, srv, hli, service) {
+			if (server_match(srv, &filter))
+				lookup_notify(from, srv, true);
+		}
+		goto out;
+	}
+
 	rcu_read_lock();
 	radix_tree_for_each_slot(node_slot, &nodes, &node_iter, 0) {
 		node = radix_tree_deref_slot(node_slot);
@@ -607,8 +632,6 @@ static int ctrl_cmd_new_lookup(struct sockaddr_qrtr *from,
 
 		radix_tree_for_each_slot(srv_slot, &node->servers,
 					 &srv_iter, 0) {
-			struct qrtr_server *srv;
-
 			srv = radix_tree_deref_slot(srv_slot);
 			if (!srv)
 				continue;
@@ -629,6 +652,7 @@ static int ctrl_cmd_new_lookup(struct sockaddr_qrtr *from,
 	}
 	rcu_read_unlock();
 
+out:
 	/* Empty notification, to indicate end of listing */
 	lookup_notify(from, NULL, true);
 
@@ -639,11 +663,10 @@ static void ctrl_cmd_del_lookup(struct sockaddr_qrtr *from,
 				unsigned int service, unsigned int instance)
 {
 	struct qrtr_lookup *lookup;
-	struct list_head *tmp;
-	struct list_head *li;
+	struct hlist_node *tmp;
 
-	list_for_each_safe(li, tmp, &qrtr_ns.lookups) {
-		lookup = container_of(li, struct qrtr_lookup, li);
+	hash_for_each_possible_safe(qrtr_ns.lookups, lookup, tmp, hli,
+				    service) {
 		if (lookup->sq.sq_node != from->sq_node)
 			continue;
 		if (lookup->sq.sq_port != from->sq_port)
@@ -653,7 +676,7 @@ static void ctrl_cmd_del_lookup(struct sockaddr_qrtr *from,
 		if (lookup->instance && lookup->instance != instance)
 			continue;
 
-		list_del(&lookup->li);
+		hash_del(&lookup->hli);
 		kfree(lookup);
 	}
 }
@@ -760,7 +783,8 @@ void qrtr_ns_init(void)
 	struct sockaddr_qrtr sq;
 	int ret;
 
-	INIT_LIST_HEAD(&qrtr_ns.lookups);
+	hash_init(qrtr_ns.servers);
+	hash_init(qrtr_ns.lookups);
 	INIT_WORK(&qrtr_ns.work, qrtr_ns_worker);
 
 	ret = sock_create_kern(&init_net, AF_QIPCRTR, SOCK_DGRAM,
@@ -97,7 +97,7 @@ static inline struct qrtr_sock *qrtr_sk(struct sock *sk)
 
 static unsigned int qrtr_local_nid = 1;
 
-/* for node ids */
+/* for node ids, readers are protected by RCU */
 static RADIX_TREE(qrtr_nodes, GFP_ATOMIC);
 static DEFINE_SPINLOCK(qrtr_nodes_lock);
 /* broadcast list */
@@ -117,8 +117,10 @@ static DEFINE_MUTEX(qrtr_port_lock);
  * @nid: node id
  * @qrtr_tx_flow: tree of qrtr_tx_flow, keyed by node << 32 | port
  * @qrtr_tx_lock: lock for qrtr_tx_flow inserts
- * @rx_queue: receive queue
+ * @rx_queue: receive queue, drained by qrtr_node_rx_flush()
+ * @rx_flags: bitmask of QRTR_NODE_RX_*
  * @item: list item for broadcast list
+ * @rcu: rcu head for deferred freeing of the node
  */
 struct qrtr_node {
 	struct mutex ep_lock;
@@ -130,9 +132,15 @@ struct qrtr_node {
 	struct mutex qrtr_tx_lock; /* for qrtr_tx_flow */
 
 	struct sk_buff_head rx_queue;
+	unsigned long rx_flags;
 	struct list_head item;
+
+	struct rcu_head rcu;
 };
 
+/* set while a context is delivering packets from the node's rx_queue */
+#define QRTR_NODE_RX_BUSY	0
+
 /**
  * struct qrtr_tx_flow - tx flow control
  * @resume_tx: waiters for a resume tx from the remote
@@ -191,15 +199,9 @@ static void __qrtr_node_release(struct kref *kref)
 		radix_tree_iter_delete(&node->qrtr_tx_flow, &iter, slot);
 		kfree(flow);
 	}
-	kfree(node);
-}
 
-/* Increment reference to node. */
-static struct qrtr_node *qrtr_node_acquire(struct qrtr_node *node)
-{
-	if (node)
-		kref_get(&node->ref);
-	return node;
+	/* qrtr_node_lookup() may still be looking at the node */
+	kfree_rcu(node, rcu);
 }
 
 /* Decrement reference to node and release as necessary. */
@@ -381,18 +383,21 @@ static int qrtr_node_enqueue(struct qrtr_node *node, struct sk_buff *skb,
 }
 
 /* Lookup node by id.
+ *
+ * The lookup is lockless; a node whose last reference is being dropped is
+ * treated as absent.
  *
  * callers must release with qrtr_node_release()
  */
 static struct qrtr_node *qrtr_node_lookup(unsigned int nid)
 {
 	struct qrtr_node *node;
-	unsigned long flags;
 
-	spin_lock_irqsave(&qrtr_nodes_lock, flags);
+	rcu_read_lock();
 	node = radix_tree_lookup(&qrtr_nodes, nid);
-	node = qrtr_node_acquire(node);
-	spin_unlock_irqrestore(&qrtr_nodes_lock, flags);
+	if (node && !kref_get_unless_zero(&node->ref))
+		node = NULL;
+	rcu_read_unlock();
 
 	return node;
 }
@@ -416,6 +421,52 @@ static void qrtr_node_assign(struct qrtr_node *node, unsigned int nid)
 	spin_unlock_irqrestore(&qrtr_nodes_lock, flags);
 }
 
+/**
+ * qrtr_node_rx_flush() - deliver packets queued on the node's rx_queue
+ * @node:	qrtr_node to drain
+ *
+ * Only one context drains a node at a time. Packets posted from other CPUs
+ * while a drain is in progress are left on the queue and picked up by the
+ * active drainer, so bursts from the transport are delivered in order and
+ * runs of packets for the same port share a single port lookup.
+ */
+static void qrtr_node_rx_flush(struct qrtr_node *node)
+{
+	struct qrtr_sock *ipc = NULL;
+	struct sk_buff *skb;
+	struct qrtr_cb *cb;
+	u32 port = 0;
+
+	do {
+		if (test_and_set_bit(QRTR_NODE_RX_BUSY, &node->rx_flags))
+			break;
+
+		while ((skb = skb_dequeue(&node->rx_queue))) {
+			cb = (struct qrtr_cb *)skb->cb;
+
+			if (!ipc || cb->dst_port != port) {
+				if (ipc)
+					qrtr_port_put(ipc);
+				port = cb->dst_port;
+				ipc = qrtr_port_lookup(port);
+			}
+
+			if (!ipc || sock_queue_rcv_skb(&ipc->sk, skb))
+				kfree_skb(skb);
+		}
+
+		clear_bit_unlock(QRTR_NODE_RX_BUSY, &node->rx_flags);
+
+		/* Pairs with the enqueue in qrtr_endpoint_post(), pick up any
+		 * packet that was queued while we still appeared busy.
+		 */
+		smp_mb__after_atomic();
+	} while (!skb_queue_empty_lockless(&node->rx_queue));
+
+	if (ipc)
+		qrtr_port_put(ipc);
+}
+
 /**
  * qrtr_endpoint_post() - post incoming data
  * @ep: endpoint handle
@@ -510,14 +561,14 @@ int qrtr_endpoint_post(struct qrtr_endpoint *ep, const void *data, size_t len)
 	if (cb->type == QRTR_TYPE_RESUME_TX) {
 		qrtr_tx_resume(node, skb);
 	} else {
+		/* Report packets for unbound ports, delivery is deferred */
 		ipc = qrtr_port_lookup(cb->dst_port);
 		if (!ipc)
 			goto err;
-
-		if (sock_queue_rcv_skb(&ipc->sk, skb))
-			goto err;
-
 		qrtr_port_put(ipc);
+
+		skb_queue_tail(&node->rx_queue, skb);
+		qrtr_node_rx_flush(node);
 	}
 
 	return 0;
@@ -642,6 +693,10 @@ void qrtr_endpoint_unregister(struct qrtr_endpoint *ep)
 EXPORT_SYMBOL_GPL(qrtr_endpoint_unregister);
 
 /* Lookup socket by port.
+ *
+ * The lookup is lockless, sockets are freed after a grace period
+ * (SOCK_RCU_FREE) so a socket found in the idr can be safely inspected and
+ * is only returned if it's not already on its way out.
  *
  * Callers must release with qrtr_port_put()
  */
@@ -654,8 +709,8 @@ static struct qrtr_sock *qrtr_port_lookup(int port)
 
 	rcu_read_lock();
 	ipc = idr_find(&qrtr_ports, port);
-	if (ipc)
-		sock_hold(&ipc->sk);
+	if (ipc && !refcount_inc_not_zero(&ipc->sk.sk_refcnt))
+		ipc = NULL;
 	rcu_read_unlock();
 
 	return ipc;
@@ -698,10 +753,6 @@ static void qrtr_port_remove(struct qrtr_sock *ipc)
 	mutex_lock(&qrtr_port_lock);
 	idr_remove(&qrtr_ports, port);
 	mutex_unlock(&qrtr_port_lock);
-
-	/* Ensure that if qrtr_port_lookup() did enter the RCU read section we
-	 * wait for it to up increment the refcount */
-	synchronize_rcu();
 }
 
 /* Assign port number to socket.
@@ -1260,6 +1311,8 @@ static int qrtr_create(struct net *net, struct socket *sock,
 		return -ENOMEM;
 
 	sock_set_flag(sk, SOCK_ZAPPED);
+	/* qrtr_port_lookup() relies on sockets being freed after a grace period */
+	sock_set_flag(sk, SOCK_RCU_FREE);
 
 	sock_init_data(sock, sk);
 	sock->ops = &qrtr_proto_ops;
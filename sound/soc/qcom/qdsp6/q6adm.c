@@ -48,7 +48,6 @@ struct q6copp {
 
 	struct aprv2_ibasic_rsp_result_t result;
 	struct kref refcount;
-	wait_queue_head_t wait;
 	struct list_head node;
 	struct q6adm *adm;
 };
@@ -60,9 +59,7 @@ struct q6adm {
 	unsigned long copp_bitmap[AFE_MAX_PORTS];
 	struct list_head copps_list;
 	spinlock_t copps_list_lock;
-	struct aprv2_ibasic_rsp_result_t result;
 	struct mutex lock;
-	wait_queue_head_t matrix_map_wait;
 };
 
 struct q6adm_cmd_device_open_v5 {
@@ -146,6 +143,7 @@ static int q6adm_callback(struct apr_device *adev, struct apr_resp_pkt *data)
 		return 0;
 	}
 
+	/* Commands are completed by the apr core once this returns */
 	switch (hdr->opcode) {
 	case APR_BASIC_RSP_RESULT: {
 		if (result->status != 0) {
@@ -155,17 +153,7 @@ static int q6adm_callback(struct apr_device *adev, struct apr_resp_pkt *data)
 		switch (result->opcode) {
 		case ADM_CMD_DEVICE_OPEN_V5:
 		case ADM_CMD_DEVICE_CLOSE_V5:
-			copp = q6adm_find_copp(adm, port_idx, copp_idx);
-			if (!copp)
-				return 0;
-
-			copp->result = *result;
-			wake_up(&copp->wait);
-			kref_put(&copp->refcount, q6adm_free_copp);
-			break;
 		case ADM_CMD_MATRIX_MAP_ROUTINGS_V5:
-			adm->result = *result;
-			wake_up(&adm->matrix_map_wait);
 			break;
 
 		default:
@@ -190,13 +178,10 @@ static int q6adm_callback(struct apr_device *adev, struct apr_resp_pkt *data)
 			dev_err(&adev->dev, "Invalid coppid rxed %d\n",
 				open->copp_id);
 			copp->result.status = ADSP_EBADPARAM;
-			wake_up(&copp->wait);
 			kref_put(&copp->refcount, q6adm_free_copp);
 			break;
 		}
-		copp->result.opcode = hdr->opcode;
 		copp->id = open->copp_id;
-		wake_up(&copp->wait);
 		kref_put(&copp->refcount, q6adm_free_copp);
 	}
 	break;
@@ -229,8 +214,6 @@ static struct q6copp *q6adm_alloc_copp(struct q6adm *adm, int port_idx)
 	c->afe_port = port_idx;
 	c->adm = adm;
 
-	init_waitqueue_head(&c->wait);
-
 	return c;
 }
 
@@ -238,36 +221,25 @@ static int q6adm_apr_send_copp_pkt(struct q6adm *adm, struct q6copp *copp,
 				   struct apr_pkt *pkt, uint32_t rsp_opcode)
 {
 	struct device *dev = adm->dev;
-	uint32_t opcode = pkt->hdr.opcode;
+	struct apr_request req;
 	int ret;
 
 	mutex_lock(&adm->lock);
-	copp->result.opcode = 0;
 	copp->result.status = 0;
-	ret = apr_send_pkt(adm->apr, pkt);
+	ret = apr_send_pkt_async(adm->apr, pkt, &req, rsp_opcode);
 	if (ret < 0) {
 		dev_err(dev, "Failed to send APR packet\n");
 		ret = -EINVAL;
 		goto err;
 	}
 
-	/* Wait for the callback with copp id */
-	if (rsp_opcode)
-		ret = wait_event_timeout(copp->wait,
-					 (copp->result.opcode == opcode) ||
-					 (copp->result.opcode == rsp_opcode),
-					 msecs_to_jiffies(TIMEOUT_MS));
-	else
-		ret = wait_event_timeout(copp->wait,
-					 (copp->result.opcode == opcode),
-					 msecs_to_jiffies(TIMEOUT_MS));
-
-	if (!ret) {
+	/* The callback has stored the copp id once the request completes */
+	ret = apr_wait_request(adm->apr, &req, msecs_to_jiffies(TIMEOUT_MS));
+	if (ret < 0) {
 		dev_err(dev, "ADM copp cmd timedout\n");
-		ret = -ETIMEDOUT;
-	} else if (copp->result.status > 0) {
+	} else if (req.status > 0 || copp->result.status > 0) {
 		dev_err(dev, "DSP returned error[%d]\n",
-			copp->result.status);
+			req.status ?: copp->result.status);
 		ret = -EINVAL;
 	}
 
@@ -462,6 +434,7 @@ int q6adm_matrix_map(struct device *dev, int path,
 	struct q6adm *adm = dev_get_drvdata(dev->parent);
 	struct q6adm_cmd_matrix_map_routings_v5 *route;
 	struct q6adm_session_map_node_v5 *node;
+	struct apr_request req;
 	struct apr_pkt *pkt;
 	uint16_t *copps_list;
 	int pkt_size, ret, i, copp_idx;
@@ -526,26 +499,20 @@ int q6adm_matrix_map(struct device *dev, int path,
 	}
 
 	mutex_lock(&adm->lock);
-	adm->result.status = 0;
-	adm->result.opcode = 0;
 
-	ret = apr_send_pkt(adm->apr, pkt);
+	ret = apr_send_pkt_async(adm->apr, pkt, &req, 0);
 	if (ret < 0) {
 		dev_err(dev, "routing for stream %d failed ret %d\n",
 		       payload_map.session_id, ret);
 		goto fail_cmd;
 	}
-	ret = wait_event_timeout(adm->matrix_map_wait,
-				 adm->result.opcode == pkt->hdr.opcode,
-				 msecs_to_jiffies(TIMEOUT_MS));
-	if (!ret) {
+	ret = apr_wait_request(adm->apr, &req, msecs_to_jiffies(TIMEOUT_MS));
+	if (ret < 0) {
 		dev_err(dev, "routing for stream %d failed\n",
 		       payload_map.session_id);
-		ret = -ETIMEDOUT;
 		goto fail_cmd;
-	} else if (adm->result.status > 0) {
-		dev_err(dev, "DSP returned error[%d]\n",
-			adm->result.status);
+	} else if (req.status > 0) {
+		dev_err(dev, "DSP returned error[%d]\n", req.status);
 		ret = -EINVAL;
 		goto fail_cmd;
 	}
@@ -596,7 +563,6 @@ static int q6adm_probe(struct apr_device *adev)
 	adm->dev = dev;
 	q6core_get_svc_api_info(adev->svc_id, &adm->ainfo);
 	mutex_init(&adm->lock);
-	init_waitqueue_head(&adm->matrix_map_wait);
 
 	INIT_LIST_HEAD(&adm->copps_list);
 	spin_lock_init(&adm->copps_list_lock);
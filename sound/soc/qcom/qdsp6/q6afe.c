@@ -366,8 +366,6 @@ struct q6afe {
 	struct device *dev;
 	struct q6core_svc_api_info ainfo;
 	struct mutex lock;
-	struct aprv2_ibasic_rsp_result_t result;
-	wait_queue_head_t wait;
 	struct list_head port_list;
 	spinlock_t port_list_lock;
 };
@@ -537,10 +535,8 @@ struct afe_param_id_slot_mapping_cfg {
 } __packed;
 
 struct q6afe_port {
-	wait_queue_head_t wait;
 	union afe_port_config port_cfg;
 	struct afe_param_id_slot_mapping_cfg *scfg;
-	struct aprv2_ibasic_rsp_result_t result;
 	int token;
 	int id;
 	int cfg_type;
@@ -866,11 +862,11 @@ static int q6afe_callback(struct apr_device *adev, struct apr_resp_pkt *data)
 	struct q6afe *afe = dev_get_drvdata(&adev->dev);
 	struct aprv2_ibasic_rsp_result_t *res;
 	struct apr_hdr *hdr = &data->hdr;
-	struct q6afe_port *port;
 
 	if (!data->payload_size)
 		return 0;
 
+	/* Commands are completed by the apr core, see afe_apr_send_pkt() */
 	res = data->payload;
 	switch (hdr->opcode) {
 	case APR_BASIC_RSP_RESULT: {
@@ -883,15 +879,6 @@ static int q6afe_callback(struct apr_device *adev, struct apr_resp_pkt *data)
 		case AFE_PORT_CMD_DEVICE_STOP:
 		case AFE_PORT_CMD_DEVICE_START:
 		case AFE_SVC_CMD_SET_PARAM:
-			port = q6afe_find_port(afe, hdr->token);
-			if (port) {
-				port->result = *res;
-				wake_up(&port->wait);
-				kref_put(&port->refcount, q6afe_port_free);
-			} else if (hdr->token == AFE_CLK_TOKEN) {
-				afe->result = *res;
-				wake_up(&afe->wait);
-			}
 			break;
 		default:
 			dev_err(afe->dev, "Unknown cmd 0x%x\n",	res->opcode);
@@ -899,11 +886,6 @@ static int q6afe_callback(struct apr_device *adev, struct apr_resp_pkt *data)
 		}
 	}
 		break;
-	case AFE_CMD_RSP_REMOTE_LPASS_CORE_HW_VOTE_REQUEST:
-		afe->result.opcode = hdr->opcode;
-		afe->result.status = res->status;
-		wake_up(&afe->wait);
-		break;
 	default:
 		break;
 	}
@@ -928,41 +910,27 @@ int q6afe_get_port_id(int index)
 EXPORT_SYMBOL_GPL(q6afe_get_port_id);
 
 static int afe_apr_send_pkt(struct q6afe *afe, struct apr_pkt *pkt,
-			    struct q6afe_port *port, uint32_t rsp_opcode)
+			    uint32_t rsp_opcode)
 {
-	wait_queue_head_t *wait = &port->wait;
-	struct aprv2_ibasic_rsp_result_t *result;
+	struct apr_request req;
 	int ret;
 
 	mutex_lock(&afe->lock);
-	if (port) {
-		wait = &port->wait;
-		result = &port->result;
-	} else {
-		result = &afe->result;
-		wait = &afe->wait;
-	}
-
-	result->opcode = 0;
-	result->status = 0;
 
-	ret = apr_send_pkt(afe->apr, pkt);
+	ret = apr_send_pkt_async(afe->apr, pkt, &req, rsp_opcode);
 	if (ret < 0) {
 		dev_err(afe->dev, "packet not transmitted (%d)\n", ret);
 		ret = -EINVAL;
 		goto err;
 	}
 
-	ret = wait_event_timeout(*wait, (result->opcode == rsp_opcode),
-				 msecs_to_jiffies(TIMEOUT_MS));
-	if (!ret) {
-		ret = -ETIMEDOUT;
-	} else if (result->status > 0) {
-		dev_err(afe->dev, "DSP returned error[%x]\n",
-			result->status);
+	ret = apr_wait_request(afe->apr, &req, msecs_to_jiffies(TIMEOUT_MS));
+	if (ret < 0)
+		goto err;
+
+	if (req.status > 0) {
+		dev_err(afe->dev, "DSP returned error[%x]\n", req.status);
 		ret = -EINVAL;
-	} else {
-		ret = 0;
 	}
 
 err:
@@ -1009,7 +977,7 @@ static int q6afe_set_param(struct q6afe *afe, struct q6afe_port *port,
 	pdata->param_id = param_id;
 	pdata->param_size = psize;
 
-	ret = afe_apr_send_pkt(afe, pkt, port, AFE_SVC_CMD_SET_PARAM);
+	ret = afe_apr_send_pkt(afe, pkt, AFE_SVC_CMD_SET_PARAM);
 	if (ret)
 		dev_err(afe->dev, "AFE set params failed %d\n", ret);
 
@@ -1064,7 +1032,7 @@ static int q6afe_port_set_param_v2(struct q6afe_port *port, void *data,
 	pdata->param_id = param_id;
 	pdata->param_size = psize;
 
-	ret = afe_apr_send_pkt(afe, pkt, port, AFE_PORT_CMD_SET_PARAM_V2);
+	ret = afe_apr_send_pkt(afe, pkt, AFE_PORT_CMD_SET_PARAM_V2);
 	if (ret)
 		dev_err(afe->dev, "AFE enable for port 0x%x failed %d\n",
 		       port_id, ret);
@@ -1214,7 +1182,7 @@ int q6afe_port_stop(struct q6afe_port *port)
 	stop->port_id = port_id;
 	stop->reserved = 0;
 
-	ret = afe_apr_send_pkt(afe, pkt, port, AFE_PORT_CMD_DEVICE_STOP);
+	ret = afe_apr_send_pkt(afe, pkt, AFE_PORT_CMD_DEVICE_STOP);
 	if (ret)
 		dev_err(afe->dev, "AFE close failed %d\n", ret);
 
@@ -1526,7 +1494,7 @@ int q6afe_port_start(struct q6afe_port *port)
 
 	start->port_id = port_id;
 
-	ret = afe_apr_send_pkt(afe, pkt, port, AFE_PORT_CMD_DEVICE_START);
+	ret = afe_apr_send_pkt(afe, pkt, AFE_PORT_CMD_DEVICE_START);
 	if (ret)
 		dev_err(afe->dev, "AFE enable for port 0x%x failed %d\n",
 			port_id, ret);
@@ -1614,8 +1582,6 @@ struct q6afe_port *q6afe_port_get_from_id(struct device *dev, int id)
 	if (!port)
 		return ERR_PTR(-ENOMEM);
 
-	init_waitqueue_head(&port->wait);
-
 	port->token = id;
 	port->id = port_id;
 	port->afe = afe;
@@ -1710,7 +1676,7 @@ int q6afe_vote_lpass_core_hw(struct device *dev, uint32_t hw_block_id,
 	strlcpy(vote_cfg->client_name, client_name,
 			sizeof(vote_cfg->client_name));
 
-	ret = afe_apr_send_pkt(afe, pkt, NULL,
+	ret = afe_apr_send_pkt(afe, pkt,
 			       AFE_CMD_RSP_REMOTE_LPASS_CORE_HW_VOTE_REQUEST);
 	if (ret)
 		dev_err(afe->dev, "AFE failed to vote (%d)\n", hw_block_id);
@@ -1733,7 +1699,6 @@ static int q6afe_probe(struct apr_device *adev)
 	q6core_get_svc_api_info(adev->svc_id, &afe->ainfo);
 	afe->apr = adev;
 	mutex_init(&afe->lock);
-	init_waitqueue_head(&afe->wait);
 	afe->dev = dev;
 	INIT_LIST_HEAD(&afe->port_list);
 	spin_lock_init(&afe->port_list_lock);
@@ -4,8 +4,10 @@
 
 #include <linux/init.h>
 #include <linux/err.h>
+#include <linux/hrtimer.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <sound/soc.h>
 #include <sound/soc-dapm.h>
@@ -72,12 +74,18 @@ struct q6asm_dai_rtd {
 	uint32_t initial_samples_drop;
 	uint32_t trailing_samples_drop;
 	bool notify_on_drain;
+	/* ultra low latency (push/pull) mode */
+	bool ull;
+	struct snd_dma_buffer pos_buffer;
+	struct hrtimer period_timer;
+	ktime_t period_time;
 };
 
 struct q6asm_dai_data {
 	struct snd_soc_dai_driver *dais;
 	int num_dais;
 	long long int sid;
+	unsigned long ull_dais;
 };
 
 static const struct snd_pcm_hardware q6asm_dai_hardware_capture = {
@@ -186,7 +194,8 @@ static void event_handler(uint32_t opcode, uint32_t token,
 
 	switch (opcode) {
 	case ASM_CLIENT_EVENT_CMD_RUN_DONE:
-		if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+		    !prtd->ull)
 			q6asm_write_async(prtd->audio_client, prtd->stream_id,
 				   prtd->pcm_count, 0, 0, 0);
 		break;
@@ -214,6 +223,85 @@ static void event_handler(uint32_t opcode, uint32_t token,
 	}
 }
 
+static dma_addr_t q6asm_dai_dsp_addr(struct q6asm_dai_data *pdata,
+				     dma_addr_t addr)
+{
+	if (pdata->sid < 0)
+		return addr;
+
+	return addr | (pdata->sid << 32);
+}
+
+/*
+ * In ultra low latency mode the DSP pulls playback data from (or pushes
+ * capture data to) the whole dma buffer on its own and publishes its
+ * position in a shared page, so there are no data commands and no done
+ * events per period.
+ */
+static int q6asm_dai_prepare_ull(struct snd_soc_component *component,
+				 struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_soc_pcm_runtime *soc_prtd = asoc_substream_to_rtd(substream);
+	struct q6asm_dai_rtd *prtd = runtime->private_data;
+	struct q6asm_dai_data *pdata = snd_soc_component_get_drvdata(component);
+	struct q6asm_shared_io_cfg cfg = { 0 };
+	struct device *dev = component->dev;
+	int ret;
+
+	if (prtd->state) {
+		/* clear the previous setup if any  */
+		q6asm_cmd(prtd->audio_client, prtd->stream_id, CMD_CLOSE);
+		q6routing_stream_close(soc_prtd->dai_link->id,
+					 substream->stream);
+	}
+
+	cfg.buf_phys = prtd->phys;
+	cfg.buf_size = prtd->pcm_size;
+	cfg.pos_phys = q6asm_dai_dsp_addr(pdata, prtd->pos_buffer.addr);
+	cfg.pos = prtd->pos_buffer.area;
+	cfg.rate = runtime->rate;
+	cfg.channels = runtime->channels;
+	cfg.bits_per_sample = prtd->bits_per_sample;
+
+	ret = q6asm_open_shared_io(prtd->audio_client, prtd->stream_id,
+				   substream->stream, &cfg);
+	if (ret < 0) {
+		dev_err(dev, "%s: q6asm_open_shared_io failed\n", __func__);
+		return ret;
+	}
+
+	prtd->session_id = q6asm_get_session_id(prtd->audio_client);
+	ret = q6routing_stream_open(soc_prtd->dai_link->id,
+				    ULTRA_LOW_LATENCY_PCM_MODE,
+				    prtd->session_id, substream->stream);
+	if (ret) {
+		dev_err(dev, "%s: stream reg failed ret:%d\n", __func__, ret);
+		return ret;
+	}
+
+	prtd->period_time = ns_to_ktime(div_u64((u64)NSEC_PER_SEC *
+						runtime->period_size,
+						runtime->rate));
+	prtd->state = Q6ASM_STREAM_RUNNING;
+
+	return 0;
+}
+
+static enum hrtimer_restart q6asm_dai_period_timer(struct hrtimer *t)
+{
+	struct q6asm_dai_rtd *prtd = container_of(t, struct q6asm_dai_rtd,
+						  period_timer);
+
+	if (prtd->state != Q6ASM_STREAM_RUNNING)
+		return HRTIMER_NORESTART;
+
+	snd_pcm_period_elapsed(prtd->substream);
+	hrtimer_forward_now(t, prtd->period_time);
+
+	return HRTIMER_RESTART;
+}
+
 static int q6asm_dai_prepare(struct snd_soc_component *component,
 			     struct snd_pcm_substream *substream)
 {
@@ -222,7 +310,7 @@ static int q6asm_dai_prepare(struct snd_soc_component *component,
 	struct q6asm_dai_rtd *prtd = runtime->private_data;
 	struct q6asm_dai_data *pdata;
 	struct device *dev = component->dev;
-	int ret, i;
+	int ret, map_ret, i;
 
 	pdata = snd_soc_component_get_drvdata(component);
 	if (!pdata)
@@ -236,6 +324,10 @@ static int q6asm_dai_prepare(struct snd_soc_component *component,
 
 	prtd->pcm_count = snd_pcm_lib_period_bytes(substream);
 	prtd->pcm_irq_pos = 0;
+
+	if (prtd->ull)
+		return q6asm_dai_prepare_ull(component, substream);
+
 	/* rate and channels are sent to audio driver */
 	if (prtd->state) {
 		/* clear the previous setup if any  */
@@ -246,10 +338,10 @@ static int q6asm_dai_prepare(struct snd_soc_component *component,
 					 substream->stream);
 	}
 
-	ret = q6asm_map_memory_regions(substream->stream, prtd->audio_client,
-				       prtd->phys,
-				       (prtd->pcm_size / prtd->periods),
-				       prtd->periods);
+	ret = q6asm_map_memory_regions_nowait(substream->stream,
+					      prtd->audio_client, prtd->phys,
+					      (prtd->pcm_size / prtd->periods),
+					      prtd->periods);
 
 	if (ret < 0) {
 		dev_err(dev, "Audio Start: Buffer Allocation failed rc = %d\n",
@@ -257,6 +349,7 @@ static int q6asm_dai_prepare(struct snd_soc_component *component,
 		return -ENOMEM;
 	}
 
+	/* Open the stream while the DSP maps the buffer */
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
 		ret = q6asm_open_write(prtd->audio_client, prtd->stream_id,
 				       FORMAT_LINEAR_PCM,
@@ -267,6 +360,9 @@ static int q6asm_dai_prepare(struct snd_soc_component *component,
 				      prtd->bits_per_sample);
 	}
 
+	map_ret = q6asm_map_memory_regions_wait(substream->stream,
+						prtd->audio_client);
+
 	if (ret < 0) {
 		dev_err(dev, "%s: q6asm_open_write failed\n", __func__);
 		q6asm_audio_client_free(prtd->audio_client);
@@ -274,6 +370,13 @@ static int q6asm_dai_prepare(struct snd_soc_component *component,
 		return -ENOMEM;
 	}
 
+	if (map_ret < 0) {
+		dev_err(dev, "Audio Start: Buffer Allocation failed rc = %d\n",
+							map_ret);
+		q6asm_cmd(prtd->audio_client, prtd->stream_id, CMD_CLOSE);
+		return -ENOMEM;
+	}
+
 	prtd->session_id = q6asm_get_session_id(prtd->audio_client);
 	ret = q6routing_stream_open(soc_prtd->dai_link->id, LEGACY_PCM_MODE,
 			      prtd->session_id, substream->stream);
@@ -320,14 +423,27 @@ static int q6asm_dai_trigger(struct snd_soc_component *component,
 	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
 		ret = q6asm_run_nowait(prtd->audio_client, prtd->stream_id,
 				       0, 0, 0);
+		/* Without done events, wake up the application on a timer */
+		if (!ret && prtd->ull && !runtime->no_period_wakeup)
+			hrtimer_start(&prtd->period_timer, prtd->period_time,
+				      HRTIMER_MODE_REL);
 		break;
 	case SNDRV_PCM_TRIGGER_STOP:
 		prtd->state = Q6ASM_STREAM_STOPPED;
+		if (prtd->ull) {
+			hrtimer_try_to_cancel(&prtd->period_timer);
+			/* No data commands to drain in push/pull mode */
+			ret = q6asm_cmd_nowait(prtd->audio_client,
+					       prtd->stream_id, CMD_PAUSE);
+			break;
+		}
 		ret = q6asm_cmd_nowait(prtd->audio_client, prtd->stream_id,
 				       CMD_EOS);
 		break;
 	case SNDRV_PCM_TRIGGER_SUSPEND:
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
+		if (prtd->ull)
+			hrtimer_try_to_cancel(&prtd->period_timer);
 		ret = q6asm_cmd_nowait(prtd->audio_client, prtd->stream_id,
 				       CMD_PAUSE);
 		break;
@@ -364,12 +480,31 @@ static int q6asm_dai_open(struct snd_soc_component *component,
 		return -ENOMEM;
 
 	prtd->substream = substream;
+	prtd->ull = test_bit(stream_id, &pdata->ull_dais);
+
+	if (prtd->ull) {
+		/* The DSP maps the position buffer as a whole 4K page */
+		ret = snd_dma_alloc_pages(SNDRV_DMA_TYPE_DEV, dev, SZ_4K,
+					  &prtd->pos_buffer);
+		if (ret) {
+			kfree(prtd);
+			return ret;
+		}
+
+		hrtimer_init(&prtd->period_timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL);
+		prtd->period_timer.function = q6asm_dai_period_timer;
+	}
+
 	prtd->audio_client = q6asm_audio_client_alloc(dev,
 				(q6asm_cb)event_handler, prtd, stream_id,
-				LEGACY_PCM_MODE);
+				prtd->ull ? ULTRA_LOW_LATENCY_PCM_MODE :
+					    LEGACY_PCM_MODE);
 	if (IS_ERR(prtd->audio_client)) {
 		dev_info(dev, "%s: Could not allocate memory\n", __func__);
 		ret = PTR_ERR(prtd->audio_client);
+		if (prtd->ull)
+			snd_dma_free_pages(&prtd->pos_buffer);
 		kfree(prtd);
 		return ret;
 	}
@@ -421,13 +556,15 @@ static int q6asm_dai_open(struct snd_soc_component *component,
 
 	snd_soc_set_runtime_hwparams(substream, &q6asm_dai_hardware_playback);
 
+	/* The pointer is sample accurate and periods need no interrupt */
+	if (prtd->ull) {
+		runtime->hw.info &= ~SNDRV_PCM_INFO_BATCH;
+		runtime->hw.info |= SNDRV_PCM_INFO_NO_PERIOD_WAKEUP;
+	}
+
 	runtime->dma_bytes = q6asm_dai_hardware_playback.buffer_bytes_max;
 
-
-	if (pdata->sid < 0)
-		prtd->phys = substream->dma_buffer.addr;
-	else
-		prtd->phys = substream->dma_buffer.addr | (pdata->sid << 32);
+	prtd->phys = q6asm_dai_dsp_addr(pdata, substream->dma_buffer.addr);
 
 	snd_pcm_set_runtime_buffer(substream, &substream->dma_buffer);
 
@@ -441,18 +578,24 @@ static int q6asm_dai_close(struct snd_soc_component *component,
 	struct snd_soc_pcm_runtime *soc_prtd = asoc_substream_to_rtd(substream);
 	struct q6asm_dai_rtd *prtd = runtime->private_data;
 
+	if (prtd->ull)
+		hrtimer_cancel(&prtd->period_timer);
+
 	if (prtd->audio_client) {
 		if (prtd->state)
 			q6asm_cmd(prtd->audio_client, prtd->stream_id,
 				  CMD_CLOSE);
 
-		q6asm_unmap_memory_regions(substream->stream,
-					   prtd->audio_client);
+		if (!prtd->ull)
+			q6asm_unmap_memory_regions(substream->stream,
+						   prtd->audio_client);
 		q6asm_audio_client_free(prtd->audio_client);
 		prtd->audio_client = NULL;
 	}
 	q6routing_stream_close(soc_prtd->dai_link->id,
 						substream->stream);
+	if (prtd->ull)
+		snd_dma_free_pages(&prtd->pos_buffer);
 	kfree(prtd);
 	return 0;
 }
@@ -463,6 +606,14 @@ static snd_pcm_uframes_t q6asm_dai_pointer(struct snd_soc_component *component,
 
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct q6asm_dai_rtd *prtd = runtime->private_data;
+	uint32_t pos;
+
+	if (prtd->ull) {
+		if (!q6asm_get_shared_io_pos(prtd->audio_client, &pos))
+			prtd->pcm_irq_pos = pos % prtd->pcm_size;
+
+		return bytes_to_frames(runtime, prtd->pcm_irq_pos);
+	}
 
 	if (prtd->pcm_irq_pos >= prtd->pcm_size)
 		prtd->pcm_irq_pos = 0;
@@ -1322,6 +1473,8 @@ static int of_q6asm_parse_dai_data(struct device *dev,
 
 		if (of_property_read_bool(node, "is-compress-dai"))
 			dai_drv->compress_new = snd_soc_new_compress;
+		else if (of_property_read_bool(node, "is-ull-dai"))
+			set_bit(dai_drv->id, &pdata->ull_dais);
 	}
 
 	return 0;
@@ -53,6 +53,8 @@
 #define ASM_MEDIA_FMT_APE			0x00012f32
 #define ASM_DATA_CMD_REMOVE_INITIAL_SILENCE	0x00010D67
 #define ASM_DATA_CMD_REMOVE_TRAILING_SILENCE	0x00010D68
+#define ASM_STREAM_CMD_OPEN_PULL_MODE_WRITE	0x00010DD9
+#define ASM_STREAM_CMD_OPEN_PUSH_MODE_READ	0x00010DDA
 
 
 #define ASM_LEGACY_STREAM_SESSION	0
@@ -237,6 +239,46 @@ struct asm_session_cmd_run_v2 {
 	u32 time_msw;
 } __packed;
 
+struct asm_shared_io_pcm_fmt {
+	u16 num_channels;
+	u16 bits_per_sample;
+	u32 sample_rate;
+	u16 is_signed;
+	u16 reserved;
+	u8 channel_mapping[PCM_MAX_NUM_CHANNEL];
+} __packed;
+
+struct asm_stream_cmd_open_shared_io {
+	u32 mode_flags;
+	u16 endpoint_type;
+	u16 topo_bits_per_sample;
+	u32 topo_id;
+	u32 fmt_id;
+	u32 shared_pos_buf_addr_lsw;
+	u32 shared_pos_buf_addr_msw;
+	u16 shared_pos_buf_mem_pool_id;
+	u16 shared_pos_buf_num_regions;
+	u32 shared_pos_buf_property_flag;
+	u32 shared_circ_buf_addr_lsw;
+	u32 shared_circ_buf_addr_msw;
+	u32 shared_circ_buf_size;
+	u16 shared_circ_buf_mem_pool_id;
+	u16 shared_circ_buf_num_regions;
+	u32 shared_circ_buf_property_flag;
+	u32 num_watermark_levels;
+	struct asm_shared_io_pcm_fmt fmt;
+	struct avs_shared_map_region_payload map_region_pos_buf;
+	struct avs_shared_map_region_payload map_region_circ_buf;
+} __packed;
+
+/* Written by the DSP, frame_counter changes on every update of index */
+struct asm_shared_position_buffer {
+	u32 frame_counter;
+	u32 index;
+	u32 wall_clock_us_lsw;
+	u32 wall_clock_us_msw;
+} __packed;
+
 struct audio_buffer {
 	phys_addr_t phys;
 	uint32_t size;		/* size of buffer */
@@ -247,13 +289,14 @@ struct audio_port_data {
 	uint32_t num_periods;
 	uint32_t dsp_buf;
 	uint32_t mem_map_handle;
+	struct apr_request map_req;
+	bool map_pending;
 };
 
 struct q6asm {
 	struct apr_device *adev;
 	struct device *dev;
 	struct q6core_svc_api_info ainfo;
-	wait_queue_head_t mem_wait;
 	spinlock_t slock;
 	struct audio_client *session[MAX_SESSIONS + 1];
 };
@@ -269,11 +312,11 @@ struct audio_client {
 	struct kref refcount;
 	/* idx:1 out port, 0: in port */
 	struct audio_port_data port[2];
-	wait_queue_head_t cmd_wait;
-	struct aprv2_ibasic_rsp_result_t result;
 	int perf_mode;
 	struct q6asm *q6asm;
 	struct device *dev;
+	/* position published by the DSP in shared io (push/pull) mode */
+	struct asm_shared_position_buffer *shared_pos;
 };
 
 static inline void q6asm_add_hdr(struct audio_client *ac, struct apr_hdr *hdr,
@@ -288,41 +331,36 @@ static inline void q6asm_add_hdr(struct audio_client *ac, struct apr_hdr *hdr,
 		hdr->token = ac->session;
 }
 
-static int q6asm_apr_send_session_pkt(struct q6asm *a, struct audio_client *ac,
-				      struct apr_pkt *pkt, uint32_t rsp_opcode)
+static int q6asm_apr_wait_session_pkt(struct q6asm *a,
+				      struct apr_request *req)
 {
-	struct apr_hdr *hdr = &pkt->hdr;
 	int rc;
 
-	mutex_lock(&ac->cmd_lock);
-	ac->result.opcode = 0;
-	ac->result.status = 0;
-	rc = apr_send_pkt(a->adev, pkt);
-	if (rc < 0)
-		goto err;
+	rc = apr_wait_request(a->adev, req, 5 * HZ);
+	if (rc < 0) {
+		dev_err(a->dev, "CMD %x timeout\n", req->opcode);
+		return rc;
+	}
 
-	if (rsp_opcode)
-		rc = wait_event_timeout(a->mem_wait,
-					(ac->result.opcode == hdr->opcode) ||
-					(ac->result.opcode == rsp_opcode),
-					5 * HZ);
-	else
-		rc = wait_event_timeout(a->mem_wait,
-					(ac->result.opcode == hdr->opcode),
-					5 * HZ);
-
-	if (!rc) {
-		dev_err(a->dev, "CMD %x timeout\n", hdr->opcode);
-		rc = -ETIMEDOUT;
-	} else if (ac->result.status > 0) {
-		dev_err(a->dev, "DSP returned error[%x]\n",
-			ac->result.status);
-		rc = -EINVAL;
+	if (req->status > 0) {
+		dev_err(a->dev, "DSP returned error[%x]\n", req->status);
+		return -EINVAL;
 	}
 
-err:
-	mutex_unlock(&ac->cmd_lock);
-	return rc;
+	return 0;
+}
+
+static int q6asm_apr_send_session_pkt(struct q6asm *a, struct apr_pkt *pkt,
+				      uint32_t rsp_opcode)
+{
+	struct apr_request req;
+	int rc;
+
+	rc = apr_send_pkt_async(a->adev, pkt, &req, rsp_opcode);
+	if (rc < 0)
+		return rc;
+
+	return q6asm_apr_wait_session_pkt(a, &req);
 }
 
 static int __q6asm_memory_unmap(struct audio_client *ac,
@@ -356,7 +394,7 @@ static int __q6asm_memory_unmap(struct audio_client *ac,
 	pkt->hdr.opcode = ASM_CMD_SHARED_MEM_UNMAP_REGIONS;
 	mem_unmap->mem_map_handle = ac->port[dir].mem_map_handle;
 
-	rc = q6asm_apr_send_session_pkt(a, ac, pkt, 0);
+	rc = q6asm_apr_send_session_pkt(a, pkt, 0);
 	if (rc < 0) {
 		kfree(pkt);
 		return rc;
@@ -478,8 +516,10 @@ static int __q6asm_memory_map_regions(struct audio_client *ac, int dir,
 	}
 	spin_unlock_irqrestore(&ac->lock, flags);
 
-	rc = q6asm_apr_send_session_pkt(a, ac, pkt,
-					ASM_CMDRSP_SHARED_MEM_MAP_REGIONS);
+	rc = apr_send_pkt_async(a->adev, pkt, &port->map_req,
+				ASM_CMDRSP_SHARED_MEM_MAP_REGIONS);
+	if (!rc)
+		port->map_pending = true;
 
 	kfree(pkt);
 
@@ -487,7 +527,7 @@ static int __q6asm_memory_map_regions(struct audio_client *ac, int dir,
 }
 
 /**
- * q6asm_map_memory_regions() - map memory regions in the dsp.
+ * q6asm_map_memory_regions_nowait() - start mapping memory regions in the dsp.
  *
  * @dir: direction of audio stream
  * @ac: audio client instanace
@@ -495,11 +535,15 @@ static int __q6asm_memory_map_regions(struct audio_client *ac, int dir,
  * @period_sz: audio period size
  * @periods: number of periods
  *
+ * Sends the map command without waiting for the DSP, so that the stream
+ * can be set up meanwhile. The mapping must be completed with
+ * q6asm_map_memory_regions_wait() before the buffers are used.
+ *
  * Return: Will be an negative value on failure or zero on success
  */
-int q6asm_map_memory_regions(unsigned int dir, struct audio_client *ac,
-			     phys_addr_t phys,
-			     size_t period_sz, unsigned int periods)
+int q6asm_map_memory_regions_nowait(unsigned int dir, struct audio_client *ac,
+				    phys_addr_t phys,
+				    size_t period_sz, unsigned int periods)
 {
 	struct audio_buffer *buf;
 	unsigned long flags;
@@ -543,6 +587,59 @@ int q6asm_map_memory_regions(unsigned int dir, struct audio_client *ac,
 
 	return rc;
 }
+EXPORT_SYMBOL_GPL(q6asm_map_memory_regions_nowait);
+
+/**
+ * q6asm_map_memory_regions_wait() - wait for memory regions to be mapped.
+ *
+ * @dir: direction of audio stream
+ * @ac: audio client instanace
+ *
+ * Return: Will be an negative value on failure or zero on success
+ */
+int q6asm_map_memory_regions_wait(unsigned int dir, struct audio_client *ac)
+{
+	struct q6asm *a = dev_get_drvdata(ac->dev->parent);
+	struct audio_port_data *port = &ac->port[dir];
+	int rc;
+
+	if (!port->map_pending)
+		return 0;
+
+	rc = q6asm_apr_wait_session_pkt(a, &port->map_req);
+	port->map_pending = false;
+	if (rc < 0) {
+		dev_err(ac->dev, "Memory_map_regions failed\n");
+		q6asm_audio_client_free_buf(ac, port);
+	}
+
+	return rc;
+}
+EXPORT_SYMBOL_GPL(q6asm_map_memory_regions_wait);
+
+/**
+ * q6asm_map_memory_regions() - map memory regions in the dsp.
+ *
+ * @dir: direction of audio stream
+ * @ac: audio client instanace
+ * @phys: physcial address that needs mapping.
+ * @period_sz: audio period size
+ * @periods: number of periods
+ *
+ * Return: Will be an negative value on failure or zero on success
+ */
+int q6asm_map_memory_regions(unsigned int dir, struct audio_client *ac,
+			     phys_addr_t phys,
+			     size_t period_sz, unsigned int periods)
+{
+	int rc;
+
+	rc = q6asm_map_memory_regions_nowait(dir, ac, phys, period_sz, periods);
+	if (rc < 0)
+		return rc;
+
+	return q6asm_map_memory_regions_wait(dir, ac);
+}
 EXPORT_SYMBOL_GPL(q6asm_map_memory_regions);
 
 static void q6asm_audio_client_release(struct kref *ref)
@@ -639,6 +736,8 @@ static int32_t q6asm_stream_callback(struct apr_device *adev,
 		case ASM_STREAM_CMD_OPEN_WRITE_V3:
 		case ASM_STREAM_CMD_OPEN_READ_V3:
 		case ASM_STREAM_CMD_OPEN_READWRITE_V2:
+		case ASM_STREAM_CMD_OPEN_PULL_MODE_WRITE:
+		case ASM_STREAM_CMD_OPEN_PUSH_MODE_READ:
 		case ASM_STREAM_CMD_SET_ENCDEC_PARAM:
 		case ASM_DATA_CMD_MEDIA_FMT_UPDATE_V2:
 		case ASM_DATA_CMD_REMOVE_INITIAL_SILENCE:
@@ -647,8 +746,6 @@ static int32_t q6asm_stream_callback(struct apr_device *adev,
 				dev_err(ac->dev,
 					"cmd = 0x%x returned error = 0x%x\n",
 					result->opcode, result->status);
-				ac->result = *result;
-				wake_up(&ac->cmd_wait);
 				ret = 0;
 				goto done;
 			}
@@ -659,9 +756,6 @@ static int32_t q6asm_stream_callback(struct apr_device *adev,
 			break;
 		}
 
-		ac->result = *result;
-		wake_up(&ac->cmd_wait);
-
 		if (ac->cb)
 			ac->cb(client_event, hdr->token,
 			       data->payload, ac->priv);
@@ -751,7 +845,6 @@ static int q6asm_srvc_callback(struct apr_device *adev,
 	struct audio_port_data *port;
 	struct audio_client *ac = NULL;
 	struct apr_hdr *hdr = &data->hdr;
-	struct q6asm *a;
 	uint32_t sid = 0;
 	uint32_t dir = 0;
 	int session_id;
@@ -767,7 +860,6 @@ static int q6asm_srvc_callback(struct apr_device *adev,
 		return 0;
 	}
 
-	a = dev_get_drvdata(ac->dev->parent);
 	dir = (hdr->token & 0x0F);
 	port = &ac->port[dir];
 	result = data->payload;
@@ -777,8 +869,7 @@ static int q6asm_srvc_callback(struct apr_device *adev,
 		switch (result->opcode) {
 		case ASM_CMD_SHARED_MEM_MAP_REGIONS:
 		case ASM_CMD_SHARED_MEM_UNMAP_REGIONS:
-			ac->result = *result;
-			wake_up(&a->mem_wait);
+			/* status is picked up from the apr request */
 			break;
 		default:
 			dev_err(&adev->dev, "command[0x%x] not expecting rsp\n",
@@ -787,16 +878,10 @@ static int q6asm_srvc_callback(struct apr_device *adev,
 		}
 		goto done;
 	case ASM_CMDRSP_SHARED_MEM_MAP_REGIONS:
-		ac->result.status = 0;
-		ac->result.opcode = hdr->opcode;
 		port->mem_map_handle = result->opcode;
-		wake_up(&a->mem_wait);
 		break;
 	case ASM_CMD_SHARED_MEM_UNMAP_REGIONS:
-		ac->result.opcode = hdr->opcode;
-		ac->result.status = 0;
 		port->mem_map_handle = 0;
-		wake_up(&a->mem_wait);
 		break;
 	default:
 		dev_dbg(&adev->dev, "command[0x%x]success [0x%x]\n",
@@ -869,7 +954,6 @@ struct audio_client *q6asm_audio_client_alloc(struct device *dev, q6asm_cb cb,
 	ac->adev = a->adev;
 	kref_init(&ac->refcount);
 
-	init_waitqueue_head(&ac->cmd_wait);
 	mutex_init(&ac->cmd_lock);
 	spin_lock_init(&ac->lock);
 
@@ -879,31 +963,23 @@ EXPORT_SYMBOL_GPL(q6asm_audio_client_alloc);
 
 static int q6asm_ac_send_cmd_sync(struct audio_client *ac, struct apr_pkt *pkt)
 {
-	struct apr_hdr *hdr = &pkt->hdr;
+	struct apr_request req;
 	int rc;
 
 	mutex_lock(&ac->cmd_lock);
-	ac->result.opcode = 0;
-	ac->result.status = 0;
-
-	rc = apr_send_pkt(ac->adev, pkt);
+	rc = apr_send_pkt_async(ac->adev, pkt, &req, 0);
 	if (rc < 0)
 		goto err;
 
-	rc = wait_event_timeout(ac->cmd_wait,
-				(ac->result.opcode == hdr->opcode), 5 * HZ);
-	if (!rc) {
-		dev_err(ac->dev, "CMD %x timeout\n", hdr->opcode);
-		rc =  -ETIMEDOUT;
+	rc = apr_wait_request(ac->adev, &req, 5 * HZ);
+	if (rc < 0) {
+		dev_err(ac->dev, "CMD %x timeout\n", req.opcode);
 		goto err;
 	}
 
-	if (ac->result.status > 0) {
-		dev_err(ac->dev, "DSP returned error[%x]\n",
-			ac->result.status);
+	if (req.status > 0) {
+		dev_err(ac->dev, "DSP returned error[%x]\n", req.status);
 		rc = -EINVAL;
-	} else {
-		rc = 0;
 	}
 
 
@@ -1005,6 +1081,121 @@ int q6asm_open_write(struct audio_client *ac, uint32_t stream_id,
 }
 EXPORT_SYMBOL_GPL(q6asm_open_write);
 
+/**
+ * q6asm_open_shared_io() - Open audio client in push/pull mode
+ * @ac: audio client pointer
+ * @stream_id: stream id of q6asm session
+ * @dir: direction of audio stream
+ * @cfg: shared buffers and pcm format of the stream
+ *
+ * Opens a linear pcm stream for which the DSP reads (playback) or writes
+ * (capture) the circular buffer on its own and publishes its position in
+ * the position buffer, instead of exchanging a data command and a done
+ * event per period. The DSP maps both buffers itself and drops the
+ * mappings when the stream is closed.
+ *
+ * Return: Will be an negative value on error or zero on success
+ */
+int q6asm_open_shared_io(struct audio_client *ac, uint32_t stream_id,
+			 unsigned int dir, struct q6asm_shared_io_cfg *cfg)
+{
+	struct asm_stream_cmd_open_shared_io *open;
+	struct apr_pkt *pkt;
+	int rc, pkt_size;
+	void *p;
+
+	if (cfg->bits_per_sample != 16 && cfg->bits_per_sample != 24)
+		return -EINVAL;
+
+	pkt_size = APR_HDR_SIZE + sizeof(*open);
+	p = kzalloc(pkt_size, GFP_KERNEL);
+	if (!p)
+		return -ENOMEM;
+
+	pkt = p;
+	open = p + APR_HDR_SIZE;
+	q6asm_add_hdr(ac, &pkt->hdr, pkt_size, true, stream_id);
+
+	if (dir == SNDRV_PCM_STREAM_PLAYBACK)
+		pkt->hdr.opcode = ASM_STREAM_CMD_OPEN_PULL_MODE_WRITE;
+	else
+		pkt->hdr.opcode = ASM_STREAM_CMD_OPEN_PUSH_MODE_READ;
+
+	open->endpoint_type = ASM_END_POINT_DEVICE_MATRIX;
+	open->topo_bits_per_sample = cfg->bits_per_sample;
+	open->topo_id = ASM_NULL_POPP_TOPOLOGY;
+	open->fmt_id = ASM_MEDIA_FMT_MULTI_CHANNEL_PCM_V2;
+
+	open->shared_pos_buf_addr_lsw = lower_32_bits(cfg->pos_phys);
+	open->shared_pos_buf_addr_msw = upper_32_bits(cfg->pos_phys);
+	open->shared_pos_buf_mem_pool_id = ADSP_MEMORY_MAP_SHMEM8_4K_POOL;
+	open->shared_pos_buf_num_regions = 1;
+	open->map_region_pos_buf.shm_addr_lsw = lower_32_bits(cfg->pos_phys);
+	open->map_region_pos_buf.shm_addr_msw = upper_32_bits(cfg->pos_phys);
+	open->map_region_pos_buf.mem_size_bytes = 4096;
+
+	open->shared_circ_buf_addr_lsw = lower_32_bits(cfg->buf_phys);
+	open->shared_circ_buf_addr_msw = upper_32_bits(cfg->buf_phys);
+	open->shared_circ_buf_size = cfg->buf_size;
+	open->shared_circ_buf_mem_pool_id = ADSP_MEMORY_MAP_SHMEM8_4K_POOL;
+	open->shared_circ_buf_num_regions = 1;
+	open->map_region_circ_buf.shm_addr_lsw = lower_32_bits(cfg->buf_phys);
+	open->map_region_circ_buf.shm_addr_msw = upper_32_bits(cfg->buf_phys);
+	/* DSP expects size should be aligned to 4K */
+	open->map_region_circ_buf.mem_size_bytes = ALIGN(cfg->buf_size, 4096);
+
+	open->fmt.num_channels = cfg->channels;
+	open->fmt.bits_per_sample = cfg->bits_per_sample;
+	open->fmt.sample_rate = cfg->rate;
+	open->fmt.is_signed = 1;
+	if (q6dsp_map_channels(open->fmt.channel_mapping, cfg->channels)) {
+		dev_err(ac->dev, " map channels failed %d\n", cfg->channels);
+		rc = -EINVAL;
+		goto err;
+	}
+
+	memset(cfg->pos, 0, sizeof(*ac->shared_pos));
+
+	rc = q6asm_ac_send_cmd_sync(ac, pkt);
+	if (rc < 0)
+		goto err;
+
+	ac->shared_pos = cfg->pos;
+
+err:
+	kfree(pkt);
+	return rc;
+}
+EXPORT_SYMBOL_GPL(q6asm_open_shared_io);
+
+/**
+ * q6asm_get_shared_io_pos() - get the DSP position of a push/pull stream
+ * @ac: audio client pointer
+ * @pos: returns the offset in bytes into the circular buffer
+ *
+ * Return: Will be an negative value on error or zero on success
+ */
+int q6asm_get_shared_io_pos(struct audio_client *ac, uint32_t *pos)
+{
+	struct asm_shared_position_buffer *sp = ac->shared_pos;
+	u32 frame_counter;
+	int retries = 2;
+
+	if (!sp)
+		return -EINVAL;
+
+	/* The DSP may update the buffer while we read it, retry if so */
+	do {
+		frame_counter = READ_ONCE(sp->frame_counter);
+		rmb();
+		*pos = READ_ONCE(sp->index);
+		rmb();
+	} while (frame_counter != READ_ONCE(sp->frame_counter) && --retries);
+
+	return retries ? 0 : -EBUSY;
+}
+EXPORT_SYMBOL_GPL(q6asm_get_shared_io_pos);
+
 static int __q6asm_run(struct audio_client *ac, uint32_t stream_id,
 		       uint32_t flags, uint32_t msw_ts, uint32_t lsw_ts,
 		       bool wait)
@@ -1671,6 +1862,9 @@ static int __q6asm_cmd(struct audio_client *ac, uint32_t stream_id, int cmd,
 	else
 		return apr_send_pkt(ac->adev, &pkt);
 
+	if (cmd == CMD_CLOSE)
+		ac->shared_pos = NULL;
+
 	if (rc < 0)
 		return rc;
 
@@ -1723,7 +1917,6 @@ static int q6asm_probe(struct apr_device *adev)
 
 	q6asm->dev = dev;
 	q6asm->adev = adev;
-	init_waitqueue_head(&q6asm->mem_wait);
 	spin_lock_init(&q6asm->slock);
 	dev_set_drvdata(dev, q6asm);
 
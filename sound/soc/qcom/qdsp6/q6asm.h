@@ -89,6 +89,26 @@ struct q6asm_ape_cfg {
 	u32 seek_table_present;
 };
 
+/**
+ * struct q6asm_shared_io_cfg - push/pull mode stream configuration
+ * @buf_phys: DSP address of the circular pcm buffer
+ * @buf_size: size of the circular pcm buffer in bytes
+ * @pos_phys: DSP address of the position buffer, a 4K page
+ * @pos: CPU address of the position buffer
+ * @rate: sample rate
+ * @channels: number of channels
+ * @bits_per_sample: bits per sample
+ */
+struct q6asm_shared_io_cfg {
+	phys_addr_t buf_phys;
+	uint32_t buf_size;
+	phys_addr_t pos_phys;
+	void *pos;
+	uint32_t rate;
+	uint32_t channels;
+	uint16_t bits_per_sample;
+};
+
 typedef void (*q6asm_cb) (uint32_t opcode, uint32_t token,
 			  void *payload, void *priv);
 struct audio_client;
@@ -104,6 +124,9 @@ int q6asm_open_write(struct audio_client *ac, uint32_t stream_id,
 
 int q6asm_open_read(struct audio_client *ac, uint32_t stream_id,
 		    uint32_t format, uint16_t bits_per_sample);
+int q6asm_open_shared_io(struct audio_client *ac, uint32_t stream_id,
+			 unsigned int dir, struct q6asm_shared_io_cfg *cfg);
+int q6asm_get_shared_io_pos(struct audio_client *ac, uint32_t *pos);
 int q6asm_enc_cfg_blk_pcm_format_support(struct audio_client *ac,
 					 uint32_t stream_id, uint32_t rate,
 					 uint32_t channels,
@@ -148,5 +171,10 @@ int q6asm_map_memory_regions(unsigned int dir,
 			     struct audio_client *ac,
 			     phys_addr_t phys,
 			     size_t bufsz, unsigned int bufcnt);
+int q6asm_map_memory_regions_nowait(unsigned int dir,
+				    struct audio_client *ac,
+				    phys_addr_t phys,
+				    size_t bufsz, unsigned int bufcnt);
+int q6asm_map_memory_regions_wait(unsigned int dir, struct audio_client *ac);
 int q6asm_unmap_memory_regions(unsigned int dir, struct audio_client *ac);
 #endif /* __Q6_ASM_H__ */